@@ -272,7 +272,7 @@ class CustomTask(emctask.Task,UserFuncs):
         self.io.status  = emctask.RCS_STATUS.RCS_DONE
         return 0
 
-    def emcToolSetNumber(self,number):
+    def emcToolSetNumber(self,number,toolno):
         if debug(): print "py:   emcToolSetNumber number =",number
         self.io.tool.toolInSpindle = number
         if self.tcpins:
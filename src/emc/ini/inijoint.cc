@@ -63,13 +63,42 @@ extern value_inihal_data old_inihal_data;
   emcJointSetHomingParams(int joint, double home, double offset, double home_vel, 
                           double search_vel, double latch_vel,
                           int use_index, int encoder_does_not_reset,
-                          int ignore_limits, int is_shared, int sequence, int volatile_home));
+                          int ignore_limits, int is_shared, int sequence, int home_after,
+                          int volatile_home));
   emcJointActivate(int joint);
   emcJointSetMaxVelocity(int joint, double vel);
   emcJointSetMaxAcceleration(int joint, double acc);
   emcJointLoadComp(int joint, const char * file, int comp_file_type);
   */
 
+/*
+  HOME_AFTER lists the joints, by number, that must be homed before
+  this one, separated by spaces or commas, or NONE. Returns them as a
+  joint mask.
+ */
+static int parseHomeAfter(const char *inistring, int *mask)
+{
+    const char *p = inistring;
+    char *end;
+    long jno;
+
+    *mask = 0;
+    while (isspace(*p)) p++;
+    if (strcasecmp(p, "NONE") == 0) {
+        return 0;
+    }
+    while (*p) {
+        jno = strtol(p, &end, 10);
+        if (end == p || jno < 0 || jno >= EMCMOT_MAX_JOINTS) {
+            return -1;
+        }
+        *mask |= 1 << jno;
+        p = end;
+        while (isspace(*p) || *p == ',') p++;
+    }
+    return 0;
+}
+
 static int loadJoint(int joint, EmcIniFile *jointIniFile)
 {
     char jointString[16];
@@ -88,6 +117,7 @@ static int loadJoint(int joint, EmcIniFile *jointIniFile)
     bool ignore_limits;
     bool is_shared;
     int sequence;
+    int home_after;
     int volatile_home;
     int locking_indexer;
     int absolute_encoder;
@@ -188,6 +218,15 @@ static int loadJoint(int joint, EmcIniFile *jointIniFile)
         jointIniFile->Find(&sequence, "HOME_SEQUENCE", jointString);
         old_inihal_data.joint_home_sequence[joint] = sequence;
 
+        home_after = -1;                // default: after lower sequences
+        if (NULL != (inistring = jointIniFile->Find("HOME_AFTER", jointString))) {
+            if (0 != parseHomeAfter(inistring, &home_after)) {
+                rcs_print_error("invalid [%s]HOME_AFTER=%s\n",
+                                jointString, inistring);
+                return -1;
+            }
+        }
+
         volatile_home = 0;	        // default
         jointIniFile->Find(&volatile_home, "VOLATILE_HOME", jointString);
         locking_indexer = false;
@@ -202,6 +241,7 @@ static int loadJoint(int joint, EmcIniFile *jointIniFile)
                                         ,(int)ignore_limits
                                         ,(int)is_shared
                                         ,sequence
+                                        ,home_after
                                         ,volatile_home
                                         ,locking_indexer
                                         ,absolute_encoder
@@ -30,10 +30,13 @@
   Loads ini file params for spindle from [EMCIO] section
 
   TOOL_TABLE <file name>  name of tool table file
+  TOOL_DATABASE <file name>  name of tool database, used instead of the
+                             tool table file if given
 
   calls:
 
   emcToolSetToolTableFile(const char filename);
+  emcToolSetToolDatabaseFile(const char filename);
   */
 
 static int loadTool(IniFile *toolInifile)
@@ -49,6 +52,13 @@ static int loadTool(IniFile *toolInifile)
     }
     // else ignore omission
 
+    if (NULL != (inistring = toolInifile->Find("TOOL_DATABASE", "EMCIO"))) {
+	if (0 != emcToolSetToolDatabaseFile(inistring)) {
+	    rcs_print("bad return value from emcToolSetToolDatabaseFile\n");
+	    retval = -1;
+	}
+    }
+
     return retval;
 }
 
@@ -153,3 +163,15 @@ int emcToolSetToolTableFile(const char *filename)
     }
     return 0;
 }
+
+int emcToolSetToolDatabaseFile(const char *filename)
+{
+    strncpy(tool_database_file, filename, sizeof(tool_database_file));
+    if (tool_database_file[sizeof(tool_database_file)-1] != '\0') {
+        rcs_print("Tool Database File name too long, max %zu characters.\n", sizeof(tool_database_file)-1);
+        rcs_print("Requested Tool Database File name was: %s\n", filename);
+        tool_database_file[0] = '\0';
+        return -1;
+    }
+    return 0;
+}
@@ -69,6 +69,9 @@
 #include "timer.hh"
 #include "rcs_print.hh"
 #include "tool_parse.h"
+#ifdef HAVE_SQLITE3
+#include "toolstore.hh"
+#endif
 
 static RCS_CMD_CHANNEL *emcioCommandBuffer = 0;
 static RCS_CMD_MSG *emcioCommand = 0;
@@ -78,6 +81,11 @@ static NML *emcErrorBuffer = 0;
 
 static char *ttcomments[CANON_POCKETS_MAX];
 static int random_toolchanger = 0;
+#ifdef HAVE_SQLITE3
+static ToolStore *tool_store;	/* [EMCIO]TOOL_DATABASE, if given */
+static int shown_pocket;	/* pocket the status shows besides the spindle */
+static int shown_magazine;	/* the magazine pocket it shows */
+#endif
 
 
 struct iocontrol_str {
@@ -522,7 +530,138 @@ int read_hal_inputs(void)
     return retval;
 }
 
+#ifdef HAVE_SQLITE3
+static void clear_tool_slot(int pocket)
+{
+    CANON_TOOL_TABLE &tool = emcioStatus.tool.toolTable[pocket];
+
+    tool.toolno = -1;
+    tool.pocketno = -1;
+    ZERO_EMC_POSE(tool.offset);
+    tool.diameter = 0.0;
+    tool.frontangle = 0.0;
+    tool.backangle = 0.0;
+    tool.orientation = 0;
+}
+
+/*
+  With a tool database the status does not carry the whole magazine, only
+  the tool in the spindle and the tool in the pocket last prepped. Task
+  reads the rest from the database. These copy tools from the database
+  to the status.
+
+  The magazine may have more pockets than the status, so task may have
+  put a tool from any magazine pocket in a pocket of its tool table. The
+  tool number in the command says which magazine pocket it is.
+*/
+static void fill_tool_slot(int pocket, int magazine)
+{
+    const CANON_TOOL_TABLE *tool = tool_store->find_pocket(magazine);
+
+    if (tool) {
+        emcioStatus.tool.toolTable[pocket] = *tool;
+    } else {
+        clear_tool_slot(pocket);
+    }
+}
+
+static void show_tool_slot(int pocket, int magazine)
+{
+    if (pocket < 0 || pocket >= CANON_POCKETS_MAX) {
+        return;
+    }
+    if (shown_pocket > 0) {
+        clear_tool_slot(shown_pocket);
+    }
+    shown_pocket = pocket;
+    shown_magazine = magazine;
+    if (pocket > 0) {
+        fill_tool_slot(pocket, magazine);
+    }
+}
+
+/* the magazine pocket of toolno, which task has in pocket */
+static int magazine_pocket(int pocket, int toolno)
+{
+    const CANON_TOOL_TABLE *tool = tool_store->find_tool(toolno);
+
+    if (pocket > 0 && tool && tool->pocketno >= 0) {
+        return tool->pocketno;
+    }
+    return pocket;
+}
+
+/* the magazine pocket shown as pocket */
+static int shown_magazine_pocket(int pocket)
+{
+    return pocket == shown_pocket ? shown_magazine : pocket;
+}
+
+/*
+  Fills an empty tool database from the tool table file, so a machine can
+  switch to a database without entering its tools again.
+*/
+static int import_tool_table(const char *filename)
+{
+    CANON_TOOL_TABLE table[CANON_POCKETS_MAX];
+    int t, retval = 0;
+
+    if (0 != loadToolTable(filename, table, ttcomments, random_toolchanger)) {
+        return -1;
+    }
+    if (0 != tool_store->begin()) {
+        return -1;
+    }
+    for (t = random_toolchanger? 0: 1; t < CANON_POCKETS_MAX; t++) {
+        CANON_TOOL_TABLE tool = table[t];
+
+        if (tool.toolno <= 0) {
+            continue;
+        }
+        if (tool_store->find_pocket(tool.pocketno)) {
+            rtapi_print_msg(RTAPI_MSG_ERR, "tool %d: pocket %d is taken, not putting it in the magazine\n",
+                            tool.toolno, tool.pocketno);
+            tool.pocketno = -1;
+        }
+        if (0 != tool_store->put(tool, ttcomments[t])) {
+            retval = -1;
+        }
+    }
+    if (0 != tool_store->commit()) {
+        tool_store->rollback();
+        return -1;
+    }
+    rtapi_print_msg(RTAPI_MSG_INFO, "imported %d tools from %s into %s\n",
+                    tool_store->size(), filename, tool_database_file);
+    return retval;
+}
+#endif
+
 void load_tool(int pocket) {
+#ifdef HAVE_SQLITE3
+    if (tool_store) {
+        int magazine = shown_magazine_pocket(pocket);
+
+        if (random_toolchanger) {
+            // swap the tools between the desired pocket and the spindle pocket
+            if (0 != tool_store->swap_pockets(0, magazine))
+                emcioStatus.status = RCS_ERROR;
+            fill_tool_slot(0, 0);
+            show_tool_slot(pocket, magazine);
+        } else if (pocket == 0) {
+            clear_tool_slot(0);
+            emcioStatus.tool.toolTable[0].toolno = 0;
+        } else {
+            show_tool_slot(pocket, magazine);
+            emcioStatus.tool.toolTable[0] = emcioStatus.tool.toolTable[pocket];
+        }
+        if (0 != tool_store->set_spindle(emcioStatus.tool.toolTable[0].toolno,
+                                         random_toolchanger? 0: magazine))
+            emcioStatus.status = RCS_ERROR;
+        return;
+    }
+#endif
+
     if(random_toolchanger) {
         // swap the tools between the desired pocket and the spindle pocket
         CANON_TOOL_TABLE temp;
@@ -555,6 +694,15 @@ void load_tool(int pocket) {
 
 void reload_tool_number(int toolno) {
     if(random_toolchanger) return; // doesn't need special handling here
+#ifdef HAVE_SQLITE3
+    if (tool_store) {
+        const CANON_TOOL_TABLE *tool = tool_store->find_tool(toolno);
+        if (tool) {
+            emcioStatus.tool.toolTable[0] = *tool;
+        }
+        return;
+    }
+#endif
     for(int i=1; i<CANON_POCKETS_MAX; i++) {
         if(emcioStatus.tool.toolTable[i].toolno == toolno) {
             load_tool(i);
@@ -563,6 +711,27 @@ void reload_tool_number(int toolno) {
     }
 }
 
+#ifdef HAVE_SQLITE3
+/*
+  Reads the tool database again, after it was changed by someone else.
+*/
+static int reload_tool_database(void)
+{
+    if (0 != tool_store->load()) {
+        return -1;
+    }
+    if (random_toolchanger) {
+        fill_tool_slot(0, 0);
+    } else {
+        reload_tool_number(emcioStatus.tool.toolInSpindle);
+    }
+    if (shown_pocket > 0) {
+        fill_tool_slot(shown_pocket, shown_magazine);
+    }
+    return 0;
+}
+#endif
+
 
 /********************************************************************
 *
@@ -696,6 +865,29 @@ int main(int argc, char *argv[])
         ttcomments[0][0] = '\0';
     }
 
+#ifndef HAVE_SQLITE3
+    if (tool_database_file[0]) {
+        rcs_print_error("can't open tool database %s, built without sqlite3.\n", tool_database_file);
+        return -1;
+    }
+#else
+    if (tool_database_file[0]) {
+        tool_store = new ToolStore;
+        if (0 != tool_store->open(tool_database_file)) {
+            rcs_print_error("can't open tool database %s.\n", tool_database_file);
+            return -1;
+        }
+        if (tool_store->size() == 0 && 0 != import_tool_table(tool_table_file)) {
+            rcs_print_error("can't import tool table %s.\n", tool_table_file);
+        }
+        for (t = 0; t < CANON_POCKETS_MAX; t++) {
+            clear_tool_slot(t);
+        }
+        if (random_toolchanger) {
+            fill_tool_slot(0, 0);
+        }
+    } else
+#endif
     if (0 != loadToolTable(tool_table_file, emcioStatus.tool.toolTable,
 		ttcomments, random_toolchanger)) {
 	rcs_print_error("can't load tool table.\n");
@@ -708,6 +900,17 @@ int main(int argc, char *argv[])
     emcioStatus.tool.pocketPrepped = -1;
     if (random_toolchanger) {
         emcioStatus.tool.toolInSpindle = emcioStatus.tool.toolTable[0].toolno;
+#ifdef HAVE_SQLITE3
+    } else if (tool_store && tool_store->spindle_tool() > 0) {
+        // the database knows what was left in the spindle, unless the
+        // tool was removed since
+        reload_tool_number(tool_store->spindle_tool());
+        if (emcioStatus.tool.toolTable[0].toolno == tool_store->spindle_tool()) {
+            emcioStatus.tool.toolInSpindle = tool_store->spindle_tool();
+        } else {
+            emcioStatus.tool.toolInSpindle = 0;
+        }
+#endif
     } else {
         emcioStatus.tool.toolInSpindle = 0;
     }
@@ -770,6 +973,12 @@ int main(int argc, char *argv[])
 
 	case EMC_TOOL_INIT_TYPE:
 	    rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_INIT\n");
+#ifdef HAVE_SQLITE3
+	    if (tool_store) {
+		reload_tool_database();
+		break;
+	    }
+#endif
 	    loadToolTable(tool_table_file, emcioStatus.tool.toolTable,
 		    ttcomments, random_toolchanger);
 	    reload_tool_number(emcioStatus.tool.toolInSpindle);
@@ -795,11 +1004,19 @@ int main(int argc, char *argv[])
             {
                 signed int p = ((EMC_TOOL_PREPARE*)emcioCommand)->pocket;
                 int t = ((EMC_TOOL_PREPARE*)emcioCommand)->tool;
+                int magazine = p;
                 rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_PREPARE tool=%d pocket=%d\n", t, p);
 
+#ifdef HAVE_SQLITE3
+                if (tool_store) {
+                    magazine = magazine_pocket(p, t);
+                    show_tool_slot(p, magazine);
+                }
+#endif
+
                 // Set HAL pins/params for tool number, pocket, and index.
                 iocontrol_data->tool_prep_index = p;
-                *(iocontrol_data->tool_prep_pocket) = random_toolchanger? p: emcioStatus.tool.toolTable[p].pocketno;
+                *(iocontrol_data->tool_prep_pocket) = random_toolchanger? magazine: emcioStatus.tool.toolTable[p].pocketno;
                 if(!random_toolchanger && p == 0) {//unload spindle
                     *(iocontrol_data->tool_prep_number) = 0;
 					*(iocontrol_data->tool_prep_pocket) = 0;
@@ -860,6 +1077,13 @@ int main(int argc, char *argv[])
 		    ((EMC_TOOL_LOAD_TOOL_TABLE *) emcioCommand)->file;
 		if(!strlen(filename)) filename = tool_table_file;
 		rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_LOAD_TOOL_TABLE\n");
+#ifdef HAVE_SQLITE3
+		if (tool_store) {
+		    // the database is the tool table
+		    if (0 != reload_tool_database())
+			emcioStatus.status = RCS_ERROR;
+		} else
+#endif
 		if (0 != loadToolTable(filename, emcioStatus.tool.toolTable,
 				  ttcomments, random_toolchanger))
 		    emcioStatus.status = RCS_ERROR;
@@ -887,6 +1111,33 @@ int main(int argc, char *argv[])
                                 " frontangle=%lf, backangle=%lf, orientation=%d\n",
                                 p, t, offs.tran.z, offs.tran.x, d, f, b, o);
 
+#ifdef HAVE_SQLITE3
+                if (tool_store) {
+                    // save just this tool
+                    const CANON_TOOL_TABLE *old = tool_store->find_tool(t);
+                    CANON_TOOL_TABLE tool;
+
+                    tool.toolno = t;
+                    tool.pocketno = old? old->pocketno: p;
+                    tool.offset = offs;
+                    tool.diameter = d;
+                    tool.frontangle = f;
+                    tool.backangle = b;
+                    tool.orientation = o;
+                    if (0 != tool_store->put(tool)) {
+                        emcioStatus.status = RCS_ERROR;
+                        break;
+                    }
+                    if (shown_pocket > 0) {
+                        fill_tool_slot(shown_pocket, shown_magazine);
+                    }
+                    if (emcioStatus.tool.toolInSpindle == t) {
+                        emcioStatus.tool.toolTable[0] = tool;
+                    }
+                    break;
+                }
+#endif
+
                 emcioStatus.tool.toolTable[p].toolno = t;
                 emcioStatus.tool.toolTable[p].offset = offs;
                 emcioStatus.tool.toolTable[p].diameter = d;
@@ -907,6 +1158,12 @@ int main(int argc, char *argv[])
 		int pocket_number;
 		
 		pocket_number = ((EMC_TOOL_SET_NUMBER *) emcioCommand)->tool;
+#ifdef HAVE_SQLITE3
+		if (tool_store) {
+		    show_tool_slot(pocket_number, magazine_pocket(pocket_number,
+				   ((EMC_TOOL_SET_NUMBER *) emcioCommand)->toolno));
+		}
+#endif
 		rtapi_print_msg(RTAPI_MSG_DBG, "EMC_TOOL_SET_NUMBER old_loaded_tool=%d new_pocket_number=%d new_tool=%d\n", emcioStatus.tool.toolInSpindle, pocket_number, emcioStatus.tool.toolTable[pocket_number].toolno);
                 load_tool(pocket_number);
 		emcioStatus.tool.toolInSpindle = emcioStatus.tool.toolTable[pocket_number].toolno;
@@ -1018,6 +1275,9 @@ int main(int argc, char *argv[])
     for(int i=0; i<CANON_POCKETS_MAX; i++) {
         free(ttcomments[i]);
     }
+#ifdef HAVE_SQLITE3
+    delete tool_store;
+#endif
 
     return 0;
 }
@@ -18,22 +18,29 @@
 #include "hal.h"
 #include "rtapi_math.h"
 
-#define d2r(d) ((d)*PM_PI/180.0)
-#define r2d(r) ((r)*180.0/PM_PI)
+#include "trtfuncs.h"
 
 struct haldata {
     hal_float_t *pivot_length;
+    hal_float_t *tool_offset;
 } *haldata;
 
-static PmCartesian s2r(double r, double t, double p) {
-    PmCartesian c;
-    t = d2r(t), p = d2r(p);
+/* trig of the last B and C seen, shared by forward and inverse */
+static trt_angle_t b_trig, c_trig;
 
-    c.x = r * sin(p) * cos(t);
-    c.y = r * sin(p) * sin(t);
-    c.z = r * cos(p);
+/* Where the tool tip is relative to the pivot, for a tool r from the
+   pivot tilted by B and turned by C. The tool length lengthens the
+   arm, so the tool tip is the controlled point (TCP). */
+static PmCartesian tool_arm(double r, double b, double c) {
+    PmCartesian arm;
 
-    return c;
+    trt_angle(&b_trig, b);
+    trt_angle(&c_trig, c);
+    arm.x = r * b_trig.s * c_trig.c;
+    arm.y = r * b_trig.s * c_trig.s;
+    arm.z = -r * b_trig.c;
+
+    return arm;
 }
 
 
@@ -51,13 +58,14 @@ int kinematicsForward(const double *joints,
 		      const KINEMATICS_FORWARD_FLAGS * fflags,
 		      KINEMATICS_INVERSE_FLAGS * iflags)
 {
-    PmCartesian r = s2r(*(haldata->pivot_length)+ joints[JOINT_W]
-                       ,joints[JOINT_C]
-                       ,180.0 - joints[JOINT_B]);
+    double pivot = *(haldata->pivot_length) + *(haldata->tool_offset);
+    PmCartesian r = tool_arm(pivot + joints[JOINT_W]
+                            ,joints[JOINT_B]
+                            ,joints[JOINT_C]);
 
     pos->tran.x = joints[JOINT_0] + r.x;
     pos->tran.y = joints[JOINT_1] + r.y;
-    pos->tran.z = joints[JOINT_2] + *(haldata->pivot_length) + r.z;
+    pos->tran.z = joints[JOINT_2] + pivot + r.z;
     pos->b      = joints[JOINT_B];
     pos->c      = joints[JOINT_C];
     pos->w      = joints[JOINT_W];
@@ -74,14 +82,14 @@ int kinematicsInverse(const EmcPose * pos,
 		      const KINEMATICS_INVERSE_FLAGS * iflags,
 		      KINEMATICS_FORWARD_FLAGS * fflags)
 {
-
-    PmCartesian r = s2r(*(haldata->pivot_length) + pos->w
-                       ,pos->c
-                       ,180.0 - pos->b);
+    double pivot = *(haldata->pivot_length) + *(haldata->tool_offset);
+    PmCartesian r = tool_arm(pivot + pos->w
+                            ,pos->b
+                            ,pos->c);
 
     joints[JOINT_0] = pos->tran.x - r.x;
     joints[JOINT_1] = pos->tran.y - r.y;
-    joints[JOINT_2] = pos->tran.z - *(haldata->pivot_length) - r.z;
+    joints[JOINT_2] = pos->tran.z - pivot - r.z;
 
     joints[JOINT_B] = pos->b;
     joints[JOINT_C] = pos->c;
@@ -126,6 +134,8 @@ int rtapi_app_main(void) {
 
     result = hal_pin_float_new("5axiskins.pivot-length", HAL_IO, &(haldata->pivot_length), comp_id);
     if(result < 0) goto error;
+    result = hal_pin_float_new("5axiskins.tool-offset", HAL_IN, &(haldata->tool_offset), comp_id);
+    if(result < 0) goto error;
 
     *(haldata->pivot_length) = 250.0;
 
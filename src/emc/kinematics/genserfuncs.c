@@ -0,0 +1,679 @@
+/********************************************************************
+* Description: genserfuncs.c
+*   Math for the generalised serial kinematics, split out of
+*   genserkins.c so it can be used without the HAL glue
+*
+*   Derived from a work by Fred Proctor,
+*   changed to work with emc2 and HAL
+*
+* Adapting Author: Alex Joni
+* License: GPL Version 2
+* System: Linux
+*    
+*******************************************************************
+
+  There are two sets of functions here. The generic ones work on any
+  go_link chain using the go_* pose math, and are what genserkins has
+  always used. The fast ones work on a pure DH chain whose constant
+  parts were cached by genser_kin_precompute(): each link transform is
+  built from one sincos() of the joint and composed as a 3x4 matrix,
+  and the inverse takes its Jacobian from the same pass that gives the
+  pose, solving each Newton step directly instead of inverting the
+  Jacobian. Both sets converge to the same answer within the go_*
+  tolerances; unit_tests/kinematics compares them.
+*/
+
+#include "rtapi_math.h"
+#include "sincos.h"
+#include "gotypes.h"		/* go_result, go_integer */
+#include "gomath.h"		/* go_pose */
+#include "genserkins.h"		/* these decls */
+
+/* compute the forward jacobian function: 
+   the jacobian is a linear aproximation of the kinematics function.
+   It is calculated using derivation of the position transformation matrix, 
+   and usually used for feeding velocities through it.
+   It is analytically possible to calculate the inverse of the jacobian 
+   (sometimes only the pseudoinverse) and to use that for the inverse kinematics.
+*/
+static int compute_jfwd(go_link * link_params, 
+		        int link_number, 
+			go_matrix * Jfwd, 
+			go_pose * T_L_0) 
+{
+    GO_MATRIX_DECLARE(Jv, Jvstg, 3, GENSER_MAX_JOINTS);
+    GO_MATRIX_DECLARE(Jw, Jwstg, 3, GENSER_MAX_JOINTS);
+    GO_MATRIX_DECLARE(R_i_ip1, R_i_ip1stg, 3, 3);
+    GO_MATRIX_DECLARE(scratch, scratchstg, 3, GENSER_MAX_JOINTS);
+    GO_MATRIX_DECLARE(R_inv, R_invstg, 3, 3);
+    go_pose pose;
+    go_quat quat;
+    go_vector P_ip1_i[3];
+    int row, col;
+
+    /* init matrices to possibly smaller size */
+    go_matrix_init(Jv, Jvstg, 3, link_number);
+    go_matrix_init(Jw, Jwstg, 3, link_number);
+    go_matrix_init(R_i_ip1, R_i_ip1stg, 3, 3);
+    go_matrix_init(scratch, scratchstg, 3, link_number);
+    go_matrix_init(R_inv, R_invstg, 3, 3);
+
+    Jv.el[0][0] = 0, Jv.el[1][0] = 0, Jv.el[2][0] = (GO_QUANTITY_LENGTH == link_params[0].quantity ? 1 : 0);
+    Jw.el[0][0] = 0, Jw.el[1][0] = 0, Jw.el[2][0] = (GO_QUANTITY_ANGLE == link_params[0].quantity ? 1 : 0);
+
+    /* initialize inverse rotational transform */
+    if (GO_LINK_DH == link_params[0].type) {
+	go_dh_pose_convert(&link_params[0].u.dh, &pose);
+    } else if (GO_LINK_PP == link_params[0].type) {
+	pose = link_params[0].u.pp.pose;
+    } else {
+	return GO_RESULT_IMPL_ERROR;
+    }
+
+    *T_L_0 = pose;
+
+    for (col = 1; col < link_number; col++) {
+	/* T_ip1_i */
+	if (GO_LINK_DH == link_params[col].type) {
+	    go_dh_pose_convert(&link_params[col].u.dh, &pose);
+	} else if (GO_LINK_PP == link_params[col].type) {
+	    pose = link_params[col].u.pp.pose;
+	} else {
+	    return GO_RESULT_IMPL_ERROR;
+	}
+
+	go_cart_vector_convert(&pose.tran, P_ip1_i);
+	go_quat_inv(&pose.rot, &quat);
+	go_quat_matrix_convert(&quat, &R_i_ip1);
+
+	/* Jv */
+	go_matrix_vector_cross(&Jw, P_ip1_i, &scratch);
+	go_matrix_matrix_add(&Jv, &scratch, &scratch);
+	go_matrix_matrix_mult(&R_i_ip1, &scratch, &Jv);
+	Jv.el[0][col] = 0, Jv.el[1][col] = 0, Jv.el[2][col] = (GO_QUANTITY_LENGTH == link_params[col].quantity ? 1 : 0);
+	/* Jw */
+	go_matrix_matrix_mult(&R_i_ip1, &Jw, &Jw);
+	Jw.el[0][col] = 0, Jw.el[1][col] = 0, Jw.el[2][col] = (GO_QUANTITY_ANGLE == link_params[col].quantity ? 1 : 0);
+	if (GO_LINK_DH == link_params[col].type) {
+	    go_dh_pose_convert(&link_params[col].u.dh, &pose);
+	} else if (GO_LINK_PP == link_params[col].type) {
+	    pose = link_params[col].u.pp.pose;
+	} else {
+	    return GO_RESULT_IMPL_ERROR;
+	}
+	go_pose_pose_mult(T_L_0, &pose, T_L_0);
+    }
+
+    /* rotate back into {0} frame */
+    go_quat_matrix_convert(&T_L_0->rot, &R_inv);
+    go_matrix_matrix_mult(&R_inv, &Jv, &Jv);
+    go_matrix_matrix_mult(&R_inv, &Jw, &Jw);
+
+    /* put Jv atop Jw in J */
+    for (row = 0; row < 6; row++) {
+	for (col = 0; col < link_number; col++) {
+	    if (row < 3) {
+		Jfwd->el[row][col] = Jv.el[row][col];
+	    } else {
+		Jfwd->el[row][col] = Jw.el[row - 3][col];
+	    }
+	}
+    }
+
+    return GO_RESULT_OK;
+}
+
+/* compute the inverse of the jacobian matrix */
+static int compute_jinv(go_matrix * Jfwd, go_matrix * Jinv)
+{
+    int retval;
+    GO_MATRIX_DECLARE(JT, JTstg, GENSER_MAX_JOINTS, 6);
+
+    /* compute inverse, or pseudo-inverse */
+    if (Jfwd->rows == Jfwd->cols) {
+	retval = go_matrix_inv(Jfwd, Jinv);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+    } else if (Jfwd->rows < Jfwd->cols) {
+	/* underdetermined, optimize on smallest sum of square of speeds */
+	/* JT(JJT)inv */
+	GO_MATRIX_DECLARE(JJT, JJTstg, 6, 6);
+
+	go_matrix_init(JT, JTstg, Jfwd->cols, Jfwd->rows);
+	go_matrix_init(JJT, JJTstg, Jfwd->rows, Jfwd->rows);
+	go_matrix_transpose(Jfwd, &JT);
+	go_matrix_matrix_mult(Jfwd, &JT, &JJT);
+	retval = go_matrix_inv(&JJT, &JJT);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+	go_matrix_matrix_mult(&JT, &JJT, Jinv);
+    } else {
+	/* overdetermined, do least-squares best fit */
+	/* (JTJ)invJT */
+	GO_MATRIX_DECLARE(JTJ, JTJstg, GENSER_MAX_JOINTS, GENSER_MAX_JOINTS);
+
+	go_matrix_init(JT, JTstg, Jfwd->cols, Jfwd->rows);
+	go_matrix_init(JTJ, JTJstg, Jfwd->cols, Jfwd->cols);
+	go_matrix_transpose(Jfwd, &JT);
+	go_matrix_matrix_mult(&JT, Jfwd, &JTJ);
+	retval = go_matrix_inv(&JTJ, &JTJ);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+	go_matrix_matrix_mult(&JTJ, &JT, Jinv);
+    }
+
+    return GO_RESULT_OK;
+}
+
+int genser_kin_jac_inv(void *kins,
+    const go_pose * pos,
+    const go_screw * vel, const go_real * joints, go_real * jointvels)
+{
+    genser_struct *genser = (genser_struct *) kins;
+    GO_MATRIX_DECLARE(Jfwd, Jfwd_stg, 6, GENSER_MAX_JOINTS);
+    GO_MATRIX_DECLARE(Jinv, Jinv_stg, GENSER_MAX_JOINTS, 6);
+    go_pose T_L_0;
+    go_link linkout[GENSER_MAX_JOINTS];
+    go_real vw[6];
+    int link;
+    int retval;
+
+    go_matrix_init(Jfwd, Jfwd_stg, 6, genser->link_num);
+    go_matrix_init(Jinv, Jinv_stg, GENSER_MAX_JOINTS, 6);
+
+    for (link = 0; link < genser->link_num; link++) {
+	retval =
+	    go_link_joint_set(&genser->links[link], joints[link],
+	    &linkout[link]);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+    }
+    retval = compute_jfwd(linkout, genser->link_num, &Jfwd, &T_L_0);
+    if (GO_RESULT_OK != retval)
+	return retval;
+    retval = compute_jinv(&Jfwd, &Jinv);
+    if (GO_RESULT_OK != retval)
+	return retval;
+
+    vw[0] = vel->v.x;
+    vw[1] = vel->v.y;
+    vw[2] = vel->v.z;
+    vw[3] = vel->w.x;
+    vw[4] = vel->w.y;
+    vw[5] = vel->w.z;
+
+    return go_matrix_vector_mult(&Jinv, vw, jointvels);
+}
+
+int genser_kin_jac_fwd(void *kins,
+    const go_real * joints,
+    const go_real * jointvels, const go_pose * pos, go_screw * vel)
+{
+    genser_struct *genser = (genser_struct *) kins;
+    GO_MATRIX_DECLARE(Jfwd, Jfwd_stg, 6, GENSER_MAX_JOINTS);
+    go_pose T_L_0;
+    go_link linkout[GENSER_MAX_JOINTS];
+    go_real vw[6];
+    int link;
+    int retval;
+
+    go_matrix_init(Jfwd, Jfwd_stg, 6, genser->link_num);
+
+    for (link = 0; link < genser->link_num; link++) {
+	retval =
+	    go_link_joint_set(&genser->links[link], joints[link],
+	    &linkout[link]);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+    }
+
+    retval = compute_jfwd(linkout, genser->link_num, &Jfwd, &T_L_0);
+    if (GO_RESULT_OK != retval)
+	return retval;
+
+    go_matrix_vector_mult(&Jfwd, jointvels, vw);
+    vel->v.x = vw[0];
+    vel->v.y = vw[1];
+    vel->v.z = vw[2];
+    vel->w.x = vw[3];
+    vel->w.y = vw[4];
+    vel->w.z = vw[5];
+
+    return GO_RESULT_OK;
+}
+
+
+int genser_kin_fwd(void *kins, const go_real * joints, go_pose * pos)
+{
+    genser_struct *genser = kins;
+    go_link linkout[GENSER_MAX_JOINTS];
+
+    int link;
+    int retval;
+
+    for (link = 0; link < genser->link_num; link++) {
+	retval = go_link_joint_set(&genser->links[link], joints[link], &linkout[link]);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+    }
+
+    retval = go_link_pose_build(linkout, genser->link_num, pos);
+    if (GO_RESULT_OK != retval)
+	return retval;
+
+    return GO_RESULT_OK;
+}
+
+/*
+  Generic inverse kinematics by Newton iteration on the inverse
+  Jacobian, for any chain go_link_pose_build() can handle. \a joints
+  holds the initial estimate on entry.
+*/
+int genser_kin_inv(void *kins, const go_pose * pos, go_real * joints)
+{
+    genser_struct *genser = kins;
+    GO_MATRIX_DECLARE(Jfwd, Jfwd_stg, 6, GENSER_MAX_JOINTS);
+    GO_MATRIX_DECLARE(Jinv, Jinv_stg, GENSER_MAX_JOINTS, 6);
+    go_pose T_L_0;
+    go_real dvw[6];
+    go_real jest[GENSER_MAX_JOINTS];
+    go_real dj[GENSER_MAX_JOINTS];
+    go_pose pest, pestinv, Tdelta;
+    go_rvec rvec;
+    go_cart cart;
+    go_link linkout[GENSER_MAX_JOINTS];
+    int link;
+    int smalls;
+    int retval;
+
+    go_matrix_init(Jfwd, Jfwd_stg, 6, genser->link_num);
+    go_matrix_init(Jinv, Jinv_stg, genser->link_num, 6);
+
+    /* jest[] is a copy of joints[], which is the joint estimate */
+    for (link = 0; link < genser->link_num; link++) {
+	jest[link] = joints[link];
+    }
+
+    for (genser->iterations = 0; genser->iterations < genser->max_iterations; genser->iterations++) {
+	/* update the Jacobians */
+	for (link = 0; link < genser->link_num; link++) {
+	    go_link_joint_set(&genser->links[link], jest[link], &linkout[link]);
+	}
+	retval = compute_jfwd(linkout, genser->link_num, &Jfwd, &T_L_0);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+	retval = compute_jinv(&Jfwd, &Jinv);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+
+	/* pest is the resulting pose estimate given joint estimate */
+	genser_kin_fwd(genser, jest, &pest);
+	/* pestinv is its inverse */
+	go_pose_inv(&pest, &pestinv);
+	/*
+	    Tdelta is the incremental pose from pest to pos, such that
+
+	    0        L         0
+	    . pest *  Tdelta =  pos, or
+	    L        L         L
+
+	    L         L          0
+	    .Tdelta =  pestinv *  pos
+	    L         0          L
+	*/
+	go_pose_pose_mult(&pestinv, pos, &Tdelta);
+
+	/*
+	    We need Tdelta in 0 frame, not pest frame, so rotate it
+    	    back. Since it's effectively a velocity, we just rotate it, and
+    	    don't translate it.
+        */
+
+        /* first rotate the translation differential */
+        go_quat_cart_mult(&pest.rot, &Tdelta.tran, &cart);
+        dvw[0] = cart.x;
+        dvw[1] = cart.y;
+        dvw[2] = cart.z;
+
+        /* to rotate the rotation differential, convert it to a
+    	    velocity screw and rotate that */
+        go_quat_rvec_convert(&Tdelta.rot, &rvec);
+        cart.x = rvec.x;
+        cart.y = rvec.y;
+        cart.z = rvec.z;
+        go_quat_cart_mult(&pest.rot, &cart, &cart);
+        dvw[3] = cart.x;
+        dvw[4] = cart.y;
+        dvw[5] = cart.z;
+
+	/* push the Cartesian velocity vector through the inverse Jacobian */
+	go_matrix_vector_mult(&Jinv, dvw, dj);
+
+	/* check for small joint increments, if so we're done */
+	for (link = 0, smalls = 0; link < genser->link_num; link++) {
+	    if (GO_QUANTITY_LENGTH == linkout[link].quantity) {
+		if (GO_TRAN_SMALL(dj[link]))
+		    smalls++;
+	    } else {
+		if (GO_ROT_SMALL(dj[link]))
+		    smalls++;
+	    }
+	}
+	if (smalls == genser->link_num) {
+	    /* converged, copy jest[] out */
+	    for (link = 0; link < genser->link_num; link++) {
+		joints[link] = jest[link];
+	    }
+	    return GO_RESULT_OK;
+	}
+	/* else keep iterating */
+	for (link = 0; link < genser->link_num; link++) {
+	    jest[link] += dj[link];
+	}
+    }				/* for (iterations) */
+
+    return GO_RESULT_ERROR;
+}
+
+
+int genser_kin_precompute(genser_struct * genser)
+{
+    genser_dh_const *c;
+    int link;
+
+    genser->precomputed = 0;
+
+    for (link = 0; link < genser->link_num; link++) {
+	if (GO_LINK_DH != genser->links[link].type)
+	    return GO_RESULT_IMPL_ERROR;
+	c = &genser->dh[link];
+	sincos(genser->links[link].u.dh.alpha, &c->sal, &c->cal);
+	c->a = genser->links[link].u.dh.a;
+	c->d = genser->links[link].u.dh.d;
+	c->theta = genser->links[link].u.dh.theta;
+	c->quantity = genser->links[link].quantity;
+    }
+
+    genser->precomputed = 1;
+    return GO_RESULT_OK;
+}
+
+/*
+  Evaluates the chain for the given joints. R and p get the end pose
+  as a row-major rotation and a translation. If z and o are not null,
+  they get the joint axis and origin of each link frame in the base
+  frame, which is all the Jacobian needs.
+
+  Each link is the same transform as go_dh_pose_convert() builds:
+
+      | cth      -sth      0    |      |  a       |
+  R = | sth*cal   cth*cal  -sal |  p = | -sal*d   |
+      | sth*sal   cth*sal   cal |      |  cal*d   |
+*/
+static void chain_eval(const genser_struct * genser,
+		       const go_real * joints,
+		       go_real R[3][3], go_real p[3],
+		       go_real z[][3], go_real o[][3])
+{
+    const genser_dh_const *c;
+    go_real sth, cth, d;
+    go_real r0, r1, r2;
+    go_real lx, ly, lz;
+    int link, row;
+
+    R[0][0] = 1, R[0][1] = 0, R[0][2] = 0;
+    R[1][0] = 0, R[1][1] = 1, R[1][2] = 0;
+    R[2][0] = 0, R[2][1] = 0, R[2][2] = 1;
+    p[0] = p[1] = p[2] = 0;
+
+    for (link = 0; link < genser->link_num; link++) {
+	c = &genser->dh[link];
+	if (GO_QUANTITY_LENGTH == c->quantity) {
+	    sincos(c->theta, &sth, &cth);
+	    d = joints[link];
+	} else {
+	    sincos(joints[link], &sth, &cth);
+	    d = c->d;
+	}
+
+	lx = c->a;
+	ly = -c->sal * d;
+	lz = c->cal * d;
+
+	for (row = 0; row < 3; row++) {
+	    r0 = R[row][0], r1 = R[row][1], r2 = R[row][2];
+	    p[row] += r0 * lx + r1 * ly + r2 * lz;
+	    R[row][0] = r0 * cth + (r1 * c->cal + r2 * c->sal) * sth;
+	    R[row][1] = -r0 * sth + (r1 * c->cal + r2 * c->sal) * cth;
+	    R[row][2] = -r1 * c->sal + r2 * c->cal;
+	}
+
+	if (z) {
+	    z[link][0] = R[0][2], z[link][1] = R[1][2], z[link][2] = R[2][2];
+	    o[link][0] = p[0], o[link][1] = p[1], o[link][2] = p[2];
+	}
+    }
+}
+
+int genser_kin_fwd_fast(genser_struct * genser,
+			const go_real * joints, go_hom * world)
+{
+    go_real R[3][3], p[3];
+
+    if (!genser->precomputed)
+	return GO_RESULT_ERROR;
+
+    chain_eval(genser, joints, R, p, 0, 0);
+
+    world->tran.x = p[0], world->tran.y = p[1], world->tran.z = p[2];
+    world->rot.x.x = R[0][0], world->rot.y.x = R[0][1], world->rot.z.x = R[0][2];
+    world->rot.x.y = R[1][0], world->rot.y.y = R[1][1], world->rot.z.y = R[1][2];
+    world->rot.x.z = R[2][0], world->rot.y.z = R[2][1], world->rot.z.z = R[2][2];
+
+    return GO_RESULT_OK;
+}
+
+/*
+  Rotation vector of the rotation matrix m, the same as converting to a
+  quaternion and then to a go_rvec but without the square roots in the
+  usual case. Near a half turn the skew part vanishes, so fall back to
+  the quaternion.
+*/
+static int mat_rvec(go_real m[3][3], go_real r[3])
+{
+    go_mat mat;
+    go_quat q;
+    go_rvec rvec;
+    go_real s[3], sn, cn, mag;
+    int retval;
+
+    s[0] = 0.5 * (m[2][1] - m[1][2]);
+    s[1] = 0.5 * (m[0][2] - m[2][0]);
+    s[2] = 0.5 * (m[1][0] - m[0][1]);
+    cn = 0.5 * (m[0][0] + m[1][1] + m[2][2] - 1);
+    sn = sqrt(s[0] * s[0] + s[1] * s[1] + s[2] * s[2]);
+
+    if (!GO_ROT_SMALL(sn)) {
+	mag = atan2(sn, cn) / sn;
+	r[0] = mag * s[0], r[1] = mag * s[1], r[2] = mag * s[2];
+	return GO_RESULT_OK;
+    }
+    if (cn > 0) {
+	r[0] = r[1] = r[2] = 0;
+	return GO_RESULT_OK;
+    }
+
+    mat.x.x = m[0][0], mat.y.x = m[0][1], mat.z.x = m[0][2];
+    mat.x.y = m[1][0], mat.y.y = m[1][1], mat.z.y = m[1][2];
+    mat.x.z = m[2][0], mat.y.z = m[2][1], mat.z.z = m[2][2];
+    retval = go_mat_quat_convert(&mat, &q);
+    if (GO_RESULT_OK != retval)
+	return retval;
+    go_quat_rvec_convert(&q, &rvec);
+    r[0] = rvec.x, r[1] = rvec.y, r[2] = rvec.z;
+
+    return GO_RESULT_OK;
+}
+
+/*
+  Solves the 6x6 system a x = b in place by Gaussian elimination with
+  partial pivoting. a and b are destroyed, x is left in b.
+*/
+static int solve6(go_real a[6][6], go_real b[6])
+{
+    go_real eps = go_get_singular_epsilon();
+    go_real tmp, f;
+    int i, j, k, piv;
+
+    for (k = 0; k < 6; k++) {
+	piv = k;
+	for (i = k + 1; i < 6; i++) {
+	    if (fabs(a[i][k]) > fabs(a[piv][k]))
+		piv = i;
+	}
+	if (fabs(a[piv][k]) < eps)
+	    return GO_RESULT_SINGULAR;
+	if (piv != k) {
+	    for (j = k; j < 6; j++) {
+		tmp = a[k][j], a[k][j] = a[piv][j], a[piv][j] = tmp;
+	    }
+	    tmp = b[k], b[k] = b[piv], b[piv] = tmp;
+	}
+	for (i = k + 1; i < 6; i++) {
+	    f = a[i][k] / a[k][k];
+	    for (j = k + 1; j < 6; j++)
+		a[i][j] -= f * a[k][j];
+	    b[i] -= f * b[k];
+	}
+    }
+
+    for (k = 5; k >= 0; k--) {
+	tmp = b[k];
+	for (j = k + 1; j < 6; j++)
+	    tmp -= a[k][j] * b[j];
+	b[k] = tmp / a[k][k];
+    }
+
+    return GO_RESULT_OK;
+}
+
+int genser_kin_inv_fast(genser_struct * genser,
+			const go_hom * world, go_real * joints)
+{
+    go_real Rt[3][3], pt[3];
+    go_real R[3][3], p[3], Rd[3][3];
+    go_real z[GENSER_MAX_JOINTS][3], o[GENSER_MAX_JOINTS][3];
+    go_real J[6][6], dj[6];
+    go_real jest[GENSER_MAX_JOINTS];
+    go_real e[3];
+    int link, row, col;
+    int smalls;
+    int retval;
+
+    /* the solve is only written for the square case, a 6-joint arm */
+    if (!genser->precomputed || 6 != genser->link_num)
+	return GO_RESULT_IMPL_ERROR;
+
+    Rt[0][0] = world->rot.x.x, Rt[0][1] = world->rot.y.x, Rt[0][2] = world->rot.z.x;
+    Rt[1][0] = world->rot.x.y, Rt[1][1] = world->rot.y.y, Rt[1][2] = world->rot.z.y;
+    Rt[2][0] = world->rot.x.z, Rt[2][1] = world->rot.y.z, Rt[2][2] = world->rot.z.z;
+    pt[0] = world->tran.x, pt[1] = world->tran.y, pt[2] = world->tran.z;
+
+    for (link = 0; link < 6; link++) {
+	jest[link] = joints[link];
+    }
+
+    for (genser->iterations = 0; genser->iterations < genser->max_iterations; genser->iterations++) {
+	chain_eval(genser, jest, R, p, z, o);
+
+	/*
+	  The error twist in the base frame: the translation difference,
+	  and the rotation vector of Rt * R^T, which is the pest-frame
+	  differential of genser_kin_inv() rotated back into {0}.
+	*/
+	dj[0] = pt[0] - p[0];
+	dj[1] = pt[1] - p[1];
+	dj[2] = pt[2] - p[2];
+	for (row = 0; row < 3; row++) {
+	    for (col = 0; col < 3; col++) {
+		Rd[row][col] = Rt[row][0] * R[col][0] + Rt[row][1] * R[col][1] + Rt[row][2] * R[col][2];
+	    }
+	}
+	retval = mat_rvec(Rd, &dj[3]);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+
+	/* analytic Jacobian, with Jv atop Jw */
+	for (link = 0; link < 6; link++) {
+	    if (GO_QUANTITY_LENGTH == genser->dh[link].quantity) {
+		J[0][link] = z[link][0];
+		J[1][link] = z[link][1];
+		J[2][link] = z[link][2];
+		J[3][link] = J[4][link] = J[5][link] = 0;
+	    } else {
+		e[0] = p[0] - o[link][0];
+		e[1] = p[1] - o[link][1];
+		e[2] = p[2] - o[link][2];
+		J[0][link] = z[link][1] * e[2] - z[link][2] * e[1];
+		J[1][link] = z[link][2] * e[0] - z[link][0] * e[2];
+		J[2][link] = z[link][0] * e[1] - z[link][1] * e[0];
+		J[3][link] = z[link][0];
+		J[4][link] = z[link][1];
+		J[5][link] = z[link][2];
+	    }
+	}
+
+	retval = solve6(J, dj);
+	if (GO_RESULT_OK != retval)
+	    return retval;
+
+	/* check for small joint increments, if so we're done */
+	for (link = 0, smalls = 0; link < 6; link++) {
+	    if (GO_QUANTITY_LENGTH == genser->dh[link].quantity) {
+		if (GO_TRAN_SMALL(dj[link]))
+		    smalls++;
+	    } else {
+		if (GO_ROT_SMALL(dj[link]))
+		    smalls++;
+	    }
+	}
+	if (smalls == 6) {
+	    for (link = 0; link < 6; link++) {
+		joints[link] = jest[link];
+	    }
+	    return GO_RESULT_OK;
+	}
+	for (link = 0; link < 6; link++) {
+	    jest[link] += dj[link];
+	}
+    }
+
+    return GO_RESULT_ERROR;
+}
+
+/*
+  Extras, not callable using go_kin_ wrapper but if you know you have
+  linked in these kinematics, go ahead and call these for your ad hoc
+  purposes.
+  FIXME-AJ: make genser->iterations a hal pin
+*/
+
+int genser_kin_inv_iterations(genser_struct * genser)
+{
+    return genser->iterations;
+}
+
+/* FIXME-AJ: make genser->max_iterations a hal pin */
+int genser_kin_inv_set_max_iterations(genser_struct * genser, int i)
+{
+    if (i <= 0)
+	return GO_RESULT_ERROR;
+    genser->max_iterations = i;
+    return GO_RESULT_OK;
+}
+
+/* FIXME-AJ: make genser->max_iterations a hal pin */
+int genser_kin_inv_get_max_iterations(genser_struct * genser)
+{
+    return genser->max_iterations;
+}
@@ -89,217 +89,25 @@ int genser_kin_init(void) {
     return GO_RESULT_OK;
 }
 
-/* compute the forward jacobian function: 
-   the jacobian is a linear aproximation of the kinematics function.
-   It is calculated using derivation of the position transformation matrix, 
-   and usually used for feeding velocities through it.
-   It is analytically possible to calculate the inverse of the jacobian 
-   (sometimes only the pseudoinverse) and to use that for the inverse kinematics.
-*/
-static int compute_jfwd(go_link * link_params, 
-		        int link_number, 
-			go_matrix * Jfwd, 
-			go_pose * T_L_0) 
-{
-    GO_MATRIX_DECLARE(Jv, Jvstg, 3, GENSER_MAX_JOINTS);
-    GO_MATRIX_DECLARE(Jw, Jwstg, 3, GENSER_MAX_JOINTS);
-    GO_MATRIX_DECLARE(R_i_ip1, R_i_ip1stg, 3, 3);
-    GO_MATRIX_DECLARE(scratch, scratchstg, 3, GENSER_MAX_JOINTS);
-    GO_MATRIX_DECLARE(R_inv, R_invstg, 3, 3);
-    go_pose pose;
-    go_quat quat;
-    go_vector P_ip1_i[3];
-    int row, col;
-
-    /* init matrices to possibly smaller size */
-    go_matrix_init(Jv, Jvstg, 3, link_number);
-    go_matrix_init(Jw, Jwstg, 3, link_number);
-    go_matrix_init(R_i_ip1, R_i_ip1stg, 3, 3);
-    go_matrix_init(scratch, scratchstg, 3, link_number);
-    go_matrix_init(R_inv, R_invstg, 3, 3);
-
-    Jv.el[0][0] = 0, Jv.el[1][0] = 0, Jv.el[2][0] = (GO_QUANTITY_LENGTH == link_params[0].quantity ? 1 : 0);
-    Jw.el[0][0] = 0, Jw.el[1][0] = 0, Jw.el[2][0] = (GO_QUANTITY_ANGLE == link_params[0].quantity ? 1 : 0);
-
-    /* initialize inverse rotational transform */
-    if (GO_LINK_DH == link_params[0].type) {
-	go_dh_pose_convert(&link_params[0].u.dh, &pose);
-    } else if (GO_LINK_PP == link_params[0].type) {
-	pose = link_params[0].u.pp.pose;
-    } else {
-	return GO_RESULT_IMPL_ERROR;
-    }
-
-    *T_L_0 = pose;
-
-    for (col = 1; col < link_number; col++) {
-	/* T_ip1_i */
-	if (GO_LINK_DH == link_params[col].type) {
-	    go_dh_pose_convert(&link_params[col].u.dh, &pose);
-	} else if (GO_LINK_PP == link_params[col].type) {
-	    pose = link_params[col].u.pp.pose;
-	} else {
-	    return GO_RESULT_IMPL_ERROR;
-	}
-
-	go_cart_vector_convert(&pose.tran, P_ip1_i);
-	go_quat_inv(&pose.rot, &quat);
-	go_quat_matrix_convert(&quat, &R_i_ip1);
-
-	/* Jv */
-	go_matrix_vector_cross(&Jw, P_ip1_i, &scratch);
-	go_matrix_matrix_add(&Jv, &scratch, &scratch);
-	go_matrix_matrix_mult(&R_i_ip1, &scratch, &Jv);
-	Jv.el[0][col] = 0, Jv.el[1][col] = 0, Jv.el[2][col] = (GO_QUANTITY_LENGTH == link_params[col].quantity ? 1 : 0);
-	/* Jw */
-	go_matrix_matrix_mult(&R_i_ip1, &Jw, &Jw);
-	Jw.el[0][col] = 0, Jw.el[1][col] = 0, Jw.el[2][col] = (GO_QUANTITY_ANGLE == link_params[col].quantity ? 1 : 0);
-	if (GO_LINK_DH == link_params[col].type) {
-	    go_dh_pose_convert(&link_params[col].u.dh, &pose);
-	} else if (GO_LINK_PP == link_params[col].type) {
-	    pose = link_params[col].u.pp.pose;
-	} else {
-	    return GO_RESULT_IMPL_ERROR;
-	}
-	go_pose_pose_mult(T_L_0, &pose, T_L_0);
-    }
-
-    /* rotate back into {0} frame */
-    go_quat_matrix_convert(&T_L_0->rot, &R_inv);
-    go_matrix_matrix_mult(&R_inv, &Jv, &Jv);
-    go_matrix_matrix_mult(&R_inv, &Jw, &Jw);
-
-    /* put Jv atop Jw in J */
-    for (row = 0; row < 6; row++) {
-	for (col = 0; col < link_number; col++) {
-	    if (row < 3) {
-		Jfwd->el[row][col] = Jv.el[row][col];
-	    } else {
-		Jfwd->el[row][col] = Jw.el[row - 3][col];
-	    }
-	}
-    }
-
-    return GO_RESULT_OK;
-}
-
-/* compute the inverse of the jacobian matrix */
-static int compute_jinv(go_matrix * Jfwd, go_matrix * Jinv)
-{
-    int retval;
-    GO_MATRIX_DECLARE(JT, JTstg, GENSER_MAX_JOINTS, 6);
-
-    /* compute inverse, or pseudo-inverse */
-    if (Jfwd->rows == Jfwd->cols) {
-	retval = go_matrix_inv(Jfwd, Jinv);
-	if (GO_RESULT_OK != retval)
-	    return retval;
-    } else if (Jfwd->rows < Jfwd->cols) {
-	/* underdetermined, optimize on smallest sum of square of speeds */
-	/* JT(JJT)inv */
-	GO_MATRIX_DECLARE(JJT, JJTstg, 6, 6);
-
-	go_matrix_init(JT, JTstg, Jfwd->cols, Jfwd->rows);
-	go_matrix_init(JJT, JJTstg, Jfwd->rows, Jfwd->rows);
-	go_matrix_transpose(Jfwd, &JT);
-	go_matrix_matrix_mult(Jfwd, &JT, &JJT);
-	retval = go_matrix_inv(&JJT, &JJT);
-	if (GO_RESULT_OK != retval)
-	    return retval;
-	go_matrix_matrix_mult(&JT, &JJT, Jinv);
-    } else {
-	/* overdetermined, do least-squares best fit */
-	/* (JTJ)invJT */
-	GO_MATRIX_DECLARE(JTJ, JTJstg, GENSER_MAX_JOINTS, GENSER_MAX_JOINTS);
-
-	go_matrix_init(JT, JTstg, Jfwd->cols, Jfwd->rows);
-	go_matrix_init(JTJ, JTJstg, Jfwd->cols, Jfwd->cols);
-	go_matrix_transpose(Jfwd, &JT);
-	go_matrix_matrix_mult(&JT, Jfwd, &JTJ);
-	retval = go_matrix_inv(&JTJ, &JTJ);
-	if (GO_RESULT_OK != retval)
-	    return retval;
-	go_matrix_matrix_mult(&JTJ, &JT, Jinv);
-    }
-
-    return GO_RESULT_OK;
-}
-
-int genser_kin_jac_inv(void *kins,
-    const go_pose * pos,
-    const go_screw * vel, const go_real * joints, go_real * jointvels)
-{
-    genser_struct *genser = (genser_struct *) kins;
-    GO_MATRIX_DECLARE(Jfwd, Jfwd_stg, 6, GENSER_MAX_JOINTS);
-    GO_MATRIX_DECLARE(Jinv, Jinv_stg, GENSER_MAX_JOINTS, 6);
-    go_pose T_L_0;
-    go_link linkout[GENSER_MAX_JOINTS];
-    go_real vw[6];
-    int link;
-    int retval;
-
-    go_matrix_init(Jfwd, Jfwd_stg, 6, genser->link_num);
-    go_matrix_init(Jinv, Jinv_stg, GENSER_MAX_JOINTS, 6);
-
-    for (link = 0; link < genser->link_num; link++) {
-	retval =
-	    go_link_joint_set(&genser->links[link], joints[link],
-	    &linkout[link]);
-	if (GO_RESULT_OK != retval)
-	    return retval;
-    }
-    retval = compute_jfwd(linkout, genser->link_num, &Jfwd, &T_L_0);
-    if (GO_RESULT_OK != retval)
-	return retval;
-    retval = compute_jinv(&Jfwd, &Jinv);
-    if (GO_RESULT_OK != retval)
-	return retval;
-
-    vw[0] = vel->v.x;
-    vw[1] = vel->v.y;
-    vw[2] = vel->v.z;
-    vw[3] = vel->w.x;
-    vw[4] = vel->w.y;
-    vw[5] = vel->w.z;
-
-    return go_matrix_vector_mult(&Jinv, vw, jointvels);
-}
-
-int genser_kin_jac_fwd(void *kins,
-    const go_real * joints,
-    const go_real * jointvels, const go_pose * pos, go_screw * vel)
+/* the DH pins may be changed at any time with setp, so rebuild the links
+   and the precomputed link constants whenever they differ, rather than
+   converting all of them on every call */
+static void genser_kin_refresh(void)
 {
-    genser_struct *genser = (genser_struct *) kins;
-    GO_MATRIX_DECLARE(Jfwd, Jfwd_stg, 6, GENSER_MAX_JOINTS);
-    go_pose T_L_0;
-    go_link linkout[GENSER_MAX_JOINTS];
-    go_real vw[6];
-    int link;
-    int retval;
-
-    go_matrix_init(Jfwd, Jfwd_stg, 6, genser->link_num);
+    genser_struct *genser = KINS_PTR;
+    int t;
 
-    for (link = 0; link < genser->link_num; link++) {
-	retval =
-	    go_link_joint_set(&genser->links[link], joints[link],
-	    &linkout[link]);
-	if (GO_RESULT_OK != retval)
-	    return retval;
+    for (t = 0; t < GENSER_MAX_JOINTS; t++) {
+	if (genser->links[t].u.dh.a != A(t) ||
+	    genser->links[t].u.dh.alpha != ALPHA(t) ||
+	    genser->links[t].u.dh.d != D(t))
+	    break;
     }
+    if (t == GENSER_MAX_JOINTS && genser->precomputed)
+	return;
 
-    retval = compute_jfwd(linkout, genser->link_num, &Jfwd, &T_L_0);
-    if (GO_RESULT_OK != retval)
-	return retval;
-
-    go_matrix_vector_mult(&Jfwd, jointvels, vw);
-    vel->v.x = vw[0];
-    vel->v.y = vw[1];
-    vel->v.z = vw[2];
-    vel->w.x = vw[3];
-    vel->w.y = vw[4];
-    vel->w.z = vw[5];
-
-    return GO_RESULT_OK;
+    genser_kin_init();
+    genser_kin_precompute(genser);
 }
 
 /* main function called by emc2 for forward Kins */
@@ -309,6 +117,7 @@ int kinematicsForward(const double *joint,
 		      KINEMATICS_INVERSE_FLAGS * iflags) {
 
     go_pose *pos;
+    go_hom hom;
     go_rpy rpy;
     go_real jcopy[GENSER_MAX_JOINTS]; // will hold the radian conversion of joints
     int ret = 0;
@@ -328,6 +137,26 @@ int kinematicsForward(const double *joint,
 	    j[i] = joint[i];
 //	rtapi_print("kinematicsForward(joints: %f %f %f %f %f %f)\n", joint[0],joint[1],joint[2],joint[3],joint[4],joint[5]);
     }
+
+    genser_kin_refresh();
+
+    if (KINS_PTR->precomputed) {
+	// the fast path gives a matrix, which converts straight to rpy
+	ret = genser_kin_fwd_fast(KINS_PTR, jcopy, &hom);
+	if (ret < 0)
+	    return ret;
+	ret = go_mat_rpy_convert(&hom.rot, &rpy);
+	if (ret < 0)
+	    return ret;
+	world->tran.x = hom.tran.x;
+	world->tran.y = hom.tran.y;
+	world->tran.z = hom.tran.z;
+	world->a = rpy.r * 180 / PM_PI;
+	world->b = rpy.p * 180 / PM_PI;
+	world->c = rpy.y * 180 / PM_PI;
+	return 0;
+    }
+
     // AJ: convert from emc2 coords (XYZABC - which are actually rpy euler
     // angles)
     // to go angles (quaternions)
@@ -364,29 +193,6 @@ int kinematicsForward(const double *joint,
     return 0;
 }
 
-int genser_kin_fwd(void *kins, const go_real * joints, go_pose * pos)
-{
-    genser_struct *genser = kins;
-    go_link linkout[GENSER_MAX_JOINTS];
-
-    int link;
-    int retval;
-
-    genser_kin_init();
-
-    for (link = 0; link < genser->link_num; link++) {
-	retval = go_link_joint_set(&genser->links[link], joints[link], &linkout[link]);
-	if (GO_RESULT_OK != retval)
-	    return retval;
-    }
-
-    retval = go_link_pose_build(linkout, genser->link_num, pos);
-    if (GO_RESULT_OK != retval)
-	return retval;
-
-    return GO_RESULT_OK;
-}
-
 int kinematicsInverse(const EmcPose * world,
 		      double *joints,
 		      const KINEMATICS_INVERSE_FLAGS * iflags,
@@ -394,162 +200,59 @@ int kinematicsInverse(const EmcPose * world,
 {
 
     genser_struct *genser = KINS_PTR;
-    GO_MATRIX_DECLARE(Jfwd, Jfwd_stg, 6, GENSER_MAX_JOINTS);
-    GO_MATRIX_DECLARE(Jinv, Jinv_stg, GENSER_MAX_JOINTS, 6);
-    go_pose T_L_0;
-    go_real dvw[6];
     go_real jest[GENSER_MAX_JOINTS];
-    go_real dj[GENSER_MAX_JOINTS];
-    go_pose pest, pestinv, Tdelta;	// pos = converted pose from EmcPose
+    go_hom hom;
     go_rpy rpy;
-    go_rvec rvec;
-    go_cart cart;
-    go_link linkout[GENSER_MAX_JOINTS];
     int link;
-    int smalls;
     int retval;
 
 //    rtapi_print("kineInverse(joints: %f %f %f %f %f %f)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5]);
 //    rtapi_print("kineInverse(world: %f %f %f %f %f %f)\n", world->tran.x, world->tran.y, world->tran.z, world->a, world->b, world->c);
 
-//    genser_kin_init();
+    genser_kin_refresh();
     
     // FIXME-AJ: rpy or zyx ?
     rpy.y = world->c * PM_PI / 180;
     rpy.p = world->b * PM_PI / 180;
     rpy.r = world->a * PM_PI / 180;
 
-    go_rpy_quat_convert(&rpy, &haldata->pos->rot);
-    haldata->pos->tran.x = world->tran.x;
-    haldata->pos->tran.y = world->tran.y;
-    haldata->pos->tran.z = world->tran.z;
-
-    go_matrix_init(Jfwd, Jfwd_stg, 6, genser->link_num);
-    go_matrix_init(Jinv, Jinv_stg, genser->link_num, 6);
-
     /* jest[] is a copy of joints[], which is the joint estimate */
     for (link = 0; link < genser->link_num; link++) {
 	// jest, and the rest of joint related calcs are in radians
 	jest[link] = joints[link] * (PM_PI / 180);
     }
 
-    for (genser->iterations = 0; genser->iterations < genser->max_iterations; genser->iterations++) {
-	/* update the Jacobians */
-	for (link = 0; link < genser->link_num; link++) {
-	    go_link_joint_set(&genser->links[link], jest[link], &linkout[link]);
-	}
-	retval = compute_jfwd(linkout, genser->link_num, &Jfwd, &T_L_0);
-	if (GO_RESULT_OK != retval) {
-	    rtapi_print("ERR kI - compute_jfwd (joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
-	    return retval;
-	}
-	retval = compute_jinv(&Jfwd, &Jinv);
-	if (GO_RESULT_OK != retval) {
-	    rtapi_print("ERR kI - compute_jinv (joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
-	    return retval;
-	}
-
-	/* pest is the resulting pose estimate given joint estimate */
-	genser_kin_fwd(KINS_PTR, jest, &pest);
-//	printf("jest: %f %f %f %f %f %f\n",jest[0],jest[1],jest[2],jest[3],jest[4],jest[5]);
-	/* pestinv is its inverse */
-	go_pose_inv(&pest, &pestinv);
-	/*
-	    Tdelta is the incremental pose from pest to pos, such that
-
-	    0        L         0
-	    . pest *  Tdelta =  pos, or
-	    L        L         L
-
-	    L         L          0
-	    .Tdelta =  pestinv *  pos
-	    L         0          L
-	*/
-	go_pose_pose_mult(&pestinv, haldata->pos, &Tdelta);
-
-	/*
-	    We need Tdelta in 0 frame, not pest frame, so rotate it
-    	    back. Since it's effectively a velocity, we just rotate it, and
-    	    don't translate it.
-        */
-
-        /* first rotate the translation differential */
-        go_quat_cart_mult(&pest.rot, &Tdelta.tran, &cart);
-        dvw[0] = cart.x;
-        dvw[1] = cart.y;
-        dvw[2] = cart.z;
-
-        /* to rotate the rotation differential, convert it to a
-    	    velocity screw and rotate that */
-        go_quat_rvec_convert(&Tdelta.rot, &rvec);
-        cart.x = rvec.x;
-        cart.y = rvec.y;
-        cart.z = rvec.z;
-        go_quat_cart_mult(&pest.rot, &cart, &cart);
-        dvw[3] = cart.x;
-        dvw[4] = cart.y;
-        dvw[5] = cart.z;
-
-	/* push the Cartesian velocity vector through the inverse Jacobian */
-	go_matrix_vector_mult(&Jinv, dvw, dj);
-
-	/* check for small joint increments, if so we're done */
-	for (link = 0, smalls = 0; link < genser->link_num; link++) {
-	    if (GO_QUANTITY_LENGTH == linkout[link].quantity) {
-		if (GO_TRAN_SMALL(dj[link]))
-		    smalls++;
-	    } else {
-		if (GO_ROT_SMALL(dj[link]))
-		    smalls++;
-	    }
-	}
-	if (smalls == genser->link_num) {
-	    /* converged, copy jest[] out */
-	    for (link = 0; link < genser->link_num; link++) {
-		// convert from radians back to angles
-		joints[link] = jest[link] * 180 / PM_PI;
-                if ((link) && (haldata->unrotate[link]))
-                    joints[link] += (haldata->unrotate[link]) * joints[link-1];
-	    }
-//	    rtapi_print("DONEkineInverse(joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
-	    return GO_RESULT_OK;
-	}
-	/* else keep iterating */
-	for (link = 0; link < genser->link_num; link++) {
-	    jest[link] += dj[link]; //still in radians
-	}
-    }				/* for (iterations) */
-
-    rtapi_print("ERRkineInverse(joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
-    return GO_RESULT_ERROR;
-}
-
-/*
-  Extras, not callable using go_kin_ wrapper but if you know you have
-  linked in these kinematics, go ahead and call these for your ad hoc
-  purposes.
-  FIXME-AJ: make genser->iterations a hal pin
-*/
+    retval = GO_RESULT_IMPL_ERROR;
+    if (genser->precomputed) {
+	go_rpy_mat_convert(&rpy, &hom.rot);
+	hom.tran.x = world->tran.x;
+	hom.tran.y = world->tran.y;
+	hom.tran.z = world->tran.z;
+	retval = genser_kin_inv_fast(genser, &hom, jest);
+    }
+    if (GO_RESULT_IMPL_ERROR == retval) {
+	go_rpy_quat_convert(&rpy, &haldata->pos->rot);
+	haldata->pos->tran.x = world->tran.x;
+	haldata->pos->tran.y = world->tran.y;
+	haldata->pos->tran.z = world->tran.z;
+	retval = genser_kin_inv(genser, haldata->pos, jest);
+    }
 
-int genser_kin_inv_iterations(genser_struct * genser)
-{
-    return genser->iterations;
-}
+    if (GO_RESULT_OK != retval) {
+	rtapi_print("ERRkineInverse(joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
+	return retval;
+    }
 
-/* FIXME-AJ: make genser->max_iterations a hal pin */
-int genser_kin_inv_set_max_iterations(genser_struct * genser, int i)
-{
-    if (i <= 0)
-	return GO_RESULT_ERROR;
-    genser->max_iterations = i;
+    for (link = 0; link < genser->link_num; link++) {
+	// convert from radians back to angles
+	joints[link] = jest[link] * 180 / PM_PI;
+	if ((link) && (haldata->unrotate[link]))
+	    joints[link] += (haldata->unrotate[link]) * joints[link-1];
+    }
+//  rtapi_print("DONEkineInverse(joints: %f %f %f %f %f %f), (iterations=%d)\n", joints[0],joints[1],joints[2],joints[3],joints[4],joints[5], genser->iterations);
     return GO_RESULT_OK;
 }
 
-/* FIXME-AJ: make genser->max_iterations a hal pin */
-int genser_kin_inv_get_max_iterations(genser_struct * genser)
-{
-    return genser->max_iterations;
-}
 
 int kinematicsHome(EmcPose * world,
     double *joint,
@@ -643,6 +346,9 @@ int rtapi_app_main(void)
     D(4) = DEFAULT_D5;
     D(5) = DEFAULT_D6;
 
+    genser_kin_init();
+    genser_kin_precompute(KINS_PTR);
+
     hal_ready(comp_id);
     return 0;
 
@@ -721,6 +427,13 @@ int main(int argc, char *argv[])
     D(3) = DEFAULT_D4;
     D(4) = DEFAULT_D5;
     D(5) = DEFAULT_D6;
+    for (i = 0; i < GENSER_MAX_JOINTS ; i++) {
+	haldata->unrotate[i] = 0;
+    }
+    KINS_PTR->max_iterations = GENSER_DEFAULT_MAX_ITERATIONS;
+
+    genser_kin_init();
+    genser_kin_precompute(KINS_PTR);
 
     /* syntax is a.out {i|f # # # # # #} */
     if (argc == 8) {
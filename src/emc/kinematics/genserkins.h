@@ -69,9 +69,24 @@
 #define DEFAULT_ALPHA6 -PI_2
 #define DEFAULT_D6 0
 
+/*!
+  Constant part of a DH link, precomputed by genser_kin_precompute() so
+  the fast paths only need one sincos() per joint per evaluation.
+*/
+typedef struct {
+  go_real sal;		/*!< sin(alpha[i-1]) */
+  go_real cal;		/*!< cos(alpha[i-1]) */
+  go_real a;		/*!< a[i-1] */
+  go_real d;		/*!< d[i], used when the joint is revolute */
+  go_real theta;	/*!< theta[i], used when the joint is prismatic */
+  go_integer quantity;	/*!< GO_QUANTITY_ANGLE or GO_QUANTITY_LENGTH */
+} genser_dh_const;
+
 typedef struct {
   go_link links[GENSER_MAX_JOINTS]; /*!< The link description of the device. */
   int link_num;		/*!< How many are actually present. */
+  genser_dh_const dh[GENSER_MAX_JOINTS]; /*!< Precomputed link constants. */
+  int precomputed;	/*!< Nonzero if \a dh matches \a links, and the fast paths may be used. */
   hal_s32_t iterations;	/*!< How many iterations were actually used to compute the inverse kinematics. */
   hal_s32_t max_iterations;	/*!< Number of iterations after which to give up and report an error. */
 } genser_struct;
@@ -111,6 +126,34 @@ extern int genser_kin_jac_fwd(void * kins,
 
 extern int genser_kin_fwd_interations(genser_struct * genser);
 
+/*
+  Fast paths. These need the link constants set up with
+  genser_kin_precompute() whenever the links change, and only handle
+  pure DH chains; genser_kin_precompute() returns an error otherwise
+  and the generic functions above must be used instead.
+
+  Poses are homogeneous transforms, so callers working in matrices or
+  Euler angles can skip the quaternion conversions. Joints are in
+  radians, as with genser_kin_fwd() and genser_kin_inv().
+*/
+
+/*! Computes the sines and cosines of the fixed link twists and
+  caches the link constants. */
+extern int genser_kin_precompute(genser_struct * genser);
+
+/*! Forward kinematics from the precomputed chain. */
+extern int genser_kin_fwd_fast(genser_struct * genser,
+			       const go_real * joints,
+			       go_hom * world);
+
+/*! Inverse kinematics from the precomputed chain. \a joints holds the
+  initial estimate on entry, like genser_kin_inv(). The Jacobian is
+  built analytically from the same pass that evaluates the chain, and
+  each step is solved directly rather than by inverting the Jacobian. */
+extern int genser_kin_inv_fast(genser_struct * genser,
+			       const go_hom * world,
+			       go_real * joints);
+
 
 /*
   Extras, not callable using go_kin_ wrapper but if you know you have
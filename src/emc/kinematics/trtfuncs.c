@@ -0,0 +1,125 @@
+/********************************************************************
+* Description: trtfuncs.c
+*   Shared math for the table rotary/tilting (trt) 5 axis kinematics.
+*   See trtfuncs.h.
+*
+* License: GPL Version 2
+* System: Linux
+*
+*******************************************************************/
+
+#include "rtapi_math.h"
+#include "posemath.h"		/* TO_RAD */
+#include "sincos.h"
+#include "trtfuncs.h"		/* these decls */
+
+void trt_init(trt_kins_t *k, trt_tilt_t tilt_axis)
+{
+    int n;
+
+    k->tilt_axis = tilt_axis;
+    for (n = 0; n < TRT_XFORMS; n++) {
+	k->xf[n].valid = 0;
+    }
+    k->next = 0;
+}
+
+void trt_angle(trt_angle_t *a, double deg)
+{
+    if (a->valid && a->deg == deg) {
+	return;
+    }
+    sincos(deg * TO_RAD, &a->s, &a->c);
+    a->deg = deg;
+    a->valid = 1;
+}
+
+static void trt_build(trt_kins_t *k, trt_xform_t *xf)
+{
+    double st, ct, sr, cr;
+    double r[3][3];		/* the tilt alone */
+    double rp[3], q[3];
+    int i;
+
+    sincos(xf->tilt * TO_RAD, &st, &ct);
+    sincos(xf->rot * TO_RAD, &sr, &cr);
+
+    if (k->tilt_axis == TRT_TILT_A) {
+	r[0][0] = 1;   r[0][1] = 0;   r[0][2] = 0;
+	r[1][0] = 0;   r[1][1] = ct;  r[1][2] = st;
+	r[2][0] = 0;   r[2][1] = -st; r[2][2] = ct;
+    } else {
+	r[0][0] = ct;  r[0][1] = 0;   r[0][2] = -st;
+	r[1][0] = 0;   r[1][1] = 1;   r[1][2] = 0;
+	r[2][0] = st;  r[2][1] = 0;   r[2][2] = ct;
+    }
+
+    /* then C turns the table about Z */
+    for (i = 0; i < 3; i++) {
+	xf->m[0][i] =  cr * r[0][i] + sr * r[1][i];
+	xf->m[1][i] = -sr * r[0][i] + cr * r[1][i];
+	xf->m[2][i] =  r[2][i];
+    }
+
+    /* the tilt is about the pivot: t = rc * (p - r * p),
+       and back again ti = p - r^T * p */
+    for (i = 0; i < 3; i++) {
+	rp[i] = r[i][0] * xf->pivot[0] + r[i][1] * xf->pivot[1]
+	      + r[i][2] * xf->pivot[2];
+	q[i] = xf->pivot[i] - rp[i];
+	xf->ti[i] = xf->pivot[i] - (r[0][i] * xf->pivot[0]
+	      + r[1][i] * xf->pivot[1] + r[2][i] * xf->pivot[2]);
+    }
+    xf->t[0] =  cr * q[0] + sr * q[1];
+    xf->t[1] = -sr * q[0] + cr * q[1];
+    xf->t[2] =  q[2];
+    xf->valid = 1;
+}
+
+const trt_xform_t *trt_xform(trt_kins_t *k, double tilt, double rot,
+			     const double pivot[3])
+{
+    trt_xform_t *xf;
+    int n;
+
+    for (n = 0; n < TRT_XFORMS; n++) {
+	xf = &k->xf[n];
+	if (xf->valid && xf->tilt == tilt && xf->rot == rot
+	    && xf->pivot[0] == pivot[0] && xf->pivot[1] == pivot[1]
+	    && xf->pivot[2] == pivot[2]) {
+	    return xf;
+	}
+    }
+
+    xf = &k->xf[k->next];
+    k->next = (k->next + 1) % TRT_XFORMS;
+    xf->tilt = tilt;
+    xf->rot = rot;
+    xf->pivot[0] = pivot[0];
+    xf->pivot[1] = pivot[1];
+    xf->pivot[2] = pivot[2];
+    trt_build(k, xf);
+    return xf;
+}
+
+void trt_forward(const trt_xform_t *xf, const double joints[3],
+		 double world[3])
+{
+    int i;
+
+    for (i = 0; i < 3; i++) {
+	world[i] = xf->m[i][0] * joints[0] + xf->m[i][1] * joints[1]
+		 + xf->m[i][2] * joints[2] + xf->t[i];
+    }
+}
+
+void trt_inverse(const trt_xform_t *xf, const double world[3],
+		 double joints[3])
+{
+    int i;
+
+    for (i = 0; i < 3; i++) {
+	joints[i] = xf->m[0][i] * world[0] + xf->m[1][i] * world[1]
+		  + xf->m[2][i] * world[2] + xf->ti[i];
+    }
+}
@@ -0,0 +1,81 @@
+/********************************************************************
+* Description: trtfuncs.h
+*   Shared math for the table rotary/tilting (trt) 5 axis kinematics
+*
+* License: GPL Version 2
+* System: Linux
+*
+*******************************************************************
+
+  xyzac-trt-kins and xyzbc-trt-kins describe the same machine: a
+  table that tilts (about X for A, about Y for B) around a pivot, with
+  a C rotary on it. For given rotary angles and pivot offsets the
+  whole chain is a rigid transform, world = m * joints + t, and its
+  inverse is joints = m^T * world + ti. trt_xform() builds both
+  directions at once and keeps the last few, so the forward and
+  inverse calls of one servo period share a single evaluation of the
+  trig, and a part machined 3+2 with the rotaries still never
+  recomputes it at all.
+
+  The tool length goes into the pivot's Z offset: with the table
+  tilted, the tool tip is what has to stay put (TCP). It is keyed
+  like the other offsets, so a tool change just builds a new
+  transform.
+
+  trt_angle() is the same cache for a single angle, used by 5axiskins
+  for its tilting head.
+*/
+
+#ifndef TRTFUNCS_H
+#define TRTFUNCS_H
+
+/* sin and cos of one angle, in degrees */
+typedef struct {
+    int valid;
+    double deg;
+    double s, c;
+} trt_angle_t;
+
+/* which way the table tilts */
+typedef enum {
+    TRT_TILT_A,			/* about X, xyzac */
+    TRT_TILT_B			/* about Y, xyzbc */
+} trt_tilt_t;
+
+typedef struct {
+    int valid;
+    /* what the transform was built for */
+    double tilt, rot;		/* degrees */
+    double pivot[3];
+    /* world = m * joints + t, joints = m^T * world + ti */
+    double m[3][3];
+    double t[3], ti[3];
+} trt_xform_t;
+
+/* the forward and inverse of one servo period usually differ only by
+   the following error, so keep room for both */
+#define TRT_XFORMS 2
+
+typedef struct {
+    trt_tilt_t tilt_axis;
+    trt_xform_t xf[TRT_XFORMS];
+    int next;
+} trt_kins_t;
+
+extern void trt_init(trt_kins_t *k, trt_tilt_t tilt_axis);
+
+/* sin and cos of deg, recomputed only when the angle changed */
+extern void trt_angle(trt_angle_t *a, double deg);
+
+/* The transform for tilt and rot (degrees) about pivot: for xyzac the
+   pivot is (0, y-offset, z-offset + tool-offset), for xyzbc
+   (x-offset, 0, z-offset + tool-offset). */
+extern const trt_xform_t *trt_xform(trt_kins_t *k, double tilt, double rot,
+				    const double pivot[3]);
+
+extern void trt_forward(const trt_xform_t *xf, const double joints[3],
+			double world[3]);
+extern void trt_inverse(const trt_xform_t *xf, const double world[3],
+			double joints[3]);
+
+#endif /* TRTFUNCS_H */
@@ -0,0 +1,370 @@
+/********************************************************************
+* Description: userkins.cc
+*   Batch kinematics from userspace, using the realtime kinematics
+*   modules themselves.  See userkins.h.
+*
+* License: GPL Version 2
+* System: Linux
+*
+*******************************************************************/
+
+#include <dlfcn.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "config.h"
+#include "userkins.h"
+
+/* found where libuserkins itself is, through its run path in a run in
+   place tree and the library cache once installed */
+#define USERKINS_HAL "libuserkins-hal.so.0"
+
+/* below this many poses per copy, threads cost more than they save */
+#define USERKINS_MIN_SLICE 256
+
+typedef int (*kins_forward_t)(const double *, EmcPose *,
+	const KINEMATICS_FORWARD_FLAGS *, KINEMATICS_INVERSE_FLAGS *);
+typedef int (*kins_inverse_t)(const EmcPose *, double *,
+	const KINEMATICS_INVERSE_FLAGS *, KINEMATICS_FORWARD_FLAGS *);
+
+struct kins_copy {
+    void *hal;
+    void *module;
+    kins_forward_t forward;
+    kins_inverse_t inverse;
+    KINEMATICS_TYPE (*type)(void);
+    int (*set)(const char *, double);
+    int (*get)(const char *, double *);
+    const char *(*name)(int);
+};
+
+struct userkins {
+    std::string key;
+    int refcount;
+    std::vector<kins_copy> copies;
+    pthread_mutex_t lock;	// one caller at a time on the copies
+};
+
+/*
+  glibc does not give back a namespace's static TLS when it is closed,
+  so a process can only ever create a handful of them. Loaded modules
+  are therefore kept for the life of the process and handed out again
+  to the next userkins_load() with the same module and parameters.
+*/
+static std::map<std::string, userkins_t *> loaded;
+static pthread_mutex_t loaded_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+template<class T> static T sym(void *handle, const char *name) {
+    return (T)(dlsym(handle, name));
+}
+
+/* module parameters, the same way rtapi_app hands them to loadrt */
+static int set_one_arg(void *module, const std::string &arg)
+{
+    size_t eq = arg.find('=');
+    if (eq == std::string::npos) {
+	fprintf(stderr, "userkins: invalid parameter `%s'\n", arg.c_str());
+	return -1;
+    }
+    std::string name(arg, 0, eq), value(arg, eq + 1);
+    void *item = sym<void*>(module, ("rtapi_info_address_" + name).c_str());
+    char **type = sym<char**>(module, ("rtapi_info_type_" + name).c_str());
+    int *max_size = sym<int*>(module, ("rtapi_info_size_" + name).c_str());
+    if (!item || !type || !*type) {
+	fprintf(stderr, "userkins: unknown parameter `%s'\n", arg.c_str());
+	return -1;
+    }
+
+    size_t pos = 0;
+    for (int idx = 0; pos != std::string::npos; idx++) {
+	if (max_size ? idx == *max_size : idx == 1) {
+	    fprintf(stderr, "userkins: too many values for `%s'\n", name.c_str());
+	    return -1;
+	}
+	size_t comma = max_size ? value.find(',', pos) : std::string::npos;
+	std::string one(value, pos, comma == std::string::npos ? std::string::npos : comma - pos);
+	char *endp;
+	switch (**type) {
+	case 'l': (*(long **) item)[idx] = strtol(one.c_str(), &endp, 0); break;
+	case 'i': (*(int **) item)[idx] = strtol(one.c_str(), &endp, 0); break;
+	case 's': (*(char ***) item)[idx] = strdup(one.c_str()); endp = (char *) ""; break;
+	default:
+	    fprintf(stderr, "userkins: `%s' has unknown type\n", name.c_str());
+	    return -1;
+	}
+	if (*endp) {
+	    fprintf(stderr, "userkins: `%s' invalid for parameter `%s'\n",
+		one.c_str(), name.c_str());
+	    return -1;
+	}
+	pos = comma == std::string::npos ? comma : comma + 1;
+    }
+    return 0;
+}
+
+/*
+  Each copy lives in a namespace of its own. The first object loaded
+  into a new namespace makes up its global scope, so loading the
+  stand-in HAL first lets the module's undefined hal_* and rtapi_*
+  symbols resolve to it.
+*/
+static int load_copy(const char *module, int argc, const char *const *argv,
+	kins_copy &c)
+{
+    char path[PATH_MAX];
+    Lmid_t lmid;
+
+    memset(&c, 0, sizeof(c));
+
+    c.hal = dlmopen(LM_ID_NEWLM, USERKINS_HAL, RTLD_NOW);
+    if (!c.hal) {
+	fprintf(stderr, "userkins: %s\n", dlerror());
+	return -1;
+    }
+    if (dlinfo(c.hal, RTLD_DI_LMID, &lmid) != 0) {
+	fprintf(stderr, "userkins: %s\n", dlerror());
+	return -1;
+    }
+    c.set = sym<int(*)(const char *, double)>(c.hal, "userkins_hal_set");
+    c.get = sym<int(*)(const char *, double *)>(c.hal, "userkins_hal_get");
+    c.name = sym<const char *(*)(int)>(c.hal, "userkins_hal_name");
+
+    if (strchr(module, '/'))
+	snprintf(path, sizeof(path), "%s", module);
+    else
+	snprintf(path, sizeof(path), "%s/%s.so", EMC2_RTLIB_DIR, module);
+    c.module = dlmopen(lmid, path, RTLD_NOW);
+    if (!c.module) {
+	fprintf(stderr, "userkins: %s: %s\n", module, dlerror());
+	return -1;
+    }
+    c.forward = sym<kins_forward_t>(c.module, "kinematicsForward");
+    c.inverse = sym<kins_inverse_t>(c.module, "kinematicsInverse");
+    c.type = sym<KINEMATICS_TYPE(*)(void)>(c.module, "kinematicsType");
+    int (*start)(void) = sym<int(*)(void)>(c.module, "rtapi_app_main");
+    if (!c.forward || !c.inverse || !c.type || !start) {
+	fprintf(stderr, "userkins: %s is not a kinematics module\n", module);
+	return -1;
+    }
+
+    for (int i = 0; i < argc; i++) {
+	std::string arg(argv[i]);
+	arg.erase(std::remove(arg.begin(), arg.end(), '"'), arg.end());
+	if (set_one_arg(c.module, arg) < 0)
+	    return -1;
+    }
+
+    int result = start();
+    if (result < 0) {
+	fprintf(stderr, "userkins: %s: rtapi_app_main: %s (%d)\n",
+	    module, strerror(-result), result);
+	return -1;
+    }
+    return 0;
+}
+
+static void unload_copy(kins_copy &c)
+{
+    if (c.module) {
+	void (*stop)(void) = sym<void(*)(void)>(c.module, "rtapi_app_exit");
+	if (stop) stop();
+	dlclose(c.module);
+    }
+    if (c.hal) dlclose(c.hal);
+}
+
+userkins_t *userkins_load(const char *module, int argc,
+	const char *const *argv, int copies)
+{
+    if (copies <= 0) copies = sysconf(_SC_NPROCESSORS_ONLN);
+    if (copies <= 0) copies = 1;
+    if (copies > USERKINS_MAX_COPIES) copies = USERKINS_MAX_COPIES;
+
+    std::string key(module);
+    for (int i = 0; i < argc; i++)
+	key += std::string(" ") + argv[i];
+
+    pthread_mutex_lock(&loaded_mutex);
+    userkins_t *k = loaded[key];
+    if (k) {
+	k->refcount++;
+	pthread_mutex_unlock(&loaded_mutex);
+	return k;
+    }
+
+    k = new userkins;
+    k->key = key;
+    k->refcount = 1;
+    pthread_mutex_init(&k->lock, NULL);
+    for (int i = 0; i < copies; i++) {
+	kins_copy c;
+	if (load_copy(module, argc, argv, c) < 0) {
+	    unload_copy(c);
+	    /* running out of namespaces is not fatal once one copy works */
+	    if (i > 0) break;
+	    delete k;
+	    loaded.erase(key);
+	    pthread_mutex_unlock(&loaded_mutex);
+	    return NULL;
+	}
+	k->copies.push_back(c);
+    }
+    loaded[key] = k;
+    pthread_mutex_unlock(&loaded_mutex);
+    return k;
+}
+
+/* the copies stay loaded for reuse, see above */
+void userkins_unload(userkins_t *k)
+{
+    if (!k) return;
+    pthread_mutex_lock(&loaded_mutex);
+    k->refcount--;
+    pthread_mutex_unlock(&loaded_mutex);
+}
+
+int userkins_copies(userkins_t *k)
+{
+    return k->copies.size();
+}
+
+KINEMATICS_TYPE userkins_type(userkins_t *k)
+{
+    return k->copies[0].type();
+}
+
+int userkins_set(userkins_t *k, const char *name, double value)
+{
+    int result = 0;
+
+    pthread_mutex_lock(&k->lock);
+    for (size_t i = 0; i < k->copies.size() && result >= 0; i++)
+	result = k->copies[i].set(name, value);
+    pthread_mutex_unlock(&k->lock);
+    return result < 0 ? result : 0;
+}
+
+int userkins_get(userkins_t *k, const char *name, double *value)
+{
+    pthread_mutex_lock(&k->lock);
+    int result = k->copies[0].get(name, value);
+    pthread_mutex_unlock(&k->lock);
+    return result;
+}
+
+const char *userkins_name(userkins_t *k, int i)
+{
+    return k->copies[0].name(i);
+}
+
+namespace {
+struct slice {
+    kins_copy *copy;
+    bool inverse;
+    int flags;
+    const double *joints_in;
+    double *joints;
+    const EmcPose *pos_in;
+    EmcPose *pos;
+    int *result;
+    long start, end;
+    long failed;
+    bool threaded;
+    pthread_t thread;
+};
+}
+
+static void *run_slice(void *arg)
+{
+    slice *s = (slice *) arg;
+    KINEMATICS_FORWARD_FLAGS fflags = 0;
+    KINEMATICS_INVERSE_FLAGS iflags = 0;
+
+    s->failed = 0;
+    for (long i = s->start; i < s->end; i++) {
+	int r;
+	if (s->inverse) {
+	    double *j = s->joints + i * USERKINS_JOINTS;
+	    if ((s->flags & USERKINS_SEED_PREVIOUS) && i > 0)
+		memcpy(j, j - USERKINS_JOINTS, USERKINS_JOINTS * sizeof(*j));
+	    r = s->copy->inverse(&s->pos_in[i], j, &iflags, &fflags);
+	} else {
+	    r = s->copy->forward(s->joints_in + i * USERKINS_JOINTS,
+		&s->pos[i], &fflags, &iflags);
+	}
+	if (s->result) s->result[i] = r;
+	if (r != 0) s->failed++;
+    }
+    return NULL;
+}
+
+static long run_batch(userkins_t *k, slice proto, long n)
+{
+    long per_copy = (n + k->copies.size() - 1) / k->copies.size();
+    if (per_copy < USERKINS_MIN_SLICE) per_copy = USERKINS_MIN_SLICE;
+    /* a path is followed from one pose to the next */
+    if (proto.flags & USERKINS_SEED_PREVIOUS) per_copy = n;
+
+    pthread_mutex_lock(&k->lock);
+    std::vector<slice> slices;
+    for (long start = 0; start < n; start += per_copy) {
+	slice s = proto;
+	s.copy = &k->copies[slices.size()];
+	s.start = start;
+	s.end = start + per_copy < n ? start + per_copy : n;
+	slices.push_back(s);
+    }
+
+    /* the calling thread takes the first slice itself */
+    for (size_t i = 1; i < slices.size(); i++) {
+	slices[i].threaded =
+	    pthread_create(&slices[i].thread, NULL, run_slice, &slices[i]) == 0;
+	if (!slices[i].threaded)
+	    run_slice(&slices[i]);
+    }
+    long failed = 0;
+    if (!slices.empty()) {
+	run_slice(&slices[0]);
+	failed = slices[0].failed;
+    }
+    for (size_t i = 1; i < slices.size(); i++) {
+	if (slices[i].threaded) pthread_join(slices[i].thread, NULL);
+	failed += slices[i].failed;
+    }
+    pthread_mutex_unlock(&k->lock);
+    return failed;
+}
+
+long userkins_forward(userkins_t *k, const double *joints, EmcPose *pos,
+	int *result, long n)
+{
+    slice s;
+    memset(&s, 0, sizeof(s));
+    s.joints_in = joints;
+    s.pos = pos;
+    s.result = result;
+    return run_batch(k, s, n);
+}
+
+long userkins_inverse(userkins_t *k, const EmcPose *pos, double *joints,
+	int *result, long n, int flags)
+{
+    slice s;
+    memset(&s, 0, sizeof(s));
+    s.inverse = true;
+    s.flags = flags;
+    s.pos_in = pos;
+    s.joints = joints;
+    s.result = result;
+    return run_batch(k, s, n);
+}
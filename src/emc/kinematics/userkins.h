@@ -0,0 +1,102 @@
+/********************************************************************
+* Description: userkins.h
+*   Batch kinematics from userspace, using the realtime kinematics
+*   modules themselves
+*
+* License: GPL Version 2
+* System: Linux
+*
+*******************************************************************
+
+  The kinematics modules only expose kinematicsForward() and
+  kinematicsInverse() for one pose at a time, to the servo thread.
+  userkins loads an unmodified module (the uspace .so from the rtlib
+  directory) into the calling process, against a private stand-in
+  for HAL, and transforms whole arrays of poses with it. Previews,
+  backplots and whole-program limit checks can then use the same
+  kinematics code as motion does.
+
+  Modules keep their state in globals, so to use more than one core
+  each worker gets its own copy of the module, loaded into its own
+  link map namespace with dlmopen(). Pins and parameters the module
+  creates are set by name on all copies with userkins_set(), e.g. from
+  the values in the running HAL, or from the INI file.
+
+  The copies of a module are shared by every userkins_load() of it
+  with the same parameters, so calls on a userkins_t from several
+  threads take turns: each batch, and each userkins_set(), runs on its
+  own.
+
+  Only available with BUILD_SYS=uspace, where modules are shared
+  objects.
+*/
+
+#ifndef USERKINS_H
+#define USERKINS_H
+
+#include "emcpos.h"
+#include "kinematics.h"
+#include "emcmotcfg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* joints per pose in the batch arrays, as kinematicsForward() expects */
+#define USERKINS_JOINTS EMCMOT_MAX_JOINTS
+
+/* glibc allows 16 namespaces per process, leave some for others */
+#define USERKINS_MAX_COPIES 8
+
+/* userkins_inverse() flags: seed each pose with the solution for the
+   one before it, rather than with the joints passed in, as the servo
+   thread does when following a path. Only the first pose's joints are
+   used as the seed. Each solution needs the one before it, so the
+   path is solved in order on one copy. */
+#define USERKINS_SEED_PREVIOUS 1
+
+typedef struct userkins userkins_t;
+
+/* Loads 'module', a module in the rtlib directory or the path of one,
+   with the given module parameters (as for loadrt, e.g.
+   "coordinates=xyzac"), once per copy. copies <= 0 means one per
+   online CPU. Returns NULL on failure, after printing why. */
+extern userkins_t *userkins_load(const char *module,
+				 int argc, const char *const *argv,
+				 int copies);
+
+/* Copies stay loaded for the life of the process, since namespaces
+   cannot be reclaimed, and a later userkins_load() with the same
+   module and parameters gets the same instance back. */
+extern void userkins_unload(userkins_t *k);
+
+extern int userkins_copies(userkins_t *k);
+
+extern KINEMATICS_TYPE userkins_type(userkins_t *k);
+
+/* Set or get a pin or parameter the module created, by its HAL name.
+   Setting applies to every copy. */
+extern int userkins_set(userkins_t *k, const char *name, double value);
+extern int userkins_get(userkins_t *k, const char *name, double *value);
+
+/* Name of the i'th pin or parameter the module created, or NULL */
+extern const char *userkins_name(userkins_t *k, int i);
+
+/* Transform n poses. joints holds n * USERKINS_JOINTS values. Each
+   entry of result, if not NULL, gets the module's return value for
+   that pose. Poses are split among the copies and run concurrently.
+   Returns the number of poses that failed.
+
+   For the inverse, joints holds the initial estimates on entry; only
+   iterative kinematics use them. */
+extern long userkins_forward(userkins_t *k, const double *joints,
+			     EmcPose * pos, int *result, long n);
+extern long userkins_inverse(userkins_t *k, const EmcPose * pos,
+			     double *joints, int *result, long n,
+			     int flags);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
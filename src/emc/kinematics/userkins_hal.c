@@ -0,0 +1,211 @@
+/********************************************************************
+* Description: userkins_hal.c
+*   A private stand-in for the HAL and RTAPI calls a kinematics module
+*   makes, so userkins can run the module outside of rtapi_app
+*
+* License: GPL Version 2
+* System: Linux
+*
+*******************************************************************
+
+  userkins loads one copy of this library, and one copy of the
+  kinematics module linked against it, into each of its link map
+  namespaces. Pins and parameters the module creates are plain
+  memory owned by this copy; the host reads and writes them by name
+  through userkins_hal_set() and userkins_hal_get(). Nothing here
+  touches the real HAL shared memory, so a GUI can run kinematics
+  without disturbing, or even needing, a running machine.
+*/
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "rtapi.h"
+#include "hal.h"
+
+#define USERKINS_MAX_ITEMS 256
+
+struct item {
+    char name[HAL_NAME_LEN + 1];
+    hal_type_t type;
+    volatile void *data;
+};
+
+static struct item items[USERKINS_MAX_ITEMS];
+static int nitems;
+static int next_comp_id = 1;
+
+static int add_item(const char *name, hal_type_t type, volatile void *data)
+{
+    if (nitems == USERKINS_MAX_ITEMS) {
+	rtapi_print_msg(RTAPI_MSG_ERR, "userkins: too many pins (%s)\n", name);
+	return -ENOMEM;
+    }
+    snprintf(items[nitems].name, sizeof(items[nitems].name), "%s", name);
+    items[nitems].type = type;
+    items[nitems].data = data;
+    nitems++;
+    return 0;
+}
+
+static struct item *find_item(const char *name)
+{
+    int i;
+
+    for (i = 0; i < nitems; i++) {
+	if (!strcmp(items[i].name, name))
+	    return &items[i];
+    }
+    return NULL;
+}
+
+/* pins get their own storage, as hal_malloc'd pin data would */
+static int new_pin(const char *name, hal_type_t type, void **data_ptr_addr,
+    size_t size)
+{
+    void *data = calloc(1, size);
+
+    if (!data)
+	return -ENOMEM;
+    *data_ptr_addr = data;
+    return add_item(name, type, data);
+}
+
+int userkins_hal_set(const char *name, double value)
+{
+    struct item *it = find_item(name);
+
+    if (!it)
+	return -ENOENT;
+    switch (it->type) {
+    case HAL_BIT: *(hal_bit_t *) it->data = value != 0; break;
+    case HAL_FLOAT: *(hal_float_t *) it->data = value; break;
+    case HAL_S32: *(hal_s32_t *) it->data = (rtapi_s32) value; break;
+    case HAL_U32: *(hal_u32_t *) it->data = (rtapi_u32) value; break;
+    default: return -EINVAL;
+    }
+    return 0;
+}
+
+int userkins_hal_get(const char *name, double *value)
+{
+    struct item *it = find_item(name);
+
+    if (!it)
+	return -ENOENT;
+    switch (it->type) {
+    case HAL_BIT: *value = *(hal_bit_t *) it->data; break;
+    case HAL_FLOAT: *value = *(hal_float_t *) it->data; break;
+    case HAL_S32: *value = *(hal_s32_t *) it->data; break;
+    case HAL_U32: *value = *(hal_u32_t *) it->data; break;
+    default: return -EINVAL;
+    }
+    return 0;
+}
+
+/* name of the i'th pin or parameter, or NULL past the end */
+const char *userkins_hal_name(int i)
+{
+    if (i < 0 || i >= nitems)
+	return NULL;
+    return items[i].name;
+}
+
+int hal_init(const char *name)
+{
+    return next_comp_id++;
+}
+
+int hal_ready(int comp_id)
+{
+    return 0;
+}
+
+int hal_exit(int comp_id)
+{
+    return 0;
+}
+
+void *hal_malloc(long int size)
+{
+    return calloc(1, size);
+}
+
+#define PIN_NEWF(type, ctype, htype) \
+int hal_pin_##type##_newf(hal_pin_dir_t dir, ctype ** data_ptr_addr, \
+    int comp_id, const char *fmt, ...) \
+{ \
+    char name[HAL_NAME_LEN + 1]; \
+    va_list ap; \
+    va_start(ap, fmt); \
+    vsnprintf(name, sizeof(name), fmt, ap); \
+    va_end(ap); \
+    return new_pin(name, htype, (void **) data_ptr_addr, sizeof(ctype)); \
+} \
+int hal_pin_##type##_new(const char *name, hal_pin_dir_t dir, \
+    ctype ** data_ptr_addr, int comp_id) \
+{ \
+    return new_pin(name, htype, (void **) data_ptr_addr, sizeof(ctype)); \
+}
+
+PIN_NEWF(bit, hal_bit_t, HAL_BIT)
+PIN_NEWF(float, hal_float_t, HAL_FLOAT)
+PIN_NEWF(s32, hal_s32_t, HAL_S32)
+PIN_NEWF(u32, hal_u32_t, HAL_U32)
+
+#define PARAM_NEWF(type, ctype, htype) \
+int hal_param_##type##_newf(hal_param_dir_t dir, ctype * data_addr, \
+    int comp_id, const char *fmt, ...) \
+{ \
+    char name[HAL_NAME_LEN + 1]; \
+    va_list ap; \
+    va_start(ap, fmt); \
+    vsnprintf(name, sizeof(name), fmt, ap); \
+    va_end(ap); \
+    return add_item(name, htype, data_addr); \
+} \
+int hal_param_##type##_new(const char *name, hal_param_dir_t dir, \
+    ctype * data_addr, int comp_id) \
+{ \
+    return add_item(name, htype, data_addr); \
+}
+
+PARAM_NEWF(bit, hal_bit_t, HAL_BIT)
+PARAM_NEWF(float, hal_float_t, HAL_FLOAT)
+PARAM_NEWF(s32, hal_s32_t, HAL_S32)
+PARAM_NEWF(u32, hal_u32_t, HAL_U32)
+
+static msg_level_t msg_level = RTAPI_MSG_ERR;
+
+void rtapi_print(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
+
+void rtapi_print_msg(msg_level_t level, const char *fmt, ...)
+{
+    va_list ap;
+
+    if (level > msg_level)
+	return;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+}
+
+int rtapi_set_msg_level(int level)
+{
+    msg_level = level;
+    return 0;
+}
+
+int rtapi_get_msg_level(void)
+{
+    return msg_level;
+}
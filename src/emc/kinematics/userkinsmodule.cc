@@ -0,0 +1,173 @@
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+// Python access to userkins, for previews and program checks:
+//
+//     import userkins
+//     k = userkins.Kins("genserkins")
+//     k.set("genserkins.A-2", 300)
+//     poses = k.forward([(j0, j1, j2, j3, j4, j5), ...])
+//     joints = k.inverse(poses, seed=(j0, j1, j2, j3, j4, j5))
+//
+// Poses are 9-tuples (x, y, z, a, b, c, u, v, w). Failed points come
+// back as None.
+
+#include <boost/python.hpp>
+#include <string>
+#include <vector>
+#include "userkins.h"
+
+using namespace boost::python;
+
+namespace {
+
+struct Kins {
+    userkins_t *k;
+
+    Kins(const std::string &module, object args, int copies) {
+        std::vector<std::string> strs;
+        for (int i = 0; i < len(args); i++)
+            strs.push_back(extract<std::string>(args[i]));
+        std::vector<const char *> argv;
+        for (size_t i = 0; i < strs.size(); i++)
+            argv.push_back(strs[i].c_str());
+
+        k = userkins_load(module.c_str(), argv.size(),
+                argv.empty() ? 0 : &argv[0], copies);
+        if (!k) {
+            PyErr_Format(PyExc_RuntimeError, "Could not load kinematics %s",
+                    module.c_str());
+            throw_error_already_set();
+        }
+    }
+
+    ~Kins() { userkins_unload(k); }
+
+    void set(const std::string &name, double value) {
+        if (userkins_set(k, name.c_str(), value) < 0) {
+            PyErr_Format(PyExc_KeyError, "%s", name.c_str());
+            throw_error_already_set();
+        }
+    }
+
+    double get(const std::string &name) {
+        double value;
+        if (userkins_get(k, name.c_str(), &value) < 0) {
+            PyErr_Format(PyExc_KeyError, "%s", name.c_str());
+            throw_error_already_set();
+        }
+        return value;
+    }
+
+    list names() {
+        list result;
+        const char *name;
+        for (int i = 0; (name = userkins_name(k, i)); i++)
+            result.append(name);
+        return result;
+    }
+
+    int type() { return userkins_type(k); }
+    int copies() { return userkins_copies(k); }
+
+    list forward(object joints) {
+        long n = len(joints);
+        if (!n) return list();
+        std::vector<double> j(n * USERKINS_JOINTS);
+        std::vector<EmcPose> pos(n);
+        std::vector<int> result(n);
+        for (long i = 0; i < n; i++) {
+            object row = joints[i];
+            int m = len(row);
+            for (int a = 0; a < m && a < USERKINS_JOINTS; a++)
+                j[i * USERKINS_JOINTS + a] = extract<double>(row[a]);
+        }
+
+        Py_BEGIN_ALLOW_THREADS
+        userkins_forward(k, &j[0], &pos[0], &result[0], n);
+        Py_END_ALLOW_THREADS
+
+        list out;
+        for (long i = 0; i < n; i++) {
+            if (result[i]) {
+                out.append(object());
+                continue;
+            }
+            const EmcPose &p = pos[i];
+            out.append(make_tuple(p.tran.x, p.tran.y, p.tran.z,
+                        p.a, p.b, p.c, p.u, p.v, p.w));
+        }
+        return out;
+    }
+
+    // Iterative kinematics start from seed, and then follow the path
+    list inverse(object poses, object seed) {
+        long n = len(poses);
+        if (!n) return list();
+        std::vector<double> j(n * USERKINS_JOINTS);
+        std::vector<EmcPose> pos(n);
+        std::vector<int> result(n);
+        for (long i = 0; i < n; i++) {
+            object row = poses[i];
+            double v[9] = {0};
+            int m = len(row);
+            for (int a = 0; a < m && a < 9; a++)
+                v[a] = extract<double>(row[a]);
+            EmcPose &p = pos[i];
+            p.tran.x = v[0]; p.tran.y = v[1]; p.tran.z = v[2];
+            p.a = v[3]; p.b = v[4]; p.c = v[5];
+            p.u = v[6]; p.v = v[7]; p.w = v[8];
+        }
+        if (!seed.is_none()) {
+            int m = len(seed);
+            for (int a = 0; a < m && a < USERKINS_JOINTS; a++)
+                j[a] = extract<double>(seed[a]);
+        }
+
+        Py_BEGIN_ALLOW_THREADS
+        userkins_inverse(k, &pos[0], &j[0], &result[0], n,
+                USERKINS_SEED_PREVIOUS);
+        Py_END_ALLOW_THREADS
+
+        list out;
+        for (long i = 0; i < n; i++) {
+            if (result[i]) {
+                out.append(object());
+                continue;
+            }
+            list row;
+            for (int a = 0; a < USERKINS_JOINTS; a++)
+                row.append(j[i * USERKINS_JOINTS + a]);
+            out.append(tuple(row));
+        }
+        return out;
+    }
+};
+
+}
+
+BOOST_PYTHON_MODULE(userkins)
+{
+    class_<Kins, boost::noncopyable>("Kins",
+            init<std::string, object, int>(
+                (arg("module"), arg("args")=tuple(), arg("copies")=0)))
+        .def("set", &Kins::set)
+        .def("get", &Kins::get)
+        .def("names", &Kins::names)
+        .def("type", &Kins::type)
+        .def("copies", &Kins::copies)
+        .def("forward", &Kins::forward)
+        .def("inverse", &Kins::inverse, (arg("poses"), arg("seed")=object()))
+        ;
+}
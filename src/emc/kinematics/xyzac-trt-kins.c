@@ -29,6 +29,7 @@
 #include "rtapi.h"
 #include "rtapi_math.h"
 #include "rtapi_app.h"
+#include "trtfuncs.h"
 
 // joint number assignments
 static int JX = -1;
@@ -44,33 +45,35 @@ struct haldata {
     hal_float_t *tool_offset;
 } *haldata;
 
+static trt_kins_t trt;
+
+/* the tool length moves the pivot, so that the tool tip is the point
+   the table turns about */
+static const trt_xform_t *xform(double a, double c)
+{
+    double pivot[3];
+
+    pivot[0] = 0;
+    pivot[1] = *(haldata->y_offset);
+    pivot[2] = *(haldata->z_offset) + *(haldata->tool_offset);
+    return trt_xform(&trt, a, c, pivot);
+}
+
 int kinematicsForward(const double *joints,
                       EmcPose * pos,
                       const KINEMATICS_FORWARD_FLAGS * fflags,
                       KINEMATICS_INVERSE_FLAGS * iflags)
 {
-    double    dy = *(haldata->y_offset);
-    double    dz = *(haldata->z_offset);
-    double    dt = *(haldata->tool_offset);
-    double a_rad = joints[JA]*TO_RAD;
-    double c_rad = joints[JC]*TO_RAD;
+    double j[3], w[3];
 
-    dz = dz + dt;
+    j[0] = joints[JX];
+    j[1] = joints[JY];
+    j[2] = joints[JZ];
+    trt_forward(xform(joints[JA], joints[JC]), j, w);
 
-    pos->tran.x = + cos(c_rad)              * (joints[JX]     )
-                  + sin(c_rad) * cos(a_rad) * (joints[JY] - dy)
-                  + sin(c_rad) * sin(a_rad) * (joints[JZ] - dz)
-                  + sin(c_rad) * dy;
-
-    pos->tran.y = - sin(c_rad)              * (joints[JX]     )
-                  + cos(c_rad) * cos(a_rad) * (joints[JY] - dy)
-                  + cos(c_rad) * sin(a_rad) * (joints[JZ] - dz)
-                  + cos(c_rad) * dy;
-
-    pos->tran.z = + 0
-                  - sin(a_rad) * (joints[JY] - dy)
-                  + cos(a_rad) * (joints[JZ] - dz)
-                  + dz;
+    pos->tran.x = w[0];
+    pos->tran.y = w[1];
+    pos->tran.z = w[2];
 
     pos->a = joints[JA];
     pos->c = joints[JC];
@@ -88,29 +91,16 @@ int kinematicsInverse(const EmcPose * pos,
                       const KINEMATICS_INVERSE_FLAGS * iflags,
                       KINEMATICS_FORWARD_FLAGS * fflags)
 {
-    double    dz = *(haldata->z_offset);
-    double    dy = *(haldata->y_offset);
-    double    dt = *(haldata->tool_offset);
-    double c_rad = pos->c*TO_RAD;
-    double a_rad = pos->a*TO_RAD;
-
-    dz = dz + dt;
-
-    joints[JX] = + cos(c_rad) * pos->tran.x
-                 - sin(c_rad) * pos->tran.y;
-
-    joints[JY] = + sin(c_rad) * cos(a_rad) * pos->tran.x
-                 + cos(c_rad) * cos(a_rad) * pos->tran.y
-                 - sin(a_rad)              * pos->tran.z
-                 - cos(a_rad) * dy
-                 + sin(a_rad) * dz + dy;
-
-    joints[JZ] = + sin(c_rad) * sin(a_rad) * pos->tran.x
-                 + cos(c_rad) * sin(a_rad) * pos->tran.y
-                 + cos(a_rad)              * pos->tran.z
-                 - sin(a_rad) * dy
-                 - cos(a_rad) * dz
-                 + dz;
+    double j[3], w[3];
+
+    w[0] = pos->tran.x;
+    w[1] = pos->tran.y;
+    w[2] = pos->tran.z;
+    trt_inverse(xform(pos->a, pos->c), w, j);
+
+    joints[JX] = j[0];
+    joints[JY] = j[1];
+    joints[JZ] = j[2];
 
     joints[JA] = pos->a;
     joints[JC] = pos->c;
@@ -163,6 +153,8 @@ static int axis_idx_for_jno[EMCMOT_MAX_JOINTS];
         return -1;
     }
 
+    trt_init(&trt, TRT_TILT_A);
+
     comp_id = hal_init("xyzac-trt-kins");
     if(comp_id < 0) return comp_id;
 
@@ -29,6 +29,7 @@
 #include "rtapi.h"
 #include "rtapi_math.h"
 #include "rtapi_app.h"
+#include "trtfuncs.h"
 
 // joint number assignments
 static int JX = -1;
@@ -44,32 +45,35 @@ struct haldata {
     hal_float_t *tool_offset;
 } *haldata;
 
+static trt_kins_t trt;
+
+/* the tool length moves the pivot, so that the tool tip is the point
+   the table turns about */
+static const trt_xform_t *xform(double b, double c)
+{
+    double pivot[3];
+
+    pivot[0] = *(haldata->x_offset);
+    pivot[1] = 0;
+    pivot[2] = *(haldata->z_offset) + *(haldata->tool_offset);
+    return trt_xform(&trt, b, c, pivot);
+}
+
 int kinematicsForward(const double *joints,
                       EmcPose * pos,
                       const KINEMATICS_FORWARD_FLAGS * fflags,
                       KINEMATICS_INVERSE_FLAGS * iflags)
 {
-    double    dx = *(haldata->x_offset);
-    double    dz = *(haldata->z_offset);
-    double    dt = *(haldata->tool_offset);
-              dz = dz + dt;
-    double b_rad = joints[JB]*TO_RAD;
-    double c_rad = joints[JC]*TO_RAD;
+    double j[3], w[3];
 
+    j[0] = joints[JX];
+    j[1] = joints[JY];
+    j[2] = joints[JZ];
+    trt_forward(xform(joints[JB], joints[JC]), j, w);
 
-    pos->tran.x =   cos(c_rad) * cos(b_rad) * (joints[JX] - dx)
-                  + sin(c_rad) *              (joints[JY])
-                  - cos(c_rad) * sin(b_rad) * (joints[JZ] - dz)
-                  + cos(c_rad) * dx;
-
-    pos->tran.y = - sin(c_rad) * cos(b_rad) * (joints[JX] - dx)
-                  + cos(c_rad) *              (joints[JY])
-                  + sin(c_rad) * sin(b_rad) * (joints[JZ] - dz)
-                  - sin(c_rad) * dx;
-
-    pos->tran.z =   sin(b_rad) * (joints[JX] - dx)
-                  + cos(b_rad) * (joints[JZ] - dz)
-                  + dz;
+    pos->tran.x = w[0];
+    pos->tran.y = w[1];
+    pos->tran.z = w[2];
 
     pos->b = joints[JB];
     pos->c = joints[JC];
@@ -87,31 +91,19 @@ int kinematicsInverse(const EmcPose * pos,
                       const KINEMATICS_INVERSE_FLAGS * iflags,
                       KINEMATICS_FORWARD_FLAGS * fflags)
 {
-    double    dx = *(haldata->x_offset);
-    double    dz = *(haldata->z_offset);
-    double    dt = *(haldata->tool_offset);
-              dz = dz + dt;
-    double b_rad = pos->b*TO_RAD;
-    double c_rad = pos->c*TO_RAD;
-    double   dpx = -cos(b_rad)*dx - sin(b_rad)*dz + dx;
-    double   dpz = sin(b_rad)*dx - cos(b_rad)*dz + dz;
-
+    double j[3], w[3];
 
-    joints[JX] =   cos(c_rad) * cos(b_rad) * (pos->tran.x)
-                 - sin(c_rad) * cos(b_rad) * (pos->tran.y)
-                 + sin(b_rad) * (pos->tran.z)
-                 + dpx;
+    w[0] = pos->tran.x;
+    w[1] = pos->tran.y;
+    w[2] = pos->tran.z;
+    trt_inverse(xform(pos->b, pos->c), w, j);
 
-    joints[JY] =   sin(c_rad) * (pos->tran.x)
-                 + cos(c_rad) * (pos->tran.y);
-
-    joints[JZ] = - cos(c_rad) * sin(b_rad) * (pos->tran.x)
-                 + sin(c_rad) * sin(b_rad) * (pos->tran.y)
-                 + cos(b_rad) * (pos->tran.z)
-                 + dpz;
+    joints[JX] = j[0];
+    joints[JY] = j[1];
+    joints[JZ] = j[2];
 
     joints[JB] = pos->b;
-    joints[JC] = pos->c ;
+    joints[JC] = pos->c;
 
     return 0;
 }
@@ -160,6 +152,8 @@ static int axis_idx_for_jno[EMCMOT_MAX_JOINTS];
         return -1;
     }
 
+    trt_init(&trt, TRT_TILT_B);
+
     comp_id = hal_init("xyzbc-trt-kins");
 
     if(comp_id < 0) return comp_id;
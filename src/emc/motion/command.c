@@ -400,11 +400,18 @@ STATIC int is_feed_type(int motion_type)
     }
 }
 
+/* planner queue slots left before it counts as full */
+static int planner_room(void)
+{
+    return tcqRoom(&emcmotDebug->coord_tp.queue);
+}
+
 /*
-  emcmotCommandHandler() is called each main cycle to read the
-  shared memory buffer
+  process_command() carries out emcmotCommand, which is either the
+  shared memory buffer or, if queued is set, a command from the
+  command queue
   */
-void emcmotCommandHandler(void *arg, long period)
+static void process_command(int queued)
 {
     int joint_num, axis_num, spindle_num;
     int n;
@@ -417,18 +424,20 @@ void emcmotCommandHandler(void *arg, long period)
     char* emsg = "";
 
     /* check for split read */
-    if (emcmotCommand->head != emcmotCommand->tail) {
+    if (!queued && emcmotCommand->head != emcmotCommand->tail) {
 	emcmotDebug->split++;
 	return;			/* not really an error */
     }
-    if (emcmotCommand->commandNum != emcmotStatus->commandNumEcho) {
+    if (queued || emcmotCommand->commandNum != emcmotStatus->commandNumEcho) {
 	/* increment head count-- we'll be modifying emcmotStatus */
 	emcmotStatus->head++;
 	emcmotDebug->head++;
 
 	/* got a new command-- echo command and number... */
-	emcmotStatus->commandEcho = emcmotCommand->command;
-	emcmotStatus->commandNumEcho = emcmotCommand->commandNum;
+	if (!queued) {
+	    emcmotStatus->commandEcho = emcmotCommand->command;
+	    emcmotStatus->commandNumEcho = emcmotCommand->commandNum;
+	}
 
 	/* clear status value by default */
 	emcmotStatus->commandStatus = EMCMOT_COMMAND_OK;
@@ -534,6 +543,8 @@ void emcmotCommandHandler(void *arg, long period)
 	       planners which stops joint motion */
 	    rtapi_print_msg(RTAPI_MSG_DBG, "ABORT");
 	    rtapi_print_msg(RTAPI_MSG_DBG, " %d", joint_num);
+	    /* take queued moves again */
+	    emcmotCommandQueue->failed = 0;
 	    /* check for coord or free space motion active */
 	    if (GET_MOTION_TELEOP_FLAG()) {
 		for (axis_num = 0; axis_num < EMCMOT_MAX_AXIS; axis_num++) {
@@ -697,6 +708,7 @@ void emcmotCommandHandler(void *arg, long period)
 	                            emcmotCommand->latch_vel,
 	                            emcmotCommand->flags,
 	                            emcmotCommand->home_sequence,
+	                            emcmotCommand->home_after,
 	                            emcmotCommand->volatile_home
 	                           );
 	    break;
@@ -1100,6 +1112,7 @@ void emcmotCommandHandler(void *arg, long period)
 	    /* emcmotDebug->coord_tp up a linear move */
 	    /* requires motion enabled, coordinated mode, not on limits */
 	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_LINE");
+	    emcmotTracePut(emcmotTrace, EMCMOT_TRACE_RECEIVE, emcmotCommand->id);
 	    if (!GET_MOTION_COORD_FLAG() || !GET_MOTION_ENABLE_FLAG()) {
 		reportError(_("need to be enabled, in coord mode for linear move"));
 		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
@@ -1150,6 +1163,7 @@ void emcmotCommandHandler(void *arg, long period)
                 emcmotStatus->atspeed_next_feed = 1;
             }
         } else {
+		emcmotTracePut(emcmotTrace, EMCMOT_TRACE_ADD, emcmotCommand->id);
 		SET_MOTION_ERROR_FLAG(0);
 		/* set flag that indicates all joints need rehoming, if any
 		   joint is moved in joint mode, for machines with no forward
@@ -1162,6 +1176,7 @@ void emcmotCommandHandler(void *arg, long period)
 	    /* emcmotDebug->coord_tp up a circular move */
 	    /* requires coordinated mode, enable on, not on limits */
 	    rtapi_print_msg(RTAPI_MSG_DBG, "SET_CIRCLE");
+	    emcmotTracePut(emcmotTrace, EMCMOT_TRACE_RECEIVE, emcmotCommand->id);
 	    if (!GET_MOTION_COORD_FLAG() || !GET_MOTION_ENABLE_FLAG()) {
 		reportError(_("need to be enabled, in coord mode for circular move"));
 		emcmotStatus->commandStatus = EMCMOT_COMMAND_INVALID_COMMAND;
@@ -1206,6 +1221,7 @@ void emcmotCommandHandler(void *arg, long period)
                 emcmotStatus->atspeed_next_feed = 1;
             }
         } else {
+		emcmotTracePut(emcmotTrace, EMCMOT_TRACE_ADD, emcmotCommand->id);
 		SET_MOTION_ERROR_FLAG(0);
 		/* set flag that indicates all joints need rehoming, if any
 		   joint is moved in joint mode, for machines with no forward
@@ -2003,3 +2019,43 @@ void emcmotCommandHandler(void *arg, long period)
 
     return;
 }
+
+/* a move from the command queue, reports if it failed */
+static int run_queued_command(emcmot_command_t * c)
+{
+    emcmotCommand = c;
+    process_command(1);
+    return emcmotStatus->commandStatus != EMCMOT_COMMAND_OK;
+}
+
+/* the moves queued behind the shared memory buffer, as many as the
+   planner has room for, up to the batch size */
+static void process_queued_commands(void)
+{
+    emcmot_command_queue_t *queue = emcmotCommandQueue;
+    emcmot_command_t *buffer = emcmotCommand;
+    int status = emcmotStatus->commandStatus;
+    int fill = emcmotCommandQueueLen(queue);
+    int n;
+
+    *(emcmot_hal_data->command_queue_fill) = fill;
+    if (fill > *(emcmot_hal_data->command_queue_max_fill)) {
+	*(emcmot_hal_data->command_queue_max_fill) = fill;
+    }
+
+    n = emcmotCommandQueueRun(queue, run_queued_command, planner_room);
+    emcmotCommand = buffer;
+    /* that is for the shared memory buffer, which usr space may read */
+    emcmotStatus->commandStatus = status;
+    *(emcmot_hal_data->command_queue_taken) = n;
+}
+
+/*
+  emcmotCommandHandler() is called each main cycle to read the
+  shared memory buffer and the command queue behind it
+  */
+void emcmotCommandHandler(void *arg, long period)
+{
+    process_command(0);
+    process_queued_commands();
+}
@@ -23,6 +23,7 @@
 #include "tc.h"
 #include "simple_tp.h"
 #include "motion_debug.h"
+#include "mottrace.h"
 #include "config.h"
 #include "motion_types.h"
 #include "homing.h"
@@ -2037,7 +2038,7 @@ static void output_to_hal(void)
 
 static void update_status(void)
 {
-    int joint_num, axis_num, dio, aio;
+    int joint_num, axis_num, dio, aio, id;
     emcmot_joint_t *joint;
     emcmot_joint_status_t *joint_status;
     emcmot_axis_t *axis;
@@ -2118,7 +2119,12 @@ static void update_status(void)
     /* motion emcmotDebug->coord_tp status */
     emcmotStatus->depth = tpQueueDepth(&emcmotDebug->coord_tp);
     emcmotStatus->activeDepth = tpActiveDepth(&emcmotDebug->coord_tp);
-    emcmotStatus->id = tpGetExecId(&emcmotDebug->coord_tp);
+    id = tpGetExecId(&emcmotDebug->coord_tp);
+    emcmotTrace->enabled = *(emcmot_hal_data->trace_enable);
+    if (id != emcmotStatus->id && id > 0) {
+	emcmotTracePut(emcmotTrace, EMCMOT_TRACE_ACTIVE, id);
+    }
+    emcmotStatus->id = id;
     //KLUDGE add an API call for this
     emcmotStatus->reverse_run = emcmotDebug->coord_tp.reverse_run;
     emcmotStatus->motionType = tpGetMotionType(&emcmotDebug->coord_tp);
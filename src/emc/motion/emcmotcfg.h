@@ -41,6 +41,11 @@
 #define EMCMOT_ERROR_NUM 32	/* how many errors we can queue */
 #define EMCMOT_ERROR_LEN 1024	/* how long error string can be */
 
+#define EMCMOT_COMMAND_QUEUE_SIZE 64	/* moves task can queue ahead of motion */
+#define DEFAULT_EMCMOT_COMMAND_BATCH 8	/* queued moves taken per servo period */
+
+#define EMCMOT_TRACE_SIZE 1024	/* move timestamps kept per stage */
+
 /*
   Shared memory keys for simulated motion process. No base address
   values need to be computed, since operating system does this for us
@@ -15,6 +15,7 @@
 #include "motion.h"		/* these decls */
 #include "dbuf.h"
 #include "stashf.h"
+#include "rtapi_atomic.h"
 
 int emcmotErrorInit(emcmot_error_t * errlog)
 {
@@ -85,3 +86,104 @@ int emcmotErrorGet(emcmot_error_t * errlog, char *error)
 
     return 0;
 }
+
+int emcmotCommandQueueInit(emcmot_command_queue_t * queue, int batch)
+{
+    if (queue == 0) {
+	return -1;
+    }
+
+    queue->in = 0;
+    queue->out = 0;
+    queue->batch = batch;
+    queue->room = 0;
+    queue->failed = 0;
+
+    return 0;
+}
+
+/* number of commands put but not taken yet */
+int emcmotCommandQueueLen(emcmot_command_queue_t * queue)
+{
+    unsigned int in = atomic_load_explicit(&queue->in, memory_order_acquire);
+    unsigned int out = atomic_load_explicit(&queue->out, memory_order_acquire);
+
+    return in - out;
+}
+
+/* number of commands user space can put now that motion will be able to
+   take into the planner; <= 0 means wait */
+int emcmotCommandQueueRoom(emcmot_command_queue_t * queue)
+{
+    /* out is read first, so room is at least as new as it */
+    int len = emcmotCommandQueueLen(queue);
+    int room = queue->room;
+
+    if (room > EMCMOT_COMMAND_QUEUE_SIZE) {
+	room = EMCMOT_COMMAND_QUEUE_SIZE;
+    }
+    return room - len;
+}
+
+/* user space side */
+int emcmotCommandQueuePut(emcmot_command_queue_t * queue, const emcmot_command_t * c)
+{
+    unsigned int in = queue->in;
+
+    if (in - atomic_load_explicit(&queue->out, memory_order_acquire) >=
+	EMCMOT_COMMAND_QUEUE_SIZE) {
+	/* full */
+	return -1;
+    }
+
+    queue->cmd[in % EMCMOT_COMMAND_QUEUE_SIZE] = *c;
+    atomic_store_explicit(&queue->in, in + 1, memory_order_release);
+
+    return 0;
+}
+
+/* motion side: the n'th oldest command not taken yet, or 0 */
+emcmot_command_t *emcmotCommandQueuePeek(emcmot_command_queue_t * queue, int n)
+{
+    unsigned int out = queue->out;
+    unsigned int in = atomic_load_explicit(&queue->in, memory_order_acquire);
+
+    if (n < 0 || (unsigned int) n >= in - out) {
+	return 0;
+    }
+    return &queue->cmd[(out + n) % EMCMOT_COMMAND_QUEUE_SIZE];
+}
+
+/* motion side: done with the n oldest commands, and the planner can take
+   room more */
+void emcmotCommandQueueTake(emcmot_command_queue_t * queue, int n, int room)
+{
+    queue->room = room;
+    atomic_store_explicit(&queue->out, queue->out + n, memory_order_release);
+}
+
+/* motion side: runs the queued commands with run(), oldest first, at most
+   batch of them and only while room() says the planner can take one. run()
+   returns non-zero for a command that failed; the commands behind it are
+   dropped, and so is whatever is put after them until an abort clears
+   failed. Returns the number of commands taken. */
+int emcmotCommandQueueRun(emcmot_command_queue_t * queue,
+    int (*run)(emcmot_command_t * c), int (*room)(void))
+{
+    int fill = emcmotCommandQueueLen(queue);
+    int n = 0;
+
+    if (queue->failed) {
+	/* task is aborting, drop whatever it sent after the failed move */
+	n = fill;
+    }
+    while (n < fill && n < queue->batch && room() > 0) {
+	if (run(emcmotCommandQueuePeek(queue, n++)) != 0) {
+	    /* the moves behind it must not run, they get dropped too */
+	    queue->failed = 1;
+	    n = fill;
+	}
+    }
+    emcmotCommandQueueTake(queue, n, queue->batch ? room() : 0);
+    return n;
+}
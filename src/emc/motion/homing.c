@@ -33,8 +33,6 @@
    now it's a constant.  It is in seconds */
 #define HOME_DELAY 0.100
 
-#define MAX_HOME_SEQUENCES EMCMOT_MAX_JOINTS
-
 /***********************************************************************
 *                  LOCAL VARIABLE DECLARATIONS                         *
 ************************************************************************/
@@ -44,6 +42,12 @@ static home_sequence_state_t sequence_state;
 static int  home_sequence = -1;
 static bool homing_active;
 
+/* joints taking part in the current sequence, and those of them that
+   have been started; a joint is started once all the joints it is to
+   home after are done (bit n is joint n) */
+static unsigned int sequence_joints;
+static unsigned int sequence_started;
+
 /* internal states for homing */
 typedef enum {
   HOME_IDLE = 0,
@@ -94,6 +98,8 @@ typedef struct {
   double       home_latch_vel;       // intfc
   int          home_flags;           // intfc
   int          home_sequence;        // intfc, updateable
+  int          home_after;           // intfc, joint mask, -1: by sequence
+  unsigned int home_deps;            // joints to wait for in this sequence
   bool         volatile_home;        // intfc
   bool         home_is_synchronized;
 } home_local_data;
@@ -200,6 +206,89 @@ static void update_home_is_synchronized(void) {
         }
     }
 }
+
+/* Work out which joints each joint in the sequence has to wait for.
+   Without HOME_AFTER that is every joint with a lower (absolute)
+   HOME_SEQUENCE, which homes the sequences one after the other as
+   always. HOME_AFTER names the joints explicitly, so joints that do
+   not depend on each other home at the same time. Joints that
+   synchronize their final move start together, once everything any
+   of them waits for is done. Joints outside the sequence are not
+   waited for. */
+static void home_sequence_plan(void)
+{
+    int jno, ii;
+    unsigned int deps[EMCMOT_MAX_JOINTS];
+    unsigned int group;
+
+    sequence_joints  = 0;
+    sequence_started = 0;
+    for (jno = 0; jno < ALL_JOINTS; jno++) {
+        if (H[jno].joint_in_sequence) {
+            sequence_joints |= 1u << jno;
+        }
+    }
+    for (jno = 0; jno < ALL_JOINTS; jno++) {
+        deps[jno] = 0;
+        if (!(sequence_joints & (1u << jno))) continue;
+        if (H[jno].home_after >= 0) {
+            deps[jno] = H[jno].home_after & sequence_joints;
+            continue;
+        }
+        for (ii = 0; ii < ALL_JOINTS; ii++) {
+            if (!(sequence_joints & (1u << ii))) continue;
+            if (ABS(H[ii].home_sequence) < ABS(H[jno].home_sequence)) {
+                deps[jno] |= 1u << ii;
+            }
+        }
+    }
+    for (jno = 0; jno < ALL_JOINTS; jno++) {
+        H[jno].home_deps = deps[jno] & ~(1u << jno);
+        if (H[jno].home_sequence >= 0) continue;
+        group = 0;
+        for (ii = 0; ii < ALL_JOINTS; ii++) {
+            if (!(sequence_joints & (1u << ii))) continue;
+            if (H[ii].home_sequence == H[jno].home_sequence) {
+                group |= 1u << ii;
+            }
+        }
+        for (ii = 0; ii < ALL_JOINTS; ii++) {
+            if (group & (1u << ii)) {
+                H[jno].home_deps |= deps[ii];
+            }
+        }
+        H[jno].home_deps &= ~group;
+    }
+} // home_sequence_plan()
+
+/* start every joint in the sequence that is not waiting for another
+   one, returns how many were started */
+static int home_start_ready_joints(void)
+{
+    int jno, ii;
+    int started = 0;
+
+    for (jno = 0; jno < ALL_JOINTS; jno++) {
+        if (!(sequence_joints & (1u << jno))) continue;
+        if (sequence_started & (1u << jno)) continue;
+        for (ii = 0; ii < ALL_JOINTS; ii++) {
+            if (!(H[jno].home_deps & (1u << ii))) continue;
+            if (   !(sequence_started & (1u << ii))
+                || (H[ii].home_state != HOME_IDLE)
+                || !H[ii].homed) {
+                break;
+            }
+        }
+        if (ii < ALL_JOINTS) continue;
+        /* start this joint */
+        joints[jno].free_tp.enable = 0;
+        H[jno].home_state = HOME_START;
+        sequence_started |= 1u << jno;
+        started++;
+    }
+    return started;
+} // home_start_ready_joints()
+
 /***********************************************************************
 *                      PUBLIC FUNCTIONS                                *
 ************************************************************************/
@@ -217,6 +306,7 @@ void homing_init(void)
         H[i].home            =  0;
         H[i].home_flags      =  0;
         H[i].home_sequence   = -1;
+        H[i].home_after      = -1;
         H[i].volatile_home   =  0;
     }
 }
@@ -310,6 +400,7 @@ void set_joint_homing_params(int    jno,
                              double home_latch_vel,
                              int    home_flags,
                              int    home_sequence,
+                             int    home_after,
                              bool   volatile_home
                              )
 {
@@ -320,6 +411,7 @@ void set_joint_homing_params(int    jno,
     H[jno].home_latch_vel  = home_latch_vel;
     H[jno].home_flags      = home_flags;
     H[jno].home_sequence   = home_sequence;
+    H[jno].home_after      = home_after;
     H[jno].volatile_home   = volatile_home;
     update_home_is_synchronized();
 }
@@ -380,9 +472,7 @@ home_sequence_state_t get_home_sequence_state(void) {
 void do_homing_sequence(void)
 {
     int i,ii;
-    int special_case_sync_all;
     int seen = 0;
-    emcmot_joint_t *joint;
     int sequence_is_set = 0;
     /* first pass init */
     if(home_sequence == -1) {
@@ -398,12 +488,11 @@ void do_homing_sequence(void)
     case HOME_SEQUENCE_DO_ONE_JOINT:
         // Expect one joint with home_state==HOME_START
         for (i=0; i < ALL_JOINTS; i++) {
-            joint = &joints[i];
             if (H[i].home_state == HOME_START) {
                H[i].joint_in_sequence = 1;
                home_sequence = ABS(H[i].home_sequence);
             } else {
-               if (H[i].joint_in_sequence) {
+               if (H[i].joint_in_sequence && H[i].home_state != HOME_IDLE) {
                    // it may already be running, leave alone
                } else {
                    H[i].joint_in_sequence = 0;
@@ -420,7 +509,6 @@ void do_homing_sequence(void)
         // based on home_state[i] == HOME_START
         if (!sequence_is_set) {
             for (i=0; i < ALL_JOINTS; i++) {
-                joint = &joints[i];
                 if (H[i].home_state == HOME_START) {
                     if (   sequence_is_set
                         && (ABS(H[i].home_sequence) != home_sequence)) {
@@ -449,7 +537,6 @@ void do_homing_sequence(void)
         if (!sequence_is_set) {
             // sequence_is_set not otherwise established: home-all 
             for (i=0; i < EMCMOT_MAX_JOINTS; i++) {
-                joint = &joints[i];
                 H[i].joint_in_sequence = 1;
                 // unspecified joints have an unrealizable home_sequence:
                 if (H[i].home_sequence >100) {
@@ -458,16 +545,37 @@ void do_homing_sequence(void)
                    H[i].joint_in_sequence = 0;  // per docs
                 }
             }
+            /* docs: 'If a sequence number is omitted, HOME ALL homing
+               will stop upon completion of the last valid sequence
+               number'. Joints placed with HOME_AFTER still home. */
+            home_sequence = 0;
+            for (i=0; i < ALL_JOINTS; i++) {
+                if (H[i].joint_in_sequence && H[i].home_sequence == 0) break;
+            }
+            if (i == ALL_JOINTS) home_sequence = 1;
+            for (;;) {
+                for (i=0; i < ALL_JOINTS; i++) {
+                    if (   H[i].joint_in_sequence
+                        && ABS(H[i].home_sequence) == home_sequence) break;
+                }
+                if (i == ALL_JOINTS) break;
+                home_sequence++;
+            }
+            for (i=0; i < ALL_JOINTS; i++) {
+                if (   H[i].home_after < 0
+                    && ABS(H[i].home_sequence) >= home_sequence) {
+                    H[i].joint_in_sequence = 0;
+                }
+            }
             sequence_is_set = 1;
             home_sequence = 0;
         }
         /* Initializations */
-        for(i=0; i < MAX_HOME_SEQUENCES; i++) {
+        for(i=0; i < EMCMOT_MAX_JOINTS; i++) {
             H[i].sync_final_move = 0; //reset to allow a rehome
         }
         for(i=0; i < ALL_JOINTS; i++) {
             if (!H[i].joint_in_sequence) continue;
-            joint = &joints[i];
             if (   (H[i].home_flags & HOME_NO_REHOME)
                 &&  H[i].homed
                ) {
@@ -485,20 +593,8 @@ void do_homing_sequence(void)
                 }
             }
         }
-        /*  special_case_sync_all: if home_sequence == -1 for all joints
-        *                          synchronize all joints final move
-        */
-        special_case_sync_all = 1; // disprove
-        for(i=0; i < ALL_JOINTS; i++) {
-            joint = &joints[i];
-            if (H[i].home_sequence != -1) {special_case_sync_all = 0;}
-        }
-        if (special_case_sync_all) {
-            home_sequence = 1;
-        }
 	for(i=0; i < ALL_JOINTS; i++) {
             if (!H[i].joint_in_sequence) continue;
-	    joint = &joints[i];
 	    if  ( H[i].home_state != HOME_IDLE && H[i].home_state != HOME_START) {
 		/* a home is already in progress, abort the home-all */
 		sequence_state = HOME_SEQUENCE_IDLE;
@@ -510,21 +606,16 @@ void do_homing_sequence(void)
         //drop through----drop through----drop through----drop through
 
     case HOME_SEQUENCE_START_JOINTS:
-	/* start all joints whose sequence number matches home_sequence */
-	for(i=0; i < ALL_JOINTS; i++) {
-	    joint = &joints[i];
-	    if(ABS(H[i].home_sequence) == home_sequence) {
-                if (!H[i].joint_in_sequence) continue;
-		/* start this joint */
-	        joint->free_tp.enable = 0;
-		H[i].home_state = HOME_START;
-		seen++;
-	    }
-	}
-	if (seen || home_sequence == 0) {
+	/* start all joints that do not wait for another one */
+	home_sequence_plan();
+	if (home_start_ready_joints()) {
 	    sequence_state = HOME_SEQUENCE_WAIT_JOINTS;
 	} else {
-	    /* no joints have this sequence number, we're done */
+	    if (sequence_joints) {
+		reportError(_("HOME_AFTER loop, cannot home joints 0x%x"),
+		    sequence_joints);
+	    }
+	    /* no joints to home, we're done */
 	    sequence_state = HOME_SEQUENCE_IDLE;
 	    /* tell the world */
 	    homing_active = 0;
@@ -533,31 +624,33 @@ void do_homing_sequence(void)
 
     case HOME_SEQUENCE_WAIT_JOINTS:
 	for(i=0; i < ALL_JOINTS; i++) {
-            if (!H[i].joint_in_sequence) continue;
-	    joint = &joints[i];
-            // negative H[i].home_sequence means sync final move
-	    if(ABS(H[i].home_sequence) != home_sequence) {
-		/* this joint is not at the current sequence number, ignore it */
-		continue;
-	    }
+	    if (!(sequence_started & (1u << i))) continue;
 	    if(H[i].home_state != HOME_IDLE) {
 		/* still busy homing, keep waiting */
 		seen = 1;
 		continue;
 	    }
-	    if (!H[i].at_home) {
-		/* joint should have been homed at this step, it is no longer
-		   homing, but its not at home - must have failed.  bail out */
+	    if (!H[i].homed) {
+		/* joint should have been homed, it is no longer
+		   homing, but its not homed - must have failed.  bail out */
 		sequence_state = HOME_SEQUENCE_IDLE;
 		homing_active = 0;
 		return;
 	    }
 	}
-        if(!seen) {
-            /* all joints at this step have finished, move on to next step */
-            home_sequence ++;
-            sequence_state = HOME_SEQUENCE_START_JOINTS;
-        }
+	/* start the joints whose predecessors have all finished */
+	if (home_start_ready_joints()) {
+	    seen = 1;
+	}
+	if (!seen) {
+	    if (sequence_started != sequence_joints) {
+		reportError(_("HOME_AFTER loop, cannot home joints 0x%x"),
+		    sequence_joints & ~sequence_started);
+	    }
+	    /* all joints have finished */
+	    sequence_state = HOME_SEQUENCE_IDLE;
+	    homing_active = 0;
+	}
 	break;
 
     default:
@@ -1132,7 +1225,7 @@ void do_homing(void)
 		    /* no, update timer and wait some more */
 		    H[joint_num].pause_timer++;
                     if (H[joint_num].home_sequence < 0) {
-                        if (!H[home_sequence].sync_final_move) break;
+                        if (!H[joint_num].sync_final_move) break;
                     } else {
                         break;
                     }
@@ -1140,27 +1233,32 @@ void do_homing(void)
 		}
                 // negative H[joint_num].home_sequence means sync final move
                 //          defer final move until all joints in sequence are ready
-                if  (        (H[joint_num].home_sequence  < 0)
-                     && ( ABS(H[joint_num].home_sequence) == home_sequence)
-                    ) {
-                    if (!H[home_sequence].sync_final_move) {
+                if  (H[joint_num].home_sequence  < 0) {
+                    if (!H[joint_num].sync_final_move) {
                         int jno;
                         emcmot_joint_t *jtmp;
-                        H[home_sequence].sync_final_move = 1; //disprove
+                        bool sync = 1; //disprove
                         for (jno = 0; jno < ALL_JOINTS; jno++) {
                             jtmp = &joints[jno];
                             if (!H[jno].joint_in_sequence) continue;
-                            if (ABS(H[jno].home_sequence) != home_sequence) {continue;}
+                            if (H[jno].home_sequence != H[joint_num].home_sequence) {continue;}
                             if (H[jno].home_flags & HOME_ABSOLUTE_ENCODER)  {continue;}
                             if (   (H[jno].home_state != HOME_FINAL_MOVE_START)
                                 ||
                                    (jtmp->free_tp.active)
                                 ) {
-                                H[home_sequence].sync_final_move = 0;
+                                sync = 0;
                                 break;
                             }
                         }
-                        if (!H[home_sequence].sync_final_move) break;
+                        if (!sync) break;
+                        // release the whole group, which may home
+                        // alongside other groups
+                        for (jno = 0; jno < ALL_JOINTS; jno++) {
+                            if (H[jno].home_sequence == H[joint_num].home_sequence) {
+                                H[jno].sync_final_move = 1;
+                            }
+                        }
                     }
                 }
 		H[joint_num].pause_timer = 0;
@@ -25,6 +25,7 @@ extern void set_joint_homing_params(int    jno,
                                     double home_latch_vel,
                                     int    home_flags,
                                     int    home_sequence,
+                                    int    home_after,
                                     bool   volatile_home
                                     );
 
@@ -191,6 +191,11 @@ typedef struct {
     hal_u32_t   *last_period;	/* pin: last period in clocks */
     hal_float_t *last_period_ns;	/* pin: last period in nanoseconds */
 
+    hal_s32_t   *command_queue_fill;	/* pin: queued moves waiting at the start of the cycle */
+    hal_s32_t   *command_queue_max_fill;	/* pin: most queued moves seen waiting */
+    hal_s32_t   *command_queue_taken;	/* pin: queued moves taken in the last cycle */
+    hal_bit_t   *trace_enable;	/* pin: timestamp moves, see mottrace.h */
+
     hal_float_t *tooloffset_x;
     hal_float_t *tooloffset_y;
     hal_float_t *tooloffset_z;
@@ -238,6 +243,8 @@ extern struct emcmot_status_t *emcmotStatus;
 extern struct emcmot_config_t *emcmotConfig;
 extern struct emcmot_debug_t *emcmotDebug;
 extern struct emcmot_error_t *emcmotError;
+extern struct emcmot_command_queue_t *emcmotCommandQueue;
+extern struct emcmot_trace_t *emcmotTrace;
 
 
 // total number of joints (typically set with [KINS]JOINTS)
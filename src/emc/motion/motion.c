@@ -43,8 +43,12 @@ static long base_period_nsec = 0;	/* fastest thread period */
 RTAPI_MP_LONG(base_period_nsec, "fastest thread period (nsecs)");
 int base_thread_fp = 0;	/* default is no floating point in base thread */
 RTAPI_MP_INT(base_thread_fp, "floating point in base thread?");
+static int base_thread_cpu = -1;	/* default is the realtime CPU */
+RTAPI_MP_INT(base_thread_cpu, "CPU to run the base thread on");
 static long servo_period_nsec = 1000000;	/* servo thread period */
 RTAPI_MP_LONG(servo_period_nsec, "servo thread period (nsecs)");
+static int servo_thread_cpu = -1;
+RTAPI_MP_INT(servo_thread_cpu, "CPU to run the servo thread on");
 static long traj_period_nsec = 0;	/* trajectory planner period */
 RTAPI_MP_LONG(traj_period_nsec, "trajectory planner period (nsecs)");
 static int num_spindles = 1; /* default number of spindles is 1 */
@@ -61,6 +65,8 @@ RTAPI_MP_INT(num_aio, "number of analog inputs/outputs");
 
 static int unlock_joints_mask = 0;/* mask to select joints for unlock pins */
 RTAPI_MP_INT(unlock_joints_mask, "mask to select joints for unlock pins");
+static int command_batch = DEFAULT_EMCMOT_COMMAND_BATCH; /* queued moves taken per period */
+RTAPI_MP_INT(command_batch, "number of queued moves taken per servo period, 0 turns the queue off");
 /***********************************************************************
 *                  GLOBAL VARIABLE DEFINITIONS                         *
 ************************************************************************/
@@ -100,6 +106,8 @@ struct emcmot_status_t *emcmotStatus = 0;
 struct emcmot_config_t *emcmotConfig = 0;
 struct emcmot_debug_t *emcmotDebug = 0;
 struct emcmot_error_t *emcmotError = 0;	/* unused for RT_FIFO */
+struct emcmot_command_queue_t *emcmotCommandQueue = 0;
+struct emcmot_trace_t *emcmotTrace = 0;
 
 /***********************************************************************
 *                  LOCAL VARIABLE DECLARATIONS                         *
@@ -415,6 +423,10 @@ static int init_hal_io(void)
 #ifdef HAVE_CPU_KHZ
     if ((retval = hal_pin_float_newf(HAL_OUT, &(emcmot_hal_data->last_period_ns), mot_comp_id, "motion.servo.last-period-ns")) != 0) goto error;
 #endif
+    if ((retval = hal_pin_s32_newf(HAL_OUT, &(emcmot_hal_data->command_queue_fill), mot_comp_id, "motion.command-queue.fill")) != 0) goto error;
+    if ((retval = hal_pin_s32_newf(HAL_IO, &(emcmot_hal_data->command_queue_max_fill), mot_comp_id, "motion.command-queue.max-fill")) != 0) goto error;
+    if ((retval = hal_pin_s32_newf(HAL_OUT, &(emcmot_hal_data->command_queue_taken), mot_comp_id, "motion.command-queue.taken")) != 0) goto error;
+    if ((retval = hal_pin_bit_newf(HAL_IN, &(emcmot_hal_data->trace_enable), mot_comp_id, "motion.trace.enable")) != 0) goto error;
 
     // export timing related HAL pins so they can be scoped
     if ((retval = hal_pin_float_newf(HAL_OUT, &(emcmot_hal_data->tooloffset_x), mot_comp_id, "motion.tooloffset.x")) != 0) goto error;
@@ -468,6 +480,10 @@ static int init_hal_io(void)
     emcmot_hal_data->debug_float_3 = 0.0;
 
     *(emcmot_hal_data->last_period) = 0;
+    *(emcmot_hal_data->command_queue_fill) = 0;
+    *(emcmot_hal_data->command_queue_max_fill) = 0;
+    *(emcmot_hal_data->command_queue_taken) = 0;
+    *(emcmot_hal_data->trace_enable) = 0;
 
     /* export spindle pins and params */
     for (n=0; n < num_spindles; n++) {
@@ -730,10 +746,21 @@ static int init_comm_buffers(void)
     emcmotConfig = &emcmotStruct->config;
     emcmotDebug = &emcmotStruct->debug;
     emcmotError = &emcmotStruct->error;
+    emcmotCommandQueue = &emcmotStruct->command_queue;
+    emcmotTrace = &emcmotStruct->trace;
 
     /* init error struct */
     emcmotErrorInit(emcmotError);
 
+    /* init command queue */
+    if (command_batch < 0) {
+	command_batch = 0;
+    }
+    if (command_batch > EMCMOT_COMMAND_QUEUE_SIZE) {
+	command_batch = EMCMOT_COMMAND_QUEUE_SIZE;
+    }
+    emcmotCommandQueueInit(emcmotCommandQueue, command_batch);
+
     /* init command struct */
     emcmotCommand->head = 0;
     emcmotCommand->command = 0;
@@ -924,7 +951,8 @@ static int init_threads(void)
     /* create HAL threads for each period */
     /* only create base thread if it is faster than servo thread */
     if (servo_base_ratio > 1) {
-	retval = hal_create_thread("base-thread", base_period_nsec, base_thread_fp);
+	retval = hal_create_thread_cpu("base-thread", base_period_nsec,
+	    base_thread_fp, base_thread_cpu);
 	if (retval < 0) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"MOTION: failed to create %ld nsec base thread\n",
@@ -932,7 +960,8 @@ static int init_threads(void)
 	    return -1;
 	}
     }
-    retval = hal_create_thread("servo-thread", servo_period_nsec, 1);
+    retval = hal_create_thread_cpu("servo-thread", servo_period_nsec, 1,
+	servo_thread_cpu);
     if (retval < 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "MOTION: failed to create %ld nsec servo thread\n",
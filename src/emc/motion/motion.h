@@ -244,6 +244,7 @@ extern "C" {
 	double latch_vel;	/* home latch velocity */
 	int flags;		/* homing config flags, other boolean args */
 	int home_sequence;      /* order in homing sequence */
+	int home_after;         /* mask of joints to home after, or -1 */
 	int volatile_home;      /* joint should get unhomed when we get unhome -2
                                    (generated by task upon estop, etc) */
 	double minFerror;	/* min following error */
@@ -741,6 +742,9 @@ Suggestion: Split this in to an Error and a Status flag register..
         int arcBlendGapCycles;
         double arcBlendRampFreq;
         double arcBlendTangentKinkRatio;
+        int arcBlendBezier;	/* Bezier line-line blends: only set by the
+				   tp tests, not from the ini file, since
+				   they are no faster than arcs yet */
         double maxFeedScale;
         int inhibit_probe_jog_error;
         int inhibit_probe_home_error;
@@ -776,6 +780,22 @@ Suggestion: Split this in to an Error and a Status flag register..
 	unsigned char tail;	/* flag count for mutex detect */
     } emcmot_error_t;
 
+/* command queue - moves user space hands to motion without waiting for
+   each to be taken.  There is one writer, task, and one reader, the
+   command handler, so neither side locks: 'in' is only written by user
+   space and everything else only by motion.  Commands that are not
+   queued go through emcmot_command_t as before, once the queue is empty,
+   so all commands are still handled in the order they were sent. */
+    typedef struct emcmot_command_queue_t {
+	unsigned int in;	/* commands put so far */
+	unsigned int out;	/* commands taken so far */
+	int batch;		/* most commands taken per cycle, 0 = queue off */
+	int room;		/* commands the planner can take next cycle */
+	int failed;		/* a queued command failed, the rest are dropped
+				   until the next abort */
+	emcmot_command_t cmd[EMCMOT_COMMAND_QUEUE_SIZE];
+    } emcmot_command_queue_t;
+
 /*
   function prototypes for emcmot code
 */
@@ -787,6 +807,16 @@ Suggestion: Split this in to an Error and a Status flag register..
     extern int emcmotErrorPutf(emcmot_error_t * errlog, const char *fmt, ...);
     extern int emcmotErrorGet(emcmot_error_t * errlog, char *error);
 
+/* command queue access functions */
+    extern int emcmotCommandQueueInit(emcmot_command_queue_t * queue, int batch);
+    extern int emcmotCommandQueueLen(emcmot_command_queue_t * queue);
+    extern int emcmotCommandQueueRoom(emcmot_command_queue_t * queue);
+    extern int emcmotCommandQueuePut(emcmot_command_queue_t * queue, const emcmot_command_t * c);
+    extern emcmot_command_t *emcmotCommandQueuePeek(emcmot_command_queue_t * queue, int n);
+    extern void emcmotCommandQueueTake(emcmot_command_queue_t * queue, int n, int room);
+    extern int emcmotCommandQueueRun(emcmot_command_queue_t * queue,
+	int (*run)(emcmot_command_t * c), int (*room)(void));
+
 #ifdef __cplusplus
 }
 #endif
@@ -12,6 +12,8 @@
 #ifndef MOTION_STRUCT_H
 #define MOTION_STRUCT_H
 
+#include "mottrace.h"
+
 /* big comm structure, for upper memory */
     typedef struct emcmot_struct_t {
 	struct emcmot_command_t command;	/* struct used to pass commands/data
@@ -23,6 +25,8 @@
 	struct emcmot_error_t error;	/* ring buffer for error messages */
 	struct emcmot_debug_t debug;	/* Struct used to store RT status and debug
 				   data - 2nd largest block */
+	struct emcmot_command_queue_t command_queue;	/* moves queued by usr space */
+	struct emcmot_trace_t trace;	/* move timestamps, see mottrace.h */
     } emcmot_struct_t;
 
 
@@ -0,0 +1,102 @@
+/********************************************************************
+* Description: mottrace.c
+*   Move timestamp rings, see mottrace.h
+*
+* License: GPL Version 2
+* System: Linux
+********************************************************************/
+
+#include "mottrace.h"		/* these decls */
+#include "rtapi_atomic.h"
+
+#ifdef RTAPI
+#include "rtapi.h"		/* rtapi_get_time() */
+#else
+#include <time.h>		/* clock_gettime() */
+#endif
+
+static const char *stage_names[EMCMOT_TRACE_STAGES] = {
+    "read", "canon", "issue", "write", "receive", "add", "active",
+};
+
+const char *emcmotTraceStageName(int stage)
+{
+    if (stage < 0 || stage >= EMCMOT_TRACE_STAGES) {
+	return "?";
+    }
+    return stage_names[stage];
+}
+
+static long long trace_time(void)
+{
+#ifdef RTAPI
+    return rtapi_get_time();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+#endif
+}
+
+void emcmotTracePut(emcmot_trace_t * trace, int stage, int id)
+{
+    if (trace == 0 || !trace->enabled) {
+	return;
+    }
+    emcmotTracePutTime(trace, stage, id, trace_time());
+}
+
+void emcmotTracePutTime(emcmot_trace_t * trace, int stage, int id,
+    long long time)
+{
+    emcmot_trace_ring_t *ring;
+    emcmot_trace_event_t *event;
+    unsigned int count;
+
+    if (stage < 0 || stage >= EMCMOT_TRACE_STAGES) {
+	return;
+    }
+    ring = &trace->ring[stage];
+    count = ring->count;
+    event = &ring->event[count % EMCMOT_TRACE_SIZE];
+    event->time = time;
+    event->id = id;
+    atomic_store_explicit(&ring->count, count + 1, memory_order_release);
+}
+
+int emcmotTraceRead(emcmot_trace_t * trace, int stage,
+    emcmot_trace_event_t * events)
+{
+    emcmot_trace_ring_t *ring;
+    unsigned int first, last, n;
+
+    if (stage < 0 || stage >= EMCMOT_TRACE_STAGES) {
+	return 0;
+    }
+    ring = &trace->ring[stage];
+    /* the oldest slot of a full ring is the one the writer fills next,
+       so it is left out */
+    last = atomic_load_explicit(&ring->count, memory_order_acquire);
+    first = last >= EMCMOT_TRACE_SIZE ? last - EMCMOT_TRACE_SIZE + 1 : 0;
+    for (n = first; n != last; n++) {
+	events[n - first] = ring->event[n % EMCMOT_TRACE_SIZE];
+    }
+
+    /* the writer may have moved on while we copied; the event it is
+       writing now replaces the one EMCMOT_TRACE_SIZE before it */
+    atomic_thread_fence(memory_order_acquire);
+    n = atomic_load_explicit(&ring->count, memory_order_acquire);
+    if (n - first >= EMCMOT_TRACE_SIZE) {
+	unsigned int lost = n - first - EMCMOT_TRACE_SIZE + 1;
+
+	if (lost >= last - first) {
+	    return 0;
+	}
+	for (n = 0; n < last - first - lost; n++) {
+	    events[n] = events[n + lost];
+	}
+	return n;
+    }
+    return last - first;
+}
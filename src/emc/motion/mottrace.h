@@ -0,0 +1,80 @@
+/********************************************************************
+* Description: mottrace.h
+*   Timestamps of moves on their way from the interpreter to the
+*   servo output
+*
+* License: GPL Version 2
+* System: Linux
+********************************************************************/
+
+/*  Each move is timestamped at every stage it passes through, by motion
+    id, which is the line number it came from.  A stage has one writer,
+    so each keeps its own ring and no locks are needed: the writer fills
+    in an event and then bumps the count, overwriting the oldest event
+    once the ring is full.  Readers copy the ring without stopping the
+    writer and drop the events that may have been overwritten meanwhile.
+
+    Times are in nanoseconds, from rtapi_get_time() in realtime and from
+    CLOCK_MONOTONIC in user space.  These are the same clock in uspace
+    builds only, so elsewhere the user space and realtime stages can't
+    be compared with each other.
+*/
+
+#ifndef MOTTRACE_H
+#define MOTTRACE_H
+
+#include "emcmotcfg.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* stages in the order a move goes through them */
+    enum emcmot_trace_stage_t {
+	EMCMOT_TRACE_READ,	/* block read by the interpreter */
+	EMCMOT_TRACE_CANON,	/* move put on interp_list */
+	EMCMOT_TRACE_ISSUE,	/* move issued by task */
+	EMCMOT_TRACE_WRITE,	/* move handed to motion */
+	EMCMOT_TRACE_RECEIVE,	/* move picked up by the command handler */
+	EMCMOT_TRACE_ADD,	/* move added to the planner queue */
+	EMCMOT_TRACE_ACTIVE,	/* move started by the planner */
+	EMCMOT_TRACE_STAGES
+    };
+
+    typedef struct emcmot_trace_event_t {
+	long long time;		/* nanoseconds */
+	int id;			/* motion id */
+	int pad;
+    } emcmot_trace_event_t;
+
+    typedef struct emcmot_trace_ring_t {
+	unsigned int count;	/* events put so far */
+	emcmot_trace_event_t event[EMCMOT_TRACE_SIZE];
+    } emcmot_trace_ring_t;
+
+    typedef struct emcmot_trace_t {
+	int enabled;		/* set by motion from motion.trace.enable */
+	emcmot_trace_ring_t ring[EMCMOT_TRACE_STAGES];
+    } emcmot_trace_t;
+
+/* name of a stage, for printing */
+    extern const char *emcmotTraceStageName(int stage);
+
+/* records that move id reached stage now, if tracing is on */
+    extern void emcmotTracePut(emcmot_trace_t * trace, int stage, int id);
+
+/* records that move id reached stage at time */
+    extern void emcmotTracePutTime(emcmot_trace_t * trace, int stage, int id,
+	long long time);
+
+/* copies the events of a stage still in its ring into events, oldest
+   first, and returns how many there were, at most EMCMOT_TRACE_SIZE - 1;
+   events needs room for EMCMOT_TRACE_SIZE */
+    extern int emcmotTraceRead(emcmot_trace_t * trace, int stage,
+	emcmot_trace_event_t * events);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* MOTTRACE_H */
@@ -45,6 +45,10 @@ static emcmot_config_t *emcmotConfig = 0;
 static emcmot_debug_t *emcmotDebug = 0;
 static emcmot_error_t *emcmotError = 0;
 static emcmot_struct_t *emcmotStruct = 0;
+static emcmot_command_queue_t *emcmotCommandQueue = 0;
+static emcmot_trace_t *emcmotTrace = 0;
+/* queued moves when status was last read, see usrmotQueuedCommands() */
+static int queuedAtLastStatus = 0;
 
 /* usrmotIniLoad() loads params (SHMEM_KEY, COMM_TIMEOUT)
    from named ini file */
@@ -92,17 +96,43 @@ int usrmotWriteEmcmotCommand(emcmot_command_t * c)
         rcs_print("USRMOT: ERROR: can't connect to shared memory\n");
 	return EMCMOT_COMM_ERROR_CONNECT;
     }
+    /* set timeout for comm failure, now + timeout */
+    end = etime() + EMCMOT_COMM_TIMEOUT;
+    if (emcmotCommandQueue->batch > 0) {
+	/* moves are queued if the planner will have room for them; motion
+	   reports it if one fails, and drops the rest until the abort */
+	if (c->command == EMCMOT_SET_LINE || c->command == EMCMOT_SET_CIRCLE) {
+	    if (emcmotCommandQueue->failed) {
+		return EMCMOT_COMM_ERROR_COMMAND;
+	    }
+	    if (emcmotCommandQueueRoom(emcmotCommandQueue) > 0) {
+		emcmotCommandQueuePut(emcmotCommandQueue, c);
+		emcmotTracePut(emcmotTrace, EMCMOT_TRACE_WRITE, c->id);
+		return EMCMOT_COMM_OK;
+	    }
+	}
+	/* anything else has to wait for the moves queued before it */
+	while (emcmotCommandQueueLen(emcmotCommandQueue) > 0) {
+	    if (etime() >= end) {
+		rcs_print("USRMOT: ERROR: command queue timeout\n");
+		return EMCMOT_COMM_ERROR_TIMEOUT;
+	    }
+	    esleep(25e-6);
+	}
+	end = etime() + EMCMOT_COMM_TIMEOUT;
+    }
     /* copy entire command structure to shared memory */
     *emcmotCommand = *c;
     /* poll for receipt of command */
-    /* set timeout for comm failure, now + timeout */
-    end = etime() + EMCMOT_COMM_TIMEOUT;
     /* now check to see if it got it */
     while (etime() < end) {
 	/* update status */
 	if (( usrmotReadEmcmotStatus(&s) == 0 ) && ( s.commandNumEcho == commandNum )) {
 	    /* now check emcmot status flag */
 	    if (s.commandStatus == EMCMOT_COMMAND_OK) {
+		if (c->command == EMCMOT_SET_LINE || c->command == EMCMOT_SET_CIRCLE) {
+		    emcmotTracePut(emcmotTrace, EMCMOT_TRACE_WRITE, c->id);
+		}
 		return EMCMOT_COMM_OK;
 	    } else {
                 rcs_print("USRMOT: ERROR: invalid command\n");
@@ -115,6 +145,36 @@ int usrmotWriteEmcmotCommand(emcmot_command_t * c)
     return EMCMOT_COMM_ERROR_TIMEOUT;
 }
 
+/* moves queued but not yet taken by motion, as of the last status read */
+int usrmotQueuedCommands(void)
+{
+    return queuedAtLastStatus;
+}
+
+/* non-zero if moves written now would have to wait */
+int usrmotCommandQueueFull(void)
+{
+    if (0 == emcmotCommandQueue || emcmotCommandQueue->batch == 0) {
+	return 0;
+    }
+    return emcmotCommandQueueRoom(emcmotCommandQueue) <= 0;
+}
+
+/* records that move id reached stage, if motion.trace.enable is set */
+void usrmotTrace(int stage, int id)
+{
+    emcmotTracePut(emcmotTrace, stage, id);
+}
+
+/* copies the events of a stage still in the trace */
+int usrmotReadTrace(int stage, struct emcmot_trace_event_t * events)
+{
+    if (0 == emcmotTrace) {
+	return EMCMOT_COMM_ERROR_CONNECT;
+    }
+    return emcmotTraceRead(emcmotTrace, stage, events);
+}
+
 /* copies status to s */
 int usrmotReadEmcmotStatus(emcmot_status_t * s)
 {
@@ -124,6 +184,11 @@ int usrmotReadEmcmotStatus(emcmot_status_t * s)
     if (0 == emcmotStatus) {
 	return EMCMOT_COMM_ERROR_CONNECT;
     }
+    /* queued moves are counted before the status is copied, so a move
+       taken in between is counted twice rather than not at all */
+    if (emcmotCommandQueue) {
+	queuedAtLastStatus = emcmotCommandQueueLen(emcmotCommandQueue);
+    }
     split_read_count = 0;
     do {
 	/* copy status struct from shmem to local memory */
@@ -668,6 +733,8 @@ int usrmotInit(const char *modname)
     emcmotDebug = &(emcmotStruct->debug);
     emcmotConfig = &(emcmotStruct->config);
     emcmotError = &(emcmotStruct->error);
+    emcmotCommandQueue = &(emcmotStruct->command_queue);
+    emcmotTrace = &(emcmotStruct->trace);
 
     inited = 1;
 
@@ -683,6 +750,8 @@ int usrmotExit(void)
 
     emcmotStruct = 0;
     emcmotCommand = 0;
+    emcmotCommandQueue = 0;
+    emcmotTrace = 0;
     emcmotStatus = 0;
     emcmotError = 0;
 /*! \todo Another #if 0 */
@@ -20,6 +20,7 @@ struct emcmot_command_t;
 struct emcmot_config_t;
 struct emcmot_debug_t;
 struct emcmot_error_t;
+struct emcmot_trace_event_t;
 
 #ifdef __cplusplus
 extern "C" {
@@ -70,6 +71,22 @@ extern "C" {
    Return values are as per the #defines above */
     extern int usrmotWriteEmcmotCommand(emcmot_command_t * c);
 
+/* usrmotQueuedCommands() gives the number of moves written but not yet
+   taken by motion, as of the last usrmotReadEmcmotStatus() */
+    extern int usrmotQueuedCommands(void);
+
+/* usrmotCommandQueueFull() is non-zero if a move written now would have
+   to wait for motion to take it */
+    extern int usrmotCommandQueueFull(void);
+
+/* usrmotTrace() records that move id reached stage, one of the
+   EMCMOT_TRACE_ stages in mottrace.h, if tracing is on */
+    extern void usrmotTrace(int stage, int id);
+
+/* usrmotReadTrace() copies the events of a stage still in the trace,
+   oldest first, and returns how many there were */
+    extern int usrmotReadTrace(int stage, struct emcmot_trace_event_t * events);
+
 /* usrmotInit() initializes communication with the emcmot process */
     extern int usrmotInit(const char *name);
 
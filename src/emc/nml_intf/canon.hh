@@ -909,6 +909,12 @@ extern int GET_EXTERNAL_SELECTED_TOOL_SLOT();
 // in the given pocket
 extern CANON_TOOL_TABLE GET_EXTERNAL_TOOL_TABLE(int pocket);
 
+// Returns the pocket of the tool table that GET_EXTERNAL_TOOL_TABLE has
+// the tool in, for a tool store with more tools than the table holds.
+// The pocket may be made to hold the tool, so the interpreter has to read
+// it again. Return value -1 means there is no such tool.
+extern int GET_EXTERNAL_TOOL_POCKET(int toolno);
+
 // return the value of iocontrol's toolchanger-fault pin
 extern int GET_EXTERNAL_TC_FAULT();
 
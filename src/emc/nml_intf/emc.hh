@@ -360,7 +360,8 @@ extern int emcJointSetMinFerror(int joint, double ferror);
 extern int emcJointSetHomingParams(int joint, double home, double offset, double home_vel,
 				  double search_vel, double latch_vel,
 				  int use_index, int encoder_does_not_reset, int ignore_limits,
-				  int is_shared, int home_sequence, int volatile_home, int locking_indexer,
+				  int is_shared, int home_sequence, int home_after,
+				  int volatile_home, int locking_indexer,
                   int absolute_encoder);
 extern int emcJointUpdateHomingParams(int joint, double home, double offset, int sequence);
 extern int emcJointSetMaxVelocity(int joint, double vel);
@@ -464,10 +465,11 @@ extern int emcToolUnload();
 extern int emcToolLoadToolTable(const char *file);
 extern int emcToolSetOffset(int pocket, int toolno, EmcPose offset, double diameter,
                             double frontangle, double backangle, int orientation);
-extern int emcToolSetNumber(int number);
+extern int emcToolSetNumber(int number, int toolno);
 extern int emcToolStartChange();
 
 extern int emcToolSetToolTableFile(const char *file);
+extern int emcToolSetToolDatabaseFile(const char *file);
 
 extern int emcToolUpdate(EMC_TOOL_STAT * stat);
 
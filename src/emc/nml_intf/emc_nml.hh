@@ -306,6 +306,7 @@ class EMC_JOINT_SET_HOMING_PARAMS:public EMC_JOINT_CMD_MSG {
     int ignore_limits;
     int is_shared;
     int home_sequence;
+    int home_after;
     int volatile_home;
     int locking_indexer;
     int absolute_encoder;
@@ -1512,6 +1513,8 @@ class EMC_TASK_STAT:public EMC_TASK_STAT_MSG {
     int task_paused;		// non-zero means task is paused
     double delayLeft;           // delay time left of G4, M66..
     int queuedMDIcommands;      // current length of MDI input queue
+    double queueTime;		// estimated seconds of moves queued in motion
+    double readaheadTime;	// estimated seconds of moves read but not sent to motion
 };
 
 // declarations for EMC_TOOL classes
@@ -1629,6 +1632,7 @@ class EMC_TOOL_SET_NUMBER:public EMC_TOOL_CMD_MSG {
     void update(CMS * cms);
 
     int tool; //number to use for currently loaded tool
+    int toolno;	// the tool in that pocket, for a tool database
 };
 
 class EMC_TOOL_START_CHANGE:public EMC_TOOL_CMD_MSG {
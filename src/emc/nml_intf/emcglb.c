@@ -34,6 +34,8 @@ int emc_task_interp_max_len = DEFAULT_EMC_TASK_INTERP_MAX_LEN;
 
 char tool_table_file[LINELEN] = DEFAULT_TOOL_TABLE_FILE;
 
+char tool_database_file[LINELEN] = "";
+
 EmcPose tool_change_position;	/* no defaults */
 unsigned char have_tool_change_position = 0;	/* default is 'not there' */
 
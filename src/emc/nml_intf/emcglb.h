@@ -50,6 +50,8 @@ extern "C" {
 
     extern char tool_table_file[LINELEN];
 
+    extern char tool_database_file[LINELEN];
+
     extern struct EmcPose tool_change_position;
     extern unsigned char have_tool_change_position;
 
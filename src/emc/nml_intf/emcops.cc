@@ -149,6 +149,8 @@ EMC_TASK_STAT_MSG(EMC_TASK_STAT_TYPE, sizeof(EMC_TASK_STAT))
     task_paused = 0;
     delayLeft = 0.0;
     queuedMDIcommands = 0;
+    queueTime = 0.0;
+    readaheadTime = 0.0;
 }
 
 EMC_TOOL_STAT::EMC_TOOL_STAT():
@@ -16,34 +16,85 @@
 ********************************************************************/
 
 
+#include <stdlib.h>		/* malloc(), free() */
 #include <string.h>		/* memcpy() */
+#include <math.h>		/* atan2() */
+#include <new>			/* placement new */
 
-#include "rcs.hh"		// LinkedList
+#include "rcs.hh"
 #include "interpl.hh"		// these decls
 #include "emc.hh"
+#include "emc_nml.hh"		// EMC_TRAJ_LINEAR_MOVE etc.
 #include "emcglb.h"
-#include "linklist.hh"
 #include "nmlmsg.hh"            /* class NMLmsg */
 #include "rcs_print.hh"
 
 NML_INTERP_LIST interp_list;	/* NML Union, for interpreter */
 
+// a node is allocated with only as much of the command as its size
+struct NML_INTERP_LIST::queue_node {
+    std::atomic<queue_node *> next;
+    NML_INTERP_LIST_NODE node;
+};
+
 NML_INTERP_LIST::NML_INTERP_LIST()
 {
-    linked_list_ptr = new LinkedList;
+    // the list starts with an empty node, as if it came from get()
+    head = tail = new_node(NULL);
 
-    next_line_number = 0;
     line_number = 0;
+    duration = 0;
+    head_given = false;
+    retired = NULL;
+    taken = 0;
+    taken_time = 0;
+    restart = false;
+
+    held_head = held_tail = NULL;
+    held_count = 0;
+    holding = false;
+    next_line_number = 0;
+    appended = 0;
+    appended_time = 0;
+    have_last_end = false;
 }
 
 NML_INTERP_LIST::~NML_INTERP_LIST()
 {
-    if (NULL != linked_list_ptr) {
-	delete linked_list_ptr;
-	linked_list_ptr = NULL;
+    discard();
+    if (retired != NULL) {
+	retired->~queue_node();
+	free(retired);
+    }
+    while (head != NULL) {
+	queue_node *next = head->next.load(std::memory_order_relaxed);
+	head->~queue_node();
+	free(head);
+	head = next;
     }
 }
 
+NML_INTERP_LIST::queue_node *NML_INTERP_LIST::new_node(NMLmsg * nml_msg_ptr)
+{
+    // the command is last, so this is where it starts
+    size_t header = sizeof(queue_node) - sizeof(NML_INTERP_LIST_NODE::_command_union);
+    size_t size = nml_msg_ptr ? nml_msg_ptr->size : sizeof(NML_INTERP_LIST_NODE::_command_union);
+    size_t align = __alignof__(queue_node);
+    void *mem = malloc((header + size + align - 1) / align * align);
+
+    if (mem == NULL) {
+	return NULL;
+    }
+    queue_node *n = new(mem) queue_node;
+    n->next.store(NULL, std::memory_order_relaxed);
+    n->node.line_number = 0;
+    n->node.duration = 0;
+    if (nml_msg_ptr) {
+	memcpy(n->node.command.commandbuf, nml_msg_ptr, size);
+    }
+    return n;
+}
+
 int NML_INTERP_LIST::append(NMLmsg & nml_msg)
 {
     return append(&nml_msg);
@@ -57,6 +108,86 @@ int NML_INTERP_LIST::set_line_number(int line)
     return 0;
 }
 
+/* estimated time a move or dwell takes at its programmed speed; the
+   first move after the list is made has no start point, so none for it */
+static double estimate_time(NMLmsg * msg, EmcPose * last_end, bool * have_last_end)
+{
+    PmCartesian start, end, d;
+    double length = 0, vel = 0, seconds = 0;
+    bool have_start = *have_last_end;
+
+    start = last_end->tran;
+    switch (msg->type) {
+    case EMC_TRAJ_DELAY_TYPE:
+	return ((EMC_TRAJ_DELAY *) msg)->delay;
+
+    case EMC_TRAJ_LINEAR_MOVE_TYPE: {
+	EMC_TRAJ_LINEAR_MOVE *move = (EMC_TRAJ_LINEAR_MOVE *) msg;
+	end = move->end.tran;
+	pmCartCartDisp(&start, &end, &length);
+	if (length == 0) {
+	    // a rotary or uvw move, its length is in those units
+	    length = sqrt(pow(move->end.a - last_end->a, 2) +
+		pow(move->end.b - last_end->b, 2) + pow(move->end.c - last_end->c, 2) +
+		pow(move->end.u - last_end->u, 2) + pow(move->end.v - last_end->v, 2) +
+		pow(move->end.w - last_end->w, 2));
+	}
+	vel = move->vel;
+	*last_end = move->end;
+	break;
+    }
+
+    case EMC_TRAJ_CIRCULAR_MOVE_TYPE: {
+	EMC_TRAJ_CIRCULAR_MOVE *move = (EMC_TRAJ_CIRCULAR_MOVE *) msg;
+	PmCartesian center = {move->center.x, move->center.y, move->center.z};
+	PmCartesian normal = {move->normal.x, move->normal.y, move->normal.z};
+	PmCartesian r0, r1, cross;
+	double h, dot, sin_angle, angle;
+
+	end = move->end.tran;
+	// radius vectors in the plane of the arc, and the helix height
+	pmCartCartSub(&end, &start, &d);
+	pmCartCartDot(&d, &normal, &h);
+	pmCartCartSub(&start, &center, &r0);
+	pmCartCartDot(&r0, &normal, &dot);
+	pmCartScalMult(&normal, dot, &d);
+	pmCartCartSubEq(&r0, &d);
+	pmCartCartSub(&end, &center, &r1);
+	pmCartCartDot(&r1, &normal, &dot);
+	pmCartScalMult(&normal, dot, &d);
+	pmCartCartSubEq(&r1, &d);
+
+	pmCartCartCross(&r0, &r1, &cross);
+	pmCartCartDot(&cross, &normal, &sin_angle);
+	pmCartCartDot(&r0, &r1, &dot);
+	// turn is the number of extra turns counterclockwise about normal,
+	// or minus the number of turns clockwise
+	angle = atan2(sin_angle, dot);
+	if (move->turn < 0) {
+	    angle = -angle;
+	}
+	if (angle <= 0) {
+	    angle += 2 * M_PI;
+	}
+	angle += 2 * M_PI * (move->turn < 0 ? -move->turn - 1 : move->turn);
+	pmCartMag(&r0, &length);
+	length = sqrt(pow(length * angle, 2) + h * h);
+	vel = move->vel;
+	*last_end = move->end;
+	break;
+    }
+
+    default:
+	return 0;
+    }
+
+    *have_last_end = true;
+    if (have_start && vel > 0) {
+	seconds = length / vel;
+    }
+    return seconds;
+}
+
 int NML_INTERP_LIST::append(NMLmsg * nml_msg_ptr)
 {
     /* check for invalid data */
@@ -83,64 +214,139 @@ int NML_INTERP_LIST::append(NMLmsg * nml_msg_ptr)
 	return -1;
     }
 #ifdef DEBUG_INTERPL
-    if (sizeof(temp_node) < MAX_NML_COMMAND_SIZE + 4 ||
-	sizeof(temp_node) > MAX_NML_COMMAND_SIZE + 16 ||
-	((void *) &temp_node.line_number) >
-	((void *) &temp_node.command.commandbuf)) {
+    if (sizeof(NML_INTERP_LIST_NODE) < MAX_NML_COMMAND_SIZE + 4 ||
+	sizeof(queue_node) - sizeof(NML_INTERP_LIST_NODE::_command_union) !=
+	offsetof(queue_node, node.command)) {
 	rcs_print_error
 	    ("NML_INTERP_LIST::append : assumptions about NML_INTERP_LIST_NODE have been violated.");
 	return -1;
     }
 #endif
 
-    if (NULL == linked_list_ptr) {
+    if (restart.exchange(false, std::memory_order_acquire)) {
+	// whatever cleared the list may have moved the machine elsewhere
+	have_last_end = false;
+    }
+
+    queue_node *n = new_node(nml_msg_ptr);
+    if (NULL == n) {
+	rcs_print_error("NML_INTERP_LIST::append : out of memory\n");
 	return -1;
     }
-    // fill in the NML_INTERP_LIST_NODE
-    temp_node.line_number = next_line_number;
-    memcpy(temp_node.command.commandbuf, nml_msg_ptr, nml_msg_ptr->size);
+    n->node.line_number = next_line_number;
+    n->node.duration = estimate_time(nml_msg_ptr, &last_end, &have_last_end);
 
-    // stick it on the list
-    linked_list_ptr->store_at_tail(&temp_node,
-				   nml_msg_ptr->size +
-				   sizeof(temp_node.line_number) +
-				   sizeof(temp_node.dummy) + 32 + (32 -
-								   nml_msg_ptr->
-								   size %
-								   32), 1);
+    if (held_tail != NULL) {
+	held_tail->next.store(n, std::memory_order_relaxed);
+    } else {
+	held_head = n;
+    }
+    held_tail = n;
+    held_count++;
 
     if (emc_debug & EMC_DEBUG_INTERP_LIST) {
 	rcs_print
-	    ("NML_INTERP_LIST(%p)::append(nml_msg_ptr{size=%ld,type=%s}) : list_size=%d, line_number=%d\n",
+	    ("NML_INTERP_LIST(%p)::append(nml_msg_ptr{size=%ld,type=%s}) : list_size=%d, line_number=%d%s\n",
              this,
 	     nml_msg_ptr->size, emc_symbol_lookup(nml_msg_ptr->type),
-	     linked_list_ptr->list_size, temp_node.line_number);
+	     len(), n->node.line_number, holding ? " (held)" : "");
     }
 
+    if (!holding) {
+	publish();
+    }
     return 0;
 }
 
-NMLmsg *NML_INTERP_LIST::get()
+void NML_INTERP_LIST::hold(bool on)
 {
-    NMLmsg *ret;
-    NML_INTERP_LIST_NODE *node_ptr;
+    holding = on;
+    if (!on) {
+	publish();
+    }
+}
 
-    if (NULL == linked_list_ptr) {
-	line_number = 0;
+void NML_INTERP_LIST::publish()
+{
+    if (held_head == NULL) {
+	return;
+    }
+    // added node by node, as get() takes them off, so the two sums round
+    // alike; before linking, as the reader may free the nodes after that
+    double t = appended_time.load(std::memory_order_relaxed);
+    for (queue_node *n = held_head; n != NULL;
+	 n = n->next.load(std::memory_order_relaxed)) {
+	t += n->node.duration;
+    }
+    // link first; until the counts catch up len() and time() may be a
+    // little short, never over
+    tail->next.store(held_head, std::memory_order_release);
+    appended_time.store(t, std::memory_order_release);
+    appended.store(appended.load(std::memory_order_relaxed) + held_count,
+	std::memory_order_release);
+    tail = held_tail;
+    held_head = held_tail = NULL;
+    held_count = 0;
+}
+
+void NML_INTERP_LIST::discard()
+{
+    while (held_head != NULL) {
+	queue_node *next = held_head->next.load(std::memory_order_relaxed);
+	held_head->~queue_node();
+	free(held_head);
+	held_head = next;
+    }
+    held_tail = NULL;
+    held_count = 0;
+}
+
+// takes the node after head off the list and makes it the new head,
+// freeing the old one unless the caller may still be using it
+NML_INTERP_LIST::queue_node *NML_INTERP_LIST::take(bool keep_old)
+{
+    queue_node *next = head->next.load(std::memory_order_acquire);
+
+    if (NULL == next) {
 	return NULL;
     }
+    if (!keep_old) {
+	head->~queue_node();
+	free(head);
+    }
+    head = next;
+    taken_time.store(taken_time.load(std::memory_order_relaxed) + head->node.duration,
+	std::memory_order_release);
+    taken.store(taken.load(std::memory_order_relaxed) + 1,
+	std::memory_order_release);
+    return head;
+}
 
-    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->retrieve_head();
+NMLmsg *NML_INTERP_LIST::get()
+{
+    NMLmsg *ret;
 
-    if (NULL == node_ptr) {
+    // the command from the get() before a clear() is done with now too
+    if (retired != NULL) {
+	retired->~queue_node();
+	free(retired);
+	retired = NULL;
+    }
+    // the node from the last get() is done with; this one stays until
+    // the next, as its command is used in the meantime
+    if (NULL == take(false)) {
 	line_number = 0;
+	duration = 0;
+	head_given = false;
 	return NULL;
     }
+    head_given = true;
+
     // save line number of this one, for use by get_line_number
-    line_number = node_ptr->line_number;
+    line_number = head->node.line_number;
+    duration = head->node.duration;
 
-    // get it off the front
-    ret = (NMLmsg *) ((char *) node_ptr->command.commandbuf);
+    ret = (NMLmsg *) ((char *) head->node.command.commandbuf);
 
     if (emc_debug & EMC_DEBUG_INTERP_LIST) {
         rcs_print(
@@ -148,7 +354,7 @@ NMLmsg *NML_INTERP_LIST::get()
             this,
             ret->size,
             emc_symbol_lookup(ret->type),
-            linked_list_ptr->list_size
+            len()
         );
     }
 
@@ -157,48 +363,70 @@ NMLmsg *NML_INTERP_LIST::get()
 
 void NML_INTERP_LIST::clear()
 {
-    if (NULL != linked_list_ptr) {
-        if (emc_debug & EMC_DEBUG_INTERP_LIST) {
-            rcs_print("NML_INTERP_LIST(%p)::clear(): discarding %d items\n", this, linked_list_ptr->list_size);
-        }
-
-	linked_list_ptr->delete_members();
+    if (emc_debug & EMC_DEBUG_INTERP_LIST) {
+	rcs_print("NML_INTERP_LIST(%p)::clear(): discarding %d items\n", this, len());
     }
+    // the command from the last get() may still be in use, as task keeps
+    // it until it has been issued; it is freed by the next get()
+    queue_node *given = head_given ? head : NULL;
+
+    if (NULL != take(given != NULL)) {
+	if (given != NULL) {
+	    retired = given;
+	}
+	while (take(false) != NULL) {
+	}
+	head_given = false;
+    }
+    line_number = 0;
+    duration = 0;
+    restart.store(true, std::memory_order_release);
 }
 
 void NML_INTERP_LIST::print()
 {
     NMLmsg *ret;
-    NML_INTERP_LIST_NODE *node_ptr;
-    int line_number;
+    queue_node *n;
 
-    if (NULL == linked_list_ptr) {
-	return;
-    }
-    node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_head();
-
-    rcs_print("NML_INTERP_LIST::print(): list size=%d\n",linked_list_ptr->list_size);
-    while (NULL != node_ptr) {
-	line_number = node_ptr->line_number;
-	ret = (NMLmsg *) ((char *) node_ptr->command.commandbuf);
+    rcs_print("NML_INTERP_LIST::print(): list size=%d\n", len());
+    for (n = head->next.load(std::memory_order_acquire); NULL != n;
+	 n = n->next.load(std::memory_order_acquire)) {
+	ret = (NMLmsg *) ((char *) n->node.command.commandbuf);
 	rcs_print("--> type=%s,  line_number=%d\n",
 		  emc_symbol_lookup((int)ret->type),
-		  line_number);
-	node_ptr = (NML_INTERP_LIST_NODE *) linked_list_ptr->get_next();
+		  n->node.line_number);
     }
     rcs_print("\n");
 }
 
 int NML_INTERP_LIST::len()
 {
-    if (NULL == linked_list_ptr) {
-	return 0;
-    }
+    // taken first, so appended is at least as new; taken can still be
+    // ahead for a moment, see publish()
+    unsigned int t = taken.load(std::memory_order_acquire);
+    unsigned int a = appended.load(std::memory_order_acquire);
 
-    return ((int) linked_list_ptr->list_size);
+    return a - t < 0x80000000u ? (int) (a - t) : 0;
 }
 
 int NML_INTERP_LIST::get_line_number()
 {
     return line_number;
 }
+
+// estimated run time of the node from get(), in seconds
+double NML_INTERP_LIST::get_duration()
+{
+    return duration;
+}
+
+// estimated run time of the moves and dwells on the list, in seconds
+double NML_INTERP_LIST::time()
+{
+    double t = taken_time.load(std::memory_order_acquire);
+    double a = appended_time.load(std::memory_order_acquire);
+
+    // both add up the same durations one at a time in the same order, so
+    // an empty list comes out as 0 exactly
+    return a > t ? a - t : 0;
+}
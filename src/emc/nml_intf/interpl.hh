@@ -18,12 +18,15 @@
 #define INTERP_LIST_HH
 
 #include <stdint.h>
+#include <atomic>
+#include "emcpos.h"		// EmcPose
 
 #define MAX_NML_COMMAND_SIZE 1000
 
 // these go on the interp list
 struct NML_INTERP_LIST_NODE {
     int line_number;		// line number it was on
+    double duration;		// estimated run time, seconds
     union _dummy_union {
 	int32_t i;
 	int32_t l;
@@ -44,26 +47,65 @@ struct NML_INTERP_LIST_NODE {
     } command;
 };
 
-// here's the interp list itself
+/* here's the interp list itself
+
+   It is a queue with one thread putting commands on it and one taking
+   them off, which may be the same thread: canon appends as the
+   interpreter executes lines and task gets them.  Neither side locks or
+   waits for the other.  The writer can hold its appends back and
+   publish them together, so the reader sees all of a line or none of
+   it.  clear() only takes off what the reader can see, and leaves the
+   command from the last get() in place until the next get(). */
 class NML_INTERP_LIST {
   public:
     NML_INTERP_LIST();
     ~NML_INTERP_LIST();
 
+    // writer's side
     int set_line_number(int line);
-    int get_line_number();
     int append(NMLmsg &);
     int append(NMLmsg *);
+    void hold(bool on);		// keep appends back until publish()
+    void publish();		// let the reader see the appends held back
+    void discard();		// drop the appends held back
+
+    // reader's side
+    int get_line_number();
+    double get_duration();
     NMLmsg *get();
     void clear();
     void print();
+
+    // either side
     int len();
+    double time();
 
   private:
-    class LinkedList * linked_list_ptr;
-    NML_INTERP_LIST_NODE temp_node;	// filled in and put on the list
-    int next_line_number;	// line number used to fill temp_node
+    struct queue_node;
+    queue_node *new_node(NMLmsg * nml_msg_ptr);
+    queue_node *take(bool keep_old);
+
+    // reader's side
+    queue_node *head;		// node from get(), before the first one on the list
+    bool head_given;		// head came from get(), not from clear()
+    queue_node *retired;	// node from get() before a clear(), freed by the next get()
     int line_number;		// line number of node from get()
+    double duration;		// estimated run time of node from get()
+    std::atomic<unsigned int> taken;	// nodes got so far
+    std::atomic<double> taken_time;	// and their estimated run time
+    std::atomic<bool> restart;	// tells the writer the list was cleared
+
+    // writer's side
+    queue_node *tail;		// last node the reader can see
+    queue_node *held_head;	// appends not published yet
+    queue_node *held_tail;
+    unsigned int held_count;
+    bool holding;
+    int next_line_number;	// line number used to fill new nodes
+    std::atomic<unsigned int> appended;	// nodes published so far
+    std::atomic<double> appended_time;	// and their estimated run time
+    EmcPose last_end;		// where the last move appended ends
+    bool have_last_end;		// false until a move was appended
 };
 
 extern NML_INTERP_LIST interp_list;	/* NML Union, for interpreter */
@@ -0,0 +1,208 @@
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "canoncache.hh"
+
+#define CANON_CACHE_MAGIC "LCNCCANO"
+#define CANON_CACHE_VERSION 1
+
+struct canon_cache_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+    uint64_t key;
+    uint64_t body_len;
+    uint64_t body_hash;
+};
+
+struct canon_cache_record {
+    uint8_t kind;
+    uint8_t op;
+    uint16_t reserved;
+    uint32_t len;
+};
+
+void CanonHash::add(const void *data, size_t len) {
+    const unsigned char *p = (const unsigned char *)data;
+    size_t i = 0;
+    // eight bytes at a time, cache files can be large
+    for(; i + 8 <= len; i += 8) {
+        uint64_t w;
+        memcpy(&w, p + i, sizeof(w));
+        h ^= w;
+        h *= 1099511628211ULL;
+    }
+    for(; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    // keep "ab","c" apart from "a","bc"
+    h ^= len;
+    h *= 1099511628211ULL;
+}
+
+int CanonHash::add_file(const char *path, uint64_t *size) {
+    char buf[65536];
+    uint64_t total = 0;
+    ssize_t n;
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+
+    if(fd < 0) return -1;
+    while((n = read(fd, buf, sizeof(buf))) > 0) {
+        add(buf, n);
+        total += n;
+    }
+    ::close(fd);
+    if(n < 0) return -1;
+    if(size) *size = total;
+    return 0;
+}
+
+void CanonRecord::put_string(const char *s) {
+    int len = s ? strlen(s) : 0;
+    put_int(len);
+    data.append(s ? s : "", len);
+}
+
+bool CanonFields::get_int(int &v) {
+    if((size_t)(end - p) < sizeof(v)) return false;
+    memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return true;
+}
+
+bool CanonFields::get_double(double &v) {
+    if((size_t)(end - p) < sizeof(v)) return false;
+    memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return true;
+}
+
+bool CanonFields::get_uint64(uint64_t &v) {
+    if((size_t)(end - p) < sizeof(v)) return false;
+    memcpy(&v, p, sizeof(v));
+    p += sizeof(v);
+    return true;
+}
+
+bool CanonFields::get_string(std::string &s) {
+    int len;
+    if(!get_int(len) || len < 0 || end - p < len) return false;
+    s.assign(p, len);
+    p += len;
+    return true;
+}
+
+void CanonCacheWriter::put(int kind, int op, const void *data, size_t len) {
+    canon_cache_record r;
+    r.kind = kind;
+    r.op = op;
+    r.reserved = 0;
+    r.len = len;
+    body.append((const char *)&r, sizeof(r));
+    body.append((const char *)data, len);
+}
+
+int CanonCacheWriter::save(const char *path, uint64_t key) {
+    canon_cache_header h;
+    CanonHash hash;
+    char tmp[PATH_MAX];
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, CANON_CACHE_MAGIC, sizeof(h.magic));
+    h.version = CANON_CACHE_VERSION;
+    h.key = key;
+    h.body_len = body.size();
+    hash.add(body.data(), body.size());
+    h.body_hash = hash.value();
+
+    // readers see the old file or the whole new one, never part of it
+    snprintf(tmp, sizeof(tmp), "%s.%d", path, (int)getpid());
+    FILE *f = fopen(tmp, "wb");
+    if(!f) return -1;
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1
+        && fwrite(body.data(), 1, body.size(), f) == body.size();
+    if(fclose(f) != 0) ok = false;
+    if(!ok || rename(tmp, path) != 0) {
+        unlink(tmp);
+        return -1;
+    }
+    return 0;
+}
+
+int CanonCacheReader::open(const char *path, uint64_t key) {
+    struct stat st;
+    canon_cache_header h;
+
+    close();
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return -1;
+    if(fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(h)) {
+        ::close(fd);
+        return -1;
+    }
+    void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(m == MAP_FAILED) return -1;
+    map = (const char *)m;
+    map_len = st.st_size;
+
+    memcpy(&h, map, sizeof(h));
+    CanonHash hash;
+    if(memcmp(h.magic, CANON_CACHE_MAGIC, sizeof(h.magic)) != 0
+            || h.version != CANON_CACHE_VERSION || h.key != key
+            || h.body_len != map_len - sizeof(h)) {
+        close();
+        return -1;
+    }
+    hash.add(map + sizeof(h), h.body_len);
+    if(hash.value() != h.body_hash) {
+        close();
+        return -1;
+    }
+    rewind();
+    return 0;
+}
+
+void CanonCacheReader::close() {
+    if(map) munmap((void *)map, map_len);
+    map = 0;
+    map_len = 0;
+    pos = 0;
+}
+
+void CanonCacheReader::rewind() {
+    pos = sizeof(canon_cache_header);
+}
+
+bool CanonCacheReader::next(int &kind, int &op, const char *&data, size_t &len) {
+    canon_cache_record r;
+
+    if(!map || map_len - pos < sizeof(r)) return false;
+    memcpy(&r, map + pos, sizeof(r));
+    if(map_len - pos - sizeof(r) < r.len) return false;
+    kind = r.kind;
+    op = r.op;
+    data = map + pos + sizeof(r);
+    len = r.len;
+    pos += sizeof(r) + r.len;
+    return true;
+}
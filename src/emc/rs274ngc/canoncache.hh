@@ -0,0 +1,106 @@
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#ifndef CANONCACHE_HH
+#define CANONCACHE_HH
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <string>
+
+/*
+  A binary file of the canon calls one parse of a program made, so the
+  next parse of the same program can replay them instead of interpreting
+  it again.
+
+  The file is a header followed by records.  Each record has a kind, an
+  opcode whose meaning is up to the user, and a payload of ints, doubles
+  and strings in host byte order.  The header holds a key, computed by the
+  user from everything the parse depends on, and a hash of the records, so
+  a file for other input or a damaged file is never replayed.
+
+  Files are written to a temporary name and renamed into place, and read
+  through mmap.
+*/
+
+enum {
+    CANON_CACHE_DEPENDENCY = 1,	// a file the parse read: path, size, hash
+    CANON_CACHE_QUERY,		// a question asked during the parse and its answer
+    CANON_CACHE_CALL,		// a canon call
+    CANON_CACHE_RESULT,		// how the parse ended
+};
+
+// FNV-1a, 64 bits, taking eight bytes at a time where it can
+class CanonHash {
+public:
+    CanonHash() : h(14695981039346656037ULL) {}
+    void add(const void *data, size_t len);
+    void add(const char *s) { add(s, s ? strlen(s) : 0); }
+    int add_file(const char *path, uint64_t *size = 0);
+    uint64_t value() const { return h; }
+private:
+    uint64_t h;
+};
+
+// payload builder
+class CanonRecord {
+public:
+    void clear() { data.clear(); }
+    void put_int(int v) { data.append((const char *)&v, sizeof(v)); }
+    void put_double(double v) { data.append((const char *)&v, sizeof(v)); }
+    void put_uint64(uint64_t v) { data.append((const char *)&v, sizeof(v)); }
+    void put_string(const char *s);
+    std::string data;
+};
+
+// payload reader; every get fails once the payload is used up
+class CanonFields {
+public:
+    CanonFields(const char *data, size_t len) : p(data), end(data + len) {}
+    bool get_int(int &v);
+    bool get_double(double &v);
+    bool get_uint64(uint64_t &v);
+    bool get_string(std::string &s);
+    bool done() const { return p == end; }
+private:
+    const char *p, *end;
+};
+
+class CanonCacheWriter {
+public:
+    void clear() { std::string().swap(body); }
+    void put(int kind, int op, const CanonRecord &r) { put(kind, op, r.data.data(), r.data.size()); }
+    void put(int kind, int op, const void *data, size_t len);
+    size_t size() const { return body.size(); }
+    int save(const char *path, uint64_t key);
+private:
+    std::string body;
+};
+
+class CanonCacheReader {
+public:
+    CanonCacheReader() : map(0), map_len(0), pos(0) {}
+    ~CanonCacheReader() { close(); }
+    int open(const char *path, uint64_t key);
+    void close();
+    bool is_open() const { return map != 0; }
+    void rewind();
+    bool next(int &kind, int &op, const char *&data, size_t &len);
+private:
+    const char *map;
+    size_t map_len;
+    size_t pos;
+};
+
+#endif
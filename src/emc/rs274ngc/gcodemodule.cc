@@ -23,7 +23,19 @@
 #include "rs274ngc_interp.hh"
 #include "interp_return.hh"
 #include "canon.hh"
+#include "canoncache.hh"
+#include "inifile.hh"
 #include "config.h"		// LINELEN
+#if defined(RTAPI_USPACE)
+#include "userkins.h"
+#endif
+
+#include <algorithm>
+#include <math.h>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
 
 int _task = 0; // control preview behaviour when remapping
 
@@ -148,6 +160,155 @@ static InterpBase *pinterp;
 
 #define callmethod(o, m, f, ...) PyObject_CallMethod((o), (char*)(m), (char*)(f), ## __VA_ARGS__)
 
+// The canon calls a parse passes on to the callback, and the questions it
+// asks the callback, are recorded so a later parse of the same program can
+// replay them from the cache instead of running the interpreter.
+enum {
+    OP_NEXT_LINE, OP_ARC_FEED, OP_STRAIGHT_FEED, OP_STRAIGHT_TRAVERSE,
+    OP_SET_G5X_OFFSET, OP_SET_G92_OFFSET, OP_SET_XY_ROTATION, OP_SET_PLANE,
+    OP_SET_TRAVERSE_RATE, OP_CHANGE_TOOL, OP_SET_FEED_RATE, OP_DWELL,
+    OP_MESSAGE, OP_COMMENT, OP_TOOL_OFFSET, OP_STRAIGHT_PROBE, OP_RIGID_TAP,
+    OP_USER_DEFINED_FUNCTION, OP_MAX
+};
+
+static const struct { const char *name, *fmt; } canon_methods[OP_MAX] = {
+    {"next_line", "O"},
+    {"arc_feed", "ffffifffffff"},
+    {"straight_feed", "fffffffff"},
+    {"straight_traverse", "fffffffff"},
+    {"set_g5x_offset", "ifffffffff"},
+    {"set_g92_offset", "fffffffff"},
+    {"set_xy_rotation", "f"},
+    {"set_plane", "i"},
+    {"set_traverse_rate", "f"},
+    {"change_tool", "i"},
+    {"set_feed_rate", "f"},
+    {"dwell", "f"},
+    {"message", "s"},
+    {"comment", "s"},
+    {"tool_offset", "ddddddddd"},
+    {"straight_probe", "fffffffff"},
+    {"rigid_tap", "fff"},
+    {"user_defined_function", "idd"},
+};
+
+enum {
+    Q_TOOL, Q_BLOCK_DELETE, Q_AXIS_MASK, Q_ANGLE_UNITS, Q_LENGTH_UNITS
+};
+
+static char *cache_dir;
+static bool cache_recording, cache_answering;
+static CanonCacheWriter cache_writer;
+static CanonRecord cache_record;
+static std::set<std::pair<int, int> > cache_queries;
+
+static PyObject *call_canon_method(int op, PyObject *args) {
+    if(!args) return NULL;
+    if(!PyTuple_Check(args)) {
+        PyObject *t = PyTuple_Pack(1, args);
+        Py_DECREF(args);
+        if(!t) return NULL;
+        args = t;
+    }
+    PyObject *result = NULL;
+    PyObject *method = PyObject_GetAttrString(callback, canon_methods[op].name);
+    if(method) result = PyObject_CallObject(method, args);
+    Py_XDECREF(method);
+    Py_DECREF(args);
+    return result;
+}
+
+static void put_linecode(CanonRecord &r, LineCode *l) {
+    for(int i = 0; i < ACTIVE_SETTINGS; i++) r.put_double(l->settings[i]);
+    for(int i = 0; i < ACTIVE_G_CODES; i++) r.put_int(l->gcodes[i]);
+    for(int i = 0; i < ACTIVE_M_CODES; i++) r.put_int(l->mcodes[i]);
+}
+
+static bool get_linecode(CanonFields &f, LineCode *l) {
+    for(int i = 0; i < ACTIVE_SETTINGS; i++) if(!f.get_double(l->settings[i])) return false;
+    for(int i = 0; i < ACTIVE_G_CODES; i++) if(!f.get_int(l->gcodes[i])) return false;
+    for(int i = 0; i < ACTIVE_M_CODES; i++) if(!f.get_int(l->mcodes[i])) return false;
+    return true;
+}
+
+// call the callback method for op with the arguments in its format
+static PyObject *canon_call(int op, ...) {
+    const char *fmt = canon_methods[op].fmt;
+    va_list ap;
+
+    if(cache_recording) {
+        cache_record.clear();
+        va_start(ap, op);
+        for(const char *c = fmt; *c; c++) {
+            switch(*c) {
+            case 'i': cache_record.put_int(va_arg(ap, int)); break;
+            case 'f': case 'd': cache_record.put_double(va_arg(ap, double)); break;
+            case 's': cache_record.put_string(va_arg(ap, const char *)); break;
+            case 'O': put_linecode(cache_record, va_arg(ap, LineCode *)); break;
+            }
+        }
+        va_end(ap);
+        cache_writer.put(CANON_CACHE_CALL, op, cache_record);
+    }
+
+    va_start(ap, op);
+    PyObject *args = Py_VaBuildValue(fmt, ap);
+    va_end(ap);
+    return call_canon_method(op, args);
+}
+
+// call the callback method for op with the arguments cached for it
+static PyObject *canon_replay(int op, const char *data, size_t len) {
+    CanonFields f(data, len);
+    const char *fmt = canon_methods[op].fmt;
+    int n = strlen(fmt);
+    PyObject *args = PyTuple_New(n);
+    if(!args) return NULL;
+
+    for(int i = 0; i < n; i++) {
+        PyObject *item = NULL;
+        int iv;
+        double dv;
+        std::string sv;
+        switch(fmt[i]) {
+        case 'i':
+            if(f.get_int(iv)) item = PyInt_FromLong(iv);
+            break;
+        case 'f': case 'd':
+            if(f.get_double(dv)) item = PyFloat_FromDouble(dv);
+            break;
+        case 's':
+            if(f.get_string(sv)) item = PyString_FromStringAndSize(sv.data(), sv.size());
+            break;
+        case 'O': {
+            LineCode *l = PyObject_New(LineCode, &LineCodeType);
+            if(l && !get_linecode(f, l)) { Py_DECREF(l); l = NULL; }
+            if(l) last_sequence_number = l->gcodes[0];
+            item = (PyObject *)l;
+            break;
+        }
+        }
+        if(!item) {
+            Py_DECREF(args);
+            if(!PyErr_Occurred())
+                PyErr_Format(PyExc_RuntimeError, "damaged preview cache entry");
+            return NULL;
+        }
+        PyTuple_SET_ITEM(args, i, item);
+    }
+    return call_canon_method(op, args);
+}
+
+static void answer_query(int op, int arg, CanonRecord &r);
+
+// remember the first answer to each question asked during the parse
+static void note_query(int op, int arg) {
+    if(!cache_recording || cache_answering) return;
+    if(!cache_queries.insert(std::make_pair(op, arg)).second) return;
+    answer_query(op, arg, cache_record);
+    cache_writer.put(CANON_CACHE_QUERY, op, cache_record);
+}
+
 static void maybe_new_line(int sequence_number=pinterp->sequence_number());
 static void maybe_new_line(int sequence_number) {
     if(!pinterp) return;
@@ -162,7 +323,7 @@ static void maybe_new_line(int sequence_number) {
     new_line_code->gcodes[0] = sequence_number;
     last_sequence_number = sequence_number;
     PyObject *result = 
-        callmethod(callback, "next_line", "O", new_line_code);
+        canon_call(OP_NEXT_LINE, new_line_code);
     Py_DECREF(new_line_code);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
@@ -205,7 +366,7 @@ void ARC_FEED(int line_number,
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "arc_feed", "ffffifffffff",
+        canon_call(OP_ARC_FEED,
                             first_end, second_end, first_axis, second_axis,
                             rotation, axis_end_point, 
                             a_position, b_position, c_position,
@@ -225,7 +386,7 @@ void STRAIGHT_FEED(int line_number,
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "straight_feed", "fffffffff",
+        canon_call(OP_STRAIGHT_FEED,
                             x, y, z, a, b, c, u, v, w);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
@@ -242,7 +403,7 @@ void STRAIGHT_TRAVERSE(int line_number,
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "straight_traverse", "fffffffff",
+        canon_call(OP_STRAIGHT_TRAVERSE,
                             x, y, z, a, b, c, u, v, w);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
@@ -256,7 +417,7 @@ void SET_G5X_OFFSET(int g5x_index,
     maybe_new_line();
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "set_g5x_offset", "ifffffffff",
+        canon_call(OP_SET_G5X_OFFSET,
                             g5x_index, x, y, z, a, b, c, u, v, w);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
@@ -269,7 +430,7 @@ void SET_G92_OFFSET(double x, double y, double z,
     maybe_new_line();
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "set_g92_offset", "fffffffff",
+        canon_call(OP_SET_G92_OFFSET,
                             x, y, z, a, b, c, u, v, w);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
@@ -279,7 +440,7 @@ void SET_XY_ROTATION(double t) {
     maybe_new_line();
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "set_xy_rotation", "f", t);
+        canon_call(OP_SET_XY_ROTATION, t);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 };
@@ -290,7 +451,7 @@ void SELECT_PLANE(CANON_PLANE pl) {
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "set_plane", "i", pl);
+        canon_call(OP_SET_PLANE, pl);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -299,7 +460,7 @@ void SET_TRAVERSE_RATE(double rate) {
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "set_traverse_rate", "f", rate);
+        canon_call(OP_SET_TRAVERSE_RATE, rate);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -319,7 +480,7 @@ void CHANGE_TOOL(int pocket) {
     maybe_new_line();
     if(interp_error) return;
     PyObject *result = 
-        callmethod(callback, "change_tool", "i", pocket);
+        canon_call(OP_CHANGE_TOOL, pocket);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -339,7 +500,7 @@ void SET_FEED_RATE(double rate) {
     if(interp_error) return;
     if(metric) rate /= 25.4;
     PyObject *result =
-        callmethod(callback, "set_feed_rate", "f", rate);
+        canon_call(OP_SET_FEED_RATE, rate);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -348,7 +509,7 @@ void DWELL(double time) {
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "dwell", "f", time);
+        canon_call(OP_DWELL, time);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -357,7 +518,7 @@ void MESSAGE(char *comment) {
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "message", "s", comment);
+        canon_call(OP_MESSAGE, comment);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -371,7 +532,7 @@ void COMMENT(const char *comment) {
     maybe_new_line();   
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "comment", "s", comment);
+        canon_call(OP_COMMENT, comment);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
 }
@@ -387,7 +548,7 @@ void USE_TOOL_LENGTH_OFFSET(EmcPose offset) {
     if(metric) {
         offset.tran.x /= 25.4; offset.tran.y /= 25.4; offset.tran.z /= 25.4;
         offset.u /= 25.4; offset.v /= 25.4; offset.w /= 25.4; }
-    PyObject *result = callmethod(callback, "tool_offset", "ddddddddd", offset.tran.x, offset.tran.y, offset.tran.z,
+    PyObject *result = canon_call(OP_TOOL_OFFSET, offset.tran.x, offset.tran.y, offset.tran.z,
         offset.a, offset.b, offset.c, offset.u, offset.v, offset.w);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
@@ -422,6 +583,7 @@ int  GET_EXTERNAL_TC_REASON() {return 0;}
 extern bool GET_BLOCK_DELETE(void) { 
     int bd = 0;
     if(interp_error) return 0;
+    note_query(Q_BLOCK_DELETE, 0);
     PyObject *result =
         callmethod(callback, "get_block_delete", "");
     if(result == NULL) {
@@ -478,7 +640,7 @@ void STRAIGHT_PROBE(int line_number,
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "straight_probe", "fffffffff",
+        canon_call(OP_STRAIGHT_PROBE,
                             x, y, z, a, b, c, u, v, w);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
@@ -490,7 +652,7 @@ void RIGID_TAP(int line_number,
     maybe_new_line(line_number);
     if(interp_error) return;
     PyObject *result =
-        callmethod(callback, "rigid_tap", "fff",
+        canon_call(OP_RIGID_TAP,
             x, y, z);
     if(result == NULL) interp_error ++;
     Py_XDECREF(result);
@@ -535,6 +697,7 @@ CANON_UNITS GET_EXTERNAL_LENGTH_UNIT_TYPE() { return CANON_UNITS_INCHES; }
 CANON_TOOL_TABLE GET_EXTERNAL_TOOL_TABLE(int pocket) {
     CANON_TOOL_TABLE t = {-1,-1,{{0,0,0},0,0,0,0,0,0},0,0,0,0};
     if(interp_error) return t;
+    note_query(Q_TOOL, pocket);
     PyObject *result =
         callmethod(callback, "get_tool", "i", pocket);
     if(result == NULL ||
@@ -555,8 +718,7 @@ static void user_defined_function(int num, double arg1, double arg2) {
     if(interp_error) return;
     maybe_new_line();
     PyObject *result =
-        callmethod(callback, "user_defined_function",
-                            "idd", num, arg1, arg2);
+        canon_call(OP_USER_DEFINED_FUNCTION, num, arg1, arg2);
     if(result == NULL) interp_error++;
     Py_XDECREF(result);
 }
@@ -565,6 +727,7 @@ void SET_FEED_REFERENCE(CANON_FEED_REFERENCE ref) {}
 int GET_EXTERNAL_QUEUE_EMPTY() { return true; }
 CANON_DIRECTION GET_EXTERNAL_SPINDLE(int) { return CANON_STOPPED; }
 int GET_EXTERNAL_TOOL_SLOT() { return 0; }
+int GET_EXTERNAL_TOOL_POCKET(int toolno) { return -1; }
 int GET_EXTERNAL_SELECTED_TOOL_SLOT() { return 0; }
 double GET_EXTERNAL_FEED_RATE() { return 1; }
 double GET_EXTERNAL_TRAVERSE_RATE() { return 0; }
@@ -598,6 +761,7 @@ EmcPose GET_EXTERNAL_OFFSETS() {
 
 int GET_EXTERNAL_AXIS_MASK() {
     if(interp_error) return 7;
+    note_query(Q_AXIS_MASK, 0);
     PyObject *result =
         callmethod(callback, "get_axis_mask", "");
     if(!result) { interp_error ++; return 7 /* XYZABC */; }
@@ -650,6 +814,7 @@ static bool PyFloat_CheckAndError(const char *func, PyObject *p)  {
 }
 
 double GET_EXTERNAL_ANGLE_UNITS() {
+    note_query(Q_ANGLE_UNITS, 0);
     PyObject *result =
         callmethod(callback, "get_external_angular_units", "");
     if(result == NULL) interp_error++;
@@ -665,6 +830,7 @@ double GET_EXTERNAL_ANGLE_UNITS() {
 }
 
 double GET_EXTERNAL_LENGTH_UNITS() {
+    note_query(Q_LENGTH_UNITS, 0);
     PyObject *result =
         callmethod(callback, "get_external_length_units", "");
     if(result == NULL) interp_error++;
@@ -679,6 +845,32 @@ double GET_EXTERNAL_LENGTH_UNITS() {
     return dresult;
 }
 
+// ask the callback again, and encode the answer the way note_query saved it
+static void answer_query(int op, int arg, CanonRecord &r) {
+    cache_answering = true;
+    r.clear();
+    r.put_int(arg);
+    switch(op) {
+    case Q_TOOL: {
+        CANON_TOOL_TABLE t = GET_EXTERNAL_TOOL_TABLE(arg);
+        r.put_int(t.toolno);
+        r.put_double(t.offset.tran.x); r.put_double(t.offset.tran.y);
+        r.put_double(t.offset.tran.z); r.put_double(t.offset.a);
+        r.put_double(t.offset.b); r.put_double(t.offset.c);
+        r.put_double(t.offset.u); r.put_double(t.offset.v);
+        r.put_double(t.offset.w); r.put_double(t.diameter);
+        r.put_double(t.frontangle); r.put_double(t.backangle);
+        r.put_int(t.orientation);
+        break;
+    }
+    case Q_BLOCK_DELETE: r.put_int(GET_BLOCK_DELETE()); break;
+    case Q_AXIS_MASK: r.put_int(GET_EXTERNAL_AXIS_MASK()); break;
+    case Q_ANGLE_UNITS: r.put_double(GET_EXTERNAL_ANGLE_UNITS()); break;
+    case Q_LENGTH_UNITS: r.put_double(GET_EXTERNAL_LENGTH_UNITS()); break;
+    }
+    cache_answering = false;
+}
+
 static bool check_abort() {
     PyObject *result =
         callmethod(callback, "check_abort", "");
@@ -701,6 +893,140 @@ void SET_MOTION_CONTROL_MODE(CANON_MOTION_MODE mode) { motion_mode = mode; }
 CANON_MOTION_MODE GET_EXTERNAL_MOTION_CONTROL_MODE() { return motion_mode; }
 void SET_NAIVECAM_TOLERANCE(double tolerance) { }
 
+// everything a parse depends on that is known before it starts
+static bool cache_key(const char *f, PyObject *initcodes, const char *unitcode,
+        const char *initcode, const char *interpname, uint64_t &key) {
+    CanonHash h;
+    char parameter_file[PATH_MAX];
+    const char *ini = getenv("INI_FILE_NAME");
+
+    if(h.add_file(f) != 0) return false;
+    if(initcodes) {
+        for(int i=0; i<PyList_Size(initcodes); i++) {
+            char *code = PyString_AsString(PyList_GetItem(initcodes, i));
+            if(!code) { PyErr_Clear(); return false; }
+            h.add(code);
+        }
+    }
+    h.add(unitcode);
+    h.add(initcode);
+    h.add(interpname);
+    h.add(ini);
+    if(ini) {
+        // Python oword subs and named parameters run code of their own
+        IniFile inifile;
+        if(!inifile.Open(ini)) return false;
+        if(inifile.Find("TOPLEVEL", "PYTHON")) return false;
+        inifile.Close();
+        if(h.add_file(ini) != 0) return false;
+    }
+    GET_EXTERNAL_PARAMETER_FILE_NAME(parameter_file, sizeof(parameter_file));
+    PyErr_Clear();
+    h.add(parameter_file);
+    if(*parameter_file && h.add_file(parameter_file) != 0) h.add("missing");
+    key = h.value();
+    return true;
+}
+
+// the files a parse read, or false if it depended on more than files:
+// remaps run code of their own, and _hal[] reads pins
+static bool cache_dependencies(std::set<std::string> &files) {
+    Interp *interp = dynamic_cast<Interp*>(pinterp);
+    if(!interp) return false;
+    if(!interp->_setup.remaps.empty() || !interp->_setup.hal_refs.empty())
+        return false;
+    for(offset_map_iterator it = interp->_setup.offset_map.begin();
+            it != interp->_setup.offset_map.end(); ++it)
+        files.insert(it->second.filename);
+    return true;
+}
+
+static void cache_save(const char *path, uint64_t key,
+        const std::set<std::string> &files, int result, int sequence_number) {
+    for(std::set<std::string>::const_iterator it = files.begin(); it != files.end(); ++it) {
+        CanonHash h;
+        uint64_t size;
+        if(h.add_file(it->c_str(), &size) != 0) return;
+        cache_record.clear();
+        cache_record.put_string(it->c_str());
+        cache_record.put_uint64(size);
+        cache_record.put_uint64(h.value());
+        cache_writer.put(CANON_CACHE_DEPENDENCY, 0, cache_record);
+    }
+    cache_record.clear();
+    cache_record.put_int(result);
+    cache_record.put_int(sequence_number);
+    cache_writer.put(CANON_CACHE_RESULT, 0, cache_record);
+    // a cache that can't be written is only a slower load next time
+    cache_writer.save(path, key);
+}
+
+// 1 if the cached parse was replayed, 0 if there is no usable one, and
+// -1 if the callback failed or the load was aborted during the replay
+static int cache_replay(const char *path, uint64_t key, int &result, int &sequence_number) {
+    CanonCacheReader r;
+    int kind, op;
+    const char *data;
+    size_t len;
+    bool finished = false;
+
+    if(r.open(path, key) != 0) return 0;
+
+    // first check that the included files and the answers are still the same
+    while(r.next(kind, op, data, len)) {
+        CanonFields f(data, len);
+        if(kind == CANON_CACHE_DEPENDENCY) {
+            std::string file;
+            uint64_t size, hash, now_size;
+            CanonHash h;
+            if(!f.get_string(file) || !f.get_uint64(size) || !f.get_uint64(hash))
+                return 0;
+            if(h.add_file(file.c_str(), &now_size) != 0
+                    || now_size != size || h.value() != hash)
+                return 0;
+        } else if(kind == CANON_CACHE_QUERY) {
+            int arg;
+            if(!f.get_int(arg)) return 0;
+            answer_query(op, arg, cache_record);
+            if(interp_error) {
+                interp_error = 0;
+                PyErr_Clear();
+                return 0;
+            }
+            if(cache_record.data.size() != len
+                    || memcmp(cache_record.data.data(), data, len) != 0)
+                return 0;
+        } else if(kind == CANON_CACHE_RESULT) {
+            if(!f.get_int(result) || !f.get_int(sequence_number)) return 0;
+            finished = true;
+        }
+    }
+    if(!finished) return 0;
+
+    struct timeval t0, t1;
+    int count = 0;
+    gettimeofday(&t0, NULL);
+    r.rewind();
+    while(r.next(kind, op, data, len)) {
+        if(kind != CANON_CACHE_CALL) continue;
+        if(op >= OP_MAX) {
+            PyErr_Format(PyExc_RuntimeError, "damaged preview cache entry");
+            return -1;
+        }
+        PyObject *res = canon_replay(op, data, len);
+        if(!res) return -1;
+        Py_DECREF(res);
+        if(++count % 1024 == 0) {
+            gettimeofday(&t1, NULL);
+            if(t1.tv_sec > t0.tv_sec + 1) {
+                if(check_abort()) return -1;
+                t0 = t1;
+            }
+        }
+    }
+    return 1;
+}
+
 #define RESULT_OK (result == INTERP_OK || result == INTERP_EXECUTE_FINISH)
 static PyObject *parse_file(PyObject *self, PyObject *args) {
     char *f;
@@ -709,6 +1035,8 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
     int error_line_offset = 0;
     struct timeval t0, t1;
     int wait = 1;
+    uint64_t cache_key_value = 0;
+    char cache_path[PATH_MAX];
 
     if(!PyArg_ParseTuple(args, "sOO!|s:new-parse",
             &f, &callback, &PyList_Type, &initcodes, &interpname))
@@ -741,6 +1069,27 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
     _pos_x = _pos_y = _pos_z = _pos_a = _pos_b = _pos_c = 0;
     _pos_u = _pos_v = _pos_w = 0;
 
+    cache_recording = false;
+    cache_writer.clear();
+    cache_queries.clear();
+    if(cache_dir && cache_key(f, initcodes, unitcode, initcode, interpname, cache_key_value)) {
+        int cached_result, cached_sequence_number;
+        snprintf(cache_path, sizeof(cache_path), "%s/%016llx.canon",
+                cache_dir, (unsigned long long)cache_key_value);
+        switch(cache_replay(cache_path, cache_key_value, cached_result, cached_sequence_number)) {
+        case 1: {
+            PyObject *retval = PyTuple_New(2);
+            PyTuple_SetItem(retval, 0, PyInt_FromLong(cached_result));
+            PyTuple_SetItem(retval, 1, PyInt_FromLong(cached_sequence_number));
+            return retval;
+        }
+        case -1:
+            return NULL;
+        }
+        last_sequence_number = -1;
+        cache_recording = true;
+    }
+
     pinterp->init();
     pinterp->open(f);
 
@@ -782,6 +1131,8 @@ static PyObject *parse_file(PyObject *self, PyObject *args) {
         result = pinterp->execute();
     }
 out_error:
+    std::set<std::string> cache_files;
+    bool cacheable = cache_recording && cache_dependencies(cache_files);
     if(pinterp)
     {
         auto interp = dynamic_cast<Interp*>(pinterp);
@@ -793,11 +1144,20 @@ out_error:
             PyErr_Format(PyExc_RuntimeError,
                     "interp_error > 0 but no Python exception set");
         }
+        cache_recording = false;
+        cache_writer.clear();
         return NULL;
     }
     PyErr_Clear();
     maybe_new_line();
     if(PyErr_Occurred()) { interp_error = 1; goto out_error; }
+    if(cacheable && result > INTERP_MIN_ERROR)
+        cacheable = false;
+    if(cacheable)
+        cache_save(cache_path, cache_key_value, cache_files, result,
+                last_sequence_number + error_line_offset);
+    cache_recording = false;
+    cache_writer.clear();
     PyObject *retval = PyTuple_New(2);
     PyTuple_SetItem(retval, 0, PyInt_FromLong(result));
     PyTuple_SetItem(retval, 1, PyInt_FromLong(last_sequence_number + error_line_offset));
@@ -878,6 +1238,239 @@ static PyObject *rs274_calc_extents(PyObject *self, PyObject *args) {
         min_xt, min_yt, min_zt,  max_xt, max_yt, max_zt);
 }
 
+#if defined(RTAPI_USPACE)
+/* joint_extents() cuts moves into steps of at most this many mm or
+   degrees, as rs274 -E does, and solves them this many at a time */
+#define JOINT_STEP 1.0
+#define JOINT_BATCH 4096
+
+struct joint_segment {
+    int line;
+    double start[6], end[6];	// mm and degrees, tool offset applied
+};
+
+static bool joint_segments(PyObject *list,
+        std::vector<joint_segment> &segments) {
+    for(int j=0; j<PySequence_Length(list); j++) {
+        PyObject *sj = PySequence_GetItem(list, j);
+        PyObject *unused;
+        joint_segment s;
+        double t[3];
+        int r;
+        if(!sj) return false;
+        if(PyTuple_Size(sj) == 4)
+            r = PyArg_ParseTuple(sj,
+                "i(ddddddOOO)(ddddddOOO)(ddd):joint_extents item",
+                &s.line,
+                &s.start[0], &s.start[1], &s.start[2],
+                &s.start[3], &s.start[4], &s.start[5],
+                &unused, &unused, &unused,
+                &s.end[0], &s.end[1], &s.end[2],
+                &s.end[3], &s.end[4], &s.end[5],
+                &unused, &unused, &unused,
+                &t[0], &t[1], &t[2]);
+        else
+            r = PyArg_ParseTuple(sj,
+                "i(ddddddOOO)(ddddddOOO)O(ddd):joint_extents item",
+                &s.line,
+                &s.start[0], &s.start[1], &s.start[2],
+                &s.start[3], &s.start[4], &s.start[5],
+                &unused, &unused, &unused,
+                &s.end[0], &s.end[1], &s.end[2],
+                &s.end[3], &s.end[4], &s.end[5],
+                &unused, &unused, &unused,
+                &unused, &t[0], &t[1], &t[2]);
+        Py_DECREF(sj);
+        if(!r) return false;
+        for(int k=0; k<3; k++) {
+            s.start[k] = (s.start[k] + t[k]) * 25.4;
+            s.end[k] = (s.end[k] + t[k]) * 25.4;
+        }
+        segments.push_back(s);
+    }
+    return true;
+}
+
+static bool joint_line_less(const joint_segment &a, const joint_segment &b) {
+    return a.line < b.line;
+}
+
+struct joint_range {
+    int count;
+    double seed[USERKINS_JOINTS];
+    bool valid;
+    double min[USERKINS_JOINTS], max[USERKINS_JOINTS];
+    int min_line[USERKINS_JOINTS], max_line[USERKINS_JOINTS];
+    int unreachable_line;
+};
+
+static void joint_solve(userkins_t *k, std::vector<EmcPose> &path,
+        std::vector<int> &lines, joint_range &r) {
+    long n = path.size();
+    if(n == 0) return;
+    std::vector<double> joints(n * USERKINS_JOINTS);
+    std::vector<int> result(n);
+    memcpy(&joints[0], r.seed, sizeof(r.seed));
+    userkins_inverse(k, &path[0], &joints[0], &result[0], n,
+            USERKINS_SEED_PREVIOUS);
+    for(long i=0; i<n; i++) {
+        const double *j = &joints[i * USERKINS_JOINTS];
+        if(result[i] != 0) {
+            if(!r.unreachable_line) r.unreachable_line = lines[i];
+            continue;
+        }
+        for(int a=0; a<r.count; a++) {
+            if(!r.valid || j[a] < r.min[a]) {
+                r.min[a] = j[a];
+                r.min_line[a] = lines[i];
+            }
+            if(!r.valid || j[a] > r.max[a]) {
+                r.max[a] = j[a];
+                r.max_line[a] = lines[i];
+            }
+        }
+        r.valid = true;
+        memcpy(r.seed, j, sizeof(r.seed));
+    }
+    path.clear();
+    lines.clear();
+}
+#endif
+
+/* joint_extents(kinematics, value, home, linear_units, angular_units,
+                 arcfeed, feed, traverse)
+
+   Runs the preview's moves through the machine's kinematics module,
+   [KINS]KINEMATICS, with userkins, the way rs274 -E does for the
+   program check: each point is solved from the one before, starting
+   from the joints' home. value(name) gives each pin and parameter of
+   the module, or None to keep its default. linear_units and
+   angular_units are the machine's units per mm and per degree.
+
+   The lists don't say in which order moves of different kinds were
+   made, so the moves are taken in line order.
+
+   Returns ([min], [max], [min line], [max line], unreachable line)
+   for the joints, or None when there are no userkins, the module can't
+   be loaded or its joints are the axes. */
+static PyObject *rs274_joint_extents(PyObject *self, PyObject *args) {
+    const char *kinematics;
+    PyObject *value, *home, *arcfeed, *feed, *traverse;
+    double linear_units, angular_units;
+    if(!PyArg_ParseTuple(args, "sOOddOOO:joint_extents", &kinematics,
+            &value, &home, &linear_units, &angular_units,
+            &arcfeed, &feed, &traverse))
+        return NULL;
+#if defined(RTAPI_USPACE)
+    std::vector<std::string> words;
+    std::vector<const char *> argv;
+    std::string word;
+    std::istringstream in(kinematics);
+    while(in >> word) words.push_back(word);
+    if(words.empty()) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    for(size_t i=1; i<words.size(); i++) argv.push_back(words[i].c_str());
+
+    joint_range r = {};
+    r.count = std::min<long>(PySequence_Length(home), USERKINS_JOINTS);
+    for(int a=0; a<r.count; a++) {
+        PyObject *h = PySequence_GetItem(home, a);
+        if(!h) return NULL;
+        r.seed[a] = PyFloat_AsDouble(h);
+        Py_DECREF(h);
+        if(PyErr_Occurred()) return NULL;
+    }
+
+    std::vector<joint_segment> segments;
+    if(!joint_segments(traverse, segments)
+            || !joint_segments(feed, segments)
+            || !joint_segments(arcfeed, segments))
+        return NULL;
+    std::stable_sort(segments.begin(), segments.end(), joint_line_less);
+
+    userkins_t *k = userkins_load(words[0].c_str(), argv.size(),
+            argv.empty() ? NULL : &argv[0], 1);
+    if(!k) {
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    if(userkins_type(k) == KINEMATICS_IDENTITY) {
+        userkins_unload(k);
+        Py_INCREF(Py_None);
+        return Py_None;
+    }
+    const char *name;
+    for(int i=0; (name = userkins_name(k, i)); i++) {
+        PyObject *v = PyObject_CallFunction(value, (char*)"s", name);
+        if(!v) {
+            userkins_unload(k);
+            return NULL;
+        }
+        if(v != Py_None) {
+            double d = PyFloat_AsDouble(v);
+            if(PyErr_Occurred()) {
+                Py_DECREF(v);
+                userkins_unload(k);
+                return NULL;
+            }
+            userkins_set(k, name, d);
+        }
+        Py_DECREF(v);
+    }
+
+    // from where the last move ended to where the next one starts, then
+    // along it
+    std::vector<EmcPose> path;
+    std::vector<int> lines;
+    double from[6];
+    if(!segments.empty())
+        memcpy(from, segments[0].start, sizeof(from));
+    for(size_t i=0; i<segments.size(); i++) {
+        const joint_segment &s = segments[i];
+        for(int end=0; end<2; end++) {
+            const double *to = end ? s.end : s.start;
+            double d = 0;
+            for(int a=0; a<6; a++) d = std::max(d, fabs(to[a] - from[a]));
+            int n = (int) ceil(d / JOINT_STEP);
+            if(n < 1 && (end || path.empty())) n = 1;
+            for(int j=1; j<=n; j++) {
+                double f = (double) j / n;
+                EmcPose p = {};
+                p.tran.x = (from[0] + (to[0] - from[0]) * f) * linear_units;
+                p.tran.y = (from[1] + (to[1] - from[1]) * f) * linear_units;
+                p.tran.z = (from[2] + (to[2] - from[2]) * f) * linear_units;
+                p.a = (from[3] + (to[3] - from[3]) * f) * angular_units;
+                p.b = (from[4] + (to[4] - from[4]) * f) * angular_units;
+                p.c = (from[5] + (to[5] - from[5]) * f) * angular_units;
+                path.push_back(p);
+                lines.push_back(s.line);
+                if(path.size() >= JOINT_BATCH)
+                    joint_solve(k, path, lines, r);
+            }
+            memcpy(from, to, sizeof(from));
+        }
+    }
+    joint_solve(k, path, lines, r);
+    userkins_unload(k);
+
+    PyObject *mins = PyList_New(r.count), *maxs = PyList_New(r.count),
+             *min_lines = PyList_New(r.count), *max_lines = PyList_New(r.count);
+    for(int a=0; a<r.count; a++) {
+        PyList_SetItem(mins, a, PyFloat_FromDouble(r.min[a]));
+        PyList_SetItem(maxs, a, PyFloat_FromDouble(r.max[a]));
+        PyList_SetItem(min_lines, a, PyInt_FromLong(r.min_line[a]));
+        PyList_SetItem(max_lines, a, PyInt_FromLong(r.max_line[a]));
+    }
+    return Py_BuildValue("NNNNi", mins, maxs, min_lines, max_lines,
+            r.unreachable_line);
+#else
+    Py_INCREF(Py_None);
+    return Py_None;
+#endif
+}
+
 #if PY_VERSION_HEX < 0x02050000
 #define PyObject_GetAttrString(o,s) \
     PyObject_GetAttrString((o),const_cast<char*>((s)))
@@ -1035,6 +1628,15 @@ static PyObject *rs274_arc_to_segments(PyObject *self, PyObject *args) {
     return segs;
 }
 
+static PyObject *rs274_set_cache_dir(PyObject *self, PyObject *args) {
+    char *dir;
+    if(!PyArg_ParseTuple(args, "z:set_cache_dir", &dir)) return NULL;
+    free(cache_dir);
+    cache_dir = dir && *dir ? strdup(dir) : NULL;
+    Py_INCREF(Py_None);
+    return Py_None;
+}
+
 static PyMethodDef gcode_methods[] = {
     {"parse", (PyCFunction)parse_file, METH_VARARGS, "Parse a G-Code file"},
     {"strerror", (PyCFunction)rs274_strerror, METH_VARARGS,
@@ -1043,6 +1645,10 @@ static PyMethodDef gcode_methods[] = {
         "Calculate information about extents of gcode"},
     {"arc_to_segments", (PyCFunction)rs274_arc_to_segments, METH_VARARGS,
         "Convert an arc to straight segments"},
+    {"joint_extents", (PyCFunction)rs274_joint_extents, METH_VARARGS,
+        "Calculate the range of each joint over the moves of gcode"},
+    {"set_cache_dir", (PyCFunction)rs274_set_cache_dir, METH_VARARGS,
+        "Keep the results of parse in this directory, or None to stop"},
     {NULL}
 };
 
@@ -23,6 +23,10 @@
 
 InterpBase::~InterpBase() {}
 
+// interpreters that don't keep checkpoints always run from the top
+int InterpBase::checkpoint(std::string &state) { return -1; }
+int InterpBase::restore_checkpoint(const std::string &state) { return -1; }
+
 InterpBase *interp_from_shlib(const char *shlib) {
     fprintf(stderr, "interp_from_shlib(%s)\n", shlib);
     dlopen(NULL, RTLD_GLOBAL);
@@ -20,6 +20,7 @@
 #define INTERP_BASE_HH
 
 #include <stdlib.h>
+#include <string>
 #include <boost/noncopyable.hpp>
 
 /* Size of certain arrays */
@@ -58,6 +59,10 @@ public:
     virtual void active_settings(double active_settings[ACTIVE_SETTINGS]) = 0;
     virtual void set_loglevel(int level) = 0;
     virtual void set_loop_on_main_m99(bool state) = 0;
+    // save the state after the line just executed, or restore it into
+    // the freshly opened program to go on after that line; 0 on success
+    virtual int checkpoint(std::string &state);
+    virtual int restore_checkpoint(const std::string &state);
 };
 
 InterpBase *interp_from_shlib(const char *shlib);
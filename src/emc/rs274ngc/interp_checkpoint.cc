@@ -0,0 +1,399 @@
+/********************************************************************
+ * Description: interp_checkpoint.cc
+ *
+ *  Checkpoints of the interpreter state between lines of the main
+ *  program, so a run from line can start at the nearest checkpoint
+ *  before the line instead of interpreting the program from the top.
+ *
+ *  A checkpoint holds the file position, the modal state, the position
+ *  the program had reached, the numbered parameters, the named
+ *  parameters and O-word labels of the main program and the M70
+ *  context.  The position matters to the lines read after it is
+ *  restored: G91 moves and IJ arcs are relative to it, and task checks
+ *  those lines against the limits before it synchs to the machine at
+ *  the line before the start line.  It is only taken at call level 0
+ *  outside of remaps, O-word skipping and cutter compensation, which
+ *  leaves nothing else in flight.
+ *
+ *  Restoring sets the state back and runs the G-code that makes canon
+ *  follow, the same way M72 does.  A checkpoint is refused if the
+ *  program file changed, or if the persisted parameters (coordinate
+ *  systems, G92, G28/G30) differ from when the run that made it
+ *  started, e.g. after touching off; the run then starts from the top.
+ *
+ * License: GPL Version 2
+ * System: Linux
+ *
+ ********************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include "rs274ngc.hh"
+#include "rs274ngc_return.hh"
+#include "rs274ngc_interp.hh"
+#include "interp_internal.hh"
+
+using namespace interp_param_global;
+
+#define CHECKPOINT_VERSION 2
+
+// named parameters that are looked up rather than stored
+#define PA_NOT_SAVED (PA_READONLY | PA_USE_LOOKUP | PA_FROM_INI | PA_PYTHON)
+
+namespace {
+
+class CheckpointWriter {
+public:
+    CheckpointWriter(std::string &s) : s(s) { s.clear(); }
+    template<class T> void put(const T &v) { s.append((const char *)&v, sizeof(v)); }
+    void put_string(const char *v) {
+	int len = v ? strlen(v) : 0;
+	put(len);
+	s.append(v ? v : "", len);
+    }
+private:
+    std::string &s;
+};
+
+class CheckpointReader {
+public:
+    CheckpointReader(const std::string &s) : p(s.data()), end(s.data() + s.size()) {}
+    template<class T> bool get(T &v) {
+	if ((size_t)(end - p) < sizeof(v)) return false;
+	memcpy(&v, p, sizeof(v));
+	p += sizeof(v);
+	return true;
+    }
+    bool get_string(std::string &v) {
+	int len;
+	if (!get(len) || len < 0 || end - p < len) return false;
+	v.assign(p, len);
+	p += len;
+	return true;
+    }
+    bool done() const { return p == end; }
+private:
+    const char *p, *end;
+};
+
+struct checkpoint_state {
+    std::string filename;
+    long long file_size, file_mtime;
+    long position;
+    int sequence_number;
+    bool percent_flag;
+    unsigned long base;
+    int g_codes[ACTIVE_G_CODES];
+    int m_codes[ACTIVE_M_CODES];
+    double settings[ACTIVE_SETTINGS];
+    double tolerance, naivecam_tolerance;
+    int motion_mode;
+    double cycle_cc, cycle_i, cycle_j, cycle_k, cycle_p, cycle_q, cycle_r, cycle_il;
+    int cycle_l, cycle_il_flag;
+    EmcPose tool_offset;
+    double current[9];		// X Y Z A B C U V W
+    double program_x, program_y, program_z;
+    bool arc_not_allowed;
+    int executed_if;
+    unsigned char context_status;
+    int saved_g_codes[ACTIVE_G_CODES];
+    int saved_m_codes[ACTIVE_M_CODES];
+    double saved_settings[ACTIVE_SETTINGS];
+};
+
+}
+
+// FNV-1a over the parameters that are kept in the parameter file
+unsigned long Interp::checkpoint_hash()
+{
+    unsigned long long h = 14695981039346656037ULL;
+    for (int k = 0; _required_parameters[k] < RS274NGC_MAX_PARAMETERS; k++) {
+	const unsigned char *p =
+	    (const unsigned char *) &_setup.parameters[_required_parameters[k]];
+	for (size_t i = 0; i < sizeof(double); i++) {
+	    h ^= p[i];
+	    h *= 1099511628211ULL;
+	}
+    }
+    return h;
+}
+
+int Interp::checkpoint(std::string &state)
+{
+    struct stat st;
+    context_pointer frame = &_setup.sub_context[0];
+
+    CHKS((_setup.file_pointer == NULL), NCE_FILE_NOT_OPEN);
+    CHKS((_setup.call_level != 0 || _setup.remap_level != 0),
+	 _("no checkpoint inside a subroutine or remap"));
+    CHKS((_setup.defining_sub || _setup.skipping_o || _setup.skipping_to_sub),
+	 _("no checkpoint while skipping O-word blocks"));
+    CHKS((_setup.cutter_comp_side),
+	 _("no checkpoint with cutter radius compensation on"));
+    CHKS((_setup.probe_flag || _setup.input_flag || _setup.toolchange_flag),
+	 _("no checkpoint while waiting for inputs"));
+    CHKS((!_setup.checkpoint_base_set || checkpoint_hash() != _setup.checkpoint_base),
+	 _("no checkpoint after the program changed persisted parameters"));
+    CHKS((fstat(fileno(_setup.file_pointer), &st) != 0),
+	 _("can't stat %s"), _setup.filename);
+
+    write_g_codes((block_pointer) NULL, &_setup);
+    write_m_codes((block_pointer) NULL, &_setup);
+    write_settings(&_setup);
+
+    CheckpointWriter w(state);
+    w.put((int) CHECKPOINT_VERSION);
+    w.put_string(_setup.filename);
+    w.put((long long) st.st_size);
+    w.put((long long) st.st_mtime);
+    w.put(ftell(_setup.file_pointer));
+    w.put(_setup.sequence_number);
+    w.put(_setup.percent_flag);
+    w.put(_setup.checkpoint_base);
+
+    w.put(_setup.active_g_codes);
+    w.put(_setup.active_m_codes);
+    w.put(_setup.active_settings);
+    w.put(_setup.tolerance);
+    w.put(_setup.naivecam_tolerance);
+    w.put(_setup.motion_mode);
+    w.put(_setup.cycle_cc);
+    w.put(_setup.cycle_i);
+    w.put(_setup.cycle_j);
+    w.put(_setup.cycle_k);
+    w.put(_setup.cycle_p);
+    w.put(_setup.cycle_q);
+    w.put(_setup.cycle_r);
+    w.put(_setup.cycle_il);
+    w.put(_setup.cycle_l);
+    w.put(_setup.cycle_il_flag);
+    w.put(_setup.tool_offset);
+    w.put(_setup.current_x);
+    w.put(_setup.current_y);
+    w.put(_setup.current_z);
+    w.put(_setup.AA_current);
+    w.put(_setup.BB_current);
+    w.put(_setup.CC_current);
+    w.put(_setup.u_current);
+    w.put(_setup.v_current);
+    w.put(_setup.w_current);
+    w.put(_setup.program_x);
+    w.put(_setup.program_y);
+    w.put(_setup.program_z);
+    w.put(_setup.arc_not_allowed);
+    w.put(_setup.executed_if);
+
+    // M70 context of the main program
+    w.put(frame->context_status);
+    w.put(frame->saved_g_codes);
+    w.put(frame->saved_m_codes);
+    w.put(frame->saved_settings);
+
+    // mostly zero, so only the others
+    int count = 0;
+    for (int k = 0; k < RS274NGC_MAX_PARAMETERS; k++)
+	if (_setup.parameters[k] != 0) count++;
+    w.put(count);
+    for (int k = 0; k < RS274NGC_MAX_PARAMETERS; k++) {
+	if (_setup.parameters[k] != 0) {
+	    w.put(k);
+	    w.put(_setup.parameters[k]);
+	}
+    }
+
+    count = 0;
+    for (parameter_map_iterator it = frame->named_params.begin();
+	 it != frame->named_params.end(); ++it)
+	if (!(it->second.attr & PA_NOT_SAVED)) count++;
+    w.put(count);
+    for (parameter_map_iterator it = frame->named_params.begin();
+	 it != frame->named_params.end(); ++it) {
+	if (it->second.attr & PA_NOT_SAVED) continue;
+	w.put_string(it->first);
+	w.put(it->second.value);
+	w.put(it->second.attr);
+    }
+
+    // loops and subroutines defined in the main program so far
+    w.put((int) _setup.offset_map.size());
+    for (offset_map_iterator it = _setup.offset_map.begin();
+	 it != _setup.offset_map.end(); ++it) {
+	w.put_string(it->first);
+	w.put_string(it->second.filename);
+	w.put(it->second.type);
+	w.put(it->second.offset);
+	w.put(it->second.sequence_number);
+	w.put(it->second.repeat_count);
+    }
+    return INTERP_OK;
+}
+
+int Interp::restore_checkpoint(const std::string &state)
+{
+    CheckpointReader r(state);
+    checkpoint_state cp;
+    struct stat st;
+    context_pointer frame = &_setup.sub_context[0];
+    int version, count;
+    bool ok;
+
+    ok = r.get(version) && version == CHECKPOINT_VERSION
+	&& r.get_string(cp.filename) && r.get(cp.file_size) && r.get(cp.file_mtime)
+	&& r.get(cp.position) && r.get(cp.sequence_number)
+	&& r.get(cp.percent_flag) && r.get(cp.base)
+	&& r.get(cp.g_codes) && r.get(cp.m_codes) && r.get(cp.settings)
+	&& r.get(cp.tolerance) && r.get(cp.naivecam_tolerance)
+	&& r.get(cp.motion_mode)
+	&& r.get(cp.cycle_cc) && r.get(cp.cycle_i) && r.get(cp.cycle_j)
+	&& r.get(cp.cycle_k) && r.get(cp.cycle_p) && r.get(cp.cycle_q)
+	&& r.get(cp.cycle_r) && r.get(cp.cycle_il) && r.get(cp.cycle_l)
+	&& r.get(cp.cycle_il_flag) && r.get(cp.tool_offset)
+	&& r.get(cp.current) && r.get(cp.program_x) && r.get(cp.program_y)
+	&& r.get(cp.program_z) && r.get(cp.arc_not_allowed)
+	&& r.get(cp.executed_if) && r.get(cp.context_status)
+	&& r.get(cp.saved_g_codes) && r.get(cp.saved_m_codes)
+	&& r.get(cp.saved_settings);
+    CHKS((!ok), _("damaged checkpoint"));
+
+    // everything is checked before anything is changed
+    CHKS((_setup.file_pointer == NULL), NCE_FILE_NOT_OPEN);
+    CHKS((_setup.call_level != 0 || _setup.sequence_number > 1),
+	 _("checkpoints can only be restored into a freshly opened program"));
+    CHKS((cp.filename != _setup.filename),
+	 _("checkpoint is for %s, not %s"), cp.filename.c_str(), _setup.filename);
+    CHKS((fstat(fileno(_setup.file_pointer), &st) != 0
+	  || st.st_size != cp.file_size || st.st_mtime != cp.file_mtime),
+	 _("%s changed since the checkpoint"), _setup.filename);
+    CHKS((checkpoint_hash() != cp.base),
+	 _("persisted parameters changed since the checkpoint"));
+
+    CHKS((!r.get(count) || count < 0), _("damaged checkpoint"));
+    std::vector<std::pair<int, double> > numbered(count);
+    for (int i = 0; i < count; i++) {
+	CHKS((!r.get(numbered[i].first) || !r.get(numbered[i].second)
+	      || numbered[i].first < 0
+	      || numbered[i].first >= RS274NGC_MAX_PARAMETERS),
+	     _("damaged checkpoint"));
+    }
+
+    struct named { std::string name; parameter_value value; };
+    CHKS((!r.get(count) || count < 0), _("damaged checkpoint"));
+    std::vector<named> named_params(count);
+    for (int i = 0; i < count; i++) {
+	CHKS((!r.get_string(named_params[i].name)
+	      || !r.get(named_params[i].value.value)
+	      || !r.get(named_params[i].value.attr)),
+	     _("damaged checkpoint"));
+    }
+
+    struct label { std::string name, filename; offset op; };
+    CHKS((!r.get(count) || count < 0), _("damaged checkpoint"));
+    std::vector<label> labels(count);
+    for (int i = 0; i < count; i++) {
+	label &l = labels[i];
+	CHKS((!r.get_string(l.name) || !r.get_string(l.filename)
+	      || !r.get(l.op.type) || !r.get(l.op.offset)
+	      || !r.get(l.op.sequence_number) || !r.get(l.op.repeat_count)),
+	     _("damaged checkpoint"));
+    }
+    CHKS((!r.done()), _("damaged checkpoint"));
+
+    std::fill(_setup.parameters, _setup.parameters + RS274NGC_MAX_PARAMETERS, 0);
+    for (size_t i = 0; i < numbered.size(); i++)
+	_setup.parameters[numbered[i].first] = numbered[i].second;
+
+    for (parameter_map_iterator it = frame->named_params.begin();
+	 it != frame->named_params.end(); ) {
+	if (it->second.attr & PA_NOT_SAVED)
+	    ++it;
+	else
+	    frame->named_params.erase(it++);
+    }
+    for (size_t i = 0; i < named_params.size(); i++)
+	frame->named_params[strstore(named_params[i].name.c_str())] = named_params[i].value;
+
+    _setup.offset_map.clear();
+    for (size_t i = 0; i < labels.size(); i++) {
+	labels[i].op.filename = strstore(labels[i].filename.c_str());
+	_setup.offset_map[strstore(labels[i].name.c_str())] = labels[i].op;
+    }
+
+    // modal state, through G-code so canon follows
+    memcpy(frame->saved_g_codes, cp.g_codes, sizeof(cp.g_codes));
+    memcpy(frame->saved_m_codes, cp.m_codes, sizeof(cp.m_codes));
+    memcpy(frame->saved_settings, cp.settings, sizeof(cp.settings));
+    CHP(restore_settings(&_setup, 0));
+
+    char buf[LINELEN];
+    // M72 only keeps one decimal of F
+    if (_setup.feed_rate != cp.settings[1]) {
+	snprintf(buf, sizeof(buf), "F%.17g", cp.settings[1]);
+	CHP(execute(buf));
+    }
+    // the offsets of the coordinate system and G92 come from the parameters
+    int origin = cp.g_codes[8];
+    if (origin % 10)
+	snprintf(buf, sizeof(buf), "G%d.%d", origin / 10, origin % 10);
+    else
+	snprintf(buf, sizeof(buf), "G%d", origin / 10);
+    CHP(execute(buf));
+    if (_setup.parameters[5210] == 1.0)
+	CHP(execute("G92.3"));
+    else
+	CHP(execute("G92.2"));
+    if (_setup.control_mode == CANON_CONTINUOUS)
+	CHP(convert_control_mode(G_64, cp.tolerance, cp.naivecam_tolerance, &_setup));
+    if (memcmp(&_setup.tool_offset, &cp.tool_offset, sizeof(cp.tool_offset)) != 0) {
+	_setup.tool_offset = cp.tool_offset;
+	USE_TOOL_LENGTH_OFFSET(_setup.tool_offset);
+    }
+
+    _setup.motion_mode = cp.motion_mode;
+    _setup.cycle_cc = cp.cycle_cc;
+    _setup.cycle_i = cp.cycle_i;
+    _setup.cycle_j = cp.cycle_j;
+    _setup.cycle_k = cp.cycle_k;
+    _setup.cycle_p = cp.cycle_p;
+    _setup.cycle_q = cp.cycle_q;
+    _setup.cycle_r = cp.cycle_r;
+    _setup.cycle_il = cp.cycle_il;
+    _setup.cycle_l = cp.cycle_l;
+    _setup.cycle_il_flag = cp.cycle_il_flag;
+    _setup.executed_if = cp.executed_if;
+
+    // after the G-code above, which moves the current position along
+    // with the origin
+    _setup.current_x = cp.current[0];
+    _setup.current_y = cp.current[1];
+    _setup.current_z = cp.current[2];
+    _setup.AA_current = cp.current[3];
+    _setup.BB_current = cp.current[4];
+    _setup.CC_current = cp.current[5];
+    _setup.u_current = cp.current[6];
+    _setup.v_current = cp.current[7];
+    _setup.w_current = cp.current[8];
+    _setup.program_x = cp.program_x;
+    _setup.program_y = cp.program_y;
+    _setup.program_z = cp.program_z;
+    _setup.arc_not_allowed = cp.arc_not_allowed;
+
+    frame->context_status = cp.context_status;
+    memcpy(frame->saved_g_codes, cp.saved_g_codes, sizeof(cp.saved_g_codes));
+    memcpy(frame->saved_m_codes, cp.saved_m_codes, sizeof(cp.saved_m_codes));
+    memcpy(frame->saved_settings, cp.saved_settings, sizeof(cp.saved_settings));
+
+    write_g_codes((block_pointer) NULL, &_setup);
+    write_m_codes((block_pointer) NULL, &_setup);
+    write_settings(&_setup);
+
+    fseek(_setup.file_pointer, cp.position, SEEK_SET);
+    _setup.sequence_number = cp.sequence_number;
+    _setup.percent_flag = cp.percent_flag;
+    _setup.checkpoint_base = cp.base;
+    _setup.checkpoint_base_set = true;
+    return INTERP_OK;
+}
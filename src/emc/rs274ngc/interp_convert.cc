@@ -1565,6 +1565,7 @@ int Interp::convert_control_mode(int g_code,     //!< g_code being executed (G_6
 {
   CHKS((settings->cutter_comp_side),
        (_("Cannot change control mode with cutter radius compensation on")));
+  settings->tolerance = settings->naivecam_tolerance = -1;
   if (g_code == G_61) {
     SET_MOTION_CONTROL_MODE(CANON_EXACT_PATH, 0);
     settings->control_mode = CANON_EXACT_PATH;
@@ -1572,6 +1573,8 @@ int Interp::convert_control_mode(int g_code,     //!< g_code being executed (G_6
     SET_MOTION_CONTROL_MODE(CANON_EXACT_STOP, 0);
     settings->control_mode = CANON_EXACT_STOP;
   } else if (g_code == G_64) {
+    settings->tolerance = tolerance;
+    settings->naivecam_tolerance = naivecam_tolerance;
 	if (tolerance >= 0) {
 	    SET_MOTION_CONTROL_MODE(CANON_CONTINUOUS, tolerance);
 	} else {
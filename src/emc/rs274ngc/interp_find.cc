@@ -718,6 +718,17 @@ int Interp::find_tool_pocket(setup_pointer settings, int toolno, int *pocket)
             *pocket = i;
     }
 
+    if(*pocket == -1) {
+        // a tool store may hold more tools than the table; it puts the
+        // tool in a pocket of the table, which is read again
+        int p = GET_EXTERNAL_TOOL_POCKET(toolno);
+        if(p >= 0 && p < settings->pockets_max) {
+            settings->tool_table[p] = GET_EXTERNAL_TOOL_TABLE(p);
+            if(settings->tool_table[p].toolno == toolno)
+                *pocket = p;
+        }
+    }
+
     CHKS((*pocket == -1), (_("Requested tool %d not found in the tool table")), toolno);
     return INTERP_OK;
 }
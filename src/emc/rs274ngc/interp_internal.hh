@@ -560,6 +560,16 @@ struct parameter_value_struct {
 typedef std::map<const char *, parameter_value, nocase_cmp> parameter_map;
 typedef parameter_map::iterator parameter_map_iterator;
 
+// a HAL pin, signal or parameter named by #<_hal[...]>, resolved to the
+// value it reads. HAL names are case sensitive, so the key is too.
+struct hal_ref {
+    int type;
+    void *ptr;
+};
+typedef std::map<std::string, hal_ref> hal_ref_map;
+
+class IniFile;
+
 #define PA_READONLY	1
 #define PA_GLOBAL	2
 #define PA_UNSET	4
@@ -677,6 +687,8 @@ struct setup
 
   char blocktext[LINELEN];   // linetext downcased, white space gone
   CANON_MOTION_MODE control_mode;       // exact path or cutting mode
+  double tolerance;             // G64 P, or -1 if none was given
+  double naivecam_tolerance;    // G64 Q, or -1 if none was given
   int current_pocket;             // carousel slot number of current tool
   double current_x;             // current X-axis position
   double current_y;             // current Y-axis position
@@ -821,6 +833,17 @@ struct setup
     // task calls upon interp.init() repeatedly
     // protect init() operations which are not idempotent
     int init_once;  
+
+    // #<_hal[...]> and #<_ini[...]> lookups for the running program,
+    // dropped by reset()
+    hal_ref_map hal_refs;             // resolved HAL names
+    unsigned long hal_topology_gen;   // hal_data->topology_gen when resolved
+    IniFile *inifile;                 // kept open for _ini[] lookups
+
+    // hash of the persisted parameters when the running program read its
+    // first line; checkpoints are only good while it stays the same
+    unsigned long checkpoint_base;
+    bool checkpoint_base_set;
 };
 
 
@@ -177,6 +177,8 @@ int Interp::read_named_parameter(
 // if the variable is of the form '_ini[section]name', then treat it as
 // an inifile  variable. Lookup section/name and cache the value
 // as global and read-only.
+// the ini file is opened on the first such reference and kept open
+// until reset(), so later names only cost a Find().
 // the shortest possible ini variable is '_ini[s]n' or 8 chars long .
 int Interp::fetch_ini_param( const char *nameBuf, int *status, double *value)
 {
@@ -187,7 +189,6 @@ int Interp::fetch_ini_param( const char *nameBuf, int *status, double *value)
      if ((n > 7) &&
 	((s = (char *) strchr(&nameBuf[6],']')) != NULL)) {
 
-	IniFile inifile;
 	const char *iniFileName;
 	int retval;
 	int closeBracket = s - nameBuf;
@@ -197,9 +198,14 @@ int Interp::fetch_ini_param( const char *nameBuf, int *status, double *value)
 	    *status = 0;
 	    return INTERP_OK;
 	}
-	if (!inifile.Open(iniFileName)) {
-	    *status = 0;
-	    ERS(_("cant open ini file '%s'"), iniFileName);
+	if (!_setup.inifile) {
+	    IniFile *inifile = new IniFile;
+	    if (!inifile->Open(iniFileName)) {
+		delete inifile;
+		*status = 0;
+		ERS(_("cant open ini file '%s'"), iniFileName);
+	    }
+	    _setup.inifile = inifile;
 	}
 
 	char capName[LINELEN];
@@ -210,11 +216,9 @@ int Interp::fetch_ini_param( const char *nameBuf, int *status, double *value)
 	    *p = toupper(*p);
 	capName[closeBracket] = '\0';
 
-	if ((retval = inifile.Find( value, &capName[closeBracket+1], &capName[5])) == 0) {
+	if ((retval = _setup.inifile->Find( value, &capName[closeBracket+1], &capName[5])) == 0) {
 	    *status = 1;
-	    inifile.Close();
 	} else {
-	    inifile.Close();
 	    *status = 0;
 	    ERS(_("Named ini parameter #<%s> not found in inifile '%s': error=0x%x"),
 		nameBuf, iniFileName, retval);
@@ -225,14 +229,16 @@ int Interp::fetch_ini_param( const char *nameBuf, int *status, double *value)
 
 // if the variable is of the form '_hal[hal_name]', then treat it as
 // a HAL pin, signal or param. Lookup value, convert to float, and export as global and read-only.
-// do not cache.
+// the value is not cached, but where it lives is: the pin, signal or param
+// is looked up once per program and read through the saved pointer after
+// that. Any change to the HAL topology (a pin linked or unlinked, anything
+// added, removed or aliased) bumps hal_data->topology_gen, which drops
+// the saved pointers so a removed pin is noticed.
 // the shortest possible ini variable is '_hal[x]' or 7 chars long .
 int Interp::fetch_hal_param( const char *nameBuf, int *status, double *value)
 {
     static int comp_id;
     int retval;
-    int type = 0;
-    hal_data_u* ptr;
     char hal_name[LINELEN];
 
     *status = 0;
@@ -252,6 +258,7 @@ int Interp::fetch_hal_param( const char *nameBuf, int *status, double *value)
 	hal_pin_t *pin;
 	hal_sig_t *sig;
 	hal_param_t *param;
+	hal_ref ref;
 
 	strncpy(hal_name, &nameBuf[5], closeBracket);
 	hal_name[closeBracket - 5] = '\0';
@@ -260,8 +267,16 @@ int Interp::fetch_hal_param( const char *nameBuf, int *status, double *value)
 	    *status = 0;
 	    ERS("%s: trailing garbage after closing bracket", nameBuf);
 	}
-	// the result of these lookups could be cached in the parameter struct, but I'm not sure
-	// this is a good idea - a removed pin/signal will not be noticed
+
+	if (_setup.hal_topology_gen != hal_data->topology_gen) {
+	    _setup.hal_refs.clear();
+	    _setup.hal_topology_gen = hal_data->topology_gen;
+	}
+	hal_ref_map::iterator ri = _setup.hal_refs.find(hal_name);
+	if (ri != _setup.hal_refs.end()) {
+	    ref = ri->second;
+	    goto assign;
+	}
 
 	// I dont think that's needed - no change in pins/sigs/params
 	// rtapi_mutex_get(&(hal_data->mutex)); 
@@ -271,41 +286,44 @@ int Interp::fetch_hal_param( const char *nameBuf, int *status, double *value)
             if (pin && !pin->signal) {
 		logOword("%s: no signal connected", hal_name);
 	    } 
-	    type = pin->type;
+	    ref.type = pin->type;
 	    if (pin->signal != 0) {
 		sig = (hal_sig_t *) SHMPTR(pin->signal);
-		ptr = (hal_data_u *) SHMPTR(sig->data_ptr);
+		ref.ptr = SHMPTR(sig->data_ptr);
 	    } else {
-		ptr = (hal_data_u *) &(pin->dummysig);
+		ref.ptr = &(pin->dummysig);
 	    }
-	    goto assign;
+	    goto resolved;
 	}
 	if ((sig = halpr_find_sig_by_name(hal_name)) != NULL) {
 	    if (!sig->writers) 
 		logOword("%s: signal has no writer", hal_name);
-	    type = sig->type;
-	    ptr = (hal_data_u *) SHMPTR(sig->data_ptr);
-	    goto assign;
+	    ref.type = sig->type;
+	    ref.ptr = SHMPTR(sig->data_ptr);
+	    goto resolved;
 	}
 	if ((param = halpr_find_param_by_name(hal_name)) != NULL) {
-	    type = param->type;
-	    ptr = (hal_data_u *) SHMPTR(param->data_ptr);
-	    goto assign;
+	    ref.type = param->type;
+	    ref.ptr = SHMPTR(param->data_ptr);
+	    goto resolved;
 	}
 	*status = 0;
 	ERS("Named hal parameter #<%s> not found", nameBuf);
-    }
-    return INTERP_OK;
+
+    resolved:
+	_setup.hal_refs[hal_name] = ref;
 
     assign:
-    switch (type) {
-    case HAL_BIT: *value = (double) (ptr->b); break;
-    case HAL_U32: *value = (double) (ptr->u); break;
-    case HAL_S32: *value = (double) (ptr->s); break;
-    case HAL_FLOAT: *value = (double) (ptr->f); break;
+	hal_data_u *ptr = (hal_data_u *) ref.ptr;
+	switch (ref.type) {
+	case HAL_BIT: *value = (double) (ptr->b); break;
+	case HAL_U32: *value = (double) (ptr->u); break;
+	case HAL_S32: *value = (double) (ptr->s); break;
+	case HAL_FLOAT: *value = (double) (ptr->f); break;
+	}
+	logOword("%s: value=%f", hal_name, *value);
+	*status = 1;
     }
-    logOword("%s: value=%f", hal_name, *value);
-    *status = 1;
     return INTERP_OK; 
 }
 
@@ -22,6 +22,7 @@
 #endif
 #include <string.h>
 #include "rs274ngc_interp.hh"
+#include "inifile.hh"
 #include <boost/python/object.hpp>
 
 #pragma GCC diagnostic error "-Wmissing-field-initializers"
@@ -180,14 +181,21 @@ setup::setup() :
     disable_g92_persistence(0),
     pythis(),
     on_abort_command(NULL),
-    init_once(CANON_STOPPED)
+    init_once(CANON_STOPPED),
+    hal_refs(),
+    hal_topology_gen(0),
+    inifile(NULL)
 {
   std::fill(parameters, parameters + interp_param_global::RS274NGC_MAX_PARAMETERS, 0);
+  tolerance = naivecam_tolerance = -1;
+  checkpoint_base = 0;
+  checkpoint_base_set = false;
 }
 
 setup::~setup() {
     assert(!pythis || Py_IsInitialized());
     if(pythis) delete pythis;
+    delete inifile;
 }
 
 block_struct::block_struct ()
@@ -69,6 +69,11 @@ public:
 // synchronize your internal model with the external world
  int synch();
 
+// save the state after the line just executed, or restore it into the
+// freshly opened program to go on after that line (run from line)
+ int checkpoint(std::string &state);
+ int restore_checkpoint(const std::string &state);
+
 /* Interface functions to call to get information from the interpreter.
    If a function has a return value, the return value contains the information.
    If a function returns nothing, information is copied into one of the
@@ -458,6 +463,7 @@ int read_dollar(char *line, int *counter, block_pointer block,
     int free_named_parameters(context_pointer frame);
  int save_settings(setup_pointer settings);
  int restore_settings(setup_pointer settings, int from_level);
+ unsigned long checkpoint_hash();
  int gen_settings(double *current, double *saved, std::string &cmd);
  int gen_g_codes(int *current, int *saved, std::string &cmd);
  int gen_m_codes(int *current, int *saved, std::string &cmd);
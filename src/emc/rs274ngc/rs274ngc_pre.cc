@@ -1418,6 +1418,7 @@ int Interp::open(const char *filename) //!< string: the name of the input NC-pro
   }
   strcpy(_setup.filename, filename);
   reset();
+  _setup.checkpoint_base_set = false;
   return INTERP_OK;
 }
 
@@ -1650,6 +1651,11 @@ int Interp::_read(const char *command)  //!< may be NULL or a string to read
 int Interp::read(const char *command) 
 {
     int status;
+    // the program starts running with the parameters as they are now
+    if (!command && !_setup.checkpoint_base_set) {
+	_setup.checkpoint_base = checkpoint_hash();
+	_setup.checkpoint_base_set = true;
+    }
     if ((status = _read(command)) > INTERP_MIN_ERROR) {
 	unwind_call(status, __FILE__,__LINE__,__FUNCTION__);
     }
@@ -1766,6 +1772,13 @@ int Interp::reset()
     
     // drop any queued points in canon
     ON_RESET();
+
+    // _hal[] and _ini[] lookups are redone for the next program
+    _setup.hal_refs.clear();
+    if (_setup.inifile) {
+        delete _setup.inifile;
+        _setup.inifile = NULL;
+    }
     
     unwind_call(INTERP_OK, __FILE__,__LINE__,__FUNCTION__);
     return INTERP_OK;
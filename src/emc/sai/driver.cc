@@ -22,15 +22,20 @@
 #include "rs274ngc_interp.hh"
 #include "rs274ngc_return.hh"
 #include "inifile.hh"		// INIFILE
+#include "emcIniFile.hh"	// FindLinearUnits
 #include "canon.hh"		// _parameter_file_name
 #include "config.h"		// LINELEN
 #include "tool_parse.h"
 #include <stdio.h>    /* gets, etc. */
 #include <stdlib.h>   /* exit       */
 #include <string.h>   /* strcpy     */
+#include <errno.h>
+#include <unistd.h>   /* mkdtemp    */
 #include <getopt.h>
 #include <stdarg.h>
 #include <string>
+#include <sstream>
+#include <vector>
 
 #include <readline/readline.h>
 #include <readline/history.h>
@@ -38,6 +43,9 @@
 #include <wordexp.h>
 
 #include <saicanon.hh>
+#if defined(RTAPI_USPACE)
+#include "userkins.h"
+#endif
 
 InterpBase *pinterp;
 #define interp_new (*pinterp)
@@ -341,6 +349,305 @@ int read_tool_file(  /* ARGUMENTS         */
 
 /************************************************************************/
 
+/* check_envelope
+
+Returned Value: int
+  Returns 0 if the program stays within the limits, 1 otherwise.
+
+Side Effects:
+  The envelope of the moves is printed to the output, one line per
+  axis, in machine units. Each limit it crosses is reported on stderr
+  with the line that crossed it.
+
+Called By: main
+
+The limits are the MIN_LIMIT and MAX_LIMIT of each [AXIS_*] section in
+the ini file; axes without them, and wrapped rotaries, are not checked.
+Without an ini file only the envelope is printed, in mm and degrees.
+
+*/
+
+/* scratch copy of the parameter file for -E */
+static char scratch_dir[] = "/tmp/rs274-XXXXXX";
+static std::string scratch_var;
+
+/* -E exits 1 for a program past the limits, and 2 when it could not
+   tell, e.g. for a remap the standalone interpreter can't run */
+static int error_status = 1;
+
+static void remove_scratch_var(void)
+{
+  unlink(scratch_var.c_str());
+  unlink((scratch_var + RS274NGC_PARAMETER_FILE_BACKUP_SUFFIX).c_str());
+  rmdir(scratch_dir);
+}
+
+static int check_envelope(const char *inifile)
+{
+  static const char axes[] = "XYZABC";
+  EmcIniFile ini;
+  EmcLinearUnits linear_units = 1.0;
+  EmcAngularUnits angular_units = 1.0;
+  int result = 0;
+
+  if (!_sai._envelope_valid)
+    return 0;
+  if (inifile)
+    {
+      if (!ini.Open(inifile))
+        {
+          fprintf(stderr, "could not open ini file %s\n", inifile);
+          return error_status;
+        }
+      ini.FindLinearUnits(&linear_units, "LINEAR_UNITS", "TRAJ");
+      ini.FindAngularUnits(&angular_units, "ANGULAR_UNITS", "TRAJ");
+    }
+
+  for (int i = 0; i < 6; i++)
+    {
+      double scale = (i < 3) ? linear_units : angular_units;
+      double lo = _sai._envelope_min[i] * scale;
+      double hi = _sai._envelope_max[i] * scale;
+      char section[8];
+      bool wrapped = false;
+      double limit;
+
+      fprintf(_outfile, "%c %.4f %.4f\n", axes[i], lo, hi);
+      if (!inifile)
+        continue;
+      snprintf(section, sizeof(section), "AXIS_%c", axes[i]);
+      ini.Find(&wrapped, "WRAPPED_ROTARY", section);
+      if (wrapped)
+        continue;
+      if (ini.Find(&limit, "MIN_LIMIT", section) == IniFile::ERR_NONE &&
+          lo < limit - 1e-6)
+        {
+          fprintf(stderr, "%c moves to %.4f on line %d, past MIN_LIMIT %.4f\n",
+                  axes[i], lo, _sai._envelope_min_line[i], limit);
+          result = 1;
+        }
+      if (ini.Find(&limit, "MAX_LIMIT", section) == IniFile::ERR_NONE &&
+          hi > limit + 1e-6)
+        {
+          fprintf(stderr, "%c moves to %.4f on line %d, past MAX_LIMIT %.4f\n",
+                  axes[i], hi, _sai._envelope_max_line[i], limit);
+          result = 1;
+        }
+    }
+  ini.Close();
+  return result;
+}
+
+/************************************************************************/
+
+/* check_joints
+
+Returned Value: int
+  Returns 0 if the joints stay within their limits, 1 otherwise.
+
+Side Effects:
+  The range of each joint is printed to the output after the envelope,
+  in machine units. Each limit it crosses is reported on stderr with
+  the line that crossed it.
+
+Called By: main
+
+A machine whose kinematics aren't trivial can have every axis within
+its limits and still drive a joint past its own. The points along the
+moves that saicanon keeps are run through the machine's kinematics
+module, [KINS]KINEMATICS, with userkins, each from the solution for the
+one before, starting from the joints' HOME. The limits are the
+MIN_LIMIT and MAX_LIMIT of each [JOINT_n] section. The module's pins
+and parameters are set with -K name=value, which task does with their
+values in the running HAL.
+
+Only uspace builds have userkins. Without it, or when the module
+can't be loaded, only the axes are checked.
+
+*/
+
+/* -K name=value */
+static std::vector<std::string> kins_settings;
+
+#if defined(RTAPI_USPACE)
+static userkins_t *joint_kins;
+static int joint_count;
+static double joint_linear_units = 1.0;
+static double joint_angular_units = 1.0;
+static double joint_seed[USERKINS_JOINTS];
+static bool joint_valid;
+static double joint_min[USERKINS_JOINTS];
+static double joint_max[USERKINS_JOINTS];
+static int joint_min_line[USERKINS_JOINTS];
+static int joint_max_line[USERKINS_JOINTS];
+static int joint_unreachable_line;
+
+/* takes the points saicanon has kept */
+static void check_path(void)
+{
+  std::vector<EmcPose> &path = _sai._path;
+  long n = path.size();
+
+  if (n == 0)
+    return;
+  for (long i = 0; i < n; i++)
+    {
+      path[i].tran.x *= joint_linear_units;
+      path[i].tran.y *= joint_linear_units;
+      path[i].tran.z *= joint_linear_units;
+      path[i].a *= joint_angular_units;
+      path[i].b *= joint_angular_units;
+      path[i].c *= joint_angular_units;
+    }
+  std::vector<double> joints(n * USERKINS_JOINTS);
+  std::vector<int> result(n);
+  memcpy(&joints[0], joint_seed, sizeof(joint_seed));
+  userkins_inverse(joint_kins, &path[0], &joints[0], &result[0], n,
+                   USERKINS_SEED_PREVIOUS);
+
+  for (long i = 0; i < n; i++)
+    {
+      int line = _sai._path_line[i];
+      const double *j = &joints[i * USERKINS_JOINTS];
+
+      if (result[i] != 0)
+        {
+          if (!joint_unreachable_line)
+            joint_unreachable_line = line;
+          continue;
+        }
+      for (int k = 0; k < joint_count; k++)
+        {
+          if (!joint_valid || j[k] < joint_min[k])
+            {
+              joint_min[k] = j[k];
+              joint_min_line[k] = line;
+            }
+          if (!joint_valid || j[k] > joint_max[k])
+            {
+              joint_max[k] = j[k];
+              joint_max_line[k] = line;
+            }
+        }
+      joint_valid = true;
+      memcpy(joint_seed, j, sizeof(joint_seed));
+    }
+  path.clear();
+  _sai._path_line.clear();
+}
+#endif
+
+static void start_joint_check(const char *inifile)
+{
+#if defined(RTAPI_USPACE)
+  EmcIniFile ini;
+  const char *kinematics;
+  std::vector<std::string> words;
+  std::string word;
+
+  if (!ini.Open(inifile))
+    return;
+  kinematics = ini.Find("KINEMATICS", "KINS");
+  if (kinematics)
+    {
+      std::istringstream in(kinematics);
+      while (in >> word)
+        words.push_back(word);
+    }
+  if (words.empty() || ini.Find(&joint_count, "JOINTS", "KINS") != IniFile::ERR_NONE)
+    {
+      ini.Close();
+      return;
+    }
+  if (joint_count > USERKINS_JOINTS)
+    joint_count = USERKINS_JOINTS;
+  for (int k = 0; k < joint_count; k++)
+    {
+      char section[16];
+      snprintf(section, sizeof(section), "JOINT_%d", k);
+      ini.Find(&joint_seed[k], "HOME", section);
+    }
+  ini.FindLinearUnits(&joint_linear_units, "LINEAR_UNITS", "TRAJ");
+  ini.FindAngularUnits(&joint_angular_units, "ANGULAR_UNITS", "TRAJ");
+  ini.Close();
+
+  std::vector<const char *> args;
+  for (size_t i = 1; i < words.size(); i++)
+    args.push_back(words[i].c_str());
+  joint_kins = userkins_load(words[0].c_str(), args.size(),
+                             args.empty() ? NULL : &args[0], 1);
+  if (!joint_kins)
+    {
+      fprintf(stderr, "joint limits not checked: could not load %s\n",
+              words[0].c_str());
+      return;
+    }
+  /* the joints are the axes, which are checked already */
+  if (userkins_type(joint_kins) == KINEMATICS_IDENTITY)
+    {
+      userkins_unload(joint_kins);
+      joint_kins = NULL;
+      return;
+    }
+  for (size_t i = 0; i < kins_settings.size(); i++)
+    {
+      const std::string &setting = kins_settings[i];
+      size_t eq = setting.find('=');
+      if (eq == std::string::npos ||
+          userkins_set(joint_kins, setting.substr(0, eq).c_str(),
+                       atof(setting.c_str() + eq + 1)) != 0)
+        fprintf(stderr, "could not set %s\n", setting.c_str());
+    }
+  _sai._path_full = check_path;
+#endif
+}
+
+static int check_joints(const char *inifile)
+{
+  int result = 0;
+#if defined(RTAPI_USPACE)
+  EmcIniFile ini;
+
+  if (!joint_kins)
+    return 0;
+  check_path();
+  if (joint_unreachable_line)
+    {
+      fprintf(stderr, "line %d moves out of reach of the joints\n",
+              joint_unreachable_line);
+      result = 1;
+    }
+  if (!joint_valid || !ini.Open(inifile))
+    return result;
+  for (int k = 0; k < joint_count; k++)
+    {
+      char section[16];
+      double limit;
+
+      fprintf(_outfile, "J%d %.4f %.4f\n", k, joint_min[k], joint_max[k]);
+      snprintf(section, sizeof(section), "JOINT_%d", k);
+      if (ini.Find(&limit, "MIN_LIMIT", section) == IniFile::ERR_NONE &&
+          joint_min[k] < limit - 1e-6)
+        {
+          fprintf(stderr, "joint %d moves to %.4f on line %d, past MIN_LIMIT %.4f\n",
+                  k, joint_min[k], joint_min_line[k], limit);
+          result = 1;
+        }
+      if (ini.Find(&limit, "MAX_LIMIT", section) == IniFile::ERR_NONE &&
+          joint_max[k] > limit + 1e-6)
+        {
+          fprintf(stderr, "joint %d moves to %.4f on line %d, past MAX_LIMIT %.4f\n",
+                  k, joint_max[k], joint_max_line[k], limit);
+          result = 1;
+        }
+    }
+  ini.Close();
+#endif
+  return result;
+}
+
+/************************************************************************/
+
 /* designate_parameter_file
 
 Returned Value: int
@@ -547,8 +854,10 @@ int main (int argc, char ** argv)
   int print_stack;
   int go_flag;
   char *inifile = NULL;
+  char *tool_database = NULL;
   int log_level = -1;
   std::string interp;
+  int envelope_check = 0;
 
   do_next = 2;  /* 2=stop */
   block_delete = OFF;
@@ -559,12 +868,13 @@ int main (int argc, char ** argv)
   go_flag = 0;
 
   while(1) {
-      int c = getopt(argc, argv, "p:t:v:bsn:gi:l:T");
+      int c = getopt(argc, argv, "p:t:D:v:bsn:gi:l:TEK:");
       if(c == -1) break;
 
       switch(c) {
           case 'p': interp = optarg; break;
           case 't': read_tool_file(optarg); tool_flag=1; break;
+          case 'D': tool_database = optarg; tool_flag=1; break;
           case 'v': SET_PARAMETER_FILE_NAME(optarg); break;
           case 'b': block_delete = (block_delete == OFF) ? ON : OFF; break;
           case 's': print_stack = (print_stack == OFF) ? ON : OFF; break;
@@ -573,6 +883,11 @@ int main (int argc, char ** argv)
           case 'g': go_flag = !go_flag; break;
           case 'i': inifile = optarg; break;
           case 'T': _task = 1; break;
+          case 'E':
+            envelope_check = 1; go_flag = 1; _sai._quiet = true;
+            error_status = 2;
+            break;
+          case 'K': kins_settings.push_back(optarg); break;
           case '?': default: goto usage;
       }
   }
@@ -581,11 +896,12 @@ int main (int argc, char ** argv)
     {
 usage:
       fprintf(stderr,
-            "Usage: %s [-p interp.so] [-t tool.tbl] [-v var-file.var] [-n 0|1|2]\n"
-            "          [-b] [-s] [-g] [input file [output file]]\n"
+            "Usage: %s [-p interp.so] [-t tool.tbl | -D tool.db] [-v var-file.var] [-n 0|1|2]\n"
+            "          [-b] [-s] [-g] [-E [-K name=value]...] [input file [output file]]\n"
             "\n"
             "    -p: Specify the pluggable interpreter to use\n"
             "    -t: Specify the .tbl (tool table) file to use\n"
+            "    -D: Specify the tool database to use instead\n"
             "    -v: Specify the .var (parameter) file to use\n"
             "    -n: Specify the continue mode:\n"
             "           0: continue\n"
@@ -597,10 +913,16 @@ usage:
             "    -i: specify the .ini file (default: no ini file)\n"
             "    -T: call task_init()\n"
             "    -l: specify the log_level (default: -1)\n"
+            "    -E: check the program against the axis limits in the .ini\n"
+            "        file instead of printing canon calls (implies -g)\n"
+            "    -K: set a pin or parameter of the kinematics module for -E\n"
             , argv[0]);
       exit(1);
     }
 
+  if (tool_database && load_tool_database(tool_database) != 0)
+    exit(error_status);
+
   if(!interp.empty()) {
     pinterp = interp_from_shlib(interp.c_str());
   }
@@ -625,12 +947,12 @@ usage:
       else if (choice == 2)
         {
           if (designate_parameter_file(_parameter_file_name) != 0)
-            exit(1);
+            exit(error_status);
         }
       else if (choice == 3)
         {
           if (read_tool_file("") != 0)
-            exit(1);
+            exit(error_status);
           tool_flag = 1;
         }
       else if (choice == 4)
@@ -638,11 +960,12 @@ usage:
       else if (choice == 5)
         adjust_error_handling(argc, &print_stack, &do_next);
     }
-  fprintf(stderr, "executing\n");
+  if (!envelope_check)
+    fprintf(stderr, "executing\n");
   if (tool_flag == 0)
     {
       if (read_tool_file(EMC2_DEFAULT_TOOLTABLE) != 0)
-        exit(1);
+        exit(error_status);
     }
 
   // Skip past arguments used up by getopt() */
@@ -655,9 +978,34 @@ usage:
       if (_outfile == NULL)
         {
           fprintf(stderr, "could not open output file %s\n", argv[2]);
-          exit(1);
+          exit(error_status);
         }
     }
+  /* the interpreter writes the parameter file back as it goes; a check
+     must leave the machine's own copy alone */
+  if (envelope_check)
+    {
+      if (!mkdtemp(scratch_dir))
+        {
+          fprintf(stderr, "could not create %s: %s\n", scratch_dir, strerror(errno));
+          exit(error_status);
+        }
+      scratch_var = std::string(scratch_dir) + "/rs274.var";
+      atexit(remove_scratch_var);
+      FILE *in = fopen(_parameter_file_name, "r");
+      FILE *out = in ? fopen(scratch_var.c_str(), "w") : NULL;
+      if (out)
+        {
+          char buf[4096];
+          size_t n;
+          while ((n = fread(buf, 1, sizeof(buf), in)) > 0)
+            fwrite(buf, 1, n, out);
+          fclose(out);
+        }
+      if (in) fclose(in);
+      SET_PARAMETER_FILE_NAME(scratch_var.c_str());
+    }
+
   if (inifile!= 0) {
       setenv("INI_FILE_NAME",inifile,1);
   } else
@@ -666,12 +1014,15 @@ usage:
   if ((status = interp_init()) != INTERP_OK)
     {
       report_error(status, print_stack);
-      exit(1);
+      exit(error_status);
     }
 
   if (log_level != -1)
       interp_set_loglevel(log_level);
 
+  if (envelope_check && inifile)
+    start_joint_check(inifile);
+
 
   if (argc == 1)
     status = interpret_from_keyboard(block_delete, print_stack);
@@ -681,7 +1032,7 @@ usage:
       if (status != INTERP_OK) /* do not need to close since not open */
         {
           report_error(status, print_stack);
-          exit(1);
+          exit(error_status);
         }
       status = interpret_from_file(do_next, block_delete, print_stack);
       file_name(buffer, 5);  /* called to exercise the function */
@@ -694,6 +1045,18 @@ usage:
   active_m_codes(ems);   /* called to exercise the function */
   active_settings(sets); /* called to exercise the function */
   interp_exit(); /* saves parameters */
+  if (envelope_check)
+    {
+      if (status != 0)
+        status = error_status;
+      else
+        {
+          status = check_envelope(inifile);
+          int joints = inifile ? check_joints(inifile) : 0;
+          if (status == 0)
+            status = joints;
+        }
+    }
   exit(status);
 }
 
@@ -40,6 +40,10 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <errno.h>
+#include "config.h"
+#ifdef HAVE_SQLITE3
+#include "toolstore.hh"
+#endif
 
 StandaloneInterpInternals _sai = StandaloneInterpInternals();
 
@@ -103,16 +107,228 @@ void print_nc_line_number()
 
 #define PRINT(control, ...) do \
 { \
+    if (_sai._quiet) break; \
     _outfile = _outfile ?: stdout; \
     fprintf(_outfile,  "%5d ", _sai._line_number++); \
     print_nc_line_number(); \
     fprintf(_outfile, control, ##__VA_ARGS__); \
 } while (false)
 
+/* Envelope
+
+The machine position of a program point is worked out the way
+emccanon.cc does it: G92 offset, XY rotation, G5x offset, then tool
+offset. Positions and offsets are kept in program units, so the result
+is scaled to mm before the tool offset, which is stored in mm.
+*/
+
+static void to_machine(double x, double y, double z, double out[3])
+{
+  double t = _sai._xy_rotation * M_PI / 180.0;
+  x += _sai._g92_x;
+  y += _sai._g92_y;
+  z += _sai._g92_z;
+  out[0] = (x * cos(t) - y * sin(t) + _sai._g5x_x) * _sai._length_unit_factor
+           + _sai._tool_offset_mm.tran.x;
+  out[1] = (x * sin(t) + y * cos(t) + _sai._g5x_y) * _sai._length_unit_factor
+           + _sai._tool_offset_mm.tran.y;
+  out[2] = (z + _sai._g5x_z) * _sai._length_unit_factor
+           + _sai._tool_offset_mm.tran.z;
+}
+
+static void envelope_add(int axis, double value, int line_number)
+{
+  if (!_sai._envelope_valid || value < _sai._envelope_min[axis]) {
+    _sai._envelope_min[axis] = value;
+    _sai._envelope_min_line[axis] = line_number;
+  }
+  if (!_sai._envelope_valid || value > _sai._envelope_max[axis]) {
+    _sai._envelope_max[axis] = value;
+    _sai._envelope_max_line[axis] = line_number;
+  }
+}
+
+static void machine_pose(double x, double y, double z,
+ double a, double b, double c, double out[6])
+{
+  to_machine(x, y, z, out);
+  out[3] = a + _sai._g92_a + _sai._g5x_a + _sai._tool_offset_mm.a;
+  out[4] = b + _sai._g92_b + _sai._g5x_b + _sai._tool_offset_mm.b;
+  out[5] = c + _sai._g92_c + _sai._g5x_c + _sai._tool_offset_mm.c;
+}
+
+/* Where a move ends, in program coordinates. Where it started is
+   already in the envelope, or is where the machine sits now. */
+static void envelope_point(int line_number,
+ double x, double y, double z, double a, double b, double c)
+{
+  double m[6];
+  int i;
+
+  machine_pose(x, y, z, a, b, c, m);
+  for (i = 0; i < 6; i++)
+    envelope_add(i, m[i], line_number);
+  _sai._envelope_valid = true;
+}
+
+/* Path
+
+The joints of a machine whose kinematics aren't trivial can pass their
+limits between the ends of a move, so moves are cut into steps of at
+most PATH_STEP mm or degrees on any axis for the joint check.
+*/
+
+#define PATH_STEP 1.0
+#define PATH_BATCH 4096
+
+static void path_add(int line_number, const double m[6])
+{
+  EmcPose p = {};
+
+  p.tran.x = m[0];
+  p.tran.y = m[1];
+  p.tran.z = m[2];
+  p.a = m[3];
+  p.b = m[4];
+  p.c = m[5];
+  _sai._path.push_back(p);
+  _sai._path_line.push_back(line_number);
+  memcpy(_sai._path_last, m, sizeof(_sai._path_last));
+  _sai._path_valid = true;
+  if (_sai._path.size() >= PATH_BATCH)
+    _sai._path_full();
+}
+
+/* A straight move to a point in program coordinates. */
+static void path_line(int line_number,
+ double x, double y, double z, double a, double b, double c)
+{
+  double m[6], from[6], p[6];
+  double d = 0;
+  int i, k, n;
+
+  if (!_sai._path_full)
+    return;
+  machine_pose(x, y, z, a, b, c, m);
+  if (!_sai._path_valid)
+    {
+      path_add(line_number, m);
+      return;
+    }
+  memcpy(from, _sai._path_last, sizeof(from));
+  for (k = 0; k < 6; k++)
+    d = fmax(d, fabs(m[k] - from[k]));
+  n = (int) ceil(d / PATH_STEP);
+  if (n < 1) n = 1;
+  for (i = 1; i <= n; i++)
+    {
+      for (k = 0; k < 6; k++)
+        p[k] = from[k] + (m[k] - from[k]) * i / n;
+      path_add(line_number, p);
+    }
+}
+
+/* The parts of an arc that bulge past its end points. A circle of
+   radius r in the plane spanned by unit vectors u and v reaches its
+   extreme along machine axis k at angle atan2(v[k], u[k]) and opposite
+   it. Those angles within the sweep are added, with the helical
+   component the arc has reached by then. All arguments are program
+   coordinates; the plane's vectors are rotated with G10 L2 R. The
+   rotary axes end at a, b and c, and go there evenly along the arc. */
+static void envelope_arc(int line_number,
+ const double start[3], const double end[3], const double center[3],
+ int rotation, double a, double b, double c)
+{
+  double s[3], e[3], ctr[3];
+  double u[3] = {0, 0, 0}, v[3] = {0, 0, 0}, n[3] = {0, 0, 0};
+  double t = _sai._xy_rotation * M_PI / 180.0;
+  int k;
+
+  to_machine(start[0], start[1], start[2], s);
+  to_machine(end[0], end[1], end[2], e);
+  to_machine(center[0], center[1], center[2], ctr);
+
+  if (_sai._active_plane == CANON_PLANE_XY) {
+    u[0] = cos(t); u[1] = sin(t);
+    v[0] = -sin(t); v[1] = cos(t);
+    n[2] = 1;
+  } else if (_sai._active_plane == CANON_PLANE_YZ) {
+    u[0] = -sin(t); u[1] = cos(t);
+    v[2] = 1;
+    n[0] = cos(t); n[1] = sin(t);
+  } else {
+    u[2] = 1;
+    v[0] = cos(t); v[1] = sin(t);
+    n[0] = -sin(t); n[1] = cos(t);
+  }
+
+  double ds[3], de[3];
+  for (k = 0; k < 3; k++) {
+    ds[k] = s[k] - ctr[k];
+    de[k] = e[k] - ctr[k];
+  }
+  double su = ds[0] * u[0] + ds[1] * u[1] + ds[2] * u[2];
+  double sv = ds[0] * v[0] + ds[1] * v[1] + ds[2] * v[2];
+  double eu = de[0] * u[0] + de[1] * u[1] + de[2] * u[2];
+  double ev = de[0] * v[0] + de[1] * v[1] + de[2] * v[2];
+  double r = fmax(hypot(su, sv), hypot(eu, ev));
+  double height = (de[0] - ds[0]) * n[0] + (de[1] - ds[1]) * n[1]
+                  + (de[2] - ds[2]) * n[2];
+
+  /* sweep from start to end in the direction of travel, plus any
+     extra full turns */
+  double theta_s = atan2(sv, su);
+  double sweep = atan2(ev, eu) - theta_s;
+  int dir = rotation > 0 ? 1 : -1;
+  if (dir > 0 && sweep <= 0) sweep += 2 * M_PI;
+  if (dir < 0 && sweep >= 0) sweep -= 2 * M_PI;
+  sweep = fabs(sweep) + (abs(rotation) - 1) * 2 * M_PI;
+
+  for (k = 0; k < 3; k++) {
+    if (u[k] == 0 && v[k] == 0)
+      continue;
+    double phi = atan2(v[k], u[k]);
+    for (int side = 0; side < 2; side++, phi += M_PI) {
+      double d = fmod(dir * (phi - theta_s), 2 * M_PI);
+      if (d < 0) d += 2 * M_PI;
+      if (d > sweep)
+        continue;
+      double h = sweep > 0 ? height * d / sweep : 0;
+      envelope_add(k, ctr[k] + r * (cos(phi) * u[k] + sin(phi) * v[k])
+                   + h * n[k], line_number);
+    }
+  }
+
+  if (!_sai._path_full)
+    return;
+  double m[6], from[6], p[6];
+  if (!_sai._path_valid)
+    path_line(line_number, start[0], start[1], start[2], a, b, c);
+  machine_pose(end[0], end[1], end[2], a, b, c, m);
+  memcpy(from, _sai._path_last, sizeof(from));
+  double length = fmax(r * sweep, fabs(height));
+  for (k = 3; k < 6; k++)
+    length = fmax(length, fabs(m[k] - from[k]));
+  int steps = (int) ceil(length / PATH_STEP);
+  if (steps < 1) steps = 1;
+  for (int i = 1; i < steps; i++) {
+    double f = (double) i / steps;
+    double phi = theta_s + dir * sweep * f;
+    for (k = 0; k < 3; k++)
+      p[k] = ctr[k] + r * (cos(phi) * u[k] + sin(phi) * v[k])
+             + height * f * n[k];
+    for (k = 3; k < 6; k++)
+      p[k] = from[k] + (m[k] - from[k]) * f;
+    path_add(line_number, p);
+  }
+  path_add(line_number, m);
+}
+
 /* Representation */
 
 void SET_XY_ROTATION(double t) {
   ECHO_WITH_ARGS("%.4f", t);
+  _sai._xy_rotation = t;
 }
 
 void SET_G5X_OFFSET(int index,
@@ -235,6 +451,8 @@ void STRAIGHT_TRAVERSE( int line_number,
   _sai._program_position_a = a; /*AA*/
   _sai._program_position_b = b; /*BB*/
   _sai._program_position_c = c; /*CC*/
+  envelope_point(line_number, x, y, z, a, b, c);
+  path_line(line_number, x, y, z, a, b, c);
 }
 
 /* Machining Attributes */
@@ -318,8 +536,22 @@ std::vector<CONTROL_POINT> nurbs_control_points, unsigned int k)
 {
   ECHO_WITH_ARGS("%lu, ...", (unsigned long)nurbs_control_points.size());
 
-  _sai._program_position_x = nurbs_control_points[nurbs_control_points.size()].X;
-  _sai._program_position_y = nurbs_control_points[nurbs_control_points.size()].Y;
+  /* the curve stays within the hull of its control points, and is
+     followed along them for the joints */
+  for (size_t i = 0; i < nurbs_control_points.size(); i++)
+    {
+      envelope_point(lineno, nurbs_control_points[i].X,
+                     nurbs_control_points[i].Y, _sai._program_position_z,
+                     _sai._program_position_a, _sai._program_position_b,
+                     _sai._program_position_c);
+      path_line(lineno, nurbs_control_points[i].X,
+                nurbs_control_points[i].Y, _sai._program_position_z,
+                _sai._program_position_a, _sai._program_position_b,
+                _sai._program_position_c);
+    }
+
+  _sai._program_position_x = nurbs_control_points[nurbs_control_points.size() - 1].X;
+  _sai._program_position_y = nurbs_control_points[nurbs_control_points.size() - 1].Y;
 }
 
 void ARC_FEED(int line_number,
@@ -341,20 +573,26 @@ void ARC_FEED(int line_number,
          , b /*BB*/
          , c /*CC*/
          );
+  double start[3] = {_sai._program_position_x, _sai._program_position_y,
+                     _sai._program_position_z};
+  double center[3];
   if (_sai._active_plane == CANON_PLANE_XY)
     {
+      center[0] = first_axis; center[1] = second_axis; center[2] = start[2];
       _sai._program_position_x = first_end;
       _sai._program_position_y = second_end;
       _sai._program_position_z = axis_end_point;
     }
   else if (_sai._active_plane == CANON_PLANE_YZ)
     {
+      center[0] = start[0]; center[1] = first_axis; center[2] = second_axis;
       _sai._program_position_x = axis_end_point;
       _sai._program_position_y = first_end;
       _sai._program_position_z = second_end;
     }
   else /* if (_active_plane == CANON_PLANE_XZ) */
     {
+      center[0] = second_axis; center[1] = start[1]; center[2] = first_axis;
       _sai._program_position_x = second_end;
       _sai._program_position_y = axis_end_point;
       _sai._program_position_z = first_end;
@@ -362,6 +600,11 @@ void ARC_FEED(int line_number,
   _sai._program_position_a = a; /*AA*/
   _sai._program_position_b = b; /*BB*/
   _sai._program_position_c = c; /*CC*/
+
+  double end[3] = {_sai._program_position_x, _sai._program_position_y,
+                   _sai._program_position_z};
+  envelope_point(line_number, end[0], end[1], end[2], a, b, c);
+  envelope_arc(line_number, start, end, center, rotation, a, b, c);
 }
 
 void STRAIGHT_FEED(int line_number,
@@ -387,6 +630,8 @@ void STRAIGHT_FEED(int line_number,
   _sai._program_position_a = a; /*AA*/
   _sai._program_position_b = b; /*BB*/
   _sai._program_position_c = c; /*CC*/
+  envelope_point(line_number, x, y, z, a, b, c);
+  path_line(line_number, x, y, z, a, b, c);
 }
 
 
@@ -420,6 +665,8 @@ void STRAIGHT_PROBE(int line_number,
          , b /*BB*/
          , c /*CC*/
          );
+  envelope_point(line_number, x, y, z, a, b, c);
+  path_line(line_number, x, y, z, a, b, c);
   _sai._probe_position_x = x;
   _sai._probe_position_y = y;
   _sai._probe_position_z = z;
@@ -442,6 +689,15 @@ void STRAIGHT_PROBE(int line_number,
 void RIGID_TAP(int line_number, double x, double y, double z, double scale)
 {
     ECHO_WITH_ARGS("%.4f, %.4f, %.4f", x, y, z);
+    envelope_point(line_number, x, y, z, _sai._program_position_a,
+                   _sai._program_position_b, _sai._program_position_c);
+    /* in and back out */
+    path_line(line_number, x, y, z, _sai._program_position_a,
+              _sai._program_position_b, _sai._program_position_c);
+    path_line(line_number, _sai._program_position_x,
+              _sai._program_position_y, _sai._program_position_z,
+              _sai._program_position_a, _sai._program_position_b,
+              _sai._program_position_c);
 }
 
 
@@ -517,6 +773,10 @@ void SET_TOOL_TABLE_ENTRY(int pocket, int toolno, EmcPose offset, double diamete
 void USE_TOOL_LENGTH_OFFSET(EmcPose offset)
 {
     _sai._tool_offset = offset;
+    _sai._tool_offset_mm = offset;
+    _sai._tool_offset_mm.tran.x *= _sai._length_unit_factor;
+    _sai._tool_offset_mm.tran.y *= _sai._length_unit_factor;
+    _sai._tool_offset_mm.tran.z *= _sai._length_unit_factor;
     ECHO_WITH_ARGS("%.4f %.4f %.4f, %.4f %.4f %.4f, %.4f %.4f %.4f",
          offset.tran.x, offset.tran.y, offset.tran.z, offset.a, offset.b, offset.c, offset.u, offset.v, offset.w);
 }
@@ -525,7 +785,7 @@ void CHANGE_TOOL(int slot)
 {
   PRINT("CHANGE_TOOL(%d)\n", slot);
   _sai._active_slot = slot;
-  _sai._tools[0] = _sai._tools[slot];
+  _sai._tools[0] = GET_EXTERNAL_TOOL_TABLE(slot);
 }
 
 void SELECT_POCKET(int slot, int tool)
@@ -904,6 +1164,52 @@ extern int GET_EXTERNAL_TOOL_SLOT()
   return _sai._active_slot;
 }
 
+#ifdef HAVE_SQLITE3
+/* With -D the tools are read from a tool database, like task does with
+   [EMCIO]TOOL_DATABASE: _tools[0] is the tool in the spindle and the
+   other pockets of the table stand for the magazine pockets in
+   tool_pockets. */
+static ToolStore tool_store;
+static PocketMap tool_pockets;
+#endif
+
+int load_tool_database(const char *filename)
+{
+#ifdef HAVE_SQLITE3
+  const CANON_TOOL_TABLE *tool;
+
+  if (tool_store.open(filename, true) != 0)
+    return 1;
+  tool = tool_store.find_tool(tool_store.spindle_tool());
+  if (tool) {
+    _sai._tools[0] = *tool;
+  } else {
+    _sai._tools[0].toolno = -1;
+  }
+  return 0;
+#else
+  fprintf(stderr, "%s: built without tool database support\n", filename);
+  return 1;
+#endif
+}
+
+/* Returns the pocket of a tool not in the tool table. Without a tool
+   database they all are; with one, its magazine pocket takes over a
+   pocket of the table other than the one of the tool in the spindle. */
+int GET_EXTERNAL_TOOL_POCKET(int toolno)
+{
+#ifdef HAVE_SQLITE3
+  const CANON_TOOL_TABLE *tool;
+
+  if (tool_store.is_open()) {
+    tool = tool_store.find_tool(toolno);
+    if (tool && tool->pocketno >= 0)
+      return tool_pockets.assign(tool->pocketno, _sai._active_slot);
+  }
+#endif
+  return -1;
+}
+
 /* Returns maximum number of pockets */
 int GET_EXTERNAL_POCKETS_MAX()
 {
@@ -914,6 +1220,18 @@ int GET_EXTERNAL_POCKETS_MAX()
    in the given pocket */
 extern CANON_TOOL_TABLE GET_EXTERNAL_TOOL_TABLE(int pocket)
 {
+#ifdef HAVE_SQLITE3
+  const CANON_TOOL_TABLE *tool;
+
+  if (pocket > 0 && tool_store.is_open()) {
+    tool = tool_store.find_pocket(tool_pockets.pocket(pocket));
+    if (tool)
+      return *tool;
+    CANON_TOOL_TABLE empty{};
+    empty.toolno = -1;
+    return empty;
+  }
+#endif
   return _sai._tools[pocket];
 }
 
@@ -1146,6 +1464,17 @@ StandaloneInterpInternals::StandaloneInterpInternals() :
 
   _tool_offset({}),
   _toolchanger_fault(false),
-  _toolchanger_reason(0)
+  _toolchanger_reason(0),
+  _quiet(false),
+  _xy_rotation(0.0),
+  _tool_offset_mm({}),
+  _envelope_valid(false),
+  _envelope_min{0},
+  _envelope_max{0},
+  _envelope_min_line{0},
+  _envelope_max_line{0},
+  _path_full(NULL),
+  _path_valid(false),
+  _path_last{0}
 {
 }
@@ -5,6 +5,7 @@
 #include <interp_fwd.hh>
 #include <canon.hh>
 #include <string>
+#include <vector>
 
 struct StandaloneInterpInternals;
 class InterpBase;
@@ -14,6 +15,9 @@ extern InterpBase *pinterp;
 extern FILE *_outfile;
 extern char _parameter_file_name[PARAMETER_FILE_NAME_LENGTH];
 
+/* reads the tools from a tool database instead of a tool table */
+extern int load_tool_database(const char *filename);
+
 struct StandaloneInterpInternals
 {
   StandaloneInterpInternals();
@@ -69,6 +73,26 @@ struct StandaloneInterpInternals
   EmcPose _tool_offset;
   bool _toolchanger_fault;
   int  _toolchanger_reason ;
+
+  /* Envelope of the moves in machine coordinates, for rs274 -E.
+     Indexed X Y Z A B C; mm and degrees. */
+  bool _quiet;
+  double _xy_rotation;
+  EmcPose _tool_offset_mm;
+  bool _envelope_valid;
+  double _envelope_min[6];
+  double _envelope_max[6];
+  int _envelope_min_line[6];
+  int _envelope_max_line[6];
+
+  /* Points along the moves for the joint check of rs274 -E, in the
+     same coordinates; only kept while _path_full is set, which is
+     called to take them once a batch has been kept. */
+  void (*_path_full)(void);
+  std::vector<EmcPose> _path;
+  std::vector<int> _path_line;
+  bool _path_valid;
+  double _path_last[6];
 };
 
 void reset_internals();
@@ -42,6 +42,11 @@
 #include "canon_position.hh"		// data type for a machine position
 #include "interpl.hh"		// interp_list
 #include "emcglb.h"		// TRAJ_MAX_VELOCITY
+#ifdef HAVE_SQLITE3
+#include "toolstore.hh"
+#endif
+#include "usrmotintf.h"		// usrmotTrace()
+#include "mottrace.h"		// EMCMOT_TRACE_CANON
 
 //#define EMCCANON_DEBUG
 
@@ -918,6 +923,7 @@ static void flush_segments(void) {
     if ((vel && acc) || canon.spindle[canon.spindle_num].synched) {
         interp_list.set_line_number(line_no);
         interp_list.append(linearMoveMsg);
+        usrmotTrace(EMCMOT_TRACE_CANON, line_no);
     }
     canonUpdateEndPoint(x, y, z, a, b, c, u, v, w);
 
@@ -1043,6 +1049,7 @@ void STRAIGHT_TRAVERSE(int line_number,
     if(vel && acc)  {
         interp_list.set_line_number(line_number);
         interp_list.append(linearMoveMsg);
+        usrmotTrace(EMCMOT_TRACE_CANON, line_number);
     }
 
     if(old_feed_mode)
@@ -1783,6 +1790,7 @@ void ARC_FEED(int line_number,
         if(vel && a_max){
             interp_list.set_line_number(line_number);
             interp_list.append(linearMoveMsg);
+            usrmotTrace(EMCMOT_TRACE_CANON, line_number);
         }
     } else {
         circularMoveMsg.end = to_ext_pose(endpt);
@@ -1809,6 +1817,7 @@ void ARC_FEED(int line_number,
         if(vel && a_max) {
             interp_list.set_line_number(line_number);
             interp_list.append(circularMoveMsg);
+            usrmotTrace(EMCMOT_TRACE_CANON, line_number);
         }
     }
     // update the end point
@@ -2122,6 +2131,8 @@ void CHANGE_TOOL_NUMBER(int pocket_number)
     EMC_TOOL_SET_NUMBER emc_tool_set_number_msg;
     
     emc_tool_set_number_msg.tool = pocket_number;
+    emc_tool_set_number_msg.toolno =
+        pocket_number > 0 ? GET_EXTERNAL_TOOL_TABLE(pocket_number).toolno : 0;
 
     interp_list.append(emc_tool_set_number_msg);
 }
@@ -2587,6 +2598,38 @@ void CANON_ERROR(const char *fmt, ...)
     interp_list.append(operator_error_msg);
 }
 
+#ifdef HAVE_SQLITE3
+/*
+  With [EMCIO]TOOL_DATABASE, iocontrol keeps the tools in a database and
+  the status only carries the tool in the spindle and the prepped one.
+  The rest of the magazine is read from the database, which is opened
+  read only here. Returns NULL when there is no database.
+  */
+static ToolStore *tool_database()
+{
+    static ToolStore *store;
+
+    if (!tool_database_file[0]) {
+        return NULL;
+    }
+    if (!store) {
+        store = new ToolStore;
+    }
+    if (!store->is_open() && 0 != store->open(tool_database_file, true)) {
+        return NULL;
+    }
+    store->refresh();
+    return store;
+}
+
+/*
+  The magazine pocket each pocket of the interpreter's tool table stands
+  for. A T word for a tool in a magazine pocket beyond the table gives it
+  one, see GET_EXTERNAL_TOOL_POCKET.
+  */
+static PocketMap tool_pockets;
+#endif
+
 /*
   GET_EXTERNAL_TOOL_TABLE(int pocket)
 
@@ -2599,21 +2642,59 @@ void CANON_ERROR(const char *fmt, ...)
 CANON_TOOL_TABLE GET_EXTERNAL_TOOL_TABLE(int pocket)
 {
     CANON_TOOL_TABLE retval;
+    const CANON_TOOL_TABLE *tool = NULL;
+#ifdef HAVE_SQLITE3
+    ToolStore *store = NULL;
 
-    if (pocket < 0 || pocket >= CANON_POCKETS_MAX) {
+    if (pocket > 0 && pocket < CANON_POCKETS_MAX) {
+        store = tool_database();
+    }
+    if (store) {
+        tool = store->find_pocket(tool_pockets.pocket(pocket));
+    } else
+#endif
+    if (pocket >= 0 && pocket < CANON_POCKETS_MAX) {
+        tool = &emcStatus->io.tool.toolTable[pocket];
+    }
+
+    if (tool) {
+	retval = *tool;
+    } else {
 	retval.toolno = -1;
         ZERO_EMC_POSE(retval.offset);
         retval.frontangle = 0.0;
         retval.backangle = 0.0;
 	retval.diameter = 0.0;
         retval.orientation = 0;
-    } else {
-	retval = emcStatus->io.tool.toolTable[pocket];
     }
 
     return retval;
 }
 
+/*
+  GET_EXTERNAL_TOOL_POCKET(int toolno)
+
+  Returns the pocket of the tool table that has toolno. Without a tool
+  database they all do, so this is only asked for tools that don't exist.
+  With one, the tool's magazine pocket takes over a pocket of the table
+  if it has none; the pockets of the tools in the spindle and prepped are
+  not taken.
+  */
+int GET_EXTERNAL_TOOL_POCKET(int toolno)
+{
+#ifdef HAVE_SQLITE3
+    ToolStore *store = tool_database();
+    const CANON_TOOL_TABLE *tool = store? store->find_tool(toolno): NULL;
+
+    if (tool && tool->pocketno >= 0) {
+        return tool_pockets.assign(tool->pocketno,
+                                   emcStatus->io.tool.pocketPrepped,
+                                   GET_EXTERNAL_TOOL_SLOT());
+    }
+#endif
+    return -1;
+}
+
 CANON_POSITION GET_EXTERNAL_POSITION()
 {
     CANON_POSITION position;
@@ -2976,6 +3057,19 @@ int GET_EXTERNAL_TOOL_SLOT()
 {
     int toolno = emcStatus->io.tool.toolInSpindle;
     int pocket;
+#ifdef HAVE_SQLITE3
+    ToolStore *store = tool_database();
+
+    if (store) {
+        const CANON_TOOL_TABLE *tool = store->find_tool(toolno);
+        if (!tool || tool->pocketno <= 0) {
+            return 0;
+        }
+        pocket = tool_pockets.assign(tool->pocketno,
+                                     emcStatus->io.tool.pocketPrepped);
+        return pocket > 0 ? pocket : 0;
+    }
+#endif
 
     for (pocket = 1; pocket < CANON_POCKETS_MAX; pocket++) {
         if (emcStatus->io.tool.toolTable[pocket].toolno == toolno) {
@@ -19,6 +19,8 @@
 #include <unistd.h>		// stat()
 #include <limits.h>		// PATH_MAX
 #include <dlfcn.h>
+#include <map>
+#include <string>
 
 #include "rcs.hh"		// INIFILE
 #include "emc.hh"		// EMC NML
@@ -175,6 +177,9 @@ int emcTaskHalt()
 
 int emcTaskAbort()
 {
+    // take the interpreter back from the read-ahead thread
+    emcTaskReadaheadStop();
+
     emcMotionAbort();
 
     // clear out the pending command
@@ -378,12 +383,21 @@ static int waitFlag = 0;
 static char interp_error_text_buf[LINELEN];
 static char interp_stack_buf[LINELEN];
 
+// errors of the interpreter reading ahead on its own thread are kept
+// for task to report, see emcTaskPlanDeferErrors()
+static int deferErrors = 0;
+static int deferredError = 0;
+
 static void print_interp_error(int retval)
 {
     int index = 0;
     if (retval == 0) {
 	return;
     }
+    if (deferErrors) {
+	deferredError = retval;
+	return;
+    }
 
     if (0 != emcStatus) {
 	emcStatus->task.interpreter_errcode = retval;
@@ -457,6 +471,21 @@ int emcTaskPlanInit()
     return retval;
 }
 
+/*
+  The error channel and status are task's, so while the interpreter
+  reads ahead on another thread the last error is kept, and reported
+  once task has the interpreter back and stops deferring.
+*/
+void emcTaskPlanDeferErrors(int defer)
+{
+    deferErrors = defer;
+    if (!defer && deferredError != 0) {
+	int retval = deferredError;
+	deferredError = 0;
+	print_interp_error(retval);
+    }
+}
+
 int emcTaskPlanSetWait()
 {
     waitFlag = 1;
@@ -518,6 +547,16 @@ void emcTaskPlanExit()
     }
 }
 
+/*
+  Run from line normally interprets the program from the top and throws
+  away everything before the start line.  While a program runs, task keeps
+  the interpreter state every emcTaskCheckpointInterval lines of the main
+  program, so a later run from line can start at the closest one instead.
+*/
+int emcTaskCheckpointInterval = 0;
+static std::map<int, std::string> checkpoints;
+static std::string checkpointFile;
+
 int emcTaskPlanOpen(const char *file)
 {
     if (emcStatus != 0) {
@@ -533,6 +572,12 @@ int emcTaskPlanOpen(const char *file)
     }
     taskplanopen = 1;
 
+    // checkpoints of another program are no use
+    if (checkpointFile != file) {
+	checkpoints.clear();
+	checkpointFile = file;
+    }
+
     if (emc_debug & EMC_DEBUG_INTERP) {
         rcs_print("emcTaskPlanOpen(%s) returned %d\n", file, retval);
     }
@@ -663,6 +708,67 @@ int emcTaskPlanCommand(char *cmd)
     return 0;
 }
 
+void emcTaskPlanActiveCodes(EMC_TASK_STAT * stat)
+{
+    interp.active_g_codes(&stat->activeGCodes[0]);
+    interp.active_m_codes(&stat->activeMCodes[0]);
+    interp.active_settings(&stat->activeSettings[0]);
+}
+
+void emcTaskPlanCheckpoint()
+{
+    std::string state;
+
+    if (emcTaskCheckpointInterval <= 0 || interp.call_level() != 0) {
+	return;
+    }
+
+    int line = interp.line();
+    std::map<int, std::string>::iterator it = checkpoints.upper_bound(line);
+    if (it != checkpoints.begin() && line - (--it)->first < emcTaskCheckpointInterval) {
+	return;
+    }
+    // refused inside a sub, with cutter comp on and so on; try the next line
+    if (interp.checkpoint(state) != 0) {
+	return;
+    }
+    checkpoints[line] = state;
+
+    if (emc_debug & EMC_DEBUG_INTERP) {
+        rcs_print("emcTaskPlanCheckpoint() kept line %d (%d bytes)\n",
+          line, (int)state.size());
+    }
+}
+
+int emcTaskPlanRestoreCheckpoint(int line)
+{
+    // the line before the start line must still be read, it is where
+    // task synchs the interpreter to the machine position
+    std::map<int, std::string>::iterator it = checkpoints.upper_bound(line - 2);
+    if (it == checkpoints.begin()) {
+	return 0;
+    }
+    --it;
+
+    if (interp.restore_checkpoint(it->second) != 0) {
+	// the program or the saved parameters changed since they were kept
+	checkpoints.clear();
+	std::string file = checkpointFile;
+	emcTaskPlanClose();
+	emcTaskPlanOpen(file.c_str());
+	if (emc_debug & EMC_DEBUG_INTERP) {
+	    rcs_print("emcTaskPlanRestoreCheckpoint(%d) failed, running from the top\n", line);
+	}
+	return 0;
+    }
+
+    if (emc_debug & EMC_DEBUG_INTERP) {
+        rcs_print("emcTaskPlanRestoreCheckpoint(%d) resumed after line %d\n",
+          line, it->first);
+    }
+    return it->first;
+}
+
 int emcTaskUpdate(EMC_TASK_STAT * stat)
 {
     stat->mode = (enum EMC_TASK_MODE_ENUM) determineMode();
@@ -684,14 +790,18 @@ int emcTaskUpdate(EMC_TASK_STAT * stat)
     // currentLine set in main
     // readLine set in main
 
-    char buf[LINELEN];
-    strcpy(stat->file, interp.file(buf, LINELEN));
-    // command set in main
+    if (emcTaskReadaheadBusy()) {
+	// the interpreter is reading ahead on its own thread; this is how
+	// it was after the last line it read
+	emcTaskReadaheadStatus(stat);
+    } else {
+	char buf[LINELEN];
+	strcpy(stat->file, interp.file(buf, LINELEN));
+	// command set in main
 
-    // update active G and M codes
-    interp.active_g_codes(&stat->activeGCodes[0]);
-    interp.active_m_codes(&stat->activeMCodes[0]);
-    interp.active_settings(&stat->activeSettings[0]);
+	// update active G and M codes
+	emcTaskPlanActiveCodes(stat);
+    }
 
     //update state of optional stop
     stat->optional_stop_state = GET_OPTIONAL_PROGRAM_STOP();
@@ -53,12 +53,15 @@
 #include <signal.h>		// signal(), SIGINT
 #include <float.h>		// DBL_MAX
 #include <sys/types.h>		// pid_t
+#include <deque>
+#include <utility>		// std::pair
 #include <unistd.h>		// fork()
 #include <sys/wait.h>		// waitpid(), WNOHANG, WIFEXITED
 #include <ctype.h>		// isspace()
 #include <libintl.h>
 #include <locale.h>
 #include "usrmotintf.h"
+#include "mottrace.h"
 
 #if 0
 // Enable this to niftily trap floating point exceptions for debugging
@@ -128,6 +131,18 @@ static int emcTaskIssueCommand(NMLmsg * cmd);
 
 // pending command to be sent out by emcTaskExecute()
 NMLmsg *emcTaskCommand = 0;
+// its estimated run time, from interp_list
+static double emcTaskCommandTime = 0.0;
+
+// [TASK] READAHEAD_TIME: if > 0, the interpreter reads ahead until the
+// moves queued in motion and on interp_list take this many seconds,
+// instead of until interp_list is two thirds full
+static double emcTaskReadaheadTime = 0.0;
+
+// moves sent to motion that it hasn't finished yet, oldest first: motion
+// id and estimated run time
+static std::deque<std::pair<int, double> > motionQueueTimes;
+static double motionQueueTime = 0.0;
 
 // signal handling code to stop main loop
 int done;
@@ -421,6 +436,11 @@ static EMC_TASK_PLAN_SYNCH taskPlanSynchCmd;
 
 static int interpResumeState = EMC_TASK_INTERP_IDLE;
 static int programStartLine = 0;	// which line to run program from
+// a run waiting for the soft limit check, see taskpreflight.cc; any
+// state or mode change, and opening or closing a program, calls it off
+static int preflightRunPending = 0;
+static int preflightRunLine = 0;
+static char preflightRunFile[LINELEN];
 // how long the interp list can be
 
 int stepping = 0;
@@ -490,12 +510,132 @@ static int checkInterpList(NML_INTERP_LIST * il, EMC_STAT * stat)
 }
 extern int emcTaskMopup();
 
+// a move went to motion
+static void motionQueueTimeSent(int id, double seconds)
+{
+    motionQueueTimes.push_back(std::make_pair(id, seconds));
+    motionQueueTime += seconds;
+}
+
+// forgets the moves motion is done with: the ones before the move it is
+// running, and the oldest ones beyond the number it still has queued
+static void motionQueueTimeUpdate(void)
+{
+    size_t done = 0;
+    size_t depth = emcStatus->motion.traj.queue > 0 ? emcStatus->motion.traj.queue : 0;
+
+    while (done < motionQueueTimes.size() &&
+	   motionQueueTimes[done].first != emcStatus->motion.traj.id) {
+	done++;
+    }
+    if (done == motionQueueTimes.size()) {
+	// not one of ours
+	done = 0;
+    }
+    if (motionQueueTimes.size() - done > depth) {
+	done = motionQueueTimes.size() - depth;
+    }
+    for (; done > 0; done--) {
+	motionQueueTime -= motionQueueTimes.front().second;
+	motionQueueTimes.pop_front();
+    }
+    if (motionQueueTimes.empty()) {
+	motionQueueTime = 0.0;
+    }
+
+    emcStatus->task.queueTime = motionQueueTime;
+    emcStatus->task.readaheadTime = interp_list.time();
+}
+
+// whether to read another line, going by how much is queued already
+static bool readahead_wanted(bool first)
+{
+    if (interp_list.len() > emc_task_interp_max_len) {
+	return false;
+    }
+    if (emcTaskReadaheadTime > 0) {
+	return motionQueueTime + interp_list.time() < emcTaskReadaheadTime;
+    }
+    return first || interp_list.len() <= emc_task_interp_max_len * 2/3;
+}
+
+// commands that use the interpreter, Python or interp_list from task's
+// side; before these task takes the interpreter back from the read-ahead
+// thread.  Aborts throw away what the thread was doing instead, in
+// emcTaskAbort().
+static bool readahead_must_stop(NMLTYPE type)
+{
+    switch (type) {
+    case EMC_TASK_SET_MODE_TYPE:
+    case EMC_TASK_SET_STATE_TYPE:
+    case EMC_TASK_PLAN_OPEN_TYPE:
+    case EMC_TASK_PLAN_RUN_TYPE:
+    case EMC_TASK_PLAN_EXECUTE_TYPE:
+    case EMC_TASK_PLAN_PAUSE_TYPE:
+    case EMC_TASK_PLAN_RESUME_TYPE:
+    case EMC_TASK_PLAN_END_TYPE:
+    case EMC_TASK_PLAN_CLOSE_TYPE:
+    case EMC_TASK_PLAN_INIT_TYPE:
+    case EMC_TASK_PLAN_SYNCH_TYPE:
+    case EMC_TASK_PLAN_SET_OPTIONAL_STOP_TYPE:
+    case EMC_TASK_PLAN_SET_BLOCK_DELETE_TYPE:
+    case EMC_TASK_PLAN_OPTIONAL_STOP_TYPE:
+    case EMC_TOOL_LOAD_TOOL_TABLE_TYPE:
+    case EMC_TOOL_SET_OFFSET_TYPE:
+    case EMC_EXEC_PLUGIN_CALL_TYPE:
+    case EMC_IO_PLUGIN_CALL_TYPE:
+	return true;
+    default:
+	return false;
+    }
+}
+
+// the read-ahead thread's side of readahead_reading(): starts a job when
+// more is wanted, and finishes the one before when it is done
+static void readahead_thread(void)
+{
+    emcTaskReadaheadPoll();
+    if (emcTaskReadaheadBusy() ||
+	emcStatus->task.interpState != EMC_TASK_INTERP_READING) {
+	return;
+    }
+    if (emcTaskPlanIsWait()) {
+	// delay reading of next line until all is done
+	if (interp_list.len() == 0 &&
+	    emcTaskCommand == 0 &&
+	    emcStatus->task.execState == EMC_TASK_EXEC_DONE) {
+	    emcTaskPlanClearWait();
+	}
+	return;
+    }
+    if (!readahead_wanted(true)) {
+	return;
+    }
+    if (emcTaskReadaheadTime > 0) {
+	emcTaskReadaheadStart(emc_task_interp_max_len,
+			      emcTaskReadaheadTime - motionQueueTime);
+    } else {
+	emcTaskReadaheadStart(emc_task_interp_max_len * 2/3, 0);
+    }
+}
+
 void readahead_reading(void)
 {
     int readRetval;
     int execRetval;
+    double start = etime();
+    // reading stops after this long so task keeps handling commands and
+    // updating status; it carries on in the next cycle
+    double budget = emc_task_cycle_time > 0 ? emc_task_cycle_time / 2 : 0.001;
+
+    // running from a line is left to the task loop, it synchs as it goes
+    if (emcTaskReadaheadBusy() ||
+	(emcTaskReadaheadThread && programStartLine == 0)) {
+	readahead_thread();
+	return;
+    }
 
-		if (interp_list.len() <= emc_task_interp_max_len) {
+		if (readahead_wanted(true)) {
                     int count = 0;
 interpret_again:
 		    if (emcTaskPlanIsWait()) {
@@ -528,6 +668,7 @@ interpret_again:
 			    // got a good line
 			    // record the line number and command
 			    emcStatus->task.readLine = emcTaskPlanLine();
+			    usrmotTrace(EMCMOT_TRACE_READ, emcStatus->task.readLine);
 
 			    emcTaskPlanCommand((char *) &emcStatus->task.
 					       command);
@@ -564,6 +705,7 @@ interpret_again:
 			    } else {
 
 				// executed a good line
+				emcTaskPlanCheckpoint();
 			    }
 
 			    // throw the results away if we're supposed to
@@ -616,8 +758,12 @@ interpret_again:
 
                             if (count++ < emc_task_interp_max_len
                                     && emcStatus->task.interpState == EMC_TASK_INTERP_READING
-                                    && interp_list.len() <= emc_task_interp_max_len * 2/3) {
-                                goto interpret_again;
+                                    && readahead_wanted(false)) {
+                                if (emcTaskReadaheadTime <= 0 || etime() - start < budget) {
+                                    goto interpret_again;
+                                }
+                                // no waiting for the timer, motion needs more
+                                emcTaskEager = 1;
                             }
 
 			}	// else read was OK, so execute
@@ -768,6 +914,10 @@ static int emcTaskPlan(void)
 	type = 0;
     }
 
+    if (type != 0 && emcTaskReadaheadBusy() && readahead_must_stop(type)) {
+	emcTaskReadaheadFinish();
+    }
+
     // handle any new command
     switch (emcStatus->task.state) {
     case EMC_TASK_STATE_OFF:
@@ -1617,6 +1767,57 @@ int emcTaskQueueCommand(NMLmsg * cmd)
 }
 
 // issues command immediately
+// start reading the open program from the given line
+static void planRun(int line)
+{
+    stepping = 0;
+    steppingWait = 0;
+    if (!taskplanopen && emcStatus->task.file[0] != 0) {
+	emcTaskPlanOpen(emcStatus->task.file);
+    }
+    programStartLine = line;
+    // skip most of the lines before the start line at once
+    if (line > 1 && taskplanopen && emcTaskPlanLine() <= 1 &&
+	emcTaskPlanRestoreCheckpoint(line) > 0) {
+	interp_list.clear();
+    }
+    emcStatus->task.interpState = EMC_TASK_INTERP_READING;
+    emcStatus->task.task_paused = 0;
+}
+
+// start a run that was waiting for the soft limit check, if nothing
+// else happened to the machine in the meantime
+static void preflightRunUpdate()
+{
+    if (!preflightRunPending) {
+	return;
+    }
+    // e.g. an estop from HAL rather than a command
+    if (emcStatus->task.state != EMC_TASK_STATE_ON ||
+	emcStatus->task.mode != EMC_TASK_MODE_AUTO ||
+	emcStatus->task.interpState != EMC_TASK_INTERP_IDLE ||
+	strcmp(emcStatus->task.file, preflightRunFile) != 0) {
+	preflightRunPending = 0;
+	return;
+    }
+    // the answer for this file, checked again if the offsets changed
+    int result = emcTaskPreflightCheck(preflightRunFile);
+    if (result == EMC_TASK_PREFLIGHT_RUNNING) {
+	return;
+    }
+    preflightRunPending = 0;
+    if (result == EMC_TASK_PREFLIGHT_FAILED) {
+	emcOperatorError(0, _("Program not started: %s"),
+			 emcTaskPreflightMessage());
+	return;
+    }
+    if (result == EMC_TASK_PREFLIGHT_UNCHECKED) {
+	emcOperatorText(0, _("Program not checked against soft limits: %s"),
+			emcTaskPreflightMessage());
+    }
+    planRun(preflightRunLine);
+}
+
 static int emcTaskIssueCommand(NMLmsg * cmd)
 {
     int retval = 0;
@@ -1632,6 +1833,9 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 	rcs_print("Issuing %s -- \t (%s)\n", emcSymbolLookup(cmd->type),
 		  emcCommandBuffer->msg2str(cmd));
     }
+    if (emcTaskReadaheadBusy() && readahead_must_stop(cmd->type)) {
+	emcTaskReadaheadFinish();
+    }
     switch (cmd->type) {
 	// general commands
 
@@ -1726,6 +1930,7 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 					set_homing_params_msg->ignore_limits,
 					set_homing_params_msg->is_shared,
 					set_homing_params_msg->home_sequence,
+					set_homing_params_msg->home_after,
 					set_homing_params_msg->volatile_home,
 					set_homing_params_msg->locking_indexer,
 					set_homing_params_msg->absolute_encoder);
@@ -1820,20 +2025,30 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 
     case EMC_TRAJ_LINEAR_MOVE_TYPE:
 	emcTrajLinearMoveMsg = (EMC_TRAJ_LINEAR_MOVE *) cmd;
+	usrmotTrace(EMCMOT_TRACE_ISSUE, emcStatus->task.currentLine);
         retval = emcTrajLinearMove(emcTrajLinearMoveMsg->end,
                                    emcTrajLinearMoveMsg->type, emcTrajLinearMoveMsg->vel,
                                    emcTrajLinearMoveMsg->ini_maxvel, emcTrajLinearMoveMsg->acc,
                                    emcTrajLinearMoveMsg->indexer_jnum);
+	if (retval == 0) {
+	    motionQueueTimeSent(emcStatus->task.currentLine,
+				cmd == emcTaskCommand ? emcTaskCommandTime : 0.0);
+	}
 	break;
 
     case EMC_TRAJ_CIRCULAR_MOVE_TYPE:
 	emcTrajCircularMoveMsg = (EMC_TRAJ_CIRCULAR_MOVE *) cmd;
+	usrmotTrace(EMCMOT_TRACE_ISSUE, emcStatus->task.currentLine);
         retval = emcTrajCircularMove(emcTrajCircularMoveMsg->end,
                 emcTrajCircularMoveMsg->center, emcTrajCircularMoveMsg->normal,
                 emcTrajCircularMoveMsg->turn, emcTrajCircularMoveMsg->type,
                 emcTrajCircularMoveMsg->vel,
                 emcTrajCircularMoveMsg->ini_maxvel,
                 emcTrajCircularMoveMsg->acc);
+	if (retval == 0) {
+	    motionQueueTimeSent(emcStatus->task.currentLine,
+				cmd == emcTaskCommand ? emcTaskCommandTime : 0.0);
+	}
 	break;
 
     case EMC_TRAJ_PAUSE_TYPE:
@@ -2078,7 +2293,8 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 
     case EMC_TOOL_SET_NUMBER_TYPE:
 	emc_tool_set_number_msg = (EMC_TOOL_SET_NUMBER *) cmd;
-	retval = emcToolSetNumber(emc_tool_set_number_msg->tool);
+	retval = emcToolSetNumber(emc_tool_set_number_msg->tool,
+				  emc_tool_set_number_msg->toolno);
 	break;
 
 	// task commands
@@ -2089,6 +2305,7 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 
     case EMC_TASK_ABORT_TYPE:
 	// abort everything
+	preflightRunPending = 0;
 	emcTaskAbort();
         emcIoAbort(EMC_ABORT_TASK_ABORT);
     for (int s = 0; s < emcStatus->motion.traj.spindles; s++) emcSpindleAbort(s);
@@ -2101,6 +2318,9 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 
     case EMC_TASK_SET_MODE_TYPE:
 	mode_msg = (EMC_TASK_SET_MODE *) cmd;
+	if (mode_msg->mode != emcStatus->task.mode) {
+	    preflightRunPending = 0;
+	}
 	if (emcStatus->task.mode == EMC_TASK_MODE_AUTO &&
 	    emcStatus->task.interpState != EMC_TASK_INTERP_IDLE &&
 	    mode_msg->mode != EMC_TASK_MODE_AUTO) {
@@ -2149,12 +2369,16 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 
     case EMC_TASK_SET_STATE_TYPE:
 	state_msg = (EMC_TASK_SET_STATE *) cmd;
+	if (state_msg->state != emcStatus->task.state) {
+	    preflightRunPending = 0;
+	}
 	retval = emcTaskSetState(state_msg->state);
 	break;
 
 	// interpreter commands
 
     case EMC_TASK_PLAN_CLOSE_TYPE:
+	preflightRunPending = 0;
         retval = emcTaskPlanClose();
 	if (retval > INTERP_MIN_ERROR) {
 	    emcOperatorError(0, _("failed to close file"));
@@ -2166,6 +2390,7 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 
     case EMC_TASK_PLAN_OPEN_TYPE:
 	open_msg = (EMC_TASK_PLAN_OPEN *) cmd;
+	preflightRunPending = 0;
 	retval = emcTaskPlanOpen(open_msg->file);
 	if (retval > INTERP_MIN_ERROR) {
 	    retval = -1;
@@ -2174,6 +2399,8 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
 	    emcOperatorError(0, _("can't open %s"), open_msg->file);
 	} else {
 	    strcpy(emcStatus->task.file, open_msg->file);
+	    // get the soft limit check going while the operator sets up
+	    emcTaskPreflightStart(open_msg->file);
 	    retval = 0;
 	}
 	break;
@@ -2274,16 +2501,32 @@ static int emcTaskIssueCommand(NMLmsg * cmd)
             retval = -1;
             break;
         }
-	stepping = 0;
-	steppingWait = 0;
-	if (!taskplanopen && emcStatus->task.file[0] != 0) {
-	    emcTaskPlanOpen(emcStatus->task.file);
-	}
 	run_msg = (EMC_TASK_PLAN_RUN *) cmd;
-	programStartLine = run_msg->line;
-	emcStatus->task.interpState = EMC_TASK_INTERP_READING;
-	emcStatus->task.task_paused = 0;
-	retval = 0;
+	switch (emcTaskPreflightCheck(emcStatus->task.file)) {
+	case EMC_TASK_PREFLIGHT_RUNNING:
+	    // started by preflightRunUpdate() once the check passes
+	    emcOperatorText(0, _("Checking program against soft limits"));
+	    preflightRunPending = 1;
+	    preflightRunLine = run_msg->line;
+	    strcpy(preflightRunFile, emcStatus->task.file);
+	    retval = 0;
+	    break;
+	case EMC_TASK_PREFLIGHT_FAILED:
+	    emcOperatorError(0, _("Program not started: %s"),
+			     emcTaskPreflightMessage());
+	    retval = -1;
+	    break;
+	case EMC_TASK_PREFLIGHT_UNCHECKED:
+	    emcOperatorText(0, _("Program not checked against soft limits: %s"),
+			    emcTaskPreflightMessage());
+	    planRun(run_msg->line);
+	    retval = 0;
+	    break;
+	default:
+	    planRun(run_msg->line);
+	    retval = 0;
+	    break;
+	}
 	break;
 
     case EMC_TASK_PLAN_PAUSE_TYPE:
@@ -2584,13 +2827,16 @@ static int emcTaskExecute(void)
 	    if (0 == emcTaskCommand) {
 		// need a new command
 		emcTaskCommand = interp_list.get();
+		emcTaskCommandTime = interp_list.get_duration();
 		// interp_list now has line number associated with this-- get
 		// it
 		if (0 != emcTaskCommand) {
 		    emcTaskEager = 1;
 		    emcStatus->task.currentLine =
 			interp_list.get_line_number();
-		    emcStatus->task.callLevel = emcTaskPlanLevel();
+		    if (!emcTaskReadaheadBusy()) {
+			emcStatus->task.callLevel = emcTaskPlanLevel();
+		    }
 		    // and set it for all subsystems which use queued ids
 		    emcTrajSetMotionId(emcStatus->task.currentLine);
 		    if (emcStatus->motion.traj.queueFull) {
@@ -3060,6 +3306,7 @@ static int emctask_startup()
 	rcs_print_error("can't initialize interpreter\n");
 	return -1;
     }
+    emcTaskReadaheadInit();
 
     if (done ) {
 	emctask_shutdown();
@@ -3082,6 +3329,7 @@ static int emctask_shutdown(void)
     // shut down the subsystems
     if (0 != emcStatus) {
 	emcTaskHalt();
+	emcTaskReadaheadExit();
 	emcTaskPlanExit();
 	emcMotionHalt();
 	emcIoHalt();
@@ -3179,6 +3427,23 @@ static int iniLoad(const char *filename)
 	}
     }
 
+    if (NULL != (inistring = inifile.Find("READAHEAD_TIME", "TASK"))) {
+	if (1 != sscanf(inistring, "%lf", &emcTaskReadaheadTime) ||
+	    emcTaskReadaheadTime < 0) {
+	    rcs_print("invalid [TASK] READAHEAD_TIME in %s (%s); reading ahead by length\n",
+		      filename, inistring);
+	    emcTaskReadaheadTime = 0.0;
+	}
+    }
+
+    if (NULL != (inistring = inifile.Find("READAHEAD_THREAD", "TASK"))) {
+	if (1 != sscanf(inistring, "%d", &emcTaskReadaheadThread)) {
+	    rcs_print("invalid [TASK] READAHEAD_THREAD in %s (%s); reading ahead in the task loop\n",
+		      filename, inistring);
+	    emcTaskReadaheadThread = 0;
+	}
+    }
+
     if (NULL != (inistring = inifile.Find("RS274NGC_STARTUP_CODE", "RS274NGC"))) {
 	// copy to global
 	strcpy(rs274ngc_startup_code, inistring);
@@ -3247,6 +3512,16 @@ static int iniLoad(const char *filename)
 	max_mdi_queued_commands = atoi(inistring);
     }
 
+    // check whole programs against the soft limits before running them
+    if (NULL != (inistring = inifile.Find("PREFLIGHT", "TASK"))) {
+	emcTaskPreflightEnable = atoi(inistring);
+    }
+
+    // lines between interpreter checkpoints for run from line
+    if (NULL != (inistring = inifile.Find("CHECKPOINT_INTERVAL", "TASK"))) {
+	emcTaskCheckpointInterval = atoi(inistring);
+    }
+
     // close it
     inifile.Close();
 
@@ -3368,6 +3643,7 @@ int main(int argc, char *argv[])
 	    taskExecuteError = 0;
 	}
 	// run control cycle
+	preflightRunUpdate();
 	if (0 != emcTaskPlan()) {
 	    taskPlanError = 1;
 	}
@@ -3378,6 +3654,7 @@ int main(int argc, char *argv[])
 
 	emcIoUpdate(&emcStatus->io);
 	emcMotionUpdate(&emcStatus->motion);
+	motionQueueTimeUpdate();
 	// synchronize subordinate states
 	if (emcStatus->io.aux.estop) {
 	    if (emcStatus->motion.traj.enabled) {
@@ -441,11 +441,12 @@ int emcToolSetOffset(int pocket, int toolno, EmcPose offset, double diameter,
     return 0;
 }
 
-int emcToolSetNumber(int number)
+int emcToolSetNumber(int number, int toolno)
 {
     EMC_TOOL_SET_NUMBER toolSetNumberMsg;
 
     toolSetNumberMsg.tool = number;
+    toolSetNumberMsg.toolno = toolno;
 
     sendCommand(&toolSetNumberMsg);
 
@@ -23,6 +23,7 @@ extern int emcTaskQueueCommand(NMLmsg *cmd);
 extern int emcPluginCall(EMC_EXEC_PLUGIN_CALL *call_msg);
 extern int emcIoPluginCall(EMC_IO_PLUGIN_CALL *call_msg);
 extern int emcTaskOnce(const char *inifile);
+extern int emcTaskPythonMethods;	// Task() is implemented in Python
 extern int emcRunHalFiles(const char *filename);
 
 // Returns 0 if all joints are homed, 1 if any joints are un-homed.
@@ -53,8 +54,40 @@ int emcTaskPlanReset();
 int emcTaskPlanLine();
 int emcTaskPlanLevel();
 int emcTaskPlanCommand(char *cmd);
+void emcTaskPlanActiveCodes(EMC_TASK_STAT * stat);
+void emcTaskPlanDeferErrors(int defer);
+
+// interpreter checkpoints for run from line
+extern int emcTaskCheckpointInterval;
+void emcTaskPlanCheckpoint();
+int emcTaskPlanRestoreCheckpoint(int line);
 
 int emcTaskUpdate(EMC_TASK_STAT * stat);
 
+// whole-program soft limit check, see taskpreflight.cc
+enum {
+    EMC_TASK_PREFLIGHT_NONE,
+    EMC_TASK_PREFLIGHT_RUNNING,
+    EMC_TASK_PREFLIGHT_PASSED,
+    EMC_TASK_PREFLIGHT_FAILED,
+    EMC_TASK_PREFLIGHT_UNCHECKED,	// the checker could not run the program
+};
+extern int emcTaskPreflightEnable;
+int emcTaskPreflightStart(const char *file);
+int emcTaskPreflightPoll();
+int emcTaskPreflightCheck(const char *file);
+const char *emcTaskPreflightMessage();
+
+// interpreter read-ahead on a thread of its own, see taskreadahead.cc
+extern int emcTaskReadaheadThread;
+int emcTaskReadaheadInit();
+void emcTaskReadaheadExit();
+int emcTaskReadaheadStart(int maxLen, double maxTime);
+int emcTaskReadaheadBusy();
+int emcTaskReadaheadPoll();
+int emcTaskReadaheadFinish();
+void emcTaskReadaheadStop();
+void emcTaskReadaheadStatus(EMC_TASK_STAT * stat);
+
 #endif
 
@@ -52,6 +52,7 @@ extern PythonPlugin *python_plugin;  // exported by python_plugin.cc
 #define PYUSABLE (((python_plugin) != NULL) && (python_plugin->usable()))
 extern int return_int(const char *funcname, bp::object &retval);
 Task *task_methods;
+int emcTaskPythonMethods = 0;
 
 // IO INTERFACE
 
@@ -296,7 +297,7 @@ int emcToolSetOffset(int pocket, int toolno, EmcPose offset, double diameter,
                      double frontangle, double backangle, int orientation) {
     return task_methods->emcToolSetOffset( pocket,  toolno,  offset,  diameter,
 					   frontangle,  backangle,  orientation); }
-int emcToolSetNumber(int number) { return task_methods->emcToolSetNumber(number); }
+int emcToolSetNumber(int number, int toolno) { return task_methods->emcToolSetNumber(number, toolno); }
 int emcIoUpdate(EMC_IO_STAT * stat) { return task_methods->emcIoUpdate(stat); }
 int emcIoPluginCall(EMC_IO_PLUGIN_CALL *call_msg) { return task_methods->emcIoPluginCall(call_msg->len,
 											   call_msg->call); }
@@ -333,6 +334,7 @@ int emcTaskOnce(const char *filename)
 	    bp::extract<Task *> typetest(result);
 	    if (typetest.check()) {
 		task_methods = bp::extract< Task * >(result);
+		emcTaskPythonMethods = 1;
 	    } else {
 		rcs_print("cant extract a Task instance out of '%s'\n", instance_name);
 		task_methods = NULL;
@@ -683,11 +685,12 @@ int Task::emcToolSetOffset(int pocket, int toolno, EmcPose offset, double diamet
     return 0;
 }
 
-int Task::emcToolSetNumber(int number)
+int Task::emcToolSetNumber(int number, int toolno)
 {
     EMC_TOOL_SET_NUMBER toolSetNumberMsg;
 
     toolSetNumberMsg.tool = number;
+    toolSetNumberMsg.toolno = toolno;
 
     sendCommand(&toolSetNumberMsg);
 
@@ -47,7 +47,7 @@ public:
     virtual int emcToolLoad();
     virtual int emcToolLoadToolTable(const char *file);
     virtual int emcToolUnload();
-    virtual int emcToolSetNumber(int number);
+    virtual int emcToolSetNumber(int number, int toolno);
     virtual int emcIoUpdate(EMC_IO_STAT * stat);
 
     virtual int emcIoPluginCall(int len, const char *msg);
@@ -282,7 +282,8 @@ int emcJointSetHomingParams(int joint, double home, double offset, double home_f
 			   double search_vel, double latch_vel,
 			   int use_index, int encoder_does_not_reset,
 			   int ignore_limits, int is_shared,
-			   int sequence,int volatile_home, int locking_indexer,int absolute_encoder)
+			   int sequence, int home_after,
+			   int volatile_home, int locking_indexer,int absolute_encoder)
 {
 #ifdef ISNAN_TRAP
     if (std::isnan(home) || std::isnan(offset) || std::isnan(home_final_vel) ||
@@ -305,6 +306,7 @@ int emcJointSetHomingParams(int joint, double home, double offset, double home_f
     emcmotCommand.latch_vel = latch_vel;
     emcmotCommand.flags = 0;
     emcmotCommand.home_sequence = sequence;
+    emcmotCommand.home_after = home_after;
     emcmotCommand.volatile_home = volatile_home;
     if (use_index) {
 	emcmotCommand.flags |= HOME_USE_INDEX;
@@ -1532,9 +1534,10 @@ int emcTrajUpdate(EMC_TRAJ_STAT * stat)
     }
 
     stat->inpos = emcmotStatus.motionFlag & EMCMOT_MOTION_INPOS_BIT;
-    stat->queue = emcmotStatus.depth;
+    /* moves still in the command queue count as queued in motion */
+    stat->queue = emcmotStatus.depth + usrmotQueuedCommands();
     stat->activeQueue = emcmotStatus.activeDepth;
-    stat->queueFull = emcmotStatus.queueFull;
+    stat->queueFull = emcmotStatus.queueFull || usrmotCommandQueueFull();
     stat->id = emcmotStatus.id;
     stat->motion_type = emcmotStatus.motionType;
     stat->distance_to_go = emcmotStatus.distance_to_go;
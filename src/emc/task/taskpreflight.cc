@@ -0,0 +1,334 @@
+/********************************************************************
+* Description: taskpreflight.cc
+*   Checks a whole program against the soft limits before it runs
+*
+*   The program is interpreted by `rs274 -E`, the standalone
+*   interpreter with a stub canon that only tracks the envelope of
+*   the moves, in a child process. It starts as soon as a program is
+*   opened, so by the time cycle start is pressed the answer is
+*   usually there, and it runs on another core alongside task.
+*
+*   The check is run again at cycle start if the offsets in the
+*   parameter file or the tool table changed since it started, e.g.
+*   after touching off. With [EMCIO]TOOL_DATABASE the database is
+*   passed with -D instead of the tool table, and it and its
+*   write-ahead log are what is compared.
+*
+*   It is one child for the whole program: interpreting is
+*   sequential, every line depending on the modal state, offsets
+*   and tools left by the ones before it, so the program can't be
+*   cut up between threads without interpreting up to each cut
+*   first. What runs in parallel is the check and task.
+*
+*   On machines whose kinematics aren't trivial rs274 -E also runs
+*   the moves through the kinematics module and checks the joint
+*   limits. It loads its own copy of the module, so the module's pins
+*   and parameters are passed to it with -K as they are in HAL now.
+*
+*   The standalone interpreter can't run everything task can, e.g.
+*   remaps that need task's Python or _hal[] parameters when HAL is
+*   not up. rs274 -E then exits 2 and the program is left unchecked
+*   rather than refused.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "rcs.hh"
+#include "rcs_print.hh"
+#include "emc.hh"
+#include "emc_nml.hh"
+#include "emcglb.h"		// emc_inifile, emc_debug
+#include "canon.hh"		// GET_EXTERNAL_PARAMETER_FILE_NAME
+#include "inifile.hh"
+#include "task.hh"
+#include "config.h"
+#include "hal.h"
+#include "hal/hal_priv.h"
+
+int emcTaskPreflightEnable = 0;
+
+static pid_t preflightPid = 0;
+static int preflightFd = -1;
+static int preflightResult = EMC_TASK_PREFLIGHT_NONE;
+static std::string preflightFile;
+static std::string preflightMessage;
+static std::string preflightVarFile, preflightToolTable, preflightToolDatabase;
+static size_t preflightVarHash, preflightToolHash;
+
+// task rewrites the parameter file on every synch, so compare what is
+// in it rather than when it was written
+static size_t contentHash(const std::string &path)
+{
+    std::string content;
+    char buf[4096];
+    size_t n;
+
+    FILE *f = path.empty() ? NULL : fopen(path.c_str(), "r");
+    if (!f) {
+	return 0;
+    }
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0) {
+	content.append(buf, n);
+    }
+    fclose(f);
+    return std::hash<std::string>()(content);
+}
+
+// the tools the check was given, from the tool table or the database;
+// changes to a database in WAL mode land in the -wal file first
+static size_t toolHash()
+{
+    if (!preflightToolDatabase.empty()) {
+	return contentHash(preflightToolDatabase) * 31 +
+	    contentHash(preflightToolDatabase + "-wal");
+    }
+    return contentHash(preflightToolTable);
+}
+
+static void addValue(std::vector<std::string> &settings, const char *name,
+		     hal_type_t type, const hal_data_u *value)
+{
+    char buf[HAL_NAME_LEN + 40];
+
+    switch (type) {
+    case HAL_BIT: snprintf(buf, sizeof(buf), "%s=%d", name, value->b); break;
+    case HAL_U32: snprintf(buf, sizeof(buf), "%s=%u", name, (unsigned) value->u); break;
+    case HAL_S32: snprintf(buf, sizeof(buf), "%s=%d", name, (int) value->s); break;
+    case HAL_FLOAT: snprintf(buf, sizeof(buf), "%s=%.17g", name, (double) value->f); break;
+    default: return;
+    }
+    settings.push_back(buf);
+}
+
+// the pins and parameters of the kinematics module, [KINS]KINEMATICS,
+// as name=value
+static void kinsSettings(IniFile &inifile, std::vector<std::string> &settings)
+{
+    const char *inistring = inifile.Find("KINEMATICS", "KINS");
+    std::string module;
+
+    if (!inistring || !hal_data) {
+	return;
+    }
+    std::istringstream(inistring) >> module;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    hal_comp_t *comp = halpr_find_comp_by_name(module.c_str());
+    if (comp) {
+	for (hal_pin_t *pin = halpr_find_pin_by_owner(comp, 0); pin;
+	     pin = halpr_find_pin_by_owner(comp, pin)) {
+	    hal_data_u *value = &pin->dummysig;
+	    if (pin->signal) {
+		hal_sig_t *sig = (hal_sig_t *) SHMPTR(pin->signal);
+		value = (hal_data_u *) SHMPTR(sig->data_ptr);
+	    }
+	    addValue(settings, pin->name, pin->type, value);
+	}
+	for (hal_param_t *param = halpr_find_param_by_owner(comp, 0); param;
+	     param = halpr_find_param_by_owner(comp, param)) {
+	    addValue(settings, param->name, param->type,
+		     (hal_data_u *) SHMPTR(param->data_ptr));
+	}
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+}
+
+static void preflightKill()
+{
+    if (preflightPid > 0) {
+	kill(preflightPid, SIGTERM);
+	waitpid(preflightPid, NULL, 0);
+    }
+    if (preflightFd >= 0) {
+	close(preflightFd);
+    }
+    preflightPid = 0;
+    preflightFd = -1;
+}
+
+int emcTaskPreflightStart(const char *file)
+{
+    char varfile[LINELEN];
+    int fds[2];
+
+    preflightKill();
+    preflightResult = EMC_TASK_PREFLIGHT_NONE;
+    preflightMessage.clear();
+    if (!emcTaskPreflightEnable || file == NULL || file[0] == 0) {
+	return 0;
+    }
+
+    GET_EXTERNAL_PARAMETER_FILE_NAME(varfile, LINELEN);
+    preflightVarFile = varfile;
+    preflightToolTable.clear();
+    preflightToolDatabase.clear();
+    std::vector<std::string> settings;
+    IniFile inifile;
+    if (inifile.Open(emc_inifile)) {
+	const char *inistring = inifile.Find("TOOL_TABLE", "EMCIO");
+	if (inistring) {
+	    preflightToolTable = inistring;
+	}
+	inistring = inifile.Find("TOOL_DATABASE", "EMCIO");
+	if (inistring) {
+	    preflightToolDatabase = inistring;
+	}
+	kinsSettings(inifile, settings);
+	inifile.Close();
+    }
+    preflightFile = file;
+    preflightVarHash = contentHash(preflightVarFile);
+    preflightToolHash = toolHash();
+
+    // built before the fork, since the child of a threaded task must
+    // not allocate
+    std::vector<const char *> argv;
+    argv.push_back(EMC2_BIN_DIR "/rs274");
+    argv.push_back("-E");
+    argv.push_back("-i");
+    argv.push_back(emc_inifile);
+    if (!preflightVarFile.empty()) {
+	argv.push_back("-v");
+	argv.push_back(preflightVarFile.c_str());
+    }
+    if (!preflightToolDatabase.empty()) {
+	argv.push_back("-D");
+	argv.push_back(preflightToolDatabase.c_str());
+    } else if (!preflightToolTable.empty()) {
+	argv.push_back("-t");
+	argv.push_back(preflightToolTable.c_str());
+    }
+    for (size_t i = 0; i < settings.size(); i++) {
+	argv.push_back("-K");
+	argv.push_back(settings[i].c_str());
+    }
+    argv.push_back(file);
+    argv.push_back(NULL);
+
+    if (pipe(fds) != 0) {
+	rcs_print_error("emcTaskPreflightStart: pipe: %s\n", strerror(errno));
+	return -1;
+    }
+
+    preflightPid = fork();
+    if (preflightPid == -1) {
+	rcs_print_error("emcTaskPreflightStart: fork: %s\n", strerror(errno));
+	close(fds[0]);
+	close(fds[1]);
+	preflightPid = 0;
+	return -1;
+    }
+
+    if (preflightPid == 0) {
+	// the envelope goes to stdout, the verdict to stderr
+	int devnull = open("/dev/null", O_RDWR);
+	dup2(devnull, 0);
+	dup2(devnull, 1);
+	dup2(fds[1], 2);
+	close(fds[0]);
+	close(fds[1]);
+	execv(argv[0], (char *const *) &argv[0]);
+	fprintf(stderr, "can't execute %s: %s\n", argv[0], strerror(errno));
+	_exit(2);
+    }
+
+    close(fds[1]);
+    preflightFd = fds[0];
+    fcntl(preflightFd, F_SETFL, O_NONBLOCK);
+    preflightResult = EMC_TASK_PREFLIGHT_RUNNING;
+    if (emc_debug & EMC_DEBUG_TASK_ISSUE) {
+	rcs_print("emcTaskPreflightStart(%s): pid %d\n", file, preflightPid);
+    }
+    return 0;
+}
+
+int emcTaskPreflightPoll()
+{
+    char buf[256];
+    ssize_t n;
+    int status;
+
+    if (preflightResult != EMC_TASK_PREFLIGHT_RUNNING) {
+	return preflightResult;
+    }
+
+    // drain the pipe so the child never blocks on it
+    while ((n = read(preflightFd, buf, sizeof(buf))) > 0) {
+	preflightMessage.append(buf, n);
+    }
+
+    pid_t pid = waitpid(preflightPid, &status, WNOHANG);
+    if (pid == 0) {
+	return preflightResult;
+    }
+    while ((n = read(preflightFd, buf, sizeof(buf))) > 0) {
+	preflightMessage.append(buf, n);
+    }
+    close(preflightFd);
+    preflightFd = -1;
+    preflightPid = 0;
+
+    if (pid == -1 || !WIFEXITED(status)) {
+	preflightResult = EMC_TASK_PREFLIGHT_UNCHECKED;
+	if (preflightMessage.empty()) {
+	    preflightMessage = "program check did not finish";
+	}
+    } else if (WEXITSTATUS(status) == 0) {
+	preflightResult = EMC_TASK_PREFLIGHT_PASSED;
+    } else if (WEXITSTATUS(status) == 1) {
+	preflightResult = EMC_TASK_PREFLIGHT_FAILED;
+    } else {
+	preflightResult = EMC_TASK_PREFLIGHT_UNCHECKED;
+    }
+    while (!preflightMessage.empty() &&
+	   preflightMessage[preflightMessage.size() - 1] == '\n') {
+	preflightMessage.erase(preflightMessage.size() - 1);
+    }
+    if (emc_debug & EMC_DEBUG_TASK_ISSUE) {
+	rcs_print("emcTaskPreflightPoll(%s): %s\n", preflightFile.c_str(),
+		  preflightResult == EMC_TASK_PREFLIGHT_PASSED ? "passed" :
+		  preflightResult == EMC_TASK_PREFLIGHT_FAILED ? "failed" :
+		  "unchecked");
+    }
+    return preflightResult;
+}
+
+int emcTaskPreflightCheck(const char *file)
+{
+    if (!emcTaskPreflightEnable) {
+	return EMC_TASK_PREFLIGHT_PASSED;
+    }
+    // offsets or tools changed since the check started, so its
+    // answer is stale
+    if (preflightResult == EMC_TASK_PREFLIGHT_NONE ||
+	preflightFile != file ||
+	preflightVarHash != contentHash(preflightVarFile) ||
+	preflightToolHash != toolHash()) {
+	if (emcTaskPreflightStart(file) != 0) {
+	    preflightMessage = "could not start the check";
+	    return EMC_TASK_PREFLIGHT_UNCHECKED;
+	}
+    }
+    return emcTaskPreflightPoll();
+}
+
+const char *emcTaskPreflightMessage()
+{
+    return preflightMessage.c_str();
+}
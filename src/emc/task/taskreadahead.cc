@@ -0,0 +1,333 @@
+/********************************************************************
+* Description: taskreadahead.cc
+*   Runs the interpreter's read-ahead on a thread of its own
+*
+*   With [TASK]READAHEAD_THREAD set, task hands the interpreter to
+*   this thread to read and execute lines while it carries on handling
+*   commands, updating status and feeding motion, so a slow remap or a
+*   long subroutine no longer holds all of that up.  Canon appends to
+*   interp_list, which task takes from without locking; the commands
+*   of a line are published together once the line has executed.
+*
+*   The interpreter, and Python with it, belongs to one thread at a
+*   time.  A job reads lines until enough is queued, then gives both
+*   back and task looks at how the last line went, as the read-ahead in
+*   the task loop does.  A job also ends on a queue buster (M66,
+*   probing, tool changes and the like), an error or the end of the
+*   program, and task does the synch.  Task can take the interpreter
+*   back sooner: the job then stops after the line it is on and task
+*   waits for that.  It does so before the commands that use the
+*   interpreter (see emctaskmain.cc) and on abort.
+*
+*   The interpreter still reads a few words of emcStatus, like the
+*   motion position on a synch, which task changes meanwhile.  These
+*   are at most a cycle old, as they were before.
+*
+* License: GPL Version 2
+* System: Linux
+*
+********************************************************************/
+
+#include <Python.h>
+#include <pthread.h>
+#include <string.h>
+
+#include <atomic>
+
+#include "rcs.hh"
+#include "rcs_print.hh"
+#include "emc.hh"
+#include "emc_nml.hh"
+#include "emcglb.h"		// emc_debug
+#include "interpl.hh"		// interp_list
+#include "interp_return.hh"	// INTERP_OK etc.
+#include "task.hh"
+#include "mottrace.h"		// EMCMOT_TRACE_READ
+#include "usrmotintf.h"		// usrmotTrace()
+
+int emcTaskReadaheadThread = 0;
+
+enum {
+    JOB_IDLE,			// task has the interpreter
+    JOB_RUNNING,		// the thread has it
+    JOB_DONE,			// the thread is done with it, task takes it back
+};
+
+static pthread_t thread;
+static bool threadStarted = false;
+static pthread_mutex_t jobLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t jobCond = PTHREAD_COND_INITIALIZER;
+static std::atomic<int> jobState(JOB_IDLE);
+static std::atomic<bool> jobStop(false);
+static bool threadQuit = false;
+static PyThreadState *taskPythonState = NULL;
+
+// what the job was asked to do, and how its last line went
+static int jobMaxLen;
+static double jobMaxTime;
+static int jobReadRetval;
+static int jobExecRetval;
+
+// the interpreter as of the last line, for task's status
+static pthread_mutex_t statusLock = PTHREAD_MUTEX_INITIALIZER;
+static EMC_TASK_STAT jobStatus;
+
+static void jobUpdateStatus(void)
+{
+    pthread_mutex_lock(&statusLock);
+    jobStatus.readLine = emcTaskPlanLine();
+    jobStatus.callLevel = emcTaskPlanLevel();
+    emcTaskPlanActiveCodes(&jobStatus);
+    pthread_mutex_unlock(&statusLock);
+}
+
+static bool jobWanted(int lines)
+{
+    if (jobStop.load(std::memory_order_relaxed) || lines >= jobMaxLen ||
+	interp_list.len() > jobMaxLen) {
+	return false;
+    }
+    return jobMaxTime <= 0 || interp_list.time() < jobMaxTime;
+}
+
+// reads and executes lines until enough is queued or a line needs task
+static void readaheadJob(void)
+{
+    int lines = 0;
+
+    jobReadRetval = INTERP_OK;
+    jobExecRetval = INTERP_OK;
+    interp_list.hold(true);
+    do {
+	jobReadRetval = emcTaskPlanRead();
+	if (jobReadRetval > INTERP_MIN_ERROR
+	    || jobReadRetval == INTERP_ENDFILE
+	    || jobReadRetval == INTERP_EXIT
+	    || jobReadRetval == INTERP_EXECUTE_FINISH) {
+	    break;
+	}
+	usrmotTrace(EMCMOT_TRACE_READ, emcTaskPlanLine());
+	pthread_mutex_lock(&statusLock);
+	jobStatus.readLine = emcTaskPlanLine();
+	emcTaskPlanCommand(jobStatus.command);
+	pthread_mutex_unlock(&statusLock);
+
+	jobExecRetval = emcTaskPlanExecute(0);
+	if (jobExecRetval > INTERP_MIN_ERROR) {
+	    // none of a line that failed is run
+	    interp_list.discard();
+	} else {
+	    interp_list.publish();
+	}
+	jobUpdateStatus();
+	if (jobExecRetval != INTERP_OK) {
+	    break;
+	}
+	emcTaskPlanCheckpoint();
+	lines++;
+    } while (jobWanted(lines));
+    interp_list.hold(false);
+}
+
+static void *readaheadMain(void *arg)
+{
+    (void) arg;
+    pthread_mutex_lock(&jobLock);
+    while (true) {
+	while (jobState != JOB_RUNNING && !threadQuit) {
+	    pthread_cond_wait(&jobCond, &jobLock);
+	}
+	if (threadQuit) {
+	    break;
+	}
+	pthread_mutex_unlock(&jobLock);
+
+	PyGILState_STATE gil = PyGILState_UNLOCKED;
+	if (Py_IsInitialized()) {
+	    gil = PyGILState_Ensure();
+	}
+	readaheadJob();
+	if (Py_IsInitialized()) {
+	    PyGILState_Release(gil);
+	}
+
+	pthread_mutex_lock(&jobLock);
+	jobState = JOB_DONE;
+	pthread_cond_broadcast(&jobCond);
+    }
+    pthread_mutex_unlock(&jobLock);
+    return NULL;
+}
+
+int emcTaskReadaheadInit()
+{
+    if (!emcTaskReadaheadThread || threadStarted) {
+	return 0;
+    }
+    if (emcTaskPythonMethods) {
+	// those are called all through the task cycle, and need Python
+	rcs_print("emcTaskReadaheadInit: task methods are in Python, "
+		  "reading ahead in the task loop\n");
+	emcTaskReadaheadThread = 0;
+	return 0;
+    }
+#if PY_VERSION_HEX < 0x03070000
+    if (Py_IsInitialized()) {
+	PyEval_InitThreads();
+    }
+#endif
+    if (pthread_create(&thread, NULL, readaheadMain, NULL) != 0) {
+	rcs_print_error("emcTaskReadaheadInit: can't start thread, "
+			"reading ahead in the task loop\n");
+	emcTaskReadaheadThread = 0;
+	return -1;
+    }
+    threadStarted = true;
+    if (emc_debug & EMC_DEBUG_INTERP) {
+	rcs_print("emcTaskReadaheadInit: interpreter reads ahead on a thread\n");
+    }
+    return 0;
+}
+
+void emcTaskReadaheadExit()
+{
+    if (!threadStarted) {
+	return;
+    }
+    emcTaskReadaheadStop();
+    pthread_mutex_lock(&jobLock);
+    threadQuit = true;
+    pthread_cond_broadcast(&jobCond);
+    pthread_mutex_unlock(&jobLock);
+    pthread_join(thread, NULL);
+    threadStarted = false;
+}
+
+int emcTaskReadaheadStart(int maxLen, double maxTime)
+{
+    if (!threadStarted || jobState != JOB_IDLE) {
+	return -1;
+    }
+    jobMaxLen = maxLen;
+    jobMaxTime = maxTime;
+    jobStop = false;
+    emcTaskPlanDeferErrors(1);
+    pthread_mutex_lock(&statusLock);
+    jobStatus.readLine = emcStatus->task.readLine;
+    jobStatus.callLevel = emcStatus->task.callLevel;
+    strcpy(jobStatus.command, emcStatus->task.command);
+    emcTaskPlanActiveCodes(&jobStatus);
+    pthread_mutex_unlock(&statusLock);
+
+    // hand over Python along with the interpreter
+    if (Py_IsInitialized()) {
+	taskPythonState = PyEval_SaveThread();
+    }
+    pthread_mutex_lock(&jobLock);
+    jobState = JOB_RUNNING;
+    pthread_cond_broadcast(&jobCond);
+    pthread_mutex_unlock(&jobLock);
+    return 0;
+}
+
+int emcTaskReadaheadBusy()
+{
+    return jobState != JOB_IDLE;
+}
+
+// after the job is done: the interpreter and Python are task's again
+static int takeBack(bool wait)
+{
+    if (jobState == JOB_IDLE) {
+	return 0;
+    }
+    pthread_mutex_lock(&jobLock);
+    while (wait && jobState != JOB_DONE) {
+	pthread_cond_wait(&jobCond, &jobLock);
+    }
+    if (jobState != JOB_DONE) {
+	pthread_mutex_unlock(&jobLock);
+	return 0;
+    }
+    jobState = JOB_IDLE;
+    pthread_mutex_unlock(&jobLock);
+
+    if (taskPythonState != NULL) {
+	PyEval_RestoreThread(taskPythonState);
+	taskPythonState = NULL;
+    }
+    return 1;
+}
+
+// what the read-ahead in the task loop does after each line, for the
+// line the job stopped at
+static void applyResult(void)
+{
+    EMC_TASK_PLAN_SYNCH taskPlanSynchCmd;
+
+    emcTaskPlanDeferErrors(0);
+    emcTaskReadaheadStatus(&emcStatus->task);
+
+    if (jobReadRetval > INTERP_MIN_ERROR
+	|| jobReadRetval == INTERP_ENDFILE
+	|| jobReadRetval == INTERP_EXIT
+	|| jobReadRetval == INTERP_EXECUTE_FINISH) {
+	emcStatus->task.interpState = EMC_TASK_INTERP_WAITING;
+    } else if (jobExecRetval > INTERP_MIN_ERROR) {
+	emcStatus->task.interpState = EMC_TASK_INTERP_WAITING;
+	interp_list.clear();
+	emcAbortCleanup(EMC_ABORT_INTERPRETER_ERROR, "interpreter error");
+    } else if (jobExecRetval == -1 || jobExecRetval == INTERP_EXIT) {
+	emcStatus->task.interpState = EMC_TASK_INTERP_WAITING;
+    } else if (jobExecRetval == INTERP_EXECUTE_FINISH) {
+	// no more reading until everything outstanding is done
+	emcTaskPlanSetWait();
+	// and resynch interp WM
+	emcTaskQueueCommand(&taskPlanSynchCmd);
+    } else if (jobExecRetval != INTERP_OK) {
+	// end of file
+	emcStatus->task.interpState = EMC_TASK_INTERP_WAITING;
+	emcStatus->task.motionLine = 0;
+	emcStatus->task.readLine = 0;
+    }
+}
+
+int emcTaskReadaheadPoll()
+{
+    if (!takeBack(false)) {
+	return 0;
+    }
+    applyResult();
+    return 1;
+}
+
+int emcTaskReadaheadFinish()
+{
+    jobStop = true;
+    if (!takeBack(true)) {
+	return 0;
+    }
+    applyResult();
+    return 1;
+}
+
+void emcTaskReadaheadStop()
+{
+    jobStop = true;
+    if (takeBack(true)) {
+	// the caller is aborting, so there is nothing to report but errors
+	emcTaskPlanDeferErrors(0);
+    }
+}
+
+void emcTaskReadaheadStatus(EMC_TASK_STAT * stat)
+{
+    pthread_mutex_lock(&statusLock);
+    stat->readLine = jobStatus.readLine;
+    stat->callLevel = jobStatus.callLevel;
+    strcpy(stat->command, jobStatus.command);
+    memcpy(stat->activeGCodes, jobStatus.activeGCodes, sizeof(stat->activeGCodes));
+    memcpy(stat->activeMCodes, jobStatus.activeMCodes, sizeof(stat->activeMCodes));
+    memcpy(stat->activeSettings, jobStatus.activeSettings, sizeof(stat->activeSettings));
+    pthread_mutex_unlock(&statusLock);
+}
@@ -0,0 +1,489 @@
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#include <stdio.h>
+#include <string.h>
+#include <sqlite3.h>
+#include "toolstore.hh"
+
+// same as sql/schema-simple.sql, less the sample tools
+static const char schema[] =
+    "CREATE TABLE IF NOT EXISTS \"tools\" ("
+    " toolno INTEGER PRIMARY KEY,"
+    " pocket INTEGER,"
+    " diameter REAL DEFAULT (0.0),"
+    " backangle REAL DEFAULT (0.0),"
+    " frontangle REAL DEFAULT (0.0),"
+    " orientation INTEGER DEFAULT (0.0),"
+    " comment TEXT DEFAULT (NULL),"
+    " x_offset REAL DEFAULT (0.0),"
+    " y_offset REAL DEFAULT (0.0),"
+    " z_offset REAL DEFAULT (0.0),"
+    " a_offset REAL DEFAULT (0.0),"
+    " b_offset REAL DEFAULT (0.0),"
+    " c_offset REAL DEFAULT (0.0),"
+    " u_offset REAL DEFAULT (0.0),"
+    " v_offset REAL DEFAULT (0.0),"
+    " w_offset REAL DEFAULT (0.0));"
+    "CREATE TABLE IF NOT EXISTS \"state\" ("
+    " toolno INTEGER,"
+    " pocket INTEGER);";
+
+#define TOOL_COLUMNS "toolno, pocket, diameter, backangle, frontangle, " \
+    "orientation, comment, x_offset, y_offset, z_offset, a_offset, " \
+    "b_offset, c_offset, u_offset, v_offset, w_offset"
+
+ToolStore::ToolStore()
+    : db(NULL), put_stmt(NULL), remove_stmt(NULL), version(0),
+      spindle_toolno(0), spindle_pocketno(0)
+{
+}
+
+ToolStore::~ToolStore()
+{
+    close();
+}
+
+/*
+  Opens the database, creating it and its tables if need be, and loads it.
+  Returns 0 on success, -1 on error.
+*/
+int ToolStore::open(const char *filename, bool readonly)
+{
+    int flags = readonly ? SQLITE_OPEN_READONLY
+                         : SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE;
+
+    close();
+    if (sqlite3_open_v2(filename, &db, flags, NULL) != SQLITE_OK) {
+        fprintf(stderr, "toolstore: can't open %s: %s\n", filename,
+                db ? sqlite3_errmsg(db) : "out of memory");
+        close();
+        return -1;
+    }
+    // wait for a writer rather than failing
+    sqlite3_busy_timeout(db, 1000);
+    if (!readonly) {
+        // so readers in other processes never block the writer, or it them
+        if (exec("PRAGMA journal_mode=WAL") || exec(schema)) {
+            close();
+            return -1;
+        }
+        if (sqlite3_prepare_v2(db,
+                "INSERT OR REPLACE INTO tools (" TOOL_COLUMNS ")"
+                " VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?)",
+                -1, &put_stmt, NULL) != SQLITE_OK ||
+            sqlite3_prepare_v2(db, "DELETE FROM tools WHERE toolno = ?",
+                -1, &remove_stmt, NULL) != SQLITE_OK) {
+            fprintf(stderr, "toolstore: %s\n", sqlite3_errmsg(db));
+            close();
+            return -1;
+        }
+    }
+    if (load()) {
+        close();
+        return -1;
+    }
+    return 0;
+}
+
+void ToolStore::close()
+{
+    sqlite3_finalize(put_stmt);
+    sqlite3_finalize(remove_stmt);
+    put_stmt = remove_stmt = NULL;
+    sqlite3_close(db);
+    db = NULL;
+    tools.clear();
+    pockets.clear();
+    spindle_toolno = spindle_pocketno = 0;
+}
+
+int ToolStore::exec(const char *sql)
+{
+    char *err = NULL;
+
+    if (sqlite3_exec(db, sql, NULL, NULL, &err) != SQLITE_OK) {
+        fprintf(stderr, "toolstore: %s\n", err ? err : sqlite3_errmsg(db));
+        sqlite3_free(err);
+        return -1;
+    }
+    return 0;
+}
+
+int ToolStore::begin()
+{
+    return exec("BEGIN IMMEDIATE");
+}
+
+int ToolStore::commit()
+{
+    return exec("COMMIT");
+}
+
+void ToolStore::rollback()
+{
+    if (!sqlite3_get_autocommit(db))
+        exec("ROLLBACK");
+}
+
+// changes whenever another connection commits to the database
+int ToolStore::data_version()
+{
+    sqlite3_stmt *stmt;
+    int v = -1;
+
+    if (sqlite3_prepare_v2(db, "PRAGMA data_version", -1, &stmt, NULL) != SQLITE_OK)
+        return -1;
+    if (sqlite3_step(stmt) == SQLITE_ROW)
+        v = sqlite3_column_int(stmt, 0);
+    sqlite3_finalize(stmt);
+    return v;
+}
+
+void ToolStore::index(const entry &e)
+{
+    if (e.tool.pocketno >= 0)
+        pockets[e.tool.pocketno] = e.tool.toolno;
+}
+
+void ToolStore::unindex(const entry &e)
+{
+    std::map<int, int>::iterator p = pockets.find(e.tool.pocketno);
+
+    if (p != pockets.end() && p->second == e.tool.toolno)
+        pockets.erase(p);
+}
+
+/*
+  Reads every tool from the database, replacing what was in memory.
+  Returns 0 on success, -1 on error.
+*/
+int ToolStore::load()
+{
+    sqlite3_stmt *stmt;
+    int rc;
+
+    if (!db)
+        return -1;
+    tools.clear();
+    pockets.clear();
+    version = data_version();
+
+    if (sqlite3_prepare_v2(db, "SELECT " TOOL_COLUMNS " FROM tools", -1,
+            &stmt, NULL) != SQLITE_OK) {
+        fprintf(stderr, "toolstore: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+    while ((rc = sqlite3_step(stmt)) == SQLITE_ROW) {
+        entry e;
+        CANON_TOOL_TABLE &t = e.tool;
+        const unsigned char *comment;
+
+        t.toolno = sqlite3_column_int(stmt, 0);
+        t.pocketno = sqlite3_column_type(stmt, 1) == SQLITE_NULL ? -1
+                   : sqlite3_column_int(stmt, 1);
+        t.diameter = sqlite3_column_double(stmt, 2);
+        t.backangle = sqlite3_column_double(stmt, 3);
+        t.frontangle = sqlite3_column_double(stmt, 4);
+        t.orientation = sqlite3_column_int(stmt, 5);
+        if ((comment = sqlite3_column_text(stmt, 6)) != NULL)
+            e.comment = (const char *) comment;
+        t.offset.tran.x = sqlite3_column_double(stmt, 7);
+        t.offset.tran.y = sqlite3_column_double(stmt, 8);
+        t.offset.tran.z = sqlite3_column_double(stmt, 9);
+        t.offset.a = sqlite3_column_double(stmt, 10);
+        t.offset.b = sqlite3_column_double(stmt, 11);
+        t.offset.c = sqlite3_column_double(stmt, 12);
+        t.offset.u = sqlite3_column_double(stmt, 13);
+        t.offset.v = sqlite3_column_double(stmt, 14);
+        t.offset.w = sqlite3_column_double(stmt, 15);
+
+        if (t.pocketno >= 0 && pockets.count(t.pocketno)) {
+            fprintf(stderr, "toolstore: tool %d and tool %d are both in pocket %d,"
+                    " ignoring the pocket of tool %d\n",
+                    pockets[t.pocketno], t.toolno, t.pocketno, t.toolno);
+            t.pocketno = -1;
+        }
+        tools[t.toolno] = e;
+        index(e);
+    }
+    sqlite3_finalize(stmt);
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "toolstore: %s\n", sqlite3_errmsg(db));
+        return -1;
+    }
+
+    spindle_toolno = spindle_pocketno = 0;
+    if (sqlite3_prepare_v2(db, "SELECT toolno, pocket FROM state", -1,
+            &stmt, NULL) == SQLITE_OK) {
+        if (sqlite3_step(stmt) == SQLITE_ROW) {
+            spindle_toolno = sqlite3_column_int(stmt, 0);
+            spindle_pocketno = sqlite3_column_int(stmt, 1);
+        }
+        sqlite3_finalize(stmt);
+    }
+    return 0;
+}
+
+/*
+  Loads the database again if another process has written to it since it
+  was last read. Returns 0 on success, -1 on error.
+*/
+int ToolStore::refresh()
+{
+    if (!db)
+        return -1;
+    if (data_version() == version)
+        return 0;
+    return load();
+}
+
+const CANON_TOOL_TABLE *ToolStore::find_tool(int toolno) const
+{
+    std::map<int, entry>::const_iterator t = tools.find(toolno);
+
+    return t == tools.end() ? NULL : &t->second.tool;
+}
+
+const CANON_TOOL_TABLE *ToolStore::find_pocket(int pocket) const
+{
+    std::map<int, int>::const_iterator p = pockets.find(pocket);
+
+    return p == pockets.end() ? NULL : find_tool(p->second);
+}
+
+const char *ToolStore::comment(int toolno) const
+{
+    std::map<int, entry>::const_iterator t = tools.find(toolno);
+
+    return t == tools.end() ? NULL : t->second.comment.c_str();
+}
+
+int ToolStore::write(const entry &e)
+{
+    const CANON_TOOL_TABLE &t = e.tool;
+    int rc;
+
+    sqlite3_reset(put_stmt);
+    sqlite3_bind_int(put_stmt, 1, t.toolno);
+    if (t.pocketno >= 0)
+        sqlite3_bind_int(put_stmt, 2, t.pocketno);
+    else
+        sqlite3_bind_null(put_stmt, 2);
+    sqlite3_bind_double(put_stmt, 3, t.diameter);
+    sqlite3_bind_double(put_stmt, 4, t.backangle);
+    sqlite3_bind_double(put_stmt, 5, t.frontangle);
+    sqlite3_bind_int(put_stmt, 6, t.orientation);
+    if (e.comment.empty())
+        sqlite3_bind_null(put_stmt, 7);
+    else
+        sqlite3_bind_text(put_stmt, 7, e.comment.c_str(), -1, SQLITE_TRANSIENT);
+    sqlite3_bind_double(put_stmt, 8, t.offset.tran.x);
+    sqlite3_bind_double(put_stmt, 9, t.offset.tran.y);
+    sqlite3_bind_double(put_stmt, 10, t.offset.tran.z);
+    sqlite3_bind_double(put_stmt, 11, t.offset.a);
+    sqlite3_bind_double(put_stmt, 12, t.offset.b);
+    sqlite3_bind_double(put_stmt, 13, t.offset.c);
+    sqlite3_bind_double(put_stmt, 14, t.offset.u);
+    sqlite3_bind_double(put_stmt, 15, t.offset.v);
+    sqlite3_bind_double(put_stmt, 16, t.offset.w);
+    rc = sqlite3_step(put_stmt);
+    sqlite3_reset(put_stmt);
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "toolstore: can't save tool %d: %s\n", t.toolno,
+                sqlite3_errmsg(db));
+        return -1;
+    }
+    return 0;
+}
+
+/*
+  Adds a tool, or replaces the tool with the same number, and saves it.
+  A NULL comment keeps the comment the tool already has. Fails if another
+  tool is in the pocket. Returns 0 on success, -1 on error.
+*/
+int ToolStore::put(const CANON_TOOL_TABLE &tool, const char *comment)
+{
+    std::map<int, entry>::iterator t;
+    const CANON_TOOL_TABLE *other;
+    entry e;
+
+    if (!put_stmt)
+        return -1;
+    other = find_pocket(tool.pocketno);
+    if (tool.pocketno >= 0 && other && other->toolno != tool.toolno) {
+        fprintf(stderr, "toolstore: can't put tool %d in pocket %d, tool %d is there\n",
+                tool.toolno, tool.pocketno, other->toolno);
+        return -1;
+    }
+    e.tool = tool;
+    t = tools.find(tool.toolno);
+    if (comment)
+        e.comment = comment;
+    else if (t != tools.end())
+        e.comment = t->second.comment;
+    if (write(e))
+        return -1;
+
+    if (t != tools.end()) {
+        unindex(t->second);
+        t->second = e;
+    } else {
+        tools[tool.toolno] = e;
+    }
+    index(e);
+    return 0;
+}
+
+/*
+  Removes a tool. Returns 0 on success, -1 on error.
+*/
+int ToolStore::remove(int toolno)
+{
+    std::map<int, entry>::iterator t = tools.find(toolno);
+    int rc;
+
+    if (!remove_stmt)
+        return -1;
+    if (t == tools.end())
+        return 0;
+    sqlite3_reset(remove_stmt);
+    sqlite3_bind_int(remove_stmt, 1, toolno);
+    rc = sqlite3_step(remove_stmt);
+    sqlite3_reset(remove_stmt);
+    if (rc != SQLITE_DONE) {
+        fprintf(stderr, "toolstore: can't remove tool %d: %s\n", toolno,
+                sqlite3_errmsg(db));
+        return -1;
+    }
+    unindex(t->second);
+    tools.erase(t);
+    return 0;
+}
+
+/*
+  Swaps the tools in two pockets, either of which may be empty, as a
+  random toolchanger does on a tool change. Returns 0 on success, -1 on
+  error.
+*/
+int ToolStore::swap_pockets(int pocket1, int pocket2)
+{
+    std::map<int, int>::iterator p1 = pockets.find(pocket1);
+    std::map<int, int>::iterator p2 = pockets.find(pocket2);
+    entry *e1 = p1 == pockets.end() ? NULL : &tools[p1->second];
+    entry *e2 = p2 == pockets.end() ? NULL : &tools[p2->second];
+
+    if (!put_stmt || pocket1 < 0 || pocket2 < 0)
+        return -1;
+    if (pocket1 == pocket2)
+        return 0;
+    if (begin())
+        return -1;
+    if (e1) {
+        e1->tool.pocketno = pocket2;
+        if (write(*e1))
+            goto fail;
+    }
+    if (e2) {
+        e2->tool.pocketno = pocket1;
+        if (write(*e2))
+            goto fail;
+    }
+    if (commit())
+        goto fail;
+    pockets.erase(pocket1);
+    pockets.erase(pocket2);
+    if (e1) index(*e1);
+    if (e2) index(*e2);
+    return 0;
+
+fail:
+    rollback();
+    if (e1) e1->tool.pocketno = pocket1;
+    if (e2) e2->tool.pocketno = pocket2;
+    return -1;
+}
+
+/*
+  Records the tool in the spindle and the pocket it came from, so it is
+  known after a restart. Returns 0 on success, -1 on error.
+*/
+int ToolStore::set_spindle(int toolno, int pocket)
+{
+    char sql[128];
+
+    if (!put_stmt)
+        return -1;
+    if (toolno == spindle_toolno && pocket == spindle_pocketno)
+        return 0;
+    snprintf(sql, sizeof(sql),
+             "BEGIN IMMEDIATE; DELETE FROM state;"
+             " INSERT INTO state VALUES (%d, %d); COMMIT", toolno, pocket);
+    if (exec(sql)) {
+        rollback();
+        return -1;
+    }
+    spindle_toolno = toolno;
+    spindle_pocketno = pocket;
+    return 0;
+}
+
+PocketMap::PocketMap() : next(1)
+{
+    for (int i = 0; i < CANON_POCKETS_MAX; i++)
+        pockets[i] = i;
+}
+
+/*
+  The magazine pocket index stands for, -1 if index is out of range.
+*/
+int PocketMap::pocket(int index) const
+{
+    if (index < 0 || index >= CANON_POCKETS_MAX)
+        return -1;
+    return pockets[index];
+}
+
+/*
+  The index standing for pocket, -1 if there is none.
+*/
+int PocketMap::index(int pocket) const
+{
+    for (int i = 0; i < CANON_POCKETS_MAX; i++) {
+        if (pockets[i] == pocket)
+            return i;
+    }
+    return -1;
+}
+
+/*
+  The index standing for pocket, giving it the next index in turn if it
+  has none. keep1 and keep2 are indices still in use that must not be
+  given away. Returns -1 if pocket is not a magazine pocket.
+*/
+int PocketMap::assign(int pocket, int keep1, int keep2)
+{
+    int i = index(pocket);
+
+    if (i >= 0 || pocket <= 0)
+        return i;
+    for (int n = 1; n < CANON_POCKETS_MAX; n++) {
+        i = next;
+        next = next % (CANON_POCKETS_MAX - 1) + 1;
+        if (i != keep1 && i != keep2) {
+            pockets[i] = pocket;
+            return i;
+        }
+    }
+    return -1;
+}
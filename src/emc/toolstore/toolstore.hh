@@ -0,0 +1,112 @@
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+#ifndef TOOLSTORE_HH
+#define TOOLSTORE_HH
+
+#include <map>
+#include <string>
+#include "emctool.h"
+
+struct sqlite3;
+struct sqlite3_stmt;
+
+/*
+  A tool database of any size, kept in an sqlite file with the layout of
+  sql/schema-simple.sql: one row per tool in "tools", and the tool in the
+  spindle in "state".
+
+  All tools are read into memory and indexed by tool number and by pocket,
+  so lookups are O(log n). Each change writes only the rows it touches.
+
+  A tool with a negative pocket number (NULL in the database) is known
+  but not in the magazine. Pocket 0 is the spindle on random toolchangers.
+  No two tools share a pocket.
+
+  Several processes may open the same file; one of them (iocontrol) writes
+  and the others open it read only and call refresh() before looking
+  something up.
+*/
+class ToolStore {
+public:
+    ToolStore();
+    ~ToolStore();
+
+    int open(const char *filename, bool readonly = false);
+    void close();
+    bool is_open() const { return db != NULL; }
+
+    int load();
+    int refresh();
+
+    const CANON_TOOL_TABLE *find_tool(int toolno) const;
+    const CANON_TOOL_TABLE *find_pocket(int pocket) const;
+    const char *comment(int toolno) const;
+    int size() const { return tools.size(); }
+
+    int put(const CANON_TOOL_TABLE &tool, const char *comment = NULL);
+    int remove(int toolno);
+    int swap_pockets(int pocket1, int pocket2);
+
+    int spindle_tool() const { return spindle_toolno; }
+    int spindle_pocket() const { return spindle_pocketno; }
+    int set_spindle(int toolno, int pocket);
+
+    int begin();
+    int commit();
+    void rollback();
+
+private:
+    struct entry {
+        CANON_TOOL_TABLE tool;
+        std::string comment;
+    };
+
+    int exec(const char *sql);
+    int write(const entry &e);
+    int data_version();
+    void index(const entry &e);
+    void unindex(const entry &e);
+
+    sqlite3 *db;
+    sqlite3_stmt *put_stmt;
+    sqlite3_stmt *remove_stmt;
+    int version;
+    int spindle_toolno;
+    int spindle_pocketno;
+    std::map<int, entry> tools;		// by tool number
+    std::map<int, int> pockets;		// pocket -> tool number
+};
+
+/*
+  The interpreter, task and iocontrol address tools by their index in a
+  table of CANON_POCKETS_MAX entries, index 0 being the spindle. A tool
+  database may have more pockets than that, so PocketMap says which
+  magazine pocket each index stands for. Index n stands for pocket n
+  until a tool in a pocket with no index is asked for; that pocket then
+  takes over the indices in turn.
+*/
+class PocketMap {
+public:
+    PocketMap();
+
+    int pocket(int index) const;
+    int index(int pocket) const;
+    int assign(int pocket, int keep1 = -1, int keep2 = -1);
+
+private:
+    int pockets[CANON_POCKETS_MAX];
+    int next;
+};
+
+#endif
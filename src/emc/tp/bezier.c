@@ -0,0 +1,261 @@
+/********************************************************************
+ * Description: bezier.c
+ *
+ * Curvature-continuous corner blends built from quintic Bezier curves.
+ *
+ * License: GPL Version 2
+ * System: Linux
+ *
+ ********************************************************************/
+
+#include "posemath.h"
+#include "bezier.h"
+#include "tp_types.h"
+#include "rtapi_math.h"
+
+#include "tp_debug.h"
+
+/*
+ * Inner control points by turn angle. For each angle, a and b were chosen
+ * to give the lowest peak curvature for a given deviation from the corner,
+ * which is what limits the cornering speed within a path tolerance. The
+ * result comes within a few percent of a circular arc, the best any curve
+ * can do, while keeping the curvature continuous where the blend meets the
+ * lines.
+ */
+#define BEZIER_SHAPE_ROWS 13
+static const double shape_angle[BEZIER_SHAPE_ROWS] = {
+    1, 15, 30, 45, 60, 75, 90, 105, 120, 135, 150, 165, 179
+};
+static const double shape_a[BEZIER_SHAPE_ROWS] = {
+    0.79, 0.82, 0.82, 0.80, 0.83, 0.80, 0.82, 0.84, 0.85, 0.91, 0.93, 0.96, 0.99
+};
+static const double shape_b[BEZIER_SHAPE_ROWS] = {
+    0.27, 0.27, 0.28, 0.30, 0.32, 0.35, 0.39, 0.44, 0.50, 0.59, 0.69, 0.82, 0.98
+};
+
+static void bezierDeriv(BezierBlend const * const bez, double u,
+        PmCartesian * const d1, PmCartesian * const d2)
+{
+    PmCartesian const * const c = bez->c;
+
+    d1->x = c[1].x + u * (2 * c[2].x + u * (3 * c[3].x + u * (4 * c[4].x + u * 5 * c[5].x)));
+    d1->y = c[1].y + u * (2 * c[2].y + u * (3 * c[3].y + u * (4 * c[4].y + u * 5 * c[5].y)));
+    d1->z = c[1].z + u * (2 * c[2].z + u * (3 * c[3].z + u * (4 * c[4].z + u * 5 * c[5].z)));
+    if (d2) {
+        d2->x = 2 * c[2].x + u * (6 * c[3].x + u * (12 * c[4].x + u * 20 * c[5].x));
+        d2->y = 2 * c[2].y + u * (6 * c[3].y + u * (12 * c[4].y + u * 20 * c[5].y));
+        d2->z = 2 * c[2].z + u * (6 * c[3].z + u * (12 * c[4].z + u * 20 * c[5].z));
+    }
+}
+
+static double bezierSpeed(BezierBlend const * const bez, double u)
+{
+    PmCartesian d1;
+    double mag;
+
+    bezierDeriv(bez, u, &d1, NULL);
+    pmCartMag(&d1, &mag);
+    return mag;
+}
+
+/** Arc length between u0 and u1, by 3 point Gauss-Legendre quadrature. */
+static double bezierArcLength(BezierBlend const * const bez, double u0, double u1)
+{
+    double h = 0.5 * (u1 - u0);
+    double m = 0.5 * (u1 + u0);
+    double x = h * 0.7745966692414834;
+
+    return h * (8.0 / 9.0 * bezierSpeed(bez, m)
+            + 5.0 / 9.0 * (bezierSpeed(bez, m - x) + bezierSpeed(bez, m + x)));
+}
+
+/**
+ * Find the blend shape for a corner with turn angle phi.
+ */
+int bezierShapeFromAngle(BezierShape * const shape, double phi)
+{
+    double deg = phi * 180.0 / PM_PI;
+    int k;
+
+    if (deg <= shape_angle[0]) {
+        shape->a = shape_a[0];
+        shape->b = shape_b[0];
+    } else if (deg >= shape_angle[BEZIER_SHAPE_ROWS - 1]) {
+        shape->a = shape_a[BEZIER_SHAPE_ROWS - 1];
+        shape->b = shape_b[BEZIER_SHAPE_ROWS - 1];
+    } else {
+        for (k = 1; shape_angle[k] < deg; ++k) {
+        }
+        double f = (deg - shape_angle[k - 1]) / (shape_angle[k] - shape_angle[k - 1]);
+        shape->a = shape_a[k - 1] + f * (shape_a[k] - shape_a[k - 1]);
+        shape->b = shape_b[k - 1] + f * (shape_b[k] - shape_b[k - 1]);
+    }
+
+    // By symmetry the middle of the curve is the point closest to the corner
+    shape->deviation = (1.0 + 5.0 * shape->a + 10.0 * shape->b) / 16.0 * sin(phi / 2.0);
+
+    // Build the unit blend in a plane to measure it
+    BezierBlend bez;
+    PmCartesian corner = {0.0, 0.0, 0.0};
+    PmCartesian u1 = {1.0, 0.0, 0.0};
+    PmCartesian u2 = {cos(phi), sin(phi), 0.0};
+    int res = bezierInitFromLines(&bez, &corner, &u1, &u2, 1.0, shape);
+    if (res != TP_ERR_OK) {
+        return res;
+    }
+    bezierLength(&bez, &shape->length);
+
+    // The curve is symmetric, so the peak is found in the first half, then
+    // refined with a parabola through the largest sample and its neighbors.
+    double kappa[BEZIER_CURVATURE_SAMPLES + 1];
+    double du = 0.5 / BEZIER_CURVATURE_SAMPLES;
+    int k_max = 0;
+    for (k = 0; k <= BEZIER_CURVATURE_SAMPLES; ++k) {
+        bezierCurvature(&bez, k * du, &kappa[k]);
+        if (kappa[k] > kappa[k_max]) {
+            k_max = k;
+        }
+    }
+    shape->curvature = kappa[k_max];
+    if (k_max > 0 && k_max < BEZIER_CURVATURE_SAMPLES) {
+        double k0 = kappa[k_max - 1], k1 = kappa[k_max], k2 = kappa[k_max + 1];
+        double denom = k0 - 2.0 * k1 + k2;
+        if (denom < 0.0) {
+            shape->curvature = k1 - pmSq(k2 - k0) / (8.0 * denom);
+        }
+    }
+    tp_debug_print("bezier shape: phi = %f, a = %f, b = %f, deviation = %f, curvature = %f\n",
+            phi, shape->a, shape->b, shape->deviation, shape->curvature);
+
+    if (shape->curvature <= 0.0) {
+        return TP_ERR_GEOM;
+    }
+    return TP_ERR_OK;
+}
+
+/**
+ * Set up a blend for the corner where a line along u1 meets a line along u2.
+ * The blend starts dist before the corner and ends dist after it.
+ */
+int bezierInitFromLines(BezierBlend * const bez, PmCartesian const * const corner,
+        PmCartesian const * const u1, PmCartesian const * const u2,
+        double dist, BezierShape const * const shape)
+{
+    if (dist < TP_POS_EPSILON) {
+        return TP_ERR_GEOM;
+    }
+
+    // Control points relative to the corner, as multiples of u1 and u2
+    double w1[6] = {-1.0, -shape->a, -shape->b, 0, 0, 0};
+    double w2[6] = {0, 0, 0, shape->b, shape->a, 1.0};
+    // Bernstein to power basis for a quintic
+    static const double M[6][6] = {
+        {  1,   0,   0,   0,  0, 0},
+        { -5,   5,   0,   0,  0, 0},
+        { 10, -20,  10,   0,  0, 0},
+        {-10,  30, -30,  10,  0, 0},
+        {  5, -20,  30, -20,  5, 0},
+        { -1,   5, -10,  10, -5, 1},
+    };
+    int i, j;
+
+    for (i = 0; i < 6; ++i) {
+        double s1 = 0, s2 = 0;
+        for (j = 0; j <= i; ++j) {
+            s1 += M[i][j] * w1[j];
+            s2 += M[i][j] * w2[j];
+        }
+        PmCartesian v1, v2;
+        pmCartScalMult(u1, s1 * dist, &v1);
+        pmCartScalMult(u2, s2 * dist, &v2);
+        pmCartCartAdd(&v1, &v2, &bez->c[i]);
+    }
+    pmCartCartAddEq(&bez->c[0], corner);
+
+    bez->s[0] = 0.0;
+    for (i = 0; i < BEZIER_TABLE_SIZE; ++i) {
+        bez->s[i + 1] = bez->s[i] + bezierArcLength(bez,
+                (double)i / BEZIER_TABLE_SIZE,
+                (double)(i + 1) / BEZIER_TABLE_SIZE);
+    }
+
+    bez->uTan = *u1;
+    bez->line_length = 0;
+    return TP_ERR_OK;
+}
+
+/**
+ * Find the point a given distance along the blend.
+ * The arc length table gives a first guess at the curve parameter, which
+ * Newton's method then corrects.
+ */
+int bezierPoint(BezierBlend const * const bez, double progress, PmCartesian * const out)
+{
+    double net_progress = progress - bez->line_length;
+    if (net_progress <= 0.0 && bez->line_length > 0) {
+        // Still on the consumed part of the previous line
+        pmCartScalMult(&bez->uTan, net_progress, out);
+        pmCartCartAdd(out, &bez->c[0], out);
+        return TP_ERR_OK;
+    }
+
+    int lo = 0, hi = BEZIER_TABLE_SIZE;
+    while (hi - lo > 1) {
+        int mid = (lo + hi) / 2;
+        if (bez->s[mid] <= net_progress) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+
+    double du = 1.0 / BEZIER_TABLE_SIZE;
+    double u0 = lo * du;
+    double ds = bez->s[lo + 1] - bez->s[lo];
+    double u = u0;
+    if (ds > 0.0) {
+        u += du * (net_progress - bez->s[lo]) / ds;
+    }
+    u = fmin(fmax(u, u0), u0 + du);
+
+    int iter;
+    for (iter = 0; iter < 2; ++iter) {
+        double speed = bezierSpeed(bez, u);
+        if (speed < TP_POS_EPSILON) {
+            break;
+        }
+        double err = bez->s[lo] + bezierArcLength(bez, u0, u) - net_progress;
+        u = fmin(fmax(u - err / speed, u0), u0 + du);
+    }
+
+    PmCartesian const * const c = bez->c;
+    out->x = c[0].x + u * (c[1].x + u * (c[2].x + u * (c[3].x + u * (c[4].x + u * c[5].x))));
+    out->y = c[0].y + u * (c[1].y + u * (c[2].y + u * (c[3].y + u * (c[4].y + u * c[5].y))));
+    out->z = c[0].z + u * (c[1].z + u * (c[2].z + u * (c[3].z + u * (c[4].z + u * c[5].z))));
+    return TP_ERR_OK;
+}
+
+int bezierLength(BezierBlend const * const bez, double * const length)
+{
+    *length = bez->s[BEZIER_TABLE_SIZE] + bez->line_length;
+    tp_debug_print("bezier length = %g\n", *length);
+    return TP_ERR_OK;
+}
+
+int bezierCurvature(BezierBlend const * const bez, double u, double * const curvature)
+{
+    PmCartesian d1, d2, cross;
+    double speed, mag;
+
+    *curvature = 0.0;
+    bezierDeriv(bez, u, &d1, &d2);
+    pmCartMag(&d1, &speed);
+    if (speed < TP_POS_EPSILON) {
+        return TP_ERR_GEOM;
+    }
+    pmCartCartCross(&d1, &d2, &cross);
+    pmCartMag(&cross, &mag);
+    *curvature = mag / (speed * speed * speed);
+    return TP_ERR_OK;
+}
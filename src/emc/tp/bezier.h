@@ -0,0 +1,60 @@
+/********************************************************************
+ * Description: bezier.h
+ *
+ * Curvature-continuous corner blends built from quintic Bezier curves.
+ *
+ * License: GPL Version 2
+ * System: Linux
+ *
+ ********************************************************************/
+#ifndef BEZIER_H
+#define BEZIER_H
+
+#include "posemath.h"
+
+/* Number of intervals in the arc length table */
+#define BEZIER_TABLE_SIZE 12
+/* Number of samples used to find the peak curvature of a shape */
+#define BEZIER_CURVATURE_SAMPLES 32
+
+/**
+ * Shape of a corner blend, for a corner with unit distance from the corner
+ * to the blend endpoints. The blend scales linearly with that distance, so
+ * the deviation and length scale with it and the curvature inversely.
+ */
+typedef struct {
+    double a;           /* inner control points are a and b times the */
+    double b;           /* distance along each line from the corner */
+    double deviation;   /* distance from the corner to the middle of the blend */
+    double curvature;   /* peak curvature */
+    double length;      /* arc length */
+} BezierShape;
+
+/**
+ * A quintic Bezier blending two lines that meet at a corner. The first
+ * three control points lie on the first line and the last three on the
+ * second, so the curve is tangent to both and has zero curvature where it
+ * meets them. The curve is kept in power form, and an arc length table
+ * maps progress along the blend to the curve parameter.
+ */
+typedef struct {
+    PmCartesian c[6];   /* B(u) = c[0] + c[1] u + ... + c[5] u^5 */
+    double s[BEZIER_TABLE_SIZE + 1];    /* arc length at u = k / BEZIER_TABLE_SIZE */
+    PmCartesian uTan;   /* Tangent vector at start of blend (copied from
+                           prev. tangent line)*/
+    double line_length; /* length of the consumed previous line, if any */
+} BezierBlend;
+
+int bezierShapeFromAngle(BezierShape * const shape, double phi);
+
+int bezierInitFromLines(BezierBlend * const bez, PmCartesian const * const corner,
+        PmCartesian const * const u1, PmCartesian const * const u2,
+        double dist, BezierShape const * const shape);
+
+int bezierPoint(BezierBlend const * const bez, double progress, PmCartesian * const out);
+
+int bezierLength(BezierBlend const * const bez, double * const length);
+
+int bezierCurvature(BezierBlend const * const bez, double u, double * const curvature);
+
+#endif
@@ -1200,6 +1200,64 @@ int blendComputeParameters(BlendParameters * const param)
 }
 
 
+/**
+ * Compute the blend parameters for a Bezier blend between two lines.
+ * This follows blendComputeParameters, with the shape's deviation and peak
+ * curvature in place of those of an arc. R_plan is the smallest radius of
+ * curvature along the blend, and d_plan the distance along each line to
+ * the blend endpoints.
+ */
+int blendComputeBezierParameters(BlendParameters * const param,
+        BezierShape const * const shape)
+{
+    // Find maximum distance along lines allowed by tolerance
+    double d_tol = param->tolerance / shape->deviation;
+    tp_debug_print(" d_tol = %f\n", d_tol);
+
+    double d_lengths = fmin(param->L1, param->L2);
+    double d_geom = fmin(d_lengths, d_tol);
+    double R_geom = d_geom / shape->curvature;
+
+    double v_normal = pmSqrt(param->a_n_max * R_geom);
+    tp_debug_print("v_normal = %f\n", v_normal);
+
+    param->v_plan = fmin(v_normal, param->v_goal);
+
+    // Size the blend by the equivalent parabolic blend, as for arcs
+    double a_parabolic = param->a_max * 0.5;
+    double v_triangle = pmSqrt(2.0 * a_parabolic  * d_geom);
+    double t_blend = fmin(v_triangle, param->v_plan) / (a_parabolic);
+    double s_blend = t_blend * param->v_plan;
+    double R_blend = fmin(s_blend / (shape->length * shape->curvature), R_geom);
+
+    param->R_plan = fmax(pmSq(param->v_plan) / param->a_n_max, R_blend);
+    param->d_plan = param->R_plan * shape->curvature;
+
+    tp_debug_print("v_plan = %f\n", param->v_plan);
+    tp_debug_print("R_plan = %f\n", param->R_plan);
+    tp_debug_print("d_plan = %f\n", param->d_plan);
+
+    if (param->v_plan > param->v_req) {
+        param->v_actual = param->v_req;
+    } else {
+        param->v_actual = param->v_plan;
+    }
+
+    param->s_arc = param->d_plan * shape->length;
+
+    if (param->R_plan < TP_POS_EPSILON) {
+        tp_debug_print("#Blend radius too small, aborting bezier\n");
+        return TP_ERR_FAIL;
+    }
+
+    if (param->s_arc < TP_MIN_ARC_LENGTH) {
+        tp_debug_print("#Blend length too small, aborting bezier\n");
+        return TP_ERR_FAIL;
+    }
+    return TP_ERR_OK;
+}
+
+
 /** Check if the previous line segment will be consumed based on the blend arc parameters. */
 int blendCheckConsume(BlendParameters * const param,
         BlendPoints3 const * const points,
@@ -1596,6 +1654,18 @@ int arcFromBlendPoints3(SphericalArc * const arc, BlendPoints3 const * const poi
             &points->arc_end, &points->arc_center);
 }
 
+int bezierFromBlendGeom3(BezierBlend * const bez, BlendGeom3 const * const geom,
+        BlendParameters const * const param, BezierShape const * const shape)
+{
+    int res = bezierInitFromLines(bez, &geom->P, &geom->u1, &geom->u2,
+            param->d_plan, shape);
+
+    // If we consume the previous line, the remaining line length gets added here
+    bez->uTan = geom->u_tan1;
+    bez->line_length = param->line_length;
+    return res;
+}
+
 int blendGeom3Print(BlendGeom3 const * const geom)
 {
     tp_debug_print("u1 = %f %f %f\n",
@@ -15,6 +15,7 @@
 
 #include "posemath.h"
 #include "tc_types.h"
+#include "bezier.h"
 
 #define BLEND_ACC_RATIO_TANGENTIAL 0.5
 #define BLEND_ACC_RATIO_NORMAL (pmSqrt(1.0 - pmSq(BLEND_ACC_RATIO_TANGENTIAL)))
@@ -173,6 +174,9 @@ int blendCalculateNormals3(BlendGeom3 * const geom);
 
 int blendComputeParameters(BlendParameters * const param);
 
+int blendComputeBezierParameters(BlendParameters * const param,
+        BezierShape const * const shape);
+
 int blendCheckConsume(BlendParameters * const param,
         BlendPoints3 const * const points,
         TC_STRUCT const * const prev_tc, int gap_cycles);
@@ -235,6 +239,9 @@ int blendArcLinePostProcess(BlendPoints3 * const points, BlendPoints3 const * co
 int arcFromBlendPoints3(SphericalArc * const arc, BlendPoints3 const * const points,
         BlendGeom3 const * const geom, BlendParameters const * const param);
 
+int bezierFromBlendGeom3(BezierBlend * const bez, BlendGeom3 const * const geom,
+        BlendParameters const * const param, BezierShape const * const shape);
+
 //Not implemented yet
 int blendGeom3Print(BlendGeom3 const * const geom);
 int blendParamPrint(BlendParameters const * const param);
@@ -22,6 +22,7 @@
 #include "tc.h"
 #include "tp_types.h"
 #include "spherical_arc.h"
+#include "bezier.h"
 #include "motion_types.h"
 
 //Debug output
@@ -77,7 +78,8 @@ double tcGetTangentialMaxAccel(TC_STRUCT const * const tc)
     // Reduce allowed tangential acceleration in circular motions to stay
     // within overall limits (accounts for centripetal acceleration while
     // moving along the circular path).
-    if (tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_SPHERICAL) {
+    if (tc->motion_type == TC_CIRCULAR || tc->motion_type == TC_SPHERICAL
+            || tc->motion_type == TC_BEZIER) {
         //Limit acceleration for cirular arcs to allow for normal acceleration
         a_scale *= tc->acc_ratio_tan;
     }
@@ -162,6 +164,7 @@ int tcGetStartAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const ou
             tcCircleStartAccelUnitVector(tc,out);
             break;
         case TC_SPHERICAL:
+        case TC_BEZIER:
             return -1;
         default:
             return -1;
@@ -186,6 +189,7 @@ int tcGetEndAccelUnitVector(TC_STRUCT const * const tc, PmCartesian * const out)
             tcCircleEndAccelUnitVector(tc,out);
             break;
        case TC_SPHERICAL:
+       case TC_BEZIER:
             return -1;
        default:
             return -1;
@@ -435,6 +439,13 @@ int tcGetPosReal(TC_STRUCT const * const tc, int of_point, EmcPose * const pos)
             abc = tc->coords.arc.abc;
             uvw = tc->coords.arc.uvw;
             break;
+        case TC_BEZIER:
+            bezierPoint(&tc->coords.bezier.xyz,
+                    progress,
+                    &xyz);
+            abc = tc->coords.bezier.abc;
+            uvw = tc->coords.bezier.uvw;
+            break;
     }
 
     if (res_fit == TP_ERR_OK) {
@@ -14,6 +14,7 @@
 #define TC_TYPES_H
 
 #include "spherical_arc.h"
+#include "bezier.h"
 #include "posemath.h"
 #include "emcpos.h"
 #include "emcmotcfg.h"
@@ -31,7 +32,8 @@ typedef enum {
     TC_LINEAR = 1,
     TC_CIRCULAR = 2,
     TC_RIGIDTAP = 3,
-    TC_SPHERICAL = 4
+    TC_SPHERICAL = 4,
+    TC_BEZIER = 5
 } tc_motion_type_t;
 
 typedef enum {
@@ -88,6 +90,12 @@ typedef struct {
     PmCartesian uvw;
 } Arc9;
 
+typedef struct {
+    BezierBlend xyz;
+    PmCartesian abc;
+    PmCartesian uvw;
+} Bezier9;
+
 typedef enum {
     TAPPING, REVERSING, RETRACTION, FINAL_REVERSAL, FINAL_PLACEMENT
 } RIGIDTAP_STATE;
@@ -143,11 +151,14 @@ typedef struct {
         PmCircle9 circle;
         PmRigidTap rigidtap;
         Arc9 arc;
+        Bezier9 bezier;
     } coords;
 
     int motion_type;       // TC_LINEAR (coords.line) or
                             // TC_CIRCULAR (coords.circle) or
-                            // TC_RIGIDTAP (coords.rigidtap)
+                            // TC_RIGIDTAP (coords.rigidtap) or
+                            // TC_SPHERICAL (coords.arc) or
+                            // TC_BEZIER (coords.bezier)
     int active;            // this motion is being executed
     int canon_motion_type;  // this motion is due to which canon function?
     int term_cond;          // gcode requests continuous feed at the end of
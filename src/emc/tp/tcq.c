@@ -166,8 +166,6 @@ int tcqPopBack(TC_QUEUE_STRUCT * const tcq)
     return 0;
 }
 
-#define TCQ_REVERSE_MARGIN 200
-
 int tcqPop(TC_QUEUE_STRUCT * const tcq)
 {
 
@@ -285,15 +283,15 @@ TC_STRUCT * tcqItem(TC_QUEUE_STRUCT const * const tcq, int n)
 {
     if (tcqCheck(tcq) || (n < 0) || (n >= tcq->_len)) return NULL;
 
-    return &(tcq->queue[(tcq->start + n) % tcq->size]);
+    /* start and n are both below size, so one wrap is enough; this is
+       called for every segment the optimizer walks over */
+    n += tcq->start;
+    if (n >= tcq->size) {
+        n -= tcq->size;
+    }
+    return &(tcq->queue[n]);
 }
 
-/*!
- * \def TC_QUEUE_MARGIN
- * sets up a margin at the end of the queue, to reduce effects of race conditions
- */
-#define TC_QUEUE_MARGIN (TCQ_REVERSE_MARGIN+20)
-
 /*! tcqFull() function
  *
  * \brief get the full status of the queue
@@ -329,6 +327,28 @@ int tcqFull(TC_QUEUE_STRUCT const * const tcq)
     return 0;
 }
 
+/*! tcqRoom() function
+ *
+ * \brief number of tcs that can be put before the queue counts as full
+ *
+ * Function called by the command handler, which tells user space how many
+ * more moves it may send.
+ *
+ * @param    tcq       pointer to the TC_QUEUE_STRUCT
+ *
+ * @return	 int       returns the room left, 0 if full
+ */
+int tcqRoom(TC_QUEUE_STRUCT const * const tcq)
+{
+    if (tcqFull(tcq)) {
+	return 0;
+    }
+    if (tcq->size <= TC_QUEUE_MARGIN) {
+	return 1;
+    }
+    return tcq->size - TC_QUEUE_MARGIN - tcq->_len;
+}
+
 /*! tcqLast() function
  *
  * \brief gets the last TC element in the queue, without removing it
@@ -346,9 +366,6 @@ TC_STRUCT *tcqLast(TC_QUEUE_STRUCT const * const tcq)
     if (tcq->_len == 0) {
         return NULL;
     }
-    //Fix for negative modulus error
-    int n = tcq->end-1 + tcq->size;
-    return &(tcq->queue[n % tcq->size]);
-
+    return &(tcq->queue[tcq->end > 0 ? tcq->end - 1 : tcq->size - 1]);
 }
 
@@ -23,6 +23,15 @@
 
 #include "tc_types.h"
 
+/* number of finished tcs kept for running backwards */
+#define TCQ_REVERSE_MARGIN 200
+
+/*!
+ * \def TC_QUEUE_MARGIN
+ * sets up a margin at the end of the queue, to reduce effects of race conditions
+ */
+#define TC_QUEUE_MARGIN (TCQ_REVERSE_MARGIN+20)
+
 typedef struct {
     TC_STRUCT *queue;	/* ptr to the tcs */
     int size;			/* size of queue */
@@ -72,4 +81,7 @@ extern TC_STRUCT * tcqLast(TC_QUEUE_STRUCT const * const tcq);
 /* get full status */
 extern int tcqFull(TC_QUEUE_STRUCT const * const tcq);
 
+/* how many tcs can be put before it is full */
+extern int tcqRoom(TC_QUEUE_STRUCT const * const tcq);
+
 #endif
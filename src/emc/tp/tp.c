@@ -20,6 +20,7 @@
 #include "motion_debug.h"
 #include "motion_types.h"
 #include "spherical_arc.h"
+#include "bezier.h"
 #include "blendmath.h"
 //KLUDGE Don't include all of emc.hh here, just hand-copy the TERM COND
 //definitions until we can break the emc constants out into a separate file.
@@ -102,6 +103,7 @@ STATIC int tcRotaryMotionCheck(TC_STRUCT const * const tc) {
                 return true;
             }
         case TC_SPHERICAL:
+        case TC_BEZIER:
             return true;
         default:
             tp_debug_print("Unknown motion type!\n");
@@ -679,14 +681,16 @@ STATIC double tpCalculateOptimizationInitialVel(TP_STRUCT const * const tp, TC_S
 
 
 /**
- * Initialize a blend arc from its parent lines.
+ * Initialize a blend segment from its parent lines.
  * This copies and initializes properties from the previous and next lines to
- * initialize a blend arc. This function does not handle connecting the
- * segments together, however.
+ * initialize a blend arc or Bezier blend, whose geometry must already be set
+ * up. This function does not handle connecting the segments together,
+ * however.
  */
-STATIC int tpInitBlendArcFromPrev(TP_STRUCT const * const tp,
+STATIC int tpInitBlendFromPrev(TP_STRUCT const * const tp,
         TC_STRUCT const * const prev_tc,
         TC_STRUCT* const blend_tc,
+        int motion_type,
         double vel,
         double ini_maxvel,
         double acc) {
@@ -698,7 +702,7 @@ STATIC int tpInitBlendArcFromPrev(TP_STRUCT const * const tp,
 #endif
 
     tcInit(blend_tc,
-            TC_SPHERICAL,
+            motion_type,
             canon_motion_type,
             tp->cycleTime,
             prev_tc->enables,
@@ -718,7 +722,11 @@ STATIC int tpInitBlendArcFromPrev(TP_STRUCT const * const tp,
 
     // find "helix" length for target
     double length;
-    arcLength(&blend_tc->coords.arc.xyz, &length);
+    if (motion_type == TC_BEZIER) {
+        bezierLength(&blend_tc->coords.bezier.xyz, &length);
+    } else {
+        arcLength(&blend_tc->coords.arc.xyz, &length);
+    }
     tp_info_print("blend tc length = %f\n",length);
     blend_tc->target = length;
     blend_tc->nominal_length = length;
@@ -733,6 +741,19 @@ STATIC int tpInitBlendArcFromPrev(TP_STRUCT const * const tp,
     return TP_ERR_OK;
 }
 
+/**
+ * Initialize a blend arc from its parent lines.
+ */
+STATIC int tpInitBlendArcFromPrev(TP_STRUCT const * const tp,
+        TC_STRUCT const * const prev_tc,
+        TC_STRUCT* const blend_tc,
+        double vel,
+        double ini_maxvel,
+        double acc) {
+    return tpInitBlendFromPrev(tp, prev_tc, blend_tc, TC_SPHERICAL,
+            vel, ini_maxvel, acc);
+}
+
 STATIC int tcSetLineXYZ(TC_STRUCT * const tc, PmCartLine const * const line)
 {
 
@@ -1300,6 +1321,39 @@ STATIC tp_err_t tpCreateArcArcBlend(TP_STRUCT * const tp, TC_STRUCT * const prev
 }
 
 
+/**
+ * Connect a blend between two lines to its neighbors.
+ * The previous line is either trimmed to meet the blend, or taken off the
+ * queue if the blend consumes it.
+ */
+STATIC tp_err_t tpConnectLineLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
+        TC_STRUCT * const tc, TC_STRUCT * const blend_tc,
+        BlendParameters const * const param, BlendPoints3 const * const points)
+{
+    int retval = TP_ERR_FAIL;
+
+    //TODO refactor to pass consume to connect function
+    if (param->consume) {
+        //Since we're consuming the previous segment, pop the last line off of the queue
+        retval = tcqPopBack(&tp->queue);
+        if (retval) {
+            //This is unrecoverable since we've already changed the line. Something is wrong if we get here...
+            rtapi_print_msg(RTAPI_MSG_ERR, "PopBack failed\n");
+            return TP_ERR_FAIL;
+        }
+        //Since the blend arc meets the end of the previous line, we only need
+        //to "connect" to the next line
+        retval = tcConnectBlendArc(NULL, tc, &points->arc_start, &points->arc_end);
+    } else {
+        //TODO refactor connect function to stretch lines and check for bad stretching
+        tp_debug_print("keeping previous line\n");
+        retval = tcConnectBlendArc(prev_tc, tc, &points->arc_start, &points->arc_end);
+        blend_tc->atspeed=0;
+    }
+    return retval;
+}
+
+
 STATIC tp_err_t tpCreateLineLineBlend(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
         TC_STRUCT * const tc, TC_STRUCT * const blend_tc)
 {
@@ -1359,27 +1413,84 @@ STATIC tp_err_t tpCreateLineLineBlend(TP_STRUCT * const tp, TC_STRUCT * const pr
         return TP_ERR_NO_ACTION;
     }
 
-    int retval = TP_ERR_FAIL;
+    return tpConnectLineLineBlend(tp, prev_tc, tc, blend_tc, &param, &points);
+}
 
-    //TODO refactor to pass consume to connect function
-    if (param.consume) {
-        //Since we're consuming the previous segment, pop the last line off of the queue
-        retval = tcqPopBack(&tp->queue);
-        if (retval) {
-            //This is unrecoverable since we've already changed the line. Something is wrong if we get here...
-            rtapi_print_msg(RTAPI_MSG_ERR, "PopBack failed\n");
-            return TP_ERR_FAIL;
-        }
-        //Since the blend arc meets the end of the previous line, we only need
-        //to "connect" to the next line
-        retval = tcConnectBlendArc(NULL, tc, &points.arc_start, &points.arc_end);
-    } else {
-        //TODO refactor connect function to stretch lines and check for bad stretching
-        tp_debug_print("keeping previous line\n");
-        retval = tcConnectBlendArc(prev_tc, tc, &points.arc_start, &points.arc_end);
-        blend_tc->atspeed=0;
+
+/**
+ * Blend two lines with a quintic Bezier instead of a circular arc.
+ * The Bezier meets each line with zero curvature, so the normal
+ * acceleration ramps up and down through the corner instead of stepping.
+ * The blend then competes with the parabolic and tangent options the same
+ * way a blend arc does.
+ */
+STATIC tp_err_t tpCreateLineLineBezier(TP_STRUCT * const tp, TC_STRUCT * const prev_tc,
+        TC_STRUCT * const tc, TC_STRUCT * const blend_tc)
+{
+
+    tp_debug_print("-- Starting LineLine Bezier blend --\n");
+    PmCartesian acc_bound, vel_bound;
+
+    //Get machine limits
+    tpGetMachineAccelBounds(&acc_bound);
+    tpGetMachineVelBounds(&vel_bound);
+
+    // Setup blend data structures
+    BlendGeom3 geom;
+    BlendParameters param;
+    BlendPoints3 points;
+    BezierShape shape;
+
+    int res_init = blendInit3FromLineLine(&geom, &param,
+            prev_tc,
+            tc,
+            &acc_bound,
+            &vel_bound,
+            emcmotConfig->maxFeedScale);
+
+    if (res_init != TP_ERR_OK) {
+        tp_debug_print("blend init failed with code %d, aborting Bezier blend\n",
+                res_init);
+        return res_init;
     }
-    return retval;
+
+    int res_shape = bezierShapeFromAngle(&shape, param.phi);
+    if (res_shape != TP_ERR_OK) {
+        return res_shape;
+    }
+
+    int res_blend = blendComputeBezierParameters(&param, &shape);
+    if (res_blend != TP_ERR_OK) {
+        return res_blend;
+    }
+
+    // The endpoints and trim distances are the same as for an arc of the
+    // same d_plan
+    blendFindPoints3(&points, &geom, &param);
+
+    blendCheckConsume(&param, &points, prev_tc, emcmotConfig->arcBlendGapCycles);
+
+    int res_bez = bezierFromBlendGeom3(&blend_tc->coords.bezier.xyz, &geom, &param, &shape);
+    if (res_bez < 0) {
+        return TP_ERR_FAIL;
+    }
+
+    // Note that previous restrictions don't allow ABC or UVW movement, so the
+    // end and start points should be identical
+    blend_tc->coords.bezier.abc = prev_tc->coords.line.abc.end;
+    blend_tc->coords.bezier.uvw = prev_tc->coords.line.uvw.end;
+
+    //set the max velocity to v_plan, since we'll violate constraints otherwise.
+    tpInitBlendFromPrev(tp, prev_tc, blend_tc, TC_BEZIER, param.v_req,
+            param.v_plan, param.a_max);
+
+    tp_debug_print("blend_tc target_vel = %g\n", blend_tc->target_vel);
+
+    if (tpChooseBestBlend(tp, prev_tc, tc, blend_tc) != ARC_BLEND) {
+        return TP_ERR_NO_ACTION;
+    }
+
+    return tpConnectLineLineBlend(tp, prev_tc, tc, blend_tc, &param, &points);
 }
 
 
@@ -1828,7 +1939,11 @@ static bool tpCreateBlendIfPossible(
 
     switch (blend_requested) {
         case BLEND_LINE_LINE:
-            res_create = tpCreateLineLineBlend(tp, prev_tc, tc, blend_tc);
+            if (emcmotConfig->arcBlendBezier) {
+                res_create = tpCreateLineLineBezier(tp, prev_tc, tc, blend_tc);
+            } else {
+                res_create = tpCreateLineLineBlend(tp, prev_tc, tc, blend_tc);
+            }
             break;
         case BLEND_LINE_ARC:
             res_create = tpCreateLineArcBlend(tp, prev_tc, tc, blend_tc);
@@ -325,6 +325,8 @@ static PyMemberDef Stat_members[] = {
     {(char*)"rotation_xy", T_DOUBLE, O(task.rotation_xy), READONLY},
     {(char*)"delay_left", T_DOUBLE, O(task.delayLeft), READONLY},
     {(char*)"queued_mdi_commands", T_INT, O(task.queuedMDIcommands), READONLY, (char*)"Number of MDI commands queued waiting to run." },
+    {(char*)"queue_time", T_DOUBLE, O(task.queueTime), READONLY, (char*)"Estimated seconds of moves queued in motion." },
+    {(char*)"readahead_time", T_DOUBLE, O(task.readaheadTime), READONLY, (char*)"Estimated seconds of moves read but not yet sent to motion." },
 
 // motion
 //   EMC_TRAJ_STAT traj
@@ -1798,6 +1798,29 @@ def get_max_jog_speed_map(a):
         a = "XYZABCUVW".index(axis_letter)
     return get_max_jog_speed(a)
 
+# On machines whose kinematics aren't trivial the joints can pass their
+# limits while the axes stay within theirs. The moves are run through the
+# kinematics module with the values its pins and parameters have in HAL,
+# as the program check in task does. None when that can't be done.
+def joint_extents():
+    kinematics = inifile.find("KINS", "KINEMATICS")
+    if not kinematics or not o.canon: return None
+    def value(name):
+        if not hal_present: return None
+        try:
+            return hal.get_value(name)
+        except RuntimeError:
+            return None
+    home = []
+    for i in range(s.joints):
+        try:
+            home.append(float(inifile.find("JOINT_%d" % i, "HOME") or 0))
+        except ValueError:
+            home.append(0.)
+    return gcode.joint_extents(kinematics, value, home,
+        s.linear_units or 1, s.angular_units or 1,
+        o.canon.arcfeed, o.canon.feed, o.canon.traverse)
+
 def run_warn():
     warnings = []
     if o.canon:
@@ -1810,6 +1833,20 @@ def run_warn():
             if o.canon.max_extents_notool[i] > machine_limit_max[i]:
                 warnings.append(_("Program exceeds machine maximum on axis %s")
                     % "XYZABCUVW"[i])
+        extents = joint_extents()
+        if extents:
+            jmin, jmax, jmin_line, jmax_line, unreachable = extents
+            for i in range(len(jmin)):
+                joint = s.joint[i]
+                if jmin[i] < joint['min_position_limit'] - 1e-6:
+                    warnings.append(_("Program exceeds machine minimum on joint %d at line %d")
+                        % (i, jmin_line[i]))
+                if jmax[i] > joint['max_position_limit'] + 1e-6:
+                    warnings.append(_("Program exceeds machine maximum on joint %d at line %d")
+                        % (i, jmax_line[i]))
+            if unreachable:
+                warnings.append(_("Program moves out of reach of the joints at line %d")
+                    % unreachable)
     if warnings:
         text = "\n".join(warnings)
         return int(root_window.tk.call("nf_dialog", ".error",
@@ -3619,6 +3656,15 @@ vcp = inifile.find("DISPLAY", "PYVCP")
 
 arcdivision = int(inifile.find("DISPLAY", "ARCDIVISION") or 64)
 
+preview_cache = inifile.find("DISPLAY", "PREVIEW_CACHE")
+if preview_cache:
+    preview_cache = os.path.expanduser(preview_cache)
+    try:
+        os.makedirs(preview_cache)
+    except OSError, detail:
+        if detail.errno != errno.EEXIST: raise
+    gcode.set_cache_dir(preview_cache)
+
 del sys.argv[1:3]
 
 root_window.bind("<KeyPress-KP_Begin>", kp_wrap(lambda e: None, "KeyPress"))
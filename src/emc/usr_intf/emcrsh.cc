@@ -26,13 +26,16 @@
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
+#include <sys/epoll.h>
 #include <netinet/in.h>
-#include <pthread.h>
 #include <errno.h>
 #include <limits.h>
 
 #include <getopt.h>
 
+#include <string>
+#include <vector>
+
 #include "rcs.hh"
 #include "posemath.h"		// PM_POSE, TO_RAD
 #include "emc.hh"		// EMC NML
@@ -60,8 +63,14 @@
             to max sessions. Default is no limit (-1).
   With -- --path Sets the base path to program (G-Code) files, default is "../../nc_files/".
             Make sure to include the final slash (/).
+  With -- --period <milliseconds> Sets how often the LinuxCNC status is read while
+            sessions are subscribed to changes, and how old a status a get may
+            reuse. Default 100.
   With -- -ini <inifile>, uses inifile instead of emc.ini. 
 
+  All sessions are served by one thread from one epoll loop, and share one
+  copy of the LinuxCNC status that is read again at most once per period.
+
   There are six commands supported, Where the commands set and get contain LinuxCNC
   specific sub-commands based on the commands supported by linuxcncrsh, but where the 
   usual prefix ( "emc_") is omitted. Commands and most parameters are not case sensitive.
@@ -178,10 +187,15 @@
   is a real number. If it's <= 0.0, it means wait forever. Default is 0.0,
   wait forever.
 
-  update (none) | none | auto
+  update (none) | none | auto | on_change
   With no arg, forces an update of the LinuxCNC status. With "none", doesn't
   cause an automatic update of status with other emc_ words. With "auto",
   makes emc_ words automatically update status before they return values.
+  With "on_change", every get this session makes from then on is repeated
+  once per period against freshly read status, and its reply is sent again
+  whenever it changes. Any session may subscribe this way; "none" or "auto"
+  end the subscriptions, and change the update mode of all sessions only
+  when sent by the enabled session.
 
   error
   Returns the current LinuxCNC error string, or "ok" if no error.
@@ -444,6 +458,11 @@ typedef enum {
   rtNoError, rtHandledNoError, rtStandardError, rtCustomError, rtCustomHandledError
   } cmdResponseType;
   
+// a get repeated for a session in update on_change mode
+typedef struct {
+  std::string command;
+  std::string last;} subscriptionRec;
+
 typedef struct {  
   int cliSock;
   char hostName[80];
@@ -456,7 +475,20 @@ typedef struct {
   int commProt;
   char inBuf[256];
   char outBuf[4096];
-  char progName[PATH_MAX];} connectionRecType;
+  char progName[PATH_MAX];
+  int inLen;
+  bool closing;
+  bool subscribed;
+  bool getOk;
+  std::vector<subscriptionRec> subscriptions;
+  std::string pending;   // output the socket hasn't taken yet
+  std::string *capture;  // when set, replies are collected here instead of sent
+  } connectionRecType;
+
+// a client that lets this much output pile up is dropped
+#define MAX_PENDING (1024 * 1024)
+#define MAX_SUBSCRIPTIONS 64
+#define MAX_EVENTS 64
 
 int port = 5007;
 int server_sockfd;
@@ -472,6 +504,10 @@ char enablePWD[16] = "EMCTOO\0";
 char serverName[24] = "EMCNETSVR\0";
 int sessions = 0;
 int maxSessions = -1;
+int epollfd = -1;
+std::vector<connectionRecType *> connections;
+double updatePeriod = 0.1;
+double lastUpdate = 0.0;
 
 const char *setCommands[] = {
   "ECHO", "VERBOSE", "ENABLE", "CONFIG", "COMM_MODE", "COMM_PROT", "INIFILE", "PLAT", "INI", "DEBUG",
@@ -498,6 +534,7 @@ struct option longopts[] = {
   {"connectpw", 1, NULL, 'w'},
   {"enablepw", 1, NULL, 'e'},
   {"path", 1, NULL, 'd'},
+  {"period", 1, NULL, 'u'},
   {0,0,0,0}};
 
 /* static char *skipWhite(char *s)
@@ -542,14 +579,14 @@ static int initSockets()
 {
   int optval = 1;
 
-  server_sockfd = socket(AF_INET, SOCK_STREAM, 0);
+  server_sockfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
   setsockopt(server_sockfd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
   server_address.sin_family = AF_INET;
   server_address.sin_addr.s_addr = htonl(INADDR_ANY);
   server_address.sin_port = htons(port);
   server_len = sizeof(server_address);
   bind(server_sockfd, (struct sockaddr *)&server_address, server_len);
-  listen(server_sockfd, 5);
+  listen(server_sockfd, SOMAXCONN);
 
   // ignore SIGCHLD
   {
@@ -568,10 +605,66 @@ static void sigQuit(int sig)
     thisQuit();
 }
 
+static void watchOutput(connectionRecType *context, bool on)
+{
+  struct epoll_event ev;
+
+  ev.events = on ? EPOLLIN | EPOLLOUT : EPOLLIN;
+  ev.data.ptr = context;
+  epoll_ctl(epollfd, EPOLL_CTL_MOD, context->cliSock, &ev);
+}
+
+// Client sockets don't block: what the socket won't take now is kept and
+// sent from the event loop when there is room again.
+static int sockSend(connectionRecType *context, const char *buf, size_t len)
+{
+  ssize_t n = 0;
+
+  if (context->capture != NULL) {
+    context->capture->append(buf, len);
+    return len;
+  }
+  if (context->closing) return -1;
+  if (context->pending.empty()) {
+    n = write(context->cliSock, buf, len);
+    if (n < 0) {
+      if ((errno != EAGAIN) && (errno != EWOULDBLOCK)) {
+        context->closing = true;
+        return -1;
+      }
+      n = 0;
+    }
+    if ((size_t)n == len) return n;
+    watchOutput(context, true);
+  }
+  if (context->pending.size() + len - n > MAX_PENDING) {
+    fprintf(stderr, "linuxcncrsh: client %s is not reading, dropping it\n", context->hostName);
+    context->closing = true;
+    return -1;
+  }
+  context->pending.append(buf + n, len - n);
+  return len;
+}
+
+static int sockSend(connectionRecType *context, const char *s)
+{
+  return sockSend(context, s, strlen(s));
+}
+
 static int sockWrite(connectionRecType *context)
 {
    strcat(context->outBuf, "\r\n");
-   return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+   return sockSend(context, context->outBuf);
+}
+
+// read the status again if the shared copy is older than the update period
+static void refreshStatus()
+{
+  double now = etime();
+
+  if (now - lastUpdate < updatePeriod) return;
+  updateStatus();
+  lastUpdate = now;
 }
 
 static setCommandType lookupSetCommand(char *s)
@@ -654,15 +747,17 @@ static int checkReceivedDoneNone(char *s)
   return -1;
 }
 
-static int checkNoneAuto(char *s)
+static int checkNoneAutoOnChange(char *s)
 {
   static const char *noneStr = "NONE";
   static const char *autoStr = "AUTO";
+  static const char *onChangeStr = "ON_CHANGE";
   
   if (s == NULL) return -1;
   strupr(s);
   if (strcmp(s, noneStr) == 0) return 0;
   if (strcmp(s, autoStr) == 0) return 1;
+  if (strcmp(s, onChangeStr) == 0) return 2;
   return -1;
 }
 
@@ -881,10 +976,23 @@ static cmdResponseType setTimeout(char *s, connectionRecType *context)
 
 static cmdResponseType setUpdate(char *s, connectionRecType *context)
 {
-  switch (checkNoneAuto(s)) {
+  int mode = checkNoneAutoOnChange(s);
+  bool subscribed = context->subscribed;
+
+  if (mode < 0) return rtStandardError;
+  // subscriptions belong to the session, any session may make them
+  if (mode == 2) {
+    context->subscribed = true;
+    return rtNoError;
+    }
+  context->subscribed = false;
+  context->subscriptions.clear();
+  // the update mode is shared by all sessions
+  if (context->cliSock != enabledConn)
+    return subscribed ? rtNoError : rtStandardError;
+  switch (mode) {
     case 0: emcUpdateType = EMC_UPDATE_NONE; break;
     case 1: emcUpdateType = EMC_UPDATE_AUTO; break;
-    default: return rtStandardError;
     }
   return rtNoError;
 }
@@ -1312,13 +1420,13 @@ int commandSet(connectionRecType *context)
   
   pch = strtok(NULL, delims);
   if (pch == NULL) {
-    return write(context->cliSock, setNakStr, strlen(setNakStr));
+    return sockSend(context, setNakStr);
     }
   strupr(pch);
   cmd = lookupSetCommand(pch);
-  if ((cmd >= scIniFile) && (context->cliSock != enabledConn)) {
+  if ((cmd >= scIniFile) && (cmd != scUpdate) && (context->cliSock != enabledConn)) {
     sprintf(context->outBuf, setCmdNakStr, pch);
-    return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+    return sockSend(context, context->outBuf);
     }
   if ((cmd > scMachine) && (emcStatus->task.state != EMC_TASK_STATE_ON)) {
 //  Extra check in the event of an undetected change in Machine state resulting in
@@ -1326,7 +1434,7 @@ int commandSet(connectionRecType *context)
 //  and appropriate error messages are generated, however erratic behavior has been
 //  seen when doing certain set commands when the Machine state is other than 'On'.
     sprintf(context->outBuf, setCmdNakStr, pch);
-    return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+    return sockSend(context, context->outBuf);
     }
   switch (cmd) {
     case scEcho: ret = setEcho(strtok(NULL, delims), context); break;
@@ -1411,17 +1519,17 @@ int commandSet(connectionRecType *context)
     case rtNoError:  
       if (context->verbose) {
         sprintf(context->outBuf, ackStr, pch);
-        return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+        return sockSend(context, context->outBuf);
         }
       break;
     case rtHandledNoError: // Custom ok response already handled, take no action
       break; 
     case rtStandardError:
       sprintf(context->outBuf, setCmdNakStr, pch);
-      return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+      return sockSend(context, context->outBuf);
       break;
     case rtCustomError: // Custom error response entered in buffer
-      return write(context->cliSock, context->outBuf, strlen(context->outBuf));
+      return sockSend(context, context->outBuf);
       break;
     case rtCustomHandledError: ;// Custom error respose handled, take no action
     }
@@ -2390,15 +2498,14 @@ int commandGet(connectionRecType *context)
   char *pch;
   cmdResponseType ret = rtNoError;
   
+  context->getOk = false;
   pch = strtok(NULL, delims);
   if (pch == NULL) {
-    return write(context->cliSock, setNakStr, strlen(setNakStr));
+    return sockSend(context, setNakStr);
     }
-  if (emcUpdateType == EMC_UPDATE_AUTO) updateStatus();
+  if (emcUpdateType == EMC_UPDATE_AUTO) refreshStatus();
   strupr(pch);
   cmd = lookupSetCommand(pch);
-  if (cmd > scIni)
-    if (emcUpdateType == EMC_UPDATE_AUTO) updateStatus();
   switch (cmd) {
     case scEcho: ret = getEcho(pch, context); break;
     case scVerbose: ret = getVerbose(pch, context); break;
@@ -2478,6 +2585,7 @@ int commandGet(connectionRecType *context)
     case scOptionalStop: ret = getOptionalStop(pch, context); break;
     case scUnknown: ret = rtStandardError;
     }
+  context->getOk = (ret == rtNoError) || (ret == rtHandledNoError);
   switch (ret) {
     case rtNoError: // Standard ok response, just write value in buffer
       sockWrite(context);
@@ -2724,17 +2832,53 @@ commandTokenType lookupToken(char *s)
   return i;
 }
   
+// a get made in update on_change mode is remembered, and repeated by
+// pushUpdates() until the session leaves that mode
+static int subscribeGet(connectionRecType *context, char *line)
+{
+  std::string reply;
+  std::string command;
+  char *save;
+  char *pch;
+  unsigned i;
+
+  context->capture = &reply;
+  commandGet(context);
+  context->capture = NULL;
+
+  if (context->getOk) {
+    for (pch = strtok_r(line, delims, &save); pch != NULL; pch = strtok_r(NULL, delims, &save)) {
+      strupr(pch);
+      if (!command.empty()) command += " ";
+      command += pch;
+      }
+    for (i = 0; i < context->subscriptions.size(); i++)
+      if (context->subscriptions[i].command == command) break;
+    if (i < context->subscriptions.size())
+      context->subscriptions[i].last = reply;
+    else if (context->subscriptions.size() < MAX_SUBSCRIPTIONS) {
+      subscriptionRec sub;
+      sub.command = command;
+      sub.last = reply;
+      context->subscriptions.push_back(sub);
+      }
+    }
+  return sockSend(context, reply.data(), reply.size());
+}
+
 // handle the linuxcncrsh command in context->inBuf
 int parseCommand(connectionRecType *context)
 {
   int ret = 0;
   char *pch;
   char s[64];
+  char line[sizeof(context->inBuf)];
   static const char *helloNakStr = "HELLO NAK\r\n";
   static const char *shutdownNakStr = "SHUTDOWN NAK\r\n";
   static const char *helloAckStr = "HELLO ACK %s 1.1\r\n";
   static const char *setNakStr = "SET NAK\r\n";
     
+  if (context->subscribed) strcpy(line, context->inBuf);
   pch = strtok(context->inBuf, delims);
   sprintf(s, helloAckStr, serverName);
   if (pch != NULL) {
@@ -2742,16 +2886,19 @@ int parseCommand(connectionRecType *context)
     switch (lookupToken(pch)) {
       case cmdHello: 
         if (commandHello(context) == -1)
-          ret = write(context->cliSock, helloNakStr, strlen(helloNakStr));
-        else ret = write(context->cliSock, s, strlen(s));
+          ret = sockSend(context, helloNakStr);
+        else ret = sockSend(context, s);
         break;
       case cmdGet: 
-        ret = commandGet(context);
+        if (context->subscribed) ret = subscribeGet(context, line);
+        else ret = commandGet(context);
         break;
       case cmdSet:
         if (!context->linked)
-	  ret = write(context->cliSock, setNakStr, strlen(setNakStr));
+	  ret = sockSend(context, setNakStr);
         else ret = commandSet(context);
+        // whatever was set, the next get should see it
+        lastUpdate = 0.0;
         break;
       case cmdQuit: 
         ret = commandQuit(context);
@@ -2759,7 +2906,7 @@ int parseCommand(connectionRecType *context)
       case cmdShutdown:
         ret = commandShutdown(context);
         if(ret ==0){
-          ret = write(context->cliSock, shutdownNakStr, strlen(shutdownNakStr));
+          ret = sockSend(context, shutdownNakStr);
         }
 	break;
       case cmdHelp:
@@ -2771,115 +2918,221 @@ int parseCommand(connectionRecType *context)
   return ret;
 }  
 
-void *readClient(void *arg)
+// Repeat the subscribed gets of every session against the status just read,
+// and send the replies that differ from the ones sent last.
+static void pushUpdates()
+{
+  char buf[sizeof(connectionRecType::inBuf)];
+  std::string reply;
+  unsigned i, j;
+
+  for (i = 0; i < connections.size(); i++) {
+    connectionRecType *context = connections[i];
+    for (j = 0; (j < context->subscriptions.size()) && !context->closing; j++) {
+      subscriptionRec &sub = context->subscriptions[j];
+      snprintf(buf, sizeof(buf), "%s", sub.command.c_str());
+      strtok(buf, delims);
+      reply.clear();
+      context->capture = &reply;
+      commandGet(context);
+      context->capture = NULL;
+      if (!context->getOk || (reply == sub.last)) continue;
+      sub.last = reply;
+      sockSend(context, reply.data(), reply.size());
+      }
+    }
+}
+
+static void readClient(connectionRecType *context)
 {
   char buf[1600];
-  int context_index;
   int i;
   int len;
-  connectionRecType *context = (connectionRecType *)arg;
 
-  context_index = 0;
-
-  while (1) {
-    // We always start this loop with an empty buf, though there may be one
-    // partial line in context->inBuf[0..context_index].
-    len = read(context->cliSock, buf, sizeof(buf));
-    if (len < 0) {
-      fprintf(stderr, "linuxcncrsh: error reading from client: %s\n", strerror(errno));
-      goto finished;
-    }
-    if (len == 0) {
-      printf("linuxcncrsh: eof from client\n");
-      goto finished;
-    }
+  // There may be one partial line in context->inBuf[0..context->inLen].
+  len = read(context->cliSock, buf, sizeof(buf));
+  if (len < 0) {
+    if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)) return;
+    fprintf(stderr, "linuxcncrsh: error reading from client: %s\n", strerror(errno));
+    context->closing = true;
+    return;
+  }
+  if (len == 0) {
+    printf("linuxcncrsh: eof from client\n");
+    context->closing = true;
+    return;
+  }
 
-    if (context->echo && context->linked)
-      if(write(context->cliSock, buf, len) != (ssize_t)len) {
-        fprintf(stderr, "linuxcncrsh: write() failed: %s", strerror(errno));
+  if (context->echo && context->linked)
+    sockSend(context, buf, len);
+
+  for (i = 0; (i < len) && !context->closing; i ++) {
+      if ((buf[i] != '\n') && (buf[i] != '\r')) {
+          // the rest of an overlong line is dropped
+          if (context->inLen < (int)sizeof(context->inBuf) - 1) {
+              context->inBuf[context->inLen] = buf[i];
+              context->inLen ++;
+          }
+          continue;
       }
 
-    for (i = 0; i < len; i ++) {
-        if ((buf[i] != '\n') && (buf[i] != '\r')) {
-            context->inBuf[context_index] = buf[i];
-            context_index ++;
-            continue;
-        }
+      // if we get here, i is the index of a line terminator in buf
 
-        // if we get here, i is the index of a line terminator in buf
+      if (context->inLen > 0) {
+          // we have some bytes in the context buffer, parse them now
+          context->inBuf[context->inLen] = '\0';
 
-        if (context_index > 0) {
-            // we have some bytes in the context buffer, parse them now
-            context->inBuf[context_index] = '\0';
+          // The return value from parseCommand was meant to indicate
+          // success or error, but it is unusable.  Some paths return
+          // the return value of write(2) and some paths return small
+          // positive integers (cmdResponseType) to indicate failure.
+          // We're best off just ignoring it.
+          (void)parseCommand(context);
 
-            // The return value from parseCommand was meant to indicate
-            // success or error, but it is unusable.  Some paths return
-            // the return value of write(2) and some paths return small
-            // positive integers (cmdResponseType) to indicate failure.
-            // We're best off just ignoring it.
-            (void)parseCommand(context);
+          context->inLen = 0;
+      }
+  }
+}
 
-            context_index = 0;
-        }
-    }
+static void flushClient(connectionRecType *context)
+{
+  ssize_t n;
+
+  n = write(context->cliSock, context->pending.data(), context->pending.size());
+  if (n < 0) {
+    if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR))
+      context->closing = true;
+    return;
+  }
+  context->pending.erase(0, n);
+  if (context->pending.empty()) watchOutput(context, false);
+}
+
+static void acceptClients()
+{
+  struct epoll_event ev;
+
+  while (1) {
+    int client_sockfd;
+    connectionRecType *context;
+
+    client_len = sizeof(client_address);
+    client_sockfd = accept4(server_sockfd,
+      (struct sockaddr *)&client_address, &client_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (client_sockfd < 0) {
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK) || (errno == EINTR)
+          || (errno == ECONNABORTED)) return;
+      exit(0);
+    }
+    if ((maxSessions != -1) && (sessions >= maxSessions)) {
+      close(client_sockfd);
+      continue;
+    }
+
+    context = new connectionRecType();
+    context->cliSock = client_sockfd;
+    context->linked = false;
+    context->echo = true;
+    context->verbose = false;
+    strcpy(context->version, "1.0");
+    strcpy(context->hostName, "Default");
+    context->enabled = false;
+    context->commMode = 0;
+    context->commProt = 0;
+    context->inBuf[0] = 0;
+    context->inLen = 0;
+    context->closing = false;
+    context->subscribed = false;
+    context->capture = NULL;
+
+    ev.events = EPOLLIN;
+    ev.data.ptr = context;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, client_sockfd, &ev) < 0) {
+      fprintf(stderr, "linuxcncrsh: can't watch client: %s\n", strerror(errno));
+      close(client_sockfd);
+      delete context;
+      continue;
+    }
+    sessions++;
+    connections.push_back(context);
   }
+}
 
-finished:
+static void closeClient(connectionRecType *context)
+{
   printf("linuxcncrsh: disconnecting client %s (%s)\n", context->hostName, context->version);
+  epoll_ctl(epollfd, EPOLL_CTL_DEL, context->cliSock, NULL);
   close(context->cliSock);
-  free(context);
-  pthread_exit((void *)0);
-  sessions--;  // FIXME: not reached
+  // a new client may get the same descriptor
+  if (enabledConn == context->cliSock) enabledConn = -1;
+  sessions--;
+  delete context;
 }
 
 int sockMain()
 {
-    int res;
-    
+    struct epoll_event ev, events[MAX_EVENTS];
+    double nextPush = 0.0;
+    int n, i;
+
+    epollfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollfd < 0) {
+      fprintf(stderr, "linuxcncrsh: epoll_create1: %s\n", strerror(errno));
+      exit(1);
+    }
+    ev.events = EPOLLIN;
+    ev.data.ptr = NULL;
+    if (epoll_ctl(epollfd, EPOLL_CTL_ADD, server_sockfd, &ev) < 0) {
+      fprintf(stderr, "linuxcncrsh: can't watch server socket: %s\n", strerror(errno));
+      exit(1);
+    }
+
     while (1) {
-      int client_sockfd;
-
-      client_len = sizeof(client_address);
-      client_sockfd = accept(server_sockfd,
-        (struct sockaddr *)&client_address, &client_len);
-      if (client_sockfd < 0) exit(0);
-      sessions++;
-      if ((maxSessions == -1) || (sessions <= maxSessions)) {
-        pthread_t *thrd;
-        connectionRecType *context;
-
-        thrd = (pthread_t *)calloc(1, sizeof(pthread_t));
-        if (thrd == NULL) {
-          fprintf(stderr, "linuxcncrsh: out of memory\n");
-          exit(1);
-        }
+      bool subscribers = false;
+      int timeout = -1;
+
+      // with nobody subscribed, status is only read when a get asks for it
+      for (i = 0; i < (int)connections.size(); i++)
+        if (!connections[i]->subscriptions.empty()) subscribers = true;
+      if (subscribers) {
+        double wait = nextPush - etime();
+        timeout = wait > 0.0 ? (int)ceil(wait * 1000.0) : 0;
+      }
+
+      n = epoll_wait(epollfd, events, MAX_EVENTS, timeout);
+      if (n < 0) {
+        if (errno == EINTR) continue;
+        fprintf(stderr, "linuxcncrsh: epoll_wait: %s\n", strerror(errno));
+        exit(1);
+      }
+
+      for (i = 0; i < n; i++) {
+        connectionRecType *context = (connectionRecType *)events[i].data.ptr;
 
-        context = (connectionRecType *) malloc(sizeof(connectionRecType));
         if (context == NULL) {
-          fprintf(stderr, "linuxcncrsh: out of memory\n");
-          exit(1);
+          acceptClients();
+          continue;
         }
+        if (context->closing) continue;
+        if (events[i].events & EPOLLOUT) flushClient(context);
+        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) readClient(context);
+      }
 
-        context->cliSock = client_sockfd;
-        context->linked = false;
-        context->echo = true;
-        context->verbose = false;
-        strcpy(context->version, "1.0");
-        strcpy(context->hostName, "Default");
-        context->enabled = false;
-        context->commMode = 0;
-        context->commProt = 0;
-        context->inBuf[0] = 0;
-
-        res = pthread_create(thrd, NULL, readClient, (void *)context);
-      } else {
-        res = -1;
+      if (subscribers && (etime() >= nextPush)) {
+        updateStatus();
+        lastUpdate = etime();
+        pushUpdates();
+        nextPush = etime() + updatePeriod;
       }
-      if (res != 0) {
-        close(client_sockfd);
-        sessions--;
-        }
-     }
+
+      // contexts are only freed here, after no event can refer to them
+      for (i = 0; i < (int)connections.size(); ) {
+        if (connections[i]->closing) {
+          closeClient(connections[i]);
+          connections.erase(connections.begin() + i);
+        } else i++;
+      }
+    }
     return 0;
 }
 
@@ -2913,9 +3166,10 @@ static void usage(char* pname) {
            "         --enablepw   <password>     (default=%s)\n"
            "         --sessions   <max sessions> (default=%d) (-1 ==> no limit) \n"
            "         --path       <path>         (default=%s)\n"
+           "         --period     <milliseconds> (default=%g)\n"
            "LinuxCNC_Options:\n"
            "          -ini        <inifile>      (default=%s)\n"
-          ,pname,port,serverName,pwd,enablePWD,maxSessions,defaultPath,emc_inifile
+          ,pname,port,serverName,pwd,enablePWD,maxSessions,defaultPath,updatePeriod * 1000.0,emc_inifile
           );
 }
 
@@ -2925,7 +3179,7 @@ int main(int argc, char *argv[])
 
     initMain();
     // process local command line args
-    while((opt = getopt_long(argc, argv, "he:n:p:s:w:d:", longopts, NULL)) != - 1) {
+    while((opt = getopt_long(argc, argv, "he:n:p:s:w:d:u:", longopts, NULL)) != - 1) {
       switch(opt) {
         case 'h': usage(argv[0]); exit(1);
         case 'e': strncpy(enablePWD, optarg, strlen(optarg) + 1); break;
@@ -2933,7 +3187,13 @@ int main(int argc, char *argv[])
         case 'p': sscanf(optarg, "%d", &port); break;
         case 's': sscanf(optarg, "%d", &maxSessions); break;
         case 'w': strncpy(pwd, optarg, strlen(optarg) + 1); break;
-        case 'd': strncpy(defaultPath, optarg, strlen(optarg) + 1);
+        case 'd': strncpy(defaultPath, optarg, strlen(optarg) + 1); break;
+        case 'u':
+          if ((sscanf(optarg, "%lf", &updatePeriod) < 1) || (updatePeriod <= 0.0)) {
+            usage(argv[0]);
+            exit(1);
+          }
+          updatePeriod /= 1000.0;
         }
       }
 
@@ -2970,7 +3230,7 @@ int main(int argc, char *argv[])
         sigaction(SIGINT, &act, NULL);
     }
 
-    // make all threads ignore SIGPIPE
+    // ignore SIGPIPE, a client that goes away shows up as a write error
     {
         struct sigaction act;
         act.sa_handler = SIG_IGN;
@@ -21,6 +21,10 @@
 #include <stdlib.h>
 #include <signal.h>
 #include <math.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
 
 #include "hal.h"		/* access to HAL functions/definitions */
 #include "rtapi.h"		/* rtapi_print_msg */
@@ -227,6 +231,9 @@ typedef halui_str_base<VALUE> local_halui_str;
 
 static halui_str *halui_data;
 static local_halui_str old_halui_data;
+// halui.changes, counted up by halui_watch when an input pin changed
+static hal_u32_t **halui_changes;
+static rtapi_u32 halui_changes_seen;
 
 static char *mdi_commands[MDI_MAX];
 static int num_mdi_commands=0;
@@ -409,33 +416,42 @@ static int updateStatus()
 }
 
 
-#define EMC_COMMAND_DELAY   0.1	// how long to sleep between checks
+#define EMC_COMMAND_DELAY   0.1	// longest sleep between checks
+#define EMC_COMMAND_POLL    0.001	// first sleep between checks
+
+// Task usually answers within a few milliseconds, so check again soon
+// at first and back off to EMC_COMMAND_DELAY only when it does not.
+static double emcCommandBackoff(double delay)
+{
+    esleep(delay);
+    delay *= 2;
+    return delay < EMC_COMMAND_DELAY ? delay : EMC_COMMAND_DELAY;
+}
 
 static int emcCommandWaitDone()
 {
-    double end;
-    for (end = 0.0; end < doneTimeout; end += EMC_COMMAND_DELAY) {
+    double end = etime() + doneTimeout;
+    double delay = EMC_COMMAND_POLL;
+    do {
 	updateStatus();
 	int serial_diff = emcStatus->echo_serial_number - emcCommandSerialNumber;
 
-	if (serial_diff < 0) {
-	    continue;
-	}
-
 	if (serial_diff > 0) {
 	    return 0;
 	}
 
-	if (emcStatus->status == RCS_DONE) {
-	    return 0;
-	}
+	if (serial_diff == 0) {
+	    if (emcStatus->status == RCS_DONE) {
+		return 0;
+	    }
 
-	if (emcStatus->status == RCS_ERROR) {
-	    return -1;
+	    if (emcStatus->status == RCS_ERROR) {
+		return -1;
+	    }
 	}
 
-	esleep(EMC_COMMAND_DELAY);
-    }
+	delay = emcCommandBackoff(delay);
+    } while (etime() < end);
 
     return -1;
 }
@@ -450,8 +466,9 @@ static int emcCommandSend(RCS_CMD_MSG & cmd)
     emcCommandSerialNumber = cmd.serial_number;
 
     // wait for receive
-    double end;
-    for (end = 0.0; end < receiveTimeout; end += EMC_COMMAND_DELAY) {
+    double end = etime() + receiveTimeout;
+    double delay = EMC_COMMAND_POLL;
+    do {
 	updateStatus();
 	int serial_diff = emcStatus->echo_serial_number - emcCommandSerialNumber;
 
@@ -459,8 +476,8 @@ static int emcCommandSend(RCS_CMD_MSG & cmd)
 	    return 0;
 	}
 
-	esleep(EMC_COMMAND_DELAY);
-    }
+	delay = emcCommandBackoff(delay);
+    } while (etime() < end);
 
     rtapi_print("halui: %s: no echo from Task after %.3f seconds\n", __func__, receiveTimeout);
     return -1;
@@ -932,6 +949,16 @@ int halui_hal_init(void)
         if (retval < 0) return retval;
     }
 
+    halui_changes = (hal_u32_t **) hal_malloc(sizeof(hal_u32_t *));
+    if (!halui_changes) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+			"HALUI: ERROR: hal_malloc() failed\n");
+	hal_exit(comp_id);
+	return -1;
+    }
+    retval = hal_pin_u32_new("halui.changes", HAL_IN, halui_changes, comp_id);
+    if (retval < 0) return retval;
+
     hal_ready(comp_id);
     return 0;
 }
@@ -2279,6 +2306,24 @@ static void modify_hal_pins()
 
 
 
+// sleeps for up to timeout seconds, but returns as soon as halui_watch
+// counts a change on halui.changes, which it follows with a futex wake.
+// Without halui_watch nothing changes the count and it just sleeps.
+static void wait_hal_changes(double timeout)
+{
+    volatile rtapi_u32 *changes = *halui_changes;
+    rtapi_u32 now = *changes;
+
+    if (now == halui_changes_seen) {
+	struct timespec ts;
+	ts.tv_sec = (time_t) timeout;
+	ts.tv_nsec = (long) ((timeout - ts.tv_sec) * 1e9);
+	// returns at once if the count moved since it was read above
+	syscall(SYS_futex, (void *) changes, FUTEX_WAIT, now, &ts, NULL, 0);
+    }
+    halui_changes_seen = *changes;
+}
+
 int main(int argc, char *argv[])
 {
     // process command line args
@@ -2331,7 +2376,7 @@ int main(int argc, char *argv[])
         }
         check_hal_changes(); //if anything changed send NML messages
         modify_hal_pins(); //if status changed modify HAL too
-        esleep(0.02); //sleep for a while
+        wait_hal_changes(0.02); //sleep for a while, or until a pin changes
         updateStatus();
     }
     thisQuit();
@@ -0,0 +1,204 @@
+/********************************************************************
+* Description: motiontrace.cc
+*   Prints the move timestamps motion and task keep when
+*   motion.trace.enable is set, as a timeline or as histograms of the
+*   time moves spend between stages.  See mottrace.h.
+*
+* License: GPL Version 2
+* System: Linux
+********************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include "motion.h"
+#include "mottrace.h"
+#include "usrmotintf.h"
+
+typedef std::vector<emcmot_trace_event_t> Events;
+
+static Events events[EMCMOT_TRACE_STAGES];
+
+/* times of each move at one stage, to find where a move came from */
+class StageTimes {
+public:
+    explicit StageTimes(const Events &e) {
+	for (size_t n = 0; n < e.size(); n++) {
+	    times[e[n].id].push_back(e[n].time);
+	}
+    }
+    /* latest time id reached this stage at or before time, or -1 */
+    long long before(int id, long long time) const {
+	std::map<int, std::vector<long long> >::const_iterator it = times.find(id);
+	if (it == times.end()) {
+	    return -1;
+	}
+	const std::vector<long long> &t = it->second;
+	std::vector<long long>::const_iterator p =
+	    std::upper_bound(t.begin(), t.end(), time);
+	if (p == t.begin()) {
+	    return -1;
+	}
+	return *--p;
+    }
+private:
+    std::map<int, std::vector<long long> > times;
+};
+
+/* nanoseconds each event of stage to took since its move reached from */
+static std::vector<long long> latencies(int from, int to)
+{
+    StageTimes start(events[from]);
+    std::vector<long long> result;
+
+    for (size_t n = 0; n < events[to].size(); n++) {
+	long long t = start.before(events[to][n].id, events[to][n].time);
+	if (t >= 0) {
+	    result.push_back(events[to][n].time - t);
+	}
+    }
+    return result;
+}
+
+static void print_histogram(int from, int to)
+{
+    std::vector<long long> l = latencies(from, to);
+    int buckets[32] = {0};
+    int most = 0, first = 32, last = -1;
+
+    printf("%s -> %s: ", emcmotTraceStageName(from), emcmotTraceStageName(to));
+    if (l.empty()) {
+	printf("no moves\n\n");
+	return;
+    }
+    std::sort(l.begin(), l.end());
+    printf("%d moves, min %.1f us, median %.1f us, 99%% %.1f us, max %.1f us\n",
+	(int) l.size(), l.front() * 1e-3, l[l.size() / 2] * 1e-3,
+	l[(l.size() - 1) * 99 / 100] * 1e-3, l.back() * 1e-3);
+
+    /* buckets by powers of two in microseconds */
+    for (size_t n = 0; n < l.size(); n++) {
+	long long us = l[n] / 1000;
+	int b = 0;
+	while (us > 0 && b < 31) {
+	    us >>= 1;
+	    b++;
+	}
+	buckets[b]++;
+	most = std::max(most, buckets[b]);
+	first = std::min(first, b);
+	last = std::max(last, b);
+    }
+    for (int b = first; b <= last; b++) {
+	printf("  < %8lld us %7d ", 1LL << b, buckets[b]);
+	for (int n = 0; n < (buckets[b] * 50 + most - 1) / most; n++) {
+	    putchar('#');
+	}
+	putchar('\n');
+    }
+    putchar('\n');
+}
+
+struct TimelineEvent {
+    long long time;
+    int stage;
+    int id;
+    bool operator<(const TimelineEvent &o) const {
+	return time < o.time || (time == o.time && stage < o.stage);
+    }
+};
+
+static void print_timeline()
+{
+    std::vector<TimelineEvent> all;
+    std::vector<StageTimes> stages;
+
+    for (int s = 0; s < EMCMOT_TRACE_STAGES; s++) {
+	stages.push_back(StageTimes(events[s]));
+	for (size_t n = 0; n < events[s].size(); n++) {
+	    TimelineEvent e = { events[s][n].time, s, events[s][n].id };
+	    all.push_back(e);
+	}
+    }
+    std::sort(all.begin(), all.end());
+
+    printf("%12s  %-8s %8s  %s\n", "ms", "stage", "id", "us since previous stage");
+    for (size_t n = 0; n < all.size(); n++) {
+	const TimelineEvent &e = all[n];
+	printf("%12.3f  %-8s %8d", (e.time - all[0].time) * 1e-6,
+	    emcmotTraceStageName(e.stage), e.id);
+	if (e.stage > 0) {
+	    long long t = stages[e.stage - 1].before(e.id, e.time);
+	    if (t >= 0) {
+		printf("  %.1f", (e.time - t) * 1e-3);
+	    }
+	}
+	putchar('\n');
+    }
+}
+
+static void usage(const char *name)
+{
+    fprintf(stderr,
+	"usage: %s [-i inifile] [-t]\n"
+	"  -i inifile  take SHMEM_KEY from the [EMCMOT] section of inifile\n"
+	"  -t          print every event in time order instead of histograms\n"
+	"Moves are traced while the motion.trace.enable pin is set.\n", name);
+    exit(1);
+}
+
+int main(int argc, char **argv)
+{
+    bool timeline = false;
+    int opt, total = 0;
+
+    while ((opt = getopt(argc, argv, "i:th")) != -1) {
+	switch (opt) {
+	case 'i':
+	    if (usrmotIniLoad(optarg) != 0) {
+		return 1;
+	    }
+	    break;
+	case 't':
+	    timeline = true;
+	    break;
+	default:
+	    usage(argv[0]);
+	}
+    }
+    if (optind != argc) {
+	usage(argv[0]);
+    }
+
+    if (usrmotInit("motion-trace") != 0) {
+	fprintf(stderr, "%s: can't connect to motion\n", argv[0]);
+	return 1;
+    }
+    for (int s = 0; s < EMCMOT_TRACE_STAGES; s++) {
+	events[s].resize(EMCMOT_TRACE_SIZE);
+	int n = usrmotReadTrace(s, &events[s][0]);
+	events[s].resize(n > 0 ? n : 0);
+	total += events[s].size();
+    }
+    usrmotExit();
+
+    if (total == 0) {
+	fprintf(stderr, "%s: nothing traced; is motion.trace.enable set?\n",
+	    argv[0]);
+	return 1;
+    }
+
+    if (timeline) {
+	print_timeline();
+	return 0;
+    }
+    for (int s = 1; s < EMCMOT_TRACE_STAGES; s++) {
+	print_histogram(s - 1, s);
+    }
+    print_histogram(EMCMOT_TRACE_READ, EMCMOT_TRACE_ACTIVE);
+    return 0;
+}
@@ -46,6 +46,36 @@ char * Expr;
 char * ErrorDesc;
 char * VerifyErrorDesc;
 int UnderVerify;
+/* not NULL while an expression is compiled: the parser then also */
+/* puts out the code that computes what it parses */
+static StrArithmCode * CompileCode;
+static char CompileFailed;
+
+/* Operations of the compiled code, on a stack of arithmtype */
+#define OP_CONST 0		/* push Arg */
+#define OP_VAR 1		/* push var VarType/Arg */
+#define OP_VAR_INDEXED 2	/* same, plus the var of the next instr */
+#define OP_NOT 3
+#define OP_ABS 4
+#define OP_POW 5
+#define OP_MUL 6
+#define OP_DIV 7
+#define OP_MOD 8
+#define OP_ADD 9
+#define OP_SUB 10
+#define OP_AND 11
+#define OP_XOR 12
+#define OP_OR 13
+#define OP_MINI 14		/* of the Arg values on top */
+#define OP_MAXI 15
+#define OP_AVG 16
+#define OP_COMPARE 17		/* Arg: COMPARE_ bits that make it true */
+#define OP_STORE 18		/* pop into var VarType/Arg */
+#define OP_STORE_INDEXED 19
+#define COMPARE_GREATER 1
+#define COMPARE_LOWER 2
+#define COMPARE_DIFFERENT 4
+#define COMPARE_EQUAL 8
 
 /* for RTLinux module */
 #if defined( MODULE )
@@ -66,6 +96,36 @@ int pow_int(int a,int b)
 }
 
 
+static void Emit(int Op,int VarType,int Arg)
+{
+	StrArithmInstr * pInstr;
+	if (!CompileCode)
+		return;
+	if (CompileCode->NbrInstr>=ARITHM_CODE_SIZE)
+	{
+		CompileFailed = TRUE;
+		return;
+	}
+	pInstr = &CompileCode->Instr[ CompileCode->NbrInstr++ ];
+	pInstr->Op = Op;
+	pInstr->VarType = VarType;
+	pInstr->Arg = Arg;
+}
+
+/* a var, with the var giving its index if there is one */
+static void EmitVar(int Op,int VarType,int VarOffset,int IndexVarType,int IndexVarOffset)
+{
+	if ( IndexVarType!=-1 && IndexVarOffset!=-1 )
+	{
+		Emit(Op+1,VarType,VarOffset);
+		Emit(OP_CONST,IndexVarType,IndexVarOffset);
+	}
+	else
+	{
+		Emit(Op,VarType,VarOffset);
+	}
+}
+
 void SyntaxError(void)
 {
 	if (UnderVerify)
@@ -74,6 +134,22 @@ void SyntaxError(void)
 		debug_printf("Syntax error : '%s' , at %s !!!!!\n",ErrorDesc,Expr);
 }
 
+/* The parser steps over some characters without looking at them, */
+/* which must not take it past the end of the string */
+static void SkipChar(void)
+{
+	if (*Expr=='\0')
+	{
+		ErrorDesc = "Unexpected end of expression";
+		SyntaxError();
+		CompileFailed = TRUE;
+	}
+	else
+	{
+		Expr++;
+	}
+}
+
 arithmtype Constant(void)
 {
 	arithmtype Res = 0;
@@ -113,6 +189,7 @@ arithmtype Constant(void)
 	}
 	if ( cIsNeg )
 		Res = Res * -1;
+	Emit(OP_CONST,0,Res);
 	return Res;
 }
 
@@ -125,22 +202,26 @@ int IdentifyVarContent( char **PtrStartExpr, int * ResType,int * ResOffset )
 	char * SearchSep = StartExpr;
 //printf("IndentifyVar=%s\n", StartExpr);
 
-	do
+	/* (the first character is never the separator, but stop at the */
+	/* end of the string: a lone @ has nothing after it) */
+	while( *SearchSep!='\0' )
 	{
 		SearchSep++;
+		if ( (*SearchSep=='/') || (*SearchSep=='\0') )
+			break;
 	}
-	while( (*SearchSep!='/') && (*SearchSep!='\0') );
 
 	if (*SearchSep=='/')
 	{
 		VarType = atoi(StartExpr);
 		SearchSep++;
 		StartExpr = SearchSep;
-		do
+		while( *StartExpr!='\0' )
 		{
 			StartExpr++;
+			if ( (*StartExpr=='@') || (*StartExpr=='[') || (*StartExpr=='\0') )
+				break;
 		}
-		while( (*StartExpr!='@') && (*StartExpr!='[') && (*StartExpr!='\0') );
 		if (*StartExpr=='@' || *StartExpr=='[')
 		{
 			VarOffset = atoi(SearchSep);
@@ -231,7 +312,20 @@ int IdentifyFinalVar( char *StartExpr, int * ResType,int * ResOffset )
 arithmtype Variable(void)
 {
 	int VarType,VarOffset;
-	if (IdentifyFinalVar(Expr, &VarType,&VarOffset))
+	int IndexVarType,IndexVarOffset;
+	int SyntaxOk;
+	if (CompileCode)
+	{
+		/* nothing is read now, the code will read it on each scan */
+		SyntaxOk = IdentifyVarIndexedOrNot(Expr,&VarType,&VarOffset,&IndexVarType,&IndexVarOffset);
+		if (SyntaxOk)
+			EmitVar(OP_VAR,VarType,VarOffset,IndexVarType,IndexVarOffset);
+	}
+	else
+	{
+		SyntaxOk = IdentifyFinalVar(Expr, &VarType,&VarOffset);
+	}
+	if (SyntaxOk)
 	{
 //printf("Variable:%d/%d\n", VarType, VarOffset);
 		/* flush var found */
@@ -241,7 +335,9 @@ arithmtype Variable(void)
 			Expr++;
 		}
 		while( (*Expr!='@') && (*Expr!='\0') );
-		Expr++;
+		SkipChar();
+		if (CompileCode)
+			return 0;
 		/* return var value */
 		return (arithmtype)ReadVar(VarType,VarOffset);
 	}
@@ -268,43 +364,50 @@ arithmtype Function(void)
 	/* functions with one parameter = variable */
 	if ( !strcmp(tcFonc, "ABS") )
 	{
-		Expr++; /* ( */
+		SkipChar(); /* ( */
 		Res = Variable( );
 		if ( Res<0 )
 			Res = Res * -1;
-		Expr++; /* ) */
+		SkipChar(); /* ) */
+		Emit(OP_ABS,0,0);
 		return Res;
 	}
 
 	/* functions with many parameters = many variables separated per ',' */
 	if ( !strcmp(tcFonc, "MINI") )
 	{
+		int NbrVars = 0;
 		Res = 0x7FFFFFFF;
 		do
 		{
 			int iValVar;
-			Expr++; /* ( -ou- , */
+			SkipChar(); /* ( -ou- , */
 			iValVar = Variable( );
+			NbrVars++;
 			if ( iValVar<Res )
 				Res = iValVar;
 		}
-		while( *Expr!=')' );
-		Expr++; /* ) */
+		while( *Expr!=')' && *Expr!='\0' );
+		SkipChar(); /* ) */
+		Emit(OP_MINI,0,NbrVars);
 		return Res;
 	}
 	if ( !strcmp(tcFonc, "MAXI") )
 	{
+		int NbrVars = 0;
 		Res = 0x80000000;
 		do
 		{
 			int iValVar;
-			Expr++; /* ( -or- , */
+			SkipChar(); /* ( -or- , */
 			iValVar = Variable( );
+			NbrVars++;
 			if ( iValVar>Res )
 				Res = iValVar;
 		}
-		while( *Expr!=')' );
-		Expr++; /* ) */
+		while( *Expr!=')' && *Expr!='\0' );
+		SkipChar(); /* ) */
+		Emit(OP_MAXI,0,NbrVars);
 		return Res;
 	}
 	if ( !strcmp(tcFonc, "MOY") /*original french term!*/ || !strcmp(tcFonc, "AVG") /*added latter!!!*/ )
@@ -313,14 +416,15 @@ arithmtype Function(void)
 		do
 		{
 			int ValVar;
-			Expr++; /* ( -or- , */
+			SkipChar(); /* ( -or- , */
 			ValVar = Variable( );
 			NbrVars++;
 			Res = Res + ValVar;
 		}
-		while( *Expr!=')' );
-		Expr++; /* ) */
+		while( *Expr!=')' && *Expr!='\0' );
+		SkipChar(); /* ) */
 		Res = Res/NbrVars;
+		Emit(OP_AVG,0,NbrVars);
 		return Res;
 	}
 
@@ -352,7 +456,7 @@ arithmtype Term(void)
 			ErrorDesc = "Missing parenthesis";
 			SyntaxError();
 		}
-		Expr++;
+		SkipChar();
 		return Res;
 	}
 	else if ( (*Expr>='0' && *Expr<='9') || (*Expr=='$') || (*Expr=='-') )
@@ -365,8 +469,11 @@ arithmtype Term(void)
 	}
 	else if (*Expr=='!')
 	{
+		arithmtype Res;
 		Expr++;
-		return Term()?0:1;
+		Res = Term()?0:1;
+		Emit(OP_NOT,0,0);
+		return Res;
 	}
 	else
 	{
@@ -389,6 +496,7 @@ arithmtype Pow(void)
 		Expr++;
 		Q = Pow();
 		Res = pow_int(Res,Q);
+		Emit(OP_POW,0,0);
 	}
 	return Res;
 }
@@ -407,22 +515,26 @@ arithmtype MulDivMod(void)
 		{
 			Expr++;
 			Res = Res * Pow();
+			Emit(OP_MUL,0,0);
 		}
 		else
 		if (*Expr=='/')
 		{
 			Expr++;
 			Val = Pow();
-			if ( ErrorDesc==NULL )
+			/* the values are all 0 while compiling */
+			if ( ErrorDesc==NULL && !CompileCode )
 				Res = Res / Val;
+			Emit(OP_DIV,0,0);
 		}
 		else
 		if (*Expr=='%')
 		{
 			Expr++;
 			Val = Pow();
-			if ( ErrorDesc==NULL )
+			if ( ErrorDesc==NULL && !CompileCode )
 				Res = Res % Val;
+			Emit(OP_MOD,0,0);
 		}
 		else
 		{
@@ -445,12 +557,14 @@ arithmtype AddSub(void)
 		{
 			Expr++;
 			Res = Res + MulDivMod();
+			Emit(OP_ADD,0,0);
 		}
 		else
 		if (*Expr=='-')
 		{
 			Expr++;
 			Res = Res - MulDivMod();
+			Emit(OP_SUB,0,0);
 		}
 		else
 		{
@@ -471,6 +585,7 @@ arithmtype And(void)
 		{
 			Expr++;
 			Res = Res & AddSub();
+			Emit(OP_AND,0,0);
 		}
 		else
 		{
@@ -490,6 +605,7 @@ arithmtype Xor(void)
 		{
 			Expr++;
 			Res = Res ^ And();
+			Emit(OP_XOR,0,0);
 		}
 		else
 		{
@@ -509,6 +625,7 @@ arithmtype Or(void)
 		{
 			Expr++;
 			Res = Res | Xor();
+			Emit(OP_OR,0,0);
 		}
 		else
 		{
@@ -544,7 +661,10 @@ int EvalCompare(char * CompareString)
 
 	/* null expression ? */
 	if (*CompareString=='\0' || *CompareString=='#')
+	{
+		Emit(OP_CONST,0,BoolRes);
 		return BoolRes;
+	}
 
 	strcpy(StrCopy,CompareString);
 
@@ -589,6 +709,20 @@ int EvalCompare(char * CompareString)
 			BoolRes = 1;
 		if ( (*SearchSep=='=' || *(SearchSep+1)=='=') && EvalFirst==EvalSecond )
 			BoolRes = 1;
+		if (CompileCode)
+		{
+			/* the same tests, done on each scan */
+			int Tests = 0;
+			if ( *SearchSep=='>' )
+				Tests |= COMPARE_GREATER;
+			if ( *SearchSep=='<' && *(SearchSep+1)!='>' )
+				Tests |= COMPARE_LOWER;
+			if ( *SearchSep=='<' && *(SearchSep+1)=='>' )
+				Tests |= COMPARE_DIFFERENT;
+			if ( *SearchSep=='=' || *(SearchSep+1)=='=' )
+				Tests |= COMPARE_EQUAL;
+			Emit(OP_COMPARE,0,Tests);
+		}
 	}
 	else
 	{
@@ -605,6 +739,8 @@ void MakeCalc(char * CalcString,int VerifyMode)
 {
 	char StrCopy[ARITHM_EXPR_SIZE+1]; /* used for putting null char after first expr */
 	int TargetVarType,TargetVarOffset;
+	int TargetIndexType = -1,TargetIndexOffset = -1;
+	int SyntaxOk;
 	int  Found = FALSE;
 
 	/* null expression ? */
@@ -614,7 +750,11 @@ void MakeCalc(char * CalcString,int VerifyMode)
 	strcpy(StrCopy,CalcString);
 
 	Expr = StrCopy;
-	if (IdentifyFinalVar(Expr,&TargetVarType,&TargetVarOffset))
+	if (CompileCode)
+		SyntaxOk = IdentifyVarIndexedOrNot(Expr,&TargetVarType,&TargetVarOffset,&TargetIndexType,&TargetIndexOffset);
+	else
+		SyntaxOk = IdentifyFinalVar(Expr,&TargetVarType,&TargetVarOffset);
+	if (SyntaxOk)
 	{
 		/* flush var found */
 		Expr++;
@@ -623,10 +763,11 @@ void MakeCalc(char * CalcString,int VerifyMode)
 			Expr++;
 		}
 		while( (*Expr!='@') && (*Expr!='\0') );
-		Expr++;
+		SkipChar();
 		/* verify if there is the '=' or ':=' */
 		do
 		{
+			char * Before = Expr;
 			if (*Expr==':')
 				Expr++;
 			if (*Expr=='=')
@@ -636,6 +777,9 @@ void MakeCalc(char * CalcString,int VerifyMode)
 			}
 			if (*Expr==' ')
 				Expr++;
+			/* anything else can not be skipped */
+			if (Expr==Before)
+				break;
 		}
 		while( !Found && *Expr!='\0' );
 		while( *Expr==' ')
@@ -646,7 +790,11 @@ void MakeCalc(char * CalcString,int VerifyMode)
 //printf("Calc - Eval String=%s\n",Expr);
 			EvalExpr = EvalExpression(Expr);
 //printf("Calc - Result=%d\n",EvalExpr);
-			if (!VerifyMode)
+			if (CompileCode)
+			{
+				EmitVar(OP_STORE,TargetVarType,TargetVarOffset,TargetIndexType,TargetIndexOffset);
+			}
+			else if (!VerifyMode)
 			{
 				WriteVar(TargetVarType,TargetVarOffset,(int)EvalExpr);
 			}
@@ -690,3 +838,141 @@ char * VerifySyntaxForMakeCalc(char * StringToVerify)
 	return VerifyErrorDesc;
 }
 
+/* Parse an expression once, for a compare element (ForCompare) or an */
+/* operate one, into code that EvalArithmCode() then runs on each scan. */
+/* An expression with a syntax error is left not compiled, so that */
+/* evaluating the string still reports it as before. */
+void CompileArithmExpr(char * ExprString,int ForCompare,StrArithmCode * Code)
+{
+	Code->Kind = ARITHM_CODE_NONE;
+	Code->NbrInstr = 0;
+	CompileCode = Code;
+	CompileFailed = FALSE;
+	UnderVerify = TRUE;
+	VerifyErrorDesc = NULL;
+	if (ForCompare)
+		EvalCompare(ExprString);
+	else
+		MakeCalc(ExprString,TRUE /* verify mode */);
+	UnderVerify = FALSE;
+	CompileCode = NULL;
+	if (VerifyErrorDesc==NULL && !CompileFailed)
+		Code->Kind = ForCompare?ARITHM_CODE_COMPARE:ARITHM_CODE_CALC;
+	CompileFailed = FALSE;
+}
+
+/* Run compiled code: returns the result of a compare, */
+/* or does the assignment of an operate */
+int EvalArithmCode(StrArithmCode * Code)
+{
+	arithmtype Stack[ ARITHM_CODE_SIZE ];
+	int Top = -1;
+	StrArithmInstr * pInstr = Code->Instr;
+	StrArithmInstr * pEnd = Code->Instr+Code->NbrInstr;
+	int Offset,NbrVars,Scan;
+	arithmtype Res;
+
+	while( pInstr<pEnd )
+	{
+		switch( pInstr->Op )
+		{
+			case OP_CONST:
+				Stack[ ++Top ] = pInstr->Arg;
+				break;
+			case OP_VAR:
+				Stack[ ++Top ] = ReadVar(pInstr->VarType,pInstr->Arg);
+				break;
+			case OP_VAR_INDEXED:
+				Offset = pInstr->Arg+ReadVar(pInstr[1].VarType,pInstr[1].Arg);
+				Stack[ ++Top ] = ReadVar(pInstr->VarType,Offset);
+				pInstr++;
+				break;
+			case OP_NOT:
+				Stack[ Top ] = Stack[ Top ]?0:1;
+				break;
+			case OP_ABS:
+				if ( Stack[ Top ]<0 )
+					Stack[ Top ] = Stack[ Top ] * -1;
+				break;
+			case OP_POW:
+				Top--;
+				Stack[ Top ] = pow_int(Stack[ Top ],Stack[ Top+1 ]);
+				break;
+			case OP_MUL:
+				Top--;
+				Stack[ Top ] = Stack[ Top ] * Stack[ Top+1 ];
+				break;
+			case OP_DIV:
+				Top--;
+				Stack[ Top ] = Stack[ Top ] / Stack[ Top+1 ];
+				break;
+			case OP_MOD:
+				Top--;
+				Stack[ Top ] = Stack[ Top ] % Stack[ Top+1 ];
+				break;
+			case OP_ADD:
+				Top--;
+				Stack[ Top ] = Stack[ Top ] + Stack[ Top+1 ];
+				break;
+			case OP_SUB:
+				Top--;
+				Stack[ Top ] = Stack[ Top ] - Stack[ Top+1 ];
+				break;
+			case OP_AND:
+				Top--;
+				Stack[ Top ] = Stack[ Top ] & Stack[ Top+1 ];
+				break;
+			case OP_XOR:
+				Top--;
+				Stack[ Top ] = Stack[ Top ] ^ Stack[ Top+1 ];
+				break;
+			case OP_OR:
+				Top--;
+				Stack[ Top ] = Stack[ Top ] | Stack[ Top+1 ];
+				break;
+			case OP_MINI:
+			case OP_MAXI:
+			case OP_AVG:
+				NbrVars = pInstr->Arg;
+				Top = Top-NbrVars+1;
+				Res = (pInstr->Op==OP_MINI)?0x7FFFFFFF:(pInstr->Op==OP_MAXI)?(arithmtype)0x80000000:0;
+				for ( Scan=0; Scan<NbrVars; Scan++ )
+				{
+					arithmtype ValVar = Stack[ Top+Scan ];
+					if ( pInstr->Op==OP_MINI && ValVar<Res )
+						Res = ValVar;
+					if ( pInstr->Op==OP_MAXI && ValVar>Res )
+						Res = ValVar;
+					if ( pInstr->Op==OP_AVG )
+						Res = Res + ValVar;
+				}
+				if ( pInstr->Op==OP_AVG )
+					Res = Res/NbrVars;
+				Stack[ Top ] = Res;
+				break;
+			case OP_COMPARE:
+				Top--;
+				Res = 0;
+				if ( (pInstr->Arg & COMPARE_GREATER) && Stack[ Top ]>Stack[ Top+1 ] )
+					Res = 1;
+				if ( (pInstr->Arg & COMPARE_LOWER) && Stack[ Top ]<Stack[ Top+1 ] )
+					Res = 1;
+				if ( (pInstr->Arg & COMPARE_DIFFERENT) && Stack[ Top ]!=Stack[ Top+1 ] )
+					Res = 1;
+				if ( (pInstr->Arg & COMPARE_EQUAL) && Stack[ Top ]==Stack[ Top+1 ] )
+					Res = 1;
+				Stack[ Top ] = Res;
+				break;
+			case OP_STORE:
+				WriteVar(pInstr->VarType,pInstr->Arg,(int)Stack[ Top-- ]);
+				break;
+			case OP_STORE_INDEXED:
+				Offset = pInstr->Arg+ReadVar(pInstr[1].VarType,pInstr[1].Arg);
+				WriteVar(pInstr->VarType,Offset,(int)Stack[ Top-- ]);
+				pInstr++;
+				break;
+		}
+		pInstr++;
+	}
+	return (Top>=0)?Stack[ Top ]:0;
+}
@@ -24,5 +24,5 @@ arithmtype AddSub(void);
 arithmtype Or(void);
 char * VerifySyntaxForEvalCompare(char * StringToVerify);
 char * VerifySyntaxForMakeCalc(char * StringToVerify);
-
-
+void CompileArithmExpr(char * ExprString,int ForCompare,StrArithmCode * Code);
+int EvalArithmCode(StrArithmCode * Code);
@@ -78,6 +78,10 @@ StrMonostable * MonostableArray;
 StrCounter * CounterArray;
 StrTimerIEC * NewTimerArray;
 StrArithmExpr * ArithmExpr;
+StrCompiledRung * CompiledRungArray;
+StrArithmCode * ArithmCodeArray;
+StrCompiledRung * CompiledRungCopies;
+StrArithmCode * ArithmCodeCopies;
 StrInfosGene * InfosGene;
 StrSection * SectionArray;
 #ifdef SEQUENTIAL_SUPPORT
@@ -192,6 +196,8 @@ int ClassicLadder_AllocAll()
     bytes += pSizesInfos->nbr_arithm_expr * sizeof(StrArithmExpr);
     bytes += pSizesInfos->nbr_sections * sizeof(StrSection);
     bytes += pSizesInfos->nbr_symbols * sizeof(StrSymbol);
+    bytes += 2 * pSizesInfos->nbr_rungs * sizeof(StrCompiledRung);
+    bytes += 2 * pSizesInfos->nbr_arithm_expr * sizeof(StrArithmCode);
     
 #ifdef SEQUENTIAL_SUPPORT
     bytes += sizeof(StrSequential);
@@ -219,6 +225,8 @@ int ClassicLadder_AllocAll()
      InfosGene = (StrInfosGene*)(shmBase+1);
      InfosGene->GeneralParams.SizesInfos = *pSizesInfos;
      memcpy( &InfosGene->GeneralParams, &GeneralParamsMirror, sizeof( StrGeneralParams ) );
+     InfosGene->CompiledCopy = 0;
+     InfosGene->CompiledCopyInUse = -1;
      rtapi_print_msg(RTAPI_MSG_INFO,"INFO----REALTIME allocations for classicladder:\n");
 #endif //end of realtime code
 
@@ -298,6 +306,13 @@ int ClassicLadder_AllocAll()
 	   pByte += pSizesInfos->nbr_counters * sizeof(StrCounter);	
     NewTimerArray = (StrTimerIEC *) pByte;
 	   pByte += pSizesInfos->nbr_timers_iec * sizeof(StrTimerIEC);
+    // compiled rungs hold ints, keep them before the strings
+    CompiledRungCopies = (StrCompiledRung *) pByte;
+	   pByte += 2 * pSizesInfos->nbr_rungs * sizeof(StrCompiledRung);
+    ArithmCodeCopies = (StrArithmCode *) pByte;
+	   pByte += 2 * pSizesInfos->nbr_arithm_expr * sizeof(StrArithmCode);
+    CompiledRungArray = CompiledRungCopies;
+    ArithmCodeArray = ArithmCodeCopies;
            ArithmExpr = (StrArithmExpr *) pByte;	
  	   pByte += pSizesInfos->nbr_arithm_expr * sizeof(StrArithmExpr);
     SectionArray = (StrSection *) pByte;	
@@ -316,6 +331,11 @@ int ClassicLadder_AllocAll()
     VarArray = (TYPE_FOR_BOOL_VAR *) pByte;
 
 	InitInfosGene( );
+#ifdef RTAPI
+	// nothing to refresh until the editor has compiled the rungs
+	memset( CompiledRungCopies, 0, 2 * pSizesInfos->nbr_rungs * sizeof(StrCompiledRung) );
+	memset( ArithmCodeCopies, 0, 2 * pSizesInfos->nbr_arithm_expr * sizeof(StrArithmCode) );
+#endif
 
 return TRUE;
 }
@@ -351,4 +371,7 @@ void ClassicLadder_InitAllDatas( void )
 	InitSequential( );
 #endif
 	InitSymbols( );
+#ifndef RTAPI
+	CompileAllRungs( );
+#endif
 }
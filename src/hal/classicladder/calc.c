@@ -40,6 +40,11 @@
 #include "calc_sequential.h"
 #endif
 #include "calc.h"
+#include "rtapi_atomic.h"
+
+/* the rung being refreshed, while StateOnLeft() can use its */
+/* compiled connections */
+static StrCompiledRung * CompiledRungUnderCalc = NULL;
 
 void InitRungs()
 {
@@ -242,6 +247,17 @@ char StateOnLeft(int x,int y,StrRung * TheRung)
     // directly connected to the "left"? if yes, ON !
     if (x==0)
         return 1;
+    if (CompiledRungUnderCalc)
+    {
+        unsigned char Rows = CompiledRungUnderCalc->RowsOnLeft[x][y];
+        StrElement * pLeft = TheRung->Element[x-1];
+        for (PosY=0; Rows!=0; PosY++, Rows>>=1)
+        {
+            if ((Rows & 1) && pLeft[PosY].DynamicOutput)
+                return 1;
+        }
+        return 0;
+    }
     /* Direct on left */
     if (TheRung->Element[x-1][y].DynamicOutput)
         State = 1;
@@ -276,6 +292,41 @@ char StateOnLeft(int x,int y,StrRung * TheRung)
     return State;
 }
 
+/* The rows of column x-1 that StateOnLeft() looks at, one bit each */
+unsigned char RowsConnectedOnLeft(int x,int y,StrRung * TheRung)
+{
+    unsigned char Rows = 1<<y;
+    int PosY;
+    char StillConnected;
+    /* Up */
+    PosY = y;
+    StillConnected = TheRung->Element[x][PosY].ConnectedWithTop;
+    while( (PosY>0) && StillConnected)
+    {
+        PosY--;
+        Rows |= 1<<PosY;
+        if ( !(TheRung->Element[x][PosY].ConnectedWithTop) )
+            StillConnected = FALSE;
+    }
+    /* Down */
+    if (y<RUNG_HEIGHT-1)
+    {
+        PosY = y+1;
+        StillConnected = TheRung->Element[x][PosY].ConnectedWithTop;
+        while( (PosY<RUNG_HEIGHT) && StillConnected)
+        {
+            Rows |= 1<<PosY;
+            PosY++;
+            if (PosY<RUNG_HEIGHT)
+            {
+                if ( !(TheRung->Element[x][PosY].ConnectedWithTop) )
+                    StillConnected = FALSE;
+            }
+        }
+    }
+    return Rows;
+}
+
 /* Elements : -| |- and -|/|- */
 char CalcTypeInput(int x,int y,StrRung * UpdateRung,char IsNot,char OnlyFronts)
 {
@@ -625,7 +676,12 @@ char CalcTypeCompar(int x,int y,StrRung * UpdateRung)
     char State;
     char StateElement;
 
-    StateElement = EvalCompare(ArithmExpr[UpdateRung->Element[x][y].VarNum].Expr);
+    int NumExpr = UpdateRung->Element[x][y].VarNum;
+
+    if (ArithmCodeArray[NumExpr].Kind==ARITHM_CODE_COMPARE)
+        StateElement = EvalArithmCode(&ArithmCodeArray[NumExpr]);
+    else
+        StateElement = EvalCompare(ArithmExpr[NumExpr].Expr);
     UpdateRung->Element[x][y].DynamicState = StateElement;
     if (x==2)
     {
@@ -644,110 +700,174 @@ char CalcTypeCompar(int x,int y,StrRung * UpdateRung)
 char CalcTypeOutputOperate(int x,int y,StrRung * UpdateRung)
 {
     char State;
+    int NumExpr = UpdateRung->Element[x][y].VarNum;
     State = StateOnLeft(x-2,y,UpdateRung);
     if (State)
-        MakeCalc(ArithmExpr[UpdateRung->Element[x][y].VarNum].Expr,FALSE /* verify mode */);
+    {
+        if (ArithmCodeArray[NumExpr].Kind==ARITHM_CODE_CALC)
+            EvalArithmCode(&ArithmCodeArray[NumExpr]);
+        else
+            MakeCalc(ArithmExpr[NumExpr].Expr,FALSE /* verify mode */);
+    }
     UpdateRung->Element[x][y].DynamicInput = State;
     UpdateRung->Element[x][y].DynamicState = State;
     return State;
 }
 
 
-int RefreshRung(StrRung * Rung, int * JumpTo)
+/* Refresh one cell of a rung, as the scan reaches it */
+void RefreshElement(int x,int y,StrRung * Rung,int * JumpToRung)
 {
-	int x = 0, y = 0;
-	int JumpToRung = -1;
-	int SectionToCall = -1;
+	int SectionToCall;
 
-	do
+	switch(Rung->Element[x][y].Type)
 	{
-		do
-		{
-			switch(Rung->Element[x][y].Type)
-			{
-				/* MLD,16/5/2001,V0.2.8 , fixed for drawing */
-				case ELE_FREE:
-				case ELE_UNUSABLE:
-					if (StateOnLeft(x,y,Rung))
-						Rung->Element[x][y].DynamicInput = 1;
-					else
-						Rung->Element[x][y].DynamicInput = 0;
-					break;
-				/* End fix */
-				case ELE_INPUT:
-					CalcTypeInput(x,y,Rung,FALSE,FALSE);
-					break;
-				case ELE_INPUT_NOT:
-					CalcTypeInput(x,y,Rung,TRUE,FALSE);
-					break;
-				case ELE_RISING_INPUT:
-					CalcTypeInput(x,y,Rung,FALSE,TRUE);
-					break;
-				case ELE_FALLING_INPUT:
-					CalcTypeInput(x,y,Rung,TRUE,TRUE);
-					break;
-				case ELE_CONNECTION:
-					CalcTypeConnection(x,y,Rung);
-					break;
+		/* MLD,16/5/2001,V0.2.8 , fixed for drawing */
+		case ELE_FREE:
+		case ELE_UNUSABLE:
+			if (StateOnLeft(x,y,Rung))
+				Rung->Element[x][y].DynamicInput = 1;
+			else
+				Rung->Element[x][y].DynamicInput = 0;
+			break;
+		/* End fix */
+		case ELE_INPUT:
+			CalcTypeInput(x,y,Rung,FALSE,FALSE);
+			break;
+		case ELE_INPUT_NOT:
+			CalcTypeInput(x,y,Rung,TRUE,FALSE);
+			break;
+		case ELE_RISING_INPUT:
+			CalcTypeInput(x,y,Rung,FALSE,TRUE);
+			break;
+		case ELE_FALLING_INPUT:
+			CalcTypeInput(x,y,Rung,TRUE,TRUE);
+			break;
+		case ELE_CONNECTION:
+			CalcTypeConnection(x,y,Rung);
+			break;
 #ifdef OLD_TIMERS_MONOS_SUPPORT
-				case ELE_TIMER:
-					CalcTypeTimer(x,y,Rung);
-					break;
-				case ELE_MONOSTABLE:
-					CalcTypeMonostable(x,y,Rung);
-					break;
+		case ELE_TIMER:
+			CalcTypeTimer(x,y,Rung);
+			break;
+		case ELE_MONOSTABLE:
+			CalcTypeMonostable(x,y,Rung);
+			break;
 #endif
-				case ELE_COUNTER:
-					CalcTypeCounter(x,y,Rung);
-					break;
-				case ELE_TIMER_IEC:
-					CalcTypeTimerIEC(x,y,Rung);
-					break;
-				case ELE_COMPAR:
-					CalcTypeCompar(x,y,Rung);
-					break;
-				case ELE_OUTPUT:
-					CalcTypeOutput(x,y,Rung,FALSE);
-					break;
-				case ELE_OUTPUT_NOT:
-					CalcTypeOutput(x,y,Rung,TRUE);
-					break;
-				case ELE_OUTPUT_SET:
-					CalcTypeOutputSetReset(x,y,Rung,FALSE);
-					break;
-				case ELE_OUTPUT_RESET:
-					CalcTypeOutputSetReset(x,y,Rung,TRUE);
-					break;
-				case ELE_OUTPUT_JUMP:
-					JumpToRung = CalcTypeOutputJump(x,y,Rung);
-					// we will now abort the refresh of the rung immediately...
-					break;
-				case ELE_OUTPUT_CALL:
-					SectionToCall = CalcTypeOutputCall(x,y,Rung);
-					if ( SectionToCall!=-1 )
-					{
-						StrSection * pSubRoutineSection = &SectionArray[ SectionToCall ];
-						if ( pSubRoutineSection->Used && pSubRoutineSection->SubRoutineNumber>=0 )
-							RefreshASection( pSubRoutineSection ); //recursive call! ;-)
-						else
-							debug_printf("Refresh rungs aborted - call to a sub-routine undefined or programmed as main !!!");
-					}
-					break;
-				case ELE_OUTPUT_OPERATE:
-					CalcTypeOutputOperate(x,y,Rung);
-					break;
+		case ELE_COUNTER:
+			CalcTypeCounter(x,y,Rung);
+			break;
+		case ELE_TIMER_IEC:
+			CalcTypeTimerIEC(x,y,Rung);
+			break;
+		case ELE_COMPAR:
+			CalcTypeCompar(x,y,Rung);
+			break;
+		case ELE_OUTPUT:
+			CalcTypeOutput(x,y,Rung,FALSE);
+			break;
+		case ELE_OUTPUT_NOT:
+			CalcTypeOutput(x,y,Rung,TRUE);
+			break;
+		case ELE_OUTPUT_SET:
+			CalcTypeOutputSetReset(x,y,Rung,FALSE);
+			break;
+		case ELE_OUTPUT_RESET:
+			CalcTypeOutputSetReset(x,y,Rung,TRUE);
+			break;
+		case ELE_OUTPUT_JUMP:
+			*JumpToRung = CalcTypeOutputJump(x,y,Rung);
+			// we will now abort the refresh of the rung immediately...
+			break;
+		case ELE_OUTPUT_CALL:
+			SectionToCall = CalcTypeOutputCall(x,y,Rung);
+			if ( SectionToCall!=-1 )
+			{
+				StrSection * pSubRoutineSection = &SectionArray[ SectionToCall ];
+				if ( pSubRoutineSection->Used && pSubRoutineSection->SubRoutineNumber>=0 )
+					RefreshASection( pSubRoutineSection ); //recursive call! ;-)
+				else
+					debug_printf("Refresh rungs aborted - call to a sub-routine undefined or programmed as main !!!");
 			}
-			y++;
-		}while( y<RUNG_HEIGHT && JumpToRung==-1 );
-		y = 0;
-		x++;
+			break;
+		case ELE_OUTPUT_OPERATE:
+			CalcTypeOutputOperate(x,y,Rung);
+			break;
+	}
+}
+
+/* Refresh the cells listed by CompileRung( ), in the order of the grid: */
+/* column per column, each from the top. */
+int RefreshRung(StrRung * Rung, StrCompiledRung * Compiled, int * JumpTo)
+{
+	StrCompiledRung * CompiledRungCalling = CompiledRungUnderCalc;
+	int JumpToRung = -1;
+	int NumCell;
+
+	CompiledRungUnderCalc = Compiled;
+	for (NumCell=0; NumCell<Compiled->NbrCells && JumpToRung==-1; NumCell++)
+	{
+		int Cell = Compiled->Cells[ NumCell ];
+		RefreshElement(Cell/RUNG_HEIGHT,Cell%RUNG_HEIGHT,Rung,&JumpToRung);
+		// after a (J)ump, we abort the refresh of the rung immediately...
 	}
-	while( x<RUNG_WIDTH && JumpToRung==-1 );
+	// back to the rung that (C)alled this section, if any
+	CompiledRungUnderCalc = CompiledRungCalling;
 
 	*JumpTo = JumpToRung;
 	return TRUE;
 }
 
+/* Prepare a rung for RefreshRung( ): the cells to refresh, leaving out */
+/* the empty ones (only drawn, unless linked with the top), the rows */
+/* connected on the left of each, and the code of its expressions. */
+void CompileRung(StrRung * Rung, StrCompiledRung * Compiled, StrArithmCode * Codes)
+{
+	int x,y;
+	Compiled->NbrCells = 0;
+	for (x=0;x<RUNG_WIDTH;x++)
+	{
+		for (y=0;y<RUNG_HEIGHT;y++)
+		{
+			StrElement * pElement = &Rung->Element[x][y];
+			Compiled->RowsOnLeft[x][y] = (x==0)?0:RowsConnectedOnLeft(x,y,Rung);
+			if ( (pElement->Type==ELE_FREE || pElement->Type==ELE_UNUSABLE)
+				&& !pElement->ConnectedWithTop )
+				continue;
+			Compiled->Cells[ Compiled->NbrCells++ ] = x*RUNG_HEIGHT+y;
+			if ( Rung->Used && pElement->VarNum>=0 && pElement->VarNum<NBR_ARITHM_EXPR )
+			{
+				if ( pElement->Type==ELE_COMPAR )
+					CompileArithmExpr(ArithmExpr[pElement->VarNum].Expr,TRUE,&Codes[pElement->VarNum]);
+				if ( pElement->Type==ELE_OUTPUT_OPERATE )
+					CompileArithmExpr(ArithmExpr[pElement->VarNum].Expr,FALSE,&Codes[pElement->VarNum]);
+			}
+		}
+	}
+}
+
+#ifndef RTAPI
+/* Compile all the rungs again, after the editor changed some. */
+/* Done here rather than in the scan, into the copy the scan is not */
+/* using, and given to it for its next scan once complete. */
+void CompileAllRungs(void)
+{
+	int Copy = 1-InfosGene->CompiledCopy;
+	StrCompiledRung * Rungs = &CompiledRungCopies[ Copy*NBR_RUNGS ];
+	StrArithmCode * Codes = &ArithmCodeCopies[ Copy*NBR_ARITHM_EXPR ];
+	int NumRung;
+	int NumExpr;
+	// a scan taken before the last compile can still be using this copy
+	while( atomic_load(&InfosGene->CompiledCopyInUse)==Copy )
+		DoPauseMilliSecs( 1 );
+	for (NumExpr=0; NumExpr<NBR_ARITHM_EXPR; NumExpr++)
+		Codes[NumExpr].Kind = ARITHM_CODE_NONE;
+	for (NumRung=0; NumRung<NBR_RUNGS; NumRung++)
+		CompileRung(&RungArray[NumRung],&Rungs[NumRung],Codes);
+	atomic_store(&InfosGene->CompiledCopy, Copy);
+}
+#endif
+
 
 // we refresh all the rungs of this section.
 // we can (J)ump to another rung in this section.
@@ -760,7 +880,7 @@ void RefreshASection( StrSection * pSection )
 	int MadLoopBreak = 0;
 	do
 	{
-		RefreshRung(&RungArray[NumRung], &Goto);
+		RefreshRung(&RungArray[NumRung], &CompiledRungArray[NumRung], &Goto);
 
 		if ( Goto!=-1 )
 		{
@@ -795,13 +915,29 @@ void ClassicLadder_RefreshAllSections()
 {
 	int ScanMainSection;
 	StrSection * pScanSection;
+	int Copy;
+	long long int StartTime;
 
 	CycleStart();
 
+	// take the rungs last compiled by the editor for all this scan,
+	// checking it has not given another copy before knowing this one is used
+	do
+	{
+		Copy = atomic_load(&InfosGene->CompiledCopy);
+		atomic_store(&InfosGene->CompiledCopyInUse, Copy);
+	}
+	while( atomic_load(&InfosGene->CompiledCopy)!=Copy );
+	CompiledRungArray = &CompiledRungCopies[ Copy*NBR_RUNGS ];
+	ArithmCodeArray = &ArithmCodeCopies[ Copy*NBR_ARITHM_EXPR ];
+
 	for ( ScanMainSection=0; ScanMainSection<NBR_SECTIONS; ScanMainSection++ )
 	{
 
 		pScanSection = &SectionArray[ ScanMainSection ];
+		if ( !pScanSection->Used )
+			continue;
+		StartTime = rtapi_get_time( );
 
 		// current section defined and is a main-section (not a sub-routine)
 		// and in Ladder language ?
@@ -817,9 +953,12 @@ void ClassicLadder_RefreshAllSections()
 			RefreshSequentialPage( pScanSection->SequentialPage );
 		}
 #endif
+		pScanSection->DurationOfLastScan = rtapi_get_time( )-StartTime;
 
 	}// for( )
 
+	atomic_store(&InfosGene->CompiledCopyInUse, -1);
+
 	CycleEnd();
 //TODO: times measures should be moved directly in the module task
 // time measurement has been moved to module_hal.c for EMC
@@ -28,5 +28,6 @@ void PrepareAllDatasBeforeRun(void);
 void InitArithmExpr(void);
 void InitIOConf( void );
 void RefreshASection( StrSection * pSection );
+void CompileAllRungs(void);
 void ClassicLadder_RefreshAllSections(void);
 void CopyRungToRung(StrRung * RungSrc,StrRung * RungDest);
@@ -225,6 +225,17 @@ typedef struct StrRung
 	StrElement Element[RUNG_WIDTH][RUNG_HEIGHT];
 }StrRung;
 
+/* A rung as the realtime side runs it: the cells to refresh in the */
+/* order of the scan (x*RUNG_HEIGHT+y, empty ones left out), and for */
+/* each cell the rows of the column on its left that it is connected */
+/* with (one bit per row), so that StateOnLeft() has nothing to search */
+typedef struct StrCompiledRung
+{
+	int NbrCells;
+	unsigned char Cells[RUNG_WIDTH*RUNG_HEIGHT];
+	unsigned char RowsOnLeft[RUNG_WIDTH][RUNG_HEIGHT];
+}StrCompiledRung;
+
 #ifdef OLD_TIMERS_MONOS_SUPPORT
 typedef struct StrTimer
 {
@@ -284,6 +295,25 @@ typedef struct StrArithmExpr
 	char Expr[ARITHM_EXPR_SIZE];
 }StrArithmExpr;
 
+/* An arithmetic expression parsed once into code for a little stack */
+/* machine (see arithm_eval.c) */
+#define ARITHM_CODE_NONE 0	/* not compiled, the string is evaluated */
+#define ARITHM_CODE_COMPARE 1
+#define ARITHM_CODE_CALC 2
+#define ARITHM_CODE_SIZE (ARITHM_EXPR_SIZE+2)
+typedef struct StrArithmInstr
+{
+	short int Op;
+	short int VarType;
+	int Arg;	/* constant, var offset or count of vars */
+}StrArithmInstr;
+typedef struct StrArithmCode
+{
+	int Kind;	/* ARITHM_CODE_ */
+	int NbrInstr;
+	StrArithmInstr Instr[ARITHM_CODE_SIZE];
+}StrArithmCode;
+
 #define DEVICE_TYPE_DIRECT_ACCESS 0	/* used inb( ) and outb( ) calls */
 #define DEVICE_TYPE_COMEDI 100	/* /dev/comedi0 and following */
 
@@ -326,6 +356,11 @@ typedef struct StrInfosGene
 	
 	/* how time for the last scan of the rungs in ns (if calc on RTLinux side) */
 	int DurationOfLastScan;
+	/* the editor compiles the rungs in turn into two copies: the one to */
+	/* use from the next scan on, and the one the scan under way is using */
+	/* (-1 between scans), that it will not write into */
+	int CompiledCopy;
+	int CompiledCopyInUse;
 	
 	int CurrentSection;
 
@@ -388,6 +423,8 @@ typedef struct StrSection
 	int LastRung;
 	/* if section is in Sequential */
 	int SequentialPage;
+	/* time taken by the last scan of this main section in ns */
+	int DurationOfLastScan;
 }StrSection;
 
 #define LGT_VAR_NAME 10
@@ -936,6 +936,7 @@ static gint PeriodicUpdateDisplay(gpointer data)
 		char TextBuffer[ 20 ];
 		sprintf(TextBuffer , _("%d us"), InfosGene->DurationOfLastScan/1000);
 		gtk_entry_set_text(GTK_ENTRY(DurationOfLastScan),TextBuffer);
+		ManagerDisplayScanTimes( );
 #endif
 		ToggleManagerWindow();
 		if (InfosGene->HideGuiState == GTK_WIDGET_VISIBLE( RungWindow ) )
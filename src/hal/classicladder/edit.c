@@ -829,6 +829,7 @@ void DeleteCurrentRung()
 				}
 			}
 		}
+		CompileAllRungs( );
 	}
 }
 
@@ -850,6 +851,8 @@ void ApplyRungEdited()
 	save_label_comment_edited();
 	CopyRungToRung(&EditDatas.Rung,&RungArray[EditDatas.NumRung]);
 	ApplyNewArithmExpr();
+	/* before linking it, so that it is compiled when first refreshed */
+	CompileAllRungs( );
 
 	/* if we have added or inserted, we will have to */
 	/* modify the links between rungs */
@@ -1370,6 +1370,7 @@ void LoadAllLadderDatas(char * DatasDirectory)
 
 //printf("Prepare all datas before run...\n");
 	PrepareAllDatasBeforeRun( );
+	CompileAllRungs( );
 }
 
 void SaveAllLadderDatas(char * DatasDirectory)
@@ -33,6 +33,10 @@ extern StrMonostable * MonostableArray;
 extern StrCounter * CounterArray;
 extern StrTimerIEC * NewTimerArray;
 extern StrArithmExpr * ArithmExpr;
+extern StrCompiledRung * CompiledRungArray;
+extern StrArithmCode * ArithmCodeArray;
+extern StrCompiledRung * CompiledRungCopies;
+extern StrArithmCode * ArithmCodeCopies;
 extern StrInfosGene * InfosGene;
 extern StrSection * SectionArray;
 #ifdef SEQUENTIAL_SUPPORT
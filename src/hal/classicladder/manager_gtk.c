@@ -53,7 +53,7 @@ void ManagerDisplaySections( )
 {
 	StrSection * pSection;
 	int NumSec;
-	char * RowList[ ] = {"---", "---", "---", "---" };
+	char * RowList[ ] = {"---", "---", "---", "---", "---" };
 	char BufferForSRx[ 10 ];
 	int OneSectionExists = FALSE;
 char buffer_debug[ 50 ];
@@ -82,6 +82,7 @@ char buffer_debug[ 50 ];
 			}
 sprintf( buffer_debug, "F=%d, L=%d, P=%d", pSection->FirstRung, pSection->LastRung, pSection->SequentialPage );
 RowList[ 3 ] = buffer_debug;
+			RowList[ 4 ] = "---";
 			gtk_clist_append( GTK_CLIST(SectionsList), RowList );
 			OneSectionExists = TRUE;
 		}
@@ -90,6 +91,29 @@ RowList[ 3 ] = buffer_debug;
 		gtk_clist_select_row( GTK_CLIST(SectionsList), 0, 0 );
 }
 
+/* the time each section took in its last scan, updated while running */
+void ManagerDisplayScanTimes( )
+{
+	StrSection * pSection;
+	int NumSec;
+	int Row = 0;
+	char Buffer[ 20 ];
+	if ( !GTK_WIDGET_VISIBLE( ManagerWindow ) )
+		return;
+	for ( NumSec=0; NumSec<NBR_SECTIONS; NumSec++ )
+	{
+		pSection = &SectionArray[ NumSec ];
+		if ( pSection->Used )
+		{
+			if ( pSection->SubRoutineNumber>=0 )
+				strcpy( Buffer, "---" ); // counted in the section calling it
+			else
+				sprintf( Buffer, _("%d us"), pSection->DurationOfLastScan/1000 );
+			gtk_clist_set_text( GTK_CLIST(SectionsList), Row++, 4, Buffer );
+		}
+	}
+}
+
 void SelectRowSignal( GtkCList *clist, gint row, gint column, GdkEventButton *event, gpointer user_data)
 {
 	if ( gtk_clist_get_text( GTK_CLIST(SectionsList), row, 0, (gchar **)&pNameSectionSelected ) )
@@ -309,7 +333,7 @@ void ManagerInitGtk()
 {
 	GtkWidget *vbox;
 	GtkWidget *hbox;
-	char * List[ ] = {_("Section Name   "), _("Language    "), _("Type   "), _("debug") };
+	char * List[ ] = {_("Section Name   "), _("Language    "), _("Type   "), _("debug"), _("Scan time") };
 
 	pNameSectionSelected = NULL;
 
@@ -320,7 +344,7 @@ void ManagerInitGtk()
 	gtk_container_add (GTK_CONTAINER (ManagerWindow), vbox);
 	gtk_widget_show (vbox);
 
-	SectionsList = gtk_clist_new_with_titles( /*3*/ 4, List );
+	SectionsList = gtk_clist_new_with_titles( /*3*/ 5, List );
 	gtk_box_pack_start (GTK_BOX(vbox), SectionsList, TRUE, TRUE, 0);
 	gtk_signal_connect(GTK_OBJECT (SectionsList), "select-row",
 		(GtkSignalFunc) SelectRowSignal, 0);
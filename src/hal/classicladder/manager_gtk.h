@@ -14,5 +14,6 @@
 //    along with this program; if not, write to the Free Software
 //    Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
 void ManagerDisplaySections( );
+void ManagerDisplayScanTimes( );
 void ManagerInitGtk();
 void ToggleManagerWindow();
@@ -0,0 +1,237 @@
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; either version 2 of the License, or
+//    (at your option) any later version.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301 USA
+//
+
+// Watches the input pins of halui from a realtime thread and tells
+// halui when one of them changed, so halui does not have to wait for its
+// next poll to notice a button or jog wheel.
+
+#include "rtapi.h"
+#include "rtapi_app.h"
+#include "rtapi_string.h"
+#include "hal.h"
+#include "hal_priv.h"
+
+#ifndef __KERNEL__
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/* module information */
+MODULE_AUTHOR("LinuxCNC");
+MODULE_DESCRIPTION("Pin change notification for halui");
+MODULE_LICENSE("GPL");
+
+static char *comp = "halui";
+RTAPI_MP_STRING(comp, "name of the component whose input pins are watched");
+static int max_pins = 512;
+RTAPI_MP_INT(max_pins, "most pins that can be watched");
+
+typedef struct {
+    hal_pin_t *pin;
+    hal_data_u last;		/* value the last time it was looked at */
+} watch_pin_t;
+
+typedef struct {
+    hal_u32_t *changes;		/* out: counts bursts of changes */
+    hal_u32_t *count;		/* out: number of pins watched */
+    watch_pin_t *pins;
+    int num_pins;
+    int built;			/* the pin table is complete ... */
+    unsigned long gen;		/* ... for this hal_data->topology_gen */
+} watch_t;
+
+static int comp_id;
+static watch_t *watch;
+
+static void watch_pins(void *arg, long period);
+
+int rtapi_app_main(void)
+{
+    int retval;
+
+    if (max_pins < 1) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HALUI_WATCH: ERROR: max_pins must be at least 1\n");
+	return -EINVAL;
+    }
+    comp_id = hal_init("halui_watch");
+    if (comp_id < 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR, "HALUI_WATCH: ERROR: hal_init() failed\n");
+	return -EINVAL;
+    }
+    watch = hal_malloc(sizeof(watch_t));
+    if (watch) {
+	watch->pins = hal_malloc(max_pins * sizeof(watch_pin_t));
+    }
+    if (!watch || !watch->pins) {
+	rtapi_print_msg(RTAPI_MSG_ERR, "HALUI_WATCH: ERROR: hal_malloc() failed\n");
+	hal_exit(comp_id);
+	return -ENOMEM;
+    }
+    watch->num_pins = 0;
+    watch->built = 0;
+    watch->gen = 0;
+
+    retval = hal_pin_u32_new("halui-watch.changes", HAL_OUT,
+	&watch->changes, comp_id);
+    if (retval == 0) {
+	retval = hal_pin_u32_new("halui-watch.pin-count", HAL_OUT,
+	    &watch->count, comp_id);
+    }
+    if (retval == 0) {
+	retval = hal_export_funct("halui-watch", watch_pins, watch, 1, 0,
+	    comp_id);
+    }
+    if (retval != 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HALUI_WATCH: ERROR: exporting pins or function failed\n");
+	hal_exit(comp_id);
+	return retval;
+    }
+    *watch->changes = 0;
+    *watch->count = 0;
+    hal_ready(comp_id);
+    return 0;
+}
+
+void rtapi_app_exit(void)
+{
+    hal_exit(comp_id);
+}
+
+/* The pin's value, wherever its signal keeps it now. The owner's own
+   pointer is only good in the owner's address space, so the pin is
+   followed to its signal like halcmd does. Called with the mutex held. */
+static hal_data_u *pin_value(hal_pin_t *pin)
+{
+    if (pin->signal != 0) {
+	hal_sig_t *sig = SHMPTR(pin->signal);
+	return SHMPTR(sig->data_ptr);
+    }
+    return &(pin->dummysig);
+}
+
+/* Finds the watched component's input pins, once it is ready, and
+   again whenever a pin, signal or parameter anywhere was added, removed
+   or (un)linked, since the pins may have been freed and reused, e.g.
+   when halui was restarted. The pin that halui-watch.changes drives is
+   left out, or every change would cause another. Called with the mutex
+   held; returns 1 if the table was (re)built. */
+static int build_table(watch_t *w)
+{
+    hal_comp_t *owner;
+    hal_pin_t *pin, *self;
+    int n;
+
+    w->built = 0;
+    w->num_pins = 0;
+    *w->count = 0;
+    owner = halpr_find_comp_by_name(comp);
+    if (owner == 0 || !owner->ready) {
+	return 0;
+    }
+    self = halpr_find_pin_by_name("halui-watch.changes");
+    pin = halpr_find_pin_by_owner(owner, 0);
+    while (pin != 0) {
+	if (pin->dir != HAL_OUT && pin->type != HAL_PORT &&
+	    !(pin->signal != 0 && self != 0 && pin->signal == self->signal)) {
+	    if (w->num_pins == max_pins) {
+		rtapi_print_msg(RTAPI_MSG_ERR,
+		    "HALUI_WATCH: ERROR: %s has more than %d input pins\n",
+		    comp, max_pins);
+		break;
+	    }
+	    w->pins[w->num_pins].pin = pin;
+	    w->num_pins++;
+	}
+	pin = halpr_find_pin_by_owner(owner, pin);
+    }
+    for (n = 0; n < w->num_pins; n++) {
+	w->pins[n].last = *pin_value(w->pins[n].pin);
+    }
+    *w->count = w->num_pins;
+    w->gen = hal_data->topology_gen;
+    w->built = 1;
+    return 1;
+}
+
+static int changed(watch_pin_t *p)
+{
+    hal_data_u *d = pin_value(p->pin);
+    int result;
+
+    switch (p->pin->type) {
+    case HAL_BIT:
+	result = d->b != p->last.b;
+	break;
+    case HAL_FLOAT:
+	result = d->f != p->last.f;
+	break;
+    case HAL_S32:
+	result = d->s != p->last.s;
+	break;
+    case HAL_U32:
+	result = d->u != p->last.u;
+	break;
+    default:
+	result = 0;
+	break;
+    }
+    p->last = *d;
+    return result;
+}
+
+/* halui waits on the changes pin with a futex between its polls. A
+   shared futex works across processes on the same HAL memory, so this
+   is only possible where the thread is in a userspace process; with
+   kernel realtime halui just sees the count at its next poll. */
+static void wake_halui(hal_u32_t *changes)
+{
+#ifndef __KERNEL__
+    syscall(SYS_futex, (void *) changes, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+#endif
+}
+
+static void watch_pins(void *arg, long period)
+{
+    watch_t *w = arg;
+    int n, any = 0;
+
+    /* The HAL mutex is only tried, never waited for: while halcmd or
+       halui holds it the pins are looked at in a later period. */
+    if (rtapi_mutex_try(&(hal_data->mutex)) != 0) {
+	return;
+    }
+    if (!w->built || w->gen != hal_data->topology_gen) {
+	/* a relinked pin may have a new value */
+	any = build_table(w);
+    } else {
+	for (n = 0; n < w->num_pins; n++) {
+	    if (changed(&w->pins[n])) {
+		any = 1;
+	    }
+	}
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+
+    /* halui looks at every pin itself once woken, so one count covers
+       all the pins that changed together */
+    if (any) {
+	(*w->changes)++;
+	wake_halui(w->changes);
+    }
+}
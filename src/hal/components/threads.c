@@ -16,7 +16,8 @@
     It will mostly be used for testing - when EMC is run normally,
     the motion module creates all the neccessary threads.
     
-    The module has three pairs of parameters, "name1, period1", etc.
+    The module has three sets of parameters, "name1, period1, fp1,
+    cpu1", etc.
 */
 
 /** Copyright (C) 2003 John Kasunich
@@ -63,18 +64,24 @@ static int fp1 = 1;		/* use floating point? default = yes */
 RTAPI_MP_INT(fp1, "thread1 uses floating point");
 static long period1 = 1000000;	/* thread period - default = 1ms thread */
 RTAPI_MP_LONG(period1,  "thread1 period (nsecs)");
+static int cpu1 = -1;		/* CPU to run on, default = the RT one */
+RTAPI_MP_INT(cpu1, "thread1 CPU");
 static char *name2 = NULL;	/* name of thread */
 RTAPI_MP_STRING(name2, "name of thread 2");
 static int fp2 = 1;		/* use floating point? default = yes */
 RTAPI_MP_INT(fp2, "thread2 uses floating point");
 static long period2 = 0;	/* thread period - default = no thread */
 RTAPI_MP_LONG(period2, "thread2 period (nsecs)");
+static int cpu2 = -1;		/* CPU to run on, default = the RT one */
+RTAPI_MP_INT(cpu2, "thread2 CPU");
 static char *name3 = NULL;	/* name of thread */
 RTAPI_MP_STRING(name3, "name of thread 3");
 static int fp3 = 1;		/* use floating point? default = yes */
 RTAPI_MP_INT(fp3, "thread1 uses floating point");
 static long period3 = 0;	/* thread period - default = no thread */
 RTAPI_MP_LONG(period3, "thread3 period (nsecs)");
+static int cpu3 = -1;		/* CPU to run on, default = the RT one */
+RTAPI_MP_INT(cpu3, "thread3 CPU");
 
 /***********************************************************************
 *                STRUCTURES AND GLOBAL VARIABLES                       *
@@ -106,7 +113,7 @@ int rtapi_app_main(void)
     /* was 'period' specified in the insmod command? */
     if ((period1 > 0) && (name1 != NULL) && (*name1 != '\0')) {
 	/* create a thread */
-	retval = hal_create_thread(name1, period1, fp1);
+	retval = hal_create_thread_cpu(name1, period1, fp1, cpu1);
 	if (retval < 0) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"THREADS: ERROR: could not create thread '%s'\n", name1);
@@ -118,7 +125,7 @@ int rtapi_app_main(void)
     }
     if ((period2 > 0) && (name2 != NULL) && (*name2 != '\0')) {
 	/* create a thread */
-	retval = hal_create_thread(name2, period2, fp2);
+	retval = hal_create_thread_cpu(name2, period2, fp2, cpu2);
 	if (retval < 0) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"THREADS: ERROR: could not create thread '%s'\n", name2);
@@ -130,7 +137,7 @@ int rtapi_app_main(void)
     }
     if ((period3 > 0) && (name3 != NULL) && (*name3 != '\0')) {
 	/* create a thread */
-	retval = hal_create_thread(name3, period3, fp3);
+	retval = hal_create_thread_cpu(name3, period3, fp3, cpu3);
 	if (retval < 0) {
 	    rtapi_print_msg(RTAPI_MSG_ERR,
 		"THREADS: ERROR: could not create thread '%s'\n", name3);
@@ -661,6 +661,19 @@ extern int hal_export_funct(const char *name, void (*funct) (void *, long),
 extern int hal_create_thread(const char *name, unsigned long period_nsec,
     int uses_fp);
 
+/** hal_create_thread_cpu() is hal_create_thread() for a thread that
+    runs on CPU 'cpu_id', or -1 for the default realtime CPU.
+    Threads on different CPUs run at the same time, so one can be
+    part way through its functions while another reads its pins.
+    Each pin or signal value is read and written as a whole, and a
+    thread sees everything another thread wrote before that thread
+    last finished its function list; but a set of signals written
+    together is only seen as a consistent set by functions in the
+    same thread.
+*/
+extern int hal_create_thread_cpu(const char *name, unsigned long period_nsec,
+    int uses_fp, int cpu_id);
+
 /** hal_thread_delete() deletes a realtime thread.
     'name' is the name of the thread, which must have been created
     by 'hal_create_thread()'.
@@ -712,6 +712,7 @@ int hal_pin_new(const char *name, hal_type_t type, hal_pin_dir_t dir,
     rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
     /* make 'data_ptr' point to dummy signal */
     *data_ptr_addr = comp->shmem_base + SHMOFF(&(new->dummysig));
+    hal_data->topology_gen++;
     /* search list for 'name' and insert new structure */
     prev = &(hal_data->pin_list_ptr);
     next = *prev;
@@ -844,6 +845,7 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 	    free_oldname_struct(oldname);
 	}
     }
+    hal_data->topology_gen++;
     /* insert pin back into list in proper place */
     prev = &(hal_data->pin_list_ptr);
     next = *prev;
@@ -876,11 +878,7 @@ int hal_pin_alias(const char *pin_name, const char *alias)
 
 int hal_signal_new(const char *name, hal_type_t type)
 {
-
-    rtapi_intptr_t *prev, next;
-    int cmp;
-    hal_sig_t *new, *ptr;
-    void *data_addr;
+    int retval;
 
     if (hal_data == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
@@ -888,11 +886,6 @@ int hal_signal_new(const char *name, hal_type_t type)
 	return -EINVAL;
     }
 
-    if (strlen(name) > HAL_NAME_LEN) {
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: signal name '%s' is too long\n", name);
-	return -EINVAL;
-    }
     if (hal_data->lock & HAL_LOCK_CONFIG) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: signal_new called while HAL is locked\n");
@@ -902,9 +895,25 @@ int hal_signal_new(const char *name, hal_type_t type)
     rtapi_print_msg(RTAPI_MSG_DBG, "HAL: creating signal '%s'\n", name);
     /* get mutex before accessing shared data */
     rtapi_mutex_get(&(hal_data->mutex));
+    retval = halpr_signal_new(name, type);
+    rtapi_mutex_give(&(hal_data->mutex));
+    return retval;
+}
+
+int halpr_signal_new(const char *name, hal_type_t type)
+{
+    rtapi_intptr_t *prev, next;
+    int cmp;
+    hal_sig_t *new, *ptr;
+    void *data_addr;
+
+    if (strlen(name) > HAL_NAME_LEN) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: signal name '%s' is too long\n", name);
+	return -EINVAL;
+    }
     /* check for an existing signal with the same name */
     if (halpr_find_sig_by_name(name) != 0) {
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: duplicate signal '%s'\n", name);
 	return -EINVAL;
@@ -929,7 +938,6 @@ with the C standard.
         data_addr = shmalloc_up(sizeof(hal_data_u));
     break;
     default:
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: illegal signal type %d'\n", type);
 	return -EINVAL;
@@ -939,7 +947,6 @@ with the C standard.
     new = alloc_sig_struct();
     if ((new == 0) || (data_addr == 0)) {
 	/* alloc failed */
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for signal '%s'\n", name);
 	return -ENOMEM;
@@ -971,6 +978,7 @@ with the C standard.
     new->writers = 0;
     new->bidirs = 0;
     rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
+    hal_data->topology_gen++;
     /* search list for 'name' and insert new structure */
     prev = &(hal_data->sig_list_ptr);
     next = *prev;
@@ -979,7 +987,6 @@ with the C standard.
 	    /* reached end of list, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
 	ptr = SHMPTR(next);
@@ -988,7 +995,6 @@ with the C standard.
 	    /* found the right place for it, insert here */
 	    new->next_ptr = next;
 	    *prev = SHMOFF(new);
-	    rtapi_mutex_give(&(hal_data->mutex));
 	    return 0;
 	}
 	/* didn't find it yet, look at next one */
@@ -1046,8 +1052,7 @@ int hal_link(const char *pin_name, const char *sig_name)
 {
     hal_pin_t *pin;
     hal_sig_t *sig;
-    hal_comp_t *comp;
-    void **data_ptr_addr, *data_addr;
+    int retval;
 
     if (hal_data == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
@@ -1092,59 +1097,62 @@ int hal_link(const char *pin_name, const char *sig_name)
 	    "HAL: ERROR: signal '%s' not found\n", sig_name);
 	return -EINVAL;
     }
-    /* found both pin and signal, are they already connected? */
+    retval = halpr_link(pin, sig);
+    rtapi_mutex_give(&(hal_data->mutex));
+    return retval;
+}
+
+int halpr_link(hal_pin_t *pin, hal_sig_t *sig)
+{
+    hal_comp_t *comp;
+    void **data_ptr_addr, *data_addr;
+
+    /* are they already connected? */
     if (SHMPTR(pin->signal) == sig) {
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_WARN,
-	    "HAL: Warning: pin '%s' already linked to '%s'\n", pin_name, sig_name);
+	    "HAL: Warning: pin '%s' already linked to '%s'\n", pin->name, sig->name);
 	return 0;
     }
     /* is the pin connected to something else? */
     if(pin->signal) {
-	rtapi_mutex_give(&(hal_data->mutex));
-	sig = SHMPTR(pin->signal);
+	hal_sig_t *osig = SHMPTR(pin->signal);
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: pin '%s' is linked to '%s', cannot link to '%s'\n",
-	    pin_name, sig->name, sig_name);
+	    pin->name, osig->name, sig->name);
 	return -EINVAL;
     }
     /* check types */
     if (pin->type != sig->type) {
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: type mismatch '%s' <- '%s'\n", pin_name, sig_name);
+	    "HAL: ERROR: type mismatch '%s' <- '%s'\n", pin->name, sig->name);
 	return -EINVAL;
     }
     /* linking output pin to sig that already has output or I/O pins? */
     if ((pin->dir == HAL_OUT) && ((sig->writers > 0) || (sig->bidirs > 0 ))) {
 	/* yes, can't do that */
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: signal '%s' already has output or I/O pin(s)\n", sig_name);
+	    "HAL: ERROR: signal '%s' already has output or I/O pin(s)\n", sig->name);
 	return -EINVAL;
     }
     /* linking bidir pin to sig that is a port?*/
     if ((pin->dir == HAL_IO) && (pin->type == HAL_PORT)) {
-    rtapi_mutex_give(&(hal_data->mutex));
     rtapi_print_msg(RTAPI_MSG_ERR,
-        "HAL: ERROR: signal '%s' is a port and cannot have I/O pin(s)\n", sig_name);
+        "HAL: ERROR: signal '%s' is a port and cannot have I/O pin(s)\n", sig->name);
     return -EINVAL;
     }
     /* linking bidir pin to sig that already has output pin? */
     if ((pin->dir == HAL_IO) && (sig->writers > 0)) {
 	/* yes, can't do that */
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: signal '%s' already has output pin\n", sig_name);
+	    "HAL: ERROR: signal '%s' already has output pin\n", sig->name);
 	return -EINVAL;
     }
 
     /* linking input pin to port sig that already has an input port? */
     if ((pin->type == HAL_PORT) && (pin->dir == HAL_IN) && (sig->readers > 0)) {
 	/* ports can only have one reader */
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: siganl '%s' can only have one input pin\n", sig_name);
+	    "HAL: ERROR: siganl '%s' can only have one input pin\n", sig->name);
 	return -EINVAL;
     }
     
@@ -1202,8 +1210,7 @@ int hal_link(const char *pin_name, const char *sig_name)
     }
     /* and update the pin */
     pin->signal = SHMOFF(sig);
-    /* done, release the mutex and return */
-    rtapi_mutex_give(&(hal_data->mutex));
+    hal_data->topology_gen++;
     return 0;
 }
 
@@ -1416,6 +1423,7 @@ int hal_param_new(const char *name, hal_type_t type, hal_param_dir_t dir, void *
     new->type = type;
     new->dir = dir;
     rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
+    hal_data->topology_gen++;
     /* search list for 'name' and insert new structure */
     prev = &(hal_data->param_list_ptr);
     next = *prev;
@@ -1646,6 +1654,7 @@ int hal_param_alias(const char *param_name, const char *alias)
 	    free_oldname_struct(oldname);
 	}
     }
+    hal_data->topology_gen++;
     /* insert param back into list in proper place */
     prev = &(hal_data->param_list_ptr);
     next = *prev;
@@ -1806,6 +1815,12 @@ int hal_export_funct(const char *name, void (*funct) (void *, long),
 }
 
 int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
+{
+    return hal_create_thread_cpu(name, period_nsec, uses_fp, -1);
+}
+
+int hal_create_thread_cpu(const char *name, unsigned long period_nsec,
+    int uses_fp, int cpu_id)
 {
     int next, cmp, prev_priority;
     int retval, n;
@@ -1814,7 +1829,8 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
     char buf[HAL_NAME_LEN + 1];
 
     rtapi_print_msg(RTAPI_MSG_DBG,
-	"HAL: creating thread %s, %ld nsec\n", name, period_nsec);
+	"HAL: creating thread %s, %ld nsec, cpu %d\n", name, period_nsec,
+	cpu_id);
     if (hal_data == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: create_thread called before init\n");
@@ -1865,6 +1881,7 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
     }
     /* initialize the structure */
     new->uses_fp = uses_fp;
+    new->cpu_id = cpu_id < 0 ? -1 : cpu_id;
     rtapi_snprintf(new->name, sizeof(new->name), "%s", name);
     /* have to create and start a task to run the thread */
     if (hal_data->thread_list_ptr == 0) {
@@ -1925,12 +1942,12 @@ int hal_create_thread(const char *name, unsigned long period_nsec, int uses_fp)
     /* make priority one lower than previous */
     new->priority = rtapi_prio_next_lower(prev_priority);
     /* create task - owned by library module, not caller */
-    retval = rtapi_task_new(thread_task, new, new->priority,
-	lib_module_id, HAL_STACKSIZE, uses_fp);
+    retval = rtapi_task_new_cpu(thread_task, new, new->priority,
+	lib_module_id, HAL_STACKSIZE, uses_fp, new->cpu_id);
     if (retval < 0) {
 	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL_LIB: could not create task for thread %s\n", name);
+	    "HAL_LIB: could not create task for thread %s: %d\n", name, retval);
 	return -EINVAL;
     }
     new->task_id = retval;
@@ -2031,9 +2048,7 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 {
     hal_thread_t *thread;
     hal_funct_t *funct;
-    hal_list_t *list_root, *list_entry;
-    int n;
-    hal_funct_entry_t *funct_entry;
+    int retval;
 
     if (hal_data == 0) {
 	rtapi_print_msg(RTAPI_MSG_ERR,
@@ -2052,13 +2067,6 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	funct_name, thread_name);
     /* get mutex before accessing data structures */
     rtapi_mutex_get(&(hal_data->mutex));
-    /* make sure position is valid */
-    if (position == 0) {
-	/* zero is not allowed */
-	rtapi_mutex_give(&(hal_data->mutex));
-	rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: bad position: 0\n");
-	return -EINVAL;
-    }
     /* make sure we were given a function name */
     if (funct_name == 0) {
 	/* no name supplied */
@@ -2082,13 +2090,6 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	    "HAL: ERROR: function '%s' not found\n", funct_name);
 	return -EINVAL;
     }
-    /* found the function, is it available? */
-    if ((funct->users > 0) && (funct->reentrant == 0)) {
-	rtapi_mutex_give(&(hal_data->mutex));
-	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: function '%s' may only be added to one thread\n", funct_name);
-	return -EINVAL;
-    }
     /* search thread list for thread_name */
     thread = halpr_find_thread_by_name(thread_name);
     if (thread == 0) {
@@ -2098,11 +2099,34 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	    "HAL: ERROR: thread '%s' not found\n", thread_name);
 	return -EINVAL;
     }
+    retval = halpr_add_funct_to_thread(funct, thread, position);
+    rtapi_mutex_give(&(hal_data->mutex));
+    return retval;
+}
+
+int halpr_add_funct_to_thread(hal_funct_t *funct, hal_thread_t *thread,
+    int position)
+{
+    hal_list_t *list_root, *list_entry;
+    int n;
+    hal_funct_entry_t *funct_entry;
+
+    /* make sure position is valid */
+    if (position == 0) {
+	/* zero is not allowed */
+	rtapi_print_msg(RTAPI_MSG_ERR, "HAL: ERROR: bad position: 0\n");
+	return -EINVAL;
+    }
+    /* is the function available? */
+    if ((funct->users > 0) && (funct->reentrant == 0)) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: function '%s' may only be added to one thread\n", funct->name);
+	return -EINVAL;
+    }
     /* ok, we have thread and function, are they compatible? */
     if ((funct->uses_fp) && (!thread->uses_fp)) {
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
-	    "HAL: ERROR: function '%s' needs FP\n", funct_name);
+	    "HAL: ERROR: function '%s' needs FP\n", funct->name);
 	return -EINVAL;
     }
     /* find insertion point */
@@ -2116,7 +2140,6 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	    list_entry = list_next(list_entry);
 	    if (list_entry == list_root) {
 		/* reached end of list */
-		rtapi_mutex_give(&(hal_data->mutex));
 		rtapi_print_msg(RTAPI_MSG_ERR,
 		    "HAL: ERROR: position '%d' is too high\n", position);
 		return -EINVAL;
@@ -2129,7 +2152,6 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
 	    list_entry = list_prev(list_entry);
 	    if (list_entry == list_root) {
 		/* reached end of list */
-		rtapi_mutex_give(&(hal_data->mutex));
 		rtapi_print_msg(RTAPI_MSG_ERR,
 		    "HAL: ERROR: position '%d' is too low\n", position);
 		return -EINVAL;
@@ -2142,7 +2164,6 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
     funct_entry = alloc_funct_entry_struct();
     if (funct_entry == 0) {
 	/* alloc failed */
-	rtapi_mutex_give(&(hal_data->mutex));
 	rtapi_print_msg(RTAPI_MSG_ERR,
 	    "HAL: ERROR: insufficient memory for thread->function link\n");
 	return -ENOMEM;
@@ -2155,7 +2176,6 @@ int hal_add_funct_to_thread(const char *funct_name, const char *thread_name, int
     list_add_after((hal_list_t *) funct_entry, list_entry);
     /* update the function usage count */
     funct->users++;
-    rtapi_mutex_give(&(hal_data->mutex));
     return 0;
 }
 
@@ -2780,6 +2800,9 @@ static void thread_task(void *arg)
 
     thread = arg;
     while (1) {
+	/* threads on other CPUs published their last period before
+	   they waited; see it all before reading any pins */
+	atomic_thread_fence(memory_order_acquire);
 	if (hal_data->threads_running > 0) {
 	    /* point at first function on function list */
 	    funct_root = (hal_funct_entry_t *) & (thread->funct_list);
@@ -2815,6 +2838,8 @@ static void thread_task(void *arg)
 	        thread->maxtime = *(thread->runtime);
 	    }
 	}
+	/* and publish this one */
+	atomic_thread_fence(memory_order_release);
 	/* wait until next period */
 	rtapi_wait();
     }
@@ -2848,6 +2873,7 @@ static int init_hal_data(void)
     hal_data->sig_list_ptr = 0;
     hal_data->param_list_ptr = 0;
     hal_data->funct_list_ptr = 0;
+    hal_data->topology_gen = 0;
     hal_data->thread_list_ptr = 0;
     hal_data->base_period = 0;
     hal_data->threads_running = 0;
@@ -3280,6 +3306,7 @@ static void unlink_pin(hal_pin_t * pin)
     }
     /* mark pin as unlinked */
     pin->signal = 0;
+    hal_data->topology_gen++;
     }
 }
 
@@ -3287,6 +3314,7 @@ static void free_pin_struct(hal_pin_t * pin)
 {
 
     unlink_pin(pin);
+    hal_data->topology_gen++;
     /* clear contents of struct */
     if ( pin->oldname != 0 ) free_oldname_struct(SHMPTR(pin->oldname));
     pin->data_ptr_addr = 0;
@@ -3305,6 +3333,7 @@ static void free_sig_struct(hal_sig_t * sig)
 {
     hal_pin_t *pin;
 
+    hal_data->topology_gen++;
     /* look for pins linked to this signal */
     pin = halpr_find_pin_by_sig(sig, 0);
     while (pin != 0) {
@@ -3327,6 +3356,7 @@ static void free_sig_struct(hal_sig_t * sig)
 
 static void free_param_struct(hal_param_t * p)
 {
+    hal_data->topology_gen++;
     /* clear contents of struct */
     if ( p->oldname != 0 ) free_oldname_struct(SHMPTR(p->oldname));
     p->data_ptr = 0;
@@ -4125,6 +4155,7 @@ EXPORT_SYMBOL(hal_set_constructor);
 EXPORT_SYMBOL(hal_export_funct);
 
 EXPORT_SYMBOL(hal_create_thread);
+EXPORT_SYMBOL(hal_create_thread_cpu);
 
 EXPORT_SYMBOL(hal_add_funct_to_thread);
 EXPORT_SYMBOL(hal_del_funct_from_thread);
@@ -4146,6 +4177,9 @@ EXPORT_SYMBOL(halpr_find_param_by_owner);
 EXPORT_SYMBOL(halpr_find_funct_by_owner);
 
 EXPORT_SYMBOL(halpr_find_pin_by_sig);
+EXPORT_SYMBOL(halpr_signal_new);
+EXPORT_SYMBOL(halpr_link);
+EXPORT_SYMBOL(halpr_add_funct_to_thread);
 
 EXPORT_SYMBOL(hal_pin_alias);
 EXPORT_SYMBOL(hal_param_alias);
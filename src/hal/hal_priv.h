@@ -201,6 +201,8 @@ typedef struct {
     int exact_base_period;      /* if set, pretend that rtapi satisfied our
 				   period request exactly */
     unsigned char lock;         /* hal locking, can be one of the HAL_LOCK_* types */
+    unsigned long topology_gen; /* changes whenever a pin, signal or parameter
+				   is added, removed, renamed or (un)linked */
 } hal_data_t;
 
 /** HAL 'component' data structure.
@@ -307,6 +309,7 @@ typedef struct {
     long int period;		/* period of the thread, in nsec */
     int priority;		/* priority of the thread */
     int task_id;		/* ID of the task that runs this thread */
+    int cpu_id;			/* CPU it was asked to run on, or -1 */
     hal_s32_t* runtime;	/* (pin) duration of last run, in CPU cycles */
     hal_s32_t maxtime;	/* (param) duration of longest run, in CPU cycles */
     hal_list_t funct_list;	/* list of functions to run */
@@ -337,7 +340,7 @@ typedef struct {
 */
 
 #define HAL_KEY   0x48414C32	/* key used to open HAL shared memory */
-#define HAL_VER   0x0000000F	/* version code */
+#define HAL_VER   0x00000011	/* version code */
 #define HAL_SIZE  (85*4096)
 #define HAL_PSEUDO_COMP_PREFIX "__" /* prefix to identify a pseudo component */
 
@@ -435,6 +438,17 @@ extern hal_funct_t *halpr_find_funct_by_owner(hal_comp_t * owner,
 */
 extern hal_pin_t *halpr_find_pin_by_sig(hal_sig_t * sig, hal_pin_t * start);
 
+/** These do the work of hal_signal_new(), hal_link() and
+    hal_add_funct_to_thread() for a caller that already holds the HAL
+    mutex, so that a batch of changes can be made under a single hold
+    of it (see 'halcmd -b').  They do not check HAL_LOCK_CONFIG; the
+    caller must.
+*/
+extern int halpr_signal_new(const char *name, hal_type_t type);
+extern int halpr_link(hal_pin_t * pin, hal_sig_t * sig);
+extern int halpr_add_funct_to_thread(hal_funct_t * funct,
+    hal_thread_t * thread, int position);
+
 
 /** hal_port_alloc allocates a new empty hal_port having a buffer of size bytes. 
     returns a negative value on failure or a hal_port_t which can be used with
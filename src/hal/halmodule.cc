@@ -1052,6 +1052,352 @@ PyObject *get_value(PyObject *self, PyObject *args) {
 }
 
 
+/*######################################*/
+/* Handles: a pin, param or signal looked up by name once, then read
+   and written straight in shared memory. The item is looked up again
+   whenever the HAL topology changed, and where its value is comes from
+   the item on every access. */
+
+enum halhandle_kind { HANDLE_PIN, HANDLE_PARAM, HANDLE_SIG };
+
+struct pyhalhandle {
+    PyObject_HEAD
+    halhandle_kind kind;
+    hal_type_t type;
+    int offset;		/* of the hal_pin_t, hal_param_t or hal_sig_t */
+    unsigned long gen;	/* hal_data->topology_gen when it was looked up */
+    char *name;
+};
+
+static const char *handle_obj_name(pyhalhandle *self) {
+    switch(self->kind) {
+        case HANDLE_PIN: return ((hal_pin_t *)SHMPTR(self->offset))->name;
+        case HANDLE_PARAM: return ((hal_param_t *)SHMPTR(self->offset))->name;
+        case HANDLE_SIG: return ((hal_sig_t *)SHMPTR(self->offset))->name;
+    }
+    return "";
+}
+
+// This function assumes that the mutex is held
+static bool handle_lookup(pyhalhandle *self, const char *name) {
+    hal_param_t *param;
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+
+    if((param = halpr_find_param_by_name(name))) {
+        self->kind = HANDLE_PARAM;
+        self->type = param->type;
+        self->offset = SHMOFF(param);
+    } else if((pin = halpr_find_pin_by_name(name))) {
+        self->kind = HANDLE_PIN;
+        self->type = pin->type;
+        self->offset = SHMOFF(pin);
+    } else if((sig = halpr_find_sig_by_name(name))) {
+        self->kind = HANDLE_SIG;
+        self->type = sig->type;
+        self->offset = SHMOFF(sig);
+    } else {
+        return false;
+    }
+    self->gen = hal_data->topology_gen;
+    return true;
+}
+
+// Where the value is now. After any pin, param or signal was added,
+// removed, renamed or (un)linked the item is looked up again by name,
+// since it may have gone away (say its component was unloaded and loaded
+// again) and its memory been reused.
+static void *handle_ptr(pyhalhandle *self) {
+    if(self->gen != hal_data->topology_gen) {
+        rtapi_mutex_get(&(hal_data->mutex));
+        bool found = handle_lookup(self, self->name);
+        rtapi_mutex_give(&(hal_data->mutex));
+        if(!found) {
+            PyErr_Format(PyExc_RuntimeError,
+                "pin / param / signal %s no longer exists", self->name);
+            return NULL;
+        }
+    }
+    switch(self->kind) {
+        case HANDLE_PARAM: {
+            hal_param_t *param = (hal_param_t *)SHMPTR(self->offset);
+            return SHMPTR(param->data_ptr);
+        }
+        case HANDLE_SIG: {
+            hal_sig_t *sig = (hal_sig_t *)SHMPTR(self->offset);
+            return SHMPTR(sig->data_ptr);
+        }
+        case HANDLE_PIN: {
+            hal_pin_t *pin = (hal_pin_t *)SHMPTR(self->offset);
+            if(pin->signal != 0) {
+                hal_sig_t *sig = (hal_sig_t *)SHMPTR(pin->signal);
+                return SHMPTR(sig->data_ptr);
+            }
+            return &(pin->dummysig);
+        }
+    }
+    return NULL;
+}
+
+static PyObject *pyhalhandle_get(PyObject *_self, PyObject *) {
+    pyhalhandle *self = (pyhalhandle *)_self;
+    void *d_ptr = handle_ptr(self);
+    if(!d_ptr) return NULL;
+
+    switch(self->type) {
+        case HAL_BIT: return to_python((bool)*(hal_bit_t *)d_ptr);
+        case HAL_U32: return to_python((unsigned)*(hal_u32_t *)d_ptr);
+        case HAL_S32: return to_python((int)*(hal_s32_t *)d_ptr);
+        case HAL_FLOAT: return to_python((double)*(hal_float_t *)d_ptr);
+        default: ;
+    }
+    PyErr_Format(pyhal_error_type, "Invalid item type %d", self->type);
+    return NULL;
+}
+
+static PyObject *pyhalhandle_set(PyObject *_self, PyObject *value) {
+    pyhalhandle *self = (pyhalhandle *)_self;
+    void *d_ptr = handle_ptr(self);
+    if(!d_ptr) return NULL;
+
+    // the same rules as set_p and halcmd's sets
+    switch(self->kind) {
+        case HANDLE_PIN: {
+            hal_pin_t *pin = (hal_pin_t *)SHMPTR(self->offset);
+            if(pin->dir == HAL_OUT) {
+                PyErr_Format(PyExc_RuntimeError, "pin not writable");
+                return NULL;
+            }
+            if(pin->signal != 0) {
+                PyErr_Format(PyExc_RuntimeError, "pin connected to signal");
+                return NULL;
+            }
+            break;
+        }
+        case HANDLE_PARAM:
+            if(((hal_param_t *)SHMPTR(self->offset))->dir == HAL_RO) {
+                PyErr_Format(PyExc_RuntimeError, "param not writable");
+                return NULL;
+            }
+            break;
+        case HANDLE_SIG:
+            if(((hal_sig_t *)SHMPTR(self->offset))->writers > 0) {
+                PyErr_Format(PyExc_RuntimeError, "signal has a writer");
+                return NULL;
+            }
+            break;
+    }
+
+    switch(self->type) {
+        case HAL_BIT:
+            *(hal_bit_t *)d_ptr = PyObject_IsTrue(value);
+            break;
+        case HAL_FLOAT: {
+            double tmp;
+            if(!from_python(value, &tmp)) return NULL;
+            *(hal_float_t *)d_ptr = tmp;
+            break;
+        }
+        case HAL_U32: {
+            uint32_t tmp;
+            if(!from_python(value, &tmp)) return NULL;
+            *(hal_u32_t *)d_ptr = tmp;
+            break;
+        }
+        case HAL_S32: {
+            int32_t tmp;
+            if(!from_python(value, &tmp)) return NULL;
+            *(hal_s32_t *)d_ptr = tmp;
+            break;
+        }
+        default:
+            PyErr_Format(pyhal_error_type, "Invalid item type %d", self->type);
+            return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *pyhalhandle_get_type(PyObject *_self, PyObject *) {
+    pyhalhandle *self = (pyhalhandle *)_self;
+    return PyInt_FromLong(self->type);
+}
+
+static PyObject *pyhalhandle_get_name(PyObject *_self, PyObject *) {
+    pyhalhandle *self = (pyhalhandle *)_self;
+    return PyString_FromString(self->name);
+}
+
+static PyObject *pyhalhandle_repr(PyObject *_self) {
+    pyhalhandle *self = (pyhalhandle *)_self;
+    static const char *kinds[] = {"pin", "param", "signal"};
+    return PyString_FromFormat("<hal handle %s \"%s\" %s>", kinds[self->kind],
+            self->name, pin_type2name(self->type));
+}
+
+static int pyhalhandle_init(PyObject *_self, PyObject *, PyObject *) {
+    PyErr_Format(PyExc_RuntimeError,
+	    "Cannot be constructed directly, use hal.get_handle()");
+    return -1;
+}
+
+static void pyhalhandle_delete(PyObject *_self) {
+    pyhalhandle *self = (pyhalhandle *)_self;
+
+    if(self->name) free(self->name);
+
+    PyObject_Del(self);
+}
+
+static PyMethodDef halhandle_methods[] = {
+    {"get", pyhalhandle_get, METH_NOARGS, "Get the value"},
+    {"set", pyhalhandle_set, METH_O, "Set the value"},
+    {"get_type", pyhalhandle_get_type, METH_NOARGS, "Get the HAL type"},
+    {"get_name", pyhalhandle_get_name, METH_NOARGS, "Get the name"},
+    {NULL},
+};
+
+static 
+PyTypeObject halhandle_type = {
+    PyObject_HEAD_INIT(NULL)
+    0,                         /*ob_size*/
+    "hal.handle",              /*tp_name*/
+    sizeof(pyhalhandle),       /*tp_basicsize*/
+    0,                         /*tp_itemsize*/
+    pyhalhandle_delete,        /*tp_dealloc*/
+    0,                         /*tp_print*/
+    0,                         /*tp_getattr*/
+    0,                         /*tp_setattr*/
+    0,                         /*tp_compare*/
+    pyhalhandle_repr,          /*tp_repr*/
+    0,                         /*tp_as_number*/
+    0,                         /*tp_as_sequence*/
+    0,                         /*tp_as_mapping*/
+    0,                         /*tp_hash */
+    0,                         /*tp_call*/
+    0,                         /*tp_str*/
+    0,                         /*tp_getattro*/
+    0,                         /*tp_setattro*/
+    0,                         /*tp_as_buffer*/
+    Py_TPFLAGS_DEFAULT,        /*tp_flags*/
+    "HAL pin, param or signal handle", /*tp_doc*/
+    0,                         /*tp_traverse*/
+    0,                         /*tp_clear*/
+    0,                         /*tp_richcompare*/
+    0,                         /*tp_weaklistoffset*/
+    0,                         /*tp_iter*/
+    0,                         /*tp_iternext*/
+    halhandle_methods,         /*tp_methods*/
+    0,                         /*tp_members*/
+    0,                         /*tp_getset*/
+    0,                         /*tp_base*/
+    0,                         /*tp_dict*/
+    0,                         /*tp_descr_get*/
+    0,                         /*tp_descr_set*/
+    0,                         /*tp_dictoffset*/
+    pyhalhandle_init,          /*tp_init*/
+    0,                         /*tp_alloc*/
+    PyType_GenericNew,         /*tp_new*/
+    0,                         /*tp_free*/
+    0,                         /*tp_is_gc*/
+};
+
+PyObject *get_handle(PyObject *self, PyObject *args) {
+    char *name;
+
+    if(!PyArg_ParseTuple(args, "s", &name)) return NULL;
+    if(!SHMPTR(0)) {
+	PyErr_Format(PyExc_RuntimeError,
+		"Cannot call before creating component");
+	return NULL;
+    }
+
+    pyhalhandle *h = PyObject_New(pyhalhandle, &halhandle_type);
+    if(!h) return NULL;
+    h->name = NULL;
+
+    rtapi_mutex_get(&(hal_data->mutex));
+    bool found = handle_lookup(h, name);
+    if(found) {
+        // the item's own name, so an alias is not looked up every time
+        h->name = strdup(handle_obj_name(h));
+    }
+    rtapi_mutex_give(&(hal_data->mutex));
+
+    if(!found) {
+        Py_DECREF(h);
+        PyErr_Format(PyExc_RuntimeError,
+            "pin / param / signal %s not found", name);
+        return NULL;
+    }
+    if(!h->name) {
+        Py_DECREF(h);
+        return PyErr_NoMemory();
+    }
+    return (PyObject *)h;
+}
+
+/* Read many handles at once: into a list, or as doubles into a writable
+   buffer such as a numpy float64 array */
+PyObject *get_values(PyObject *self, PyObject *args) {
+    PyObject *handles, *buffer = NULL;
+
+    if(!PyArg_ParseTuple(args, "O|O", &handles, &buffer)) return NULL;
+
+    PyObject *seq = PySequence_Fast(handles, "handles must be a sequence");
+    if(!seq) return NULL;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    PyObject **items = PySequence_Fast_ITEMS(seq);
+
+    for(Py_ssize_t i = 0; i < n; i++) {
+        if(!PyObject_TypeCheck(items[i], &halhandle_type)) {
+            Py_DECREF(seq);
+            PyErr_Format(PyExc_TypeError, "item %zd is not a hal.handle", i);
+            return NULL;
+        }
+    }
+
+    if(!buffer || buffer == Py_None) {
+        PyObject *result = PyList_New(n);
+        if(!result) { Py_DECREF(seq); return NULL; }
+        for(Py_ssize_t i = 0; i < n; i++) {
+            PyObject *v = pyhalhandle_get(items[i], NULL);
+            if(!v) { Py_DECREF(result); Py_DECREF(seq); return NULL; }
+            PyList_SET_ITEM(result, i, v);
+        }
+        Py_DECREF(seq);
+        return result;
+    }
+
+    void *buf;
+    Py_ssize_t len;
+    if(PyObject_AsWriteBuffer(buffer, &buf, &len) < 0) {
+        Py_DECREF(seq);
+        return NULL;
+    }
+    if(len < n * (Py_ssize_t)sizeof(double)) {
+        Py_DECREF(seq);
+        PyErr_Format(PyExc_ValueError,
+            "buffer holds %zd doubles, %zd needed", len / (Py_ssize_t)sizeof(double), n);
+        return NULL;
+    }
+    double *out = (double *)buf;
+    for(Py_ssize_t i = 0; i < n; i++) {
+        pyhalhandle *h = (pyhalhandle *)items[i];
+        void *d_ptr = handle_ptr(h);
+        if(!d_ptr) { Py_DECREF(seq); return NULL; }
+        switch(h->type) {
+            case HAL_BIT: out[i] = *(hal_bit_t *)d_ptr; break;
+            case HAL_U32: out[i] = *(hal_u32_t *)d_ptr; break;
+            case HAL_S32: out[i] = *(hal_s32_t *)d_ptr; break;
+            case HAL_FLOAT: out[i] = *(hal_float_t *)d_ptr; break;
+            default: out[i] = 0; break;
+        }
+    }
+    Py_DECREF(seq);
+    Py_RETURN_NONE;
+}
+
+
 
 
 struct shmobject {
@@ -1451,6 +1797,10 @@ PyMethodDef module_methods[] = {
 	"set pin value"},
     {"get_value", get_value, METH_VARARGS,
 	".get_value('name'}: Gets the pin, param or signal value"},
+    {"get_handle", get_handle, METH_VARARGS,
+	".get_handle('name'): Look up a pin, param or signal once; the handle's get() and set() then go straight to its value"},
+    {"get_values", get_values, METH_VARARGS,
+	".get_values(handles[, buffer]): Read many handles at once, into a list or as doubles into a writable buffer such as a numpy array"},
     {NULL},
 };
 
@@ -1492,10 +1842,12 @@ void init_hal(void) {
     PyType_Ready(&shm_type);
     PyType_Ready(&halpin_type);
     PyType_Ready(&stream_type);
+    PyType_Ready(&halhandle_type);
     PyModule_AddObject(m, "component", (PyObject*)&halobject_type);
     PyModule_AddObject(m, "shm", (PyObject*)&shm_type);
     PyModule_AddObject(m, "item", (PyObject*)&halpin_type);
     PyModule_AddObject(m, "stream", (PyObject*)&stream_type);
+    PyModule_AddObject(m, "handle", (PyObject*)&halhandle_type);
 
     PyModule_AddIntConstant(m, "MSG_NONE", RTAPI_MSG_NONE);
     PyModule_AddIntConstant(m, "MSG_ERR", RTAPI_MSG_ERR);
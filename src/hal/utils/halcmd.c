@@ -134,7 +134,7 @@ void halcmd_shutdown(void) {
 #define FUNCT(x) ((halcmd_func_t)x)
 
 struct halcmd_command halcmd_commands[] = {
-    {"addf",    FUNCT(do_addf_cmd),    A_TWO | A_PLUS },
+    {"addf",    FUNCT(do_addf_cmd),    A_TWO | A_PLUS | A_BATCH },
     {"alias",   FUNCT(do_alias_cmd),   A_THREE },
     {"delf",    FUNCT(do_delf_cmd),    A_TWO | A_OPTIONAL },
     {"delsig",  FUNCT(do_delsig_cmd),  A_ONE },
@@ -145,18 +145,18 @@ struct halcmd_command halcmd_commands[] = {
     {"stype",   FUNCT(do_stype_cmd),   A_ONE },
     {"help",    FUNCT(do_help_cmd),    A_ONE | A_OPTIONAL },
     {"linkpp",  FUNCT(do_linkpp_cmd),  A_TWO | A_REMOVE_ARROWS },
-    {"linkps",  FUNCT(do_linkps_cmd),  A_TWO | A_REMOVE_ARROWS },
-    {"linksp",  FUNCT(do_linksp_cmd),  A_TWO | A_REMOVE_ARROWS },
+    {"linkps",  FUNCT(do_linkps_cmd),  A_TWO | A_REMOVE_ARROWS | A_BATCH },
+    {"linksp",  FUNCT(do_linksp_cmd),  A_TWO | A_REMOVE_ARROWS | A_BATCH },
     {"list",    FUNCT(do_list_cmd),    A_ONE | A_PLUS },
     {"loadrt",  FUNCT(do_loadrt_cmd),  A_ONE | A_PLUS },
     {"loadusr", FUNCT(do_loadusr_cmd), A_PLUS | A_TILDE },
     {"lock",    FUNCT(do_lock_cmd),    A_ONE | A_OPTIONAL },
-    {"net",     FUNCT(do_net_cmd),     A_ONE | A_PLUS | A_REMOVE_ARROWS },
-    {"newsig",  FUNCT(do_newsig_cmd),  A_TWO },
+    {"net",     FUNCT(do_net_cmd),     A_ONE | A_PLUS | A_REMOVE_ARROWS | A_BATCH },
+    {"newsig",  FUNCT(do_newsig_cmd),  A_TWO | A_BATCH },
     {"save",    FUNCT(do_save_cmd),    A_TWO | A_OPTIONAL | A_TILDE },
     {"setexact_for_test_suite_only", FUNCT(do_setexact_cmd), A_ZERO },
-    {"setp",    FUNCT(do_setp_cmd),    A_TWO },
-    {"sets",    FUNCT(do_sets_cmd),    A_TWO },
+    {"setp",    FUNCT(do_setp_cmd),    A_TWO | A_BATCH },
+    {"sets",    FUNCT(do_sets_cmd),    A_TWO | A_BATCH },
     {"show",    FUNCT(do_show_cmd),    A_ONE | A_OPTIONAL | A_PLUS},
     {"source",  FUNCT(do_source_cmd),  A_ONE | A_TILDE },
     {"start",   FUNCT(do_start_cmd),   A_ZERO},
@@ -441,9 +441,8 @@ static int parse_cmd1(char **argv) {
     }
 }
 
-int halcmd_parse_cmd(char *tokens[])
+static void sort_commands(void)
 {
-    int retval;
     static int first_time = 1;
 
     if(first_time) {
@@ -452,13 +451,39 @@ int halcmd_parse_cmd(char *tokens[])
                 sizeof(struct halcmd_command), sort_command);
         first_time = 0;
     }
+}
+
+int halcmd_parse_cmd(char *tokens[])
+{
+    int retval;
 
+    sort_commands();
     hal_flag = 1;
     retval = parse_cmd1(tokens);
-    hal_flag = 0;
+    /* a batch keeps the mutex until it is done */
+    hal_flag = halcmd_in_batch;
     return retval;
 }
 
+/* halcmd_batchable() tells whether the command in tokens[] may be part
+   of a batch: it only links, sets or adds functions, under the HAL
+   mutex, and never waits for anything else. */
+int halcmd_batchable(char *tokens[])
+{
+    struct halcmd_command *command;
+
+    if(!tokens[0] || !tokens[0][0])
+        return 0;
+    sort_commands();
+    command = bsearch(tokens[0], halcmd_commands, halcmd_ncommands,
+		sizeof(struct halcmd_command), compare_command);
+    if(!command) {
+        /* pin/param = newvalue is a setp */
+        return tokens[1] && !strcmp(tokens[1], "=");
+    }
+    return (command->type & A_BATCH) != 0;
+}
+
 /* tokenize() sets an array of pointers to each non-whitespace
    token in the input line.  It expects that variable substitution
    and comment removal have already been done, and that any
@@ -46,7 +46,8 @@ extern void halcmd_shutdown();
 extern int halcmd_parse_cmd(char * tokens[]);
 extern int halcmd_parse_line(char * line);
 extern void halcmd_shutdown(void);
-extern int prompt_mode, echo_mode, errorcount, halcmd_done;
+extern int prompt_mode, echo_mode, errorcount, halcmd_done, hal_flag;
+extern int halcmd_batchable(char * tokens[]);
 extern int halcmd_preprocess_line ( char *line, char **tokens);
 
 void halcmd_info(const char *format,...) __attribute__((format(printf,1,2)));
@@ -71,6 +72,7 @@ enum halcmd_argtype {
     A_REMOVE_ARROWS = 0x200, /* removes any arrows from command */
     A_OPTIONAL = 0x400,      /* arguments may be NULL */
     A_TILDE = 0x800,         /* tilde-expand all arguments */
+    A_BATCH = 0x1000,        /* may run in a batch, see halcmd_batch_begin() */
 };
 
 typedef int(*halcmd_func_t)(void);
@@ -50,6 +50,8 @@
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/un.h>
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
@@ -109,6 +111,181 @@ static int match(char **patterns, char *value) {
     return 0;
 }
 
+/* While a batch is open (see halcmd_batch_begin()) halcmd holds the
+   HAL mutex from its first command to its last, so the commands that
+   can be batched only take it themselves outside of one. */
+int halcmd_in_batch = 0;
+
+static void get_mutex(void) {
+    if (!halcmd_in_batch) rtapi_mutex_get(&(hal_data->mutex));
+}
+
+static void give_mutex(void) {
+    if (!halcmd_in_batch) rtapi_mutex_give(&(hal_data->mutex));
+}
+
+/* Nothing in a batch creates pins or parameters, so their names are
+   looked up in a sorted copy of the lists made when it opens instead
+   of walking the lists for every name. Aliases get entries of their
+   own. */
+typedef struct {
+    const char *name;
+    void *item;
+} name_index_t;
+
+static name_index_t *pin_index, *param_index;
+static int num_pins, num_params;
+
+static int compare_index(const void *a, const void *b) {
+    return strcmp(((const name_index_t *)a)->name,
+                  ((const name_index_t *)b)->name);
+}
+
+static int find_index(const void *key, const void *entry) {
+    return strcmp(key, ((const name_index_t *)entry)->name);
+}
+
+static void build_index(void) {
+    hal_pin_t *pin;
+    hal_param_t *param;
+    hal_oldname_t *oldname;
+    int next, n;
+
+    n = 0;
+    for (next = hal_data->pin_list_ptr; next; next = pin->next_ptr) {
+        pin = SHMPTR(next);
+        n += pin->oldname ? 2 : 1;
+    }
+    pin_index = malloc((n + 1) * sizeof(name_index_t));
+    num_pins = 0;
+    for (next = hal_data->pin_list_ptr; pin_index && next; next = pin->next_ptr) {
+        pin = SHMPTR(next);
+        pin_index[num_pins].name = pin->name;
+        pin_index[num_pins++].item = pin;
+        if (pin->oldname) {
+            oldname = SHMPTR(pin->oldname);
+            pin_index[num_pins].name = oldname->name;
+            pin_index[num_pins++].item = pin;
+        }
+    }
+    n = 0;
+    for (next = hal_data->param_list_ptr; next; next = param->next_ptr) {
+        param = SHMPTR(next);
+        n += param->oldname ? 2 : 1;
+    }
+    param_index = malloc((n + 1) * sizeof(name_index_t));
+    num_params = 0;
+    for (next = hal_data->param_list_ptr; param_index && next; next = param->next_ptr) {
+        param = SHMPTR(next);
+        param_index[num_params].name = param->name;
+        param_index[num_params++].item = param;
+        if (param->oldname) {
+            oldname = SHMPTR(param->oldname);
+            param_index[num_params].name = oldname->name;
+            param_index[num_params++].item = param;
+        }
+    }
+    /* the lists are sorted, but the aliases are not in the same order */
+    if (pin_index) qsort(pin_index, num_pins, sizeof(name_index_t), compare_index);
+    if (param_index) qsort(param_index, num_params, sizeof(name_index_t), compare_index);
+}
+
+static void free_index(void) {
+    free(pin_index);
+    free(param_index);
+    pin_index = param_index = 0;
+}
+
+static hal_pin_t *find_pin(const char *name) {
+    name_index_t *e;
+
+    if (!halcmd_in_batch || !pin_index) return halpr_find_pin_by_name(name);
+    e = bsearch(name, pin_index, num_pins, sizeof(name_index_t), find_index);
+    return e ? e->item : 0;
+}
+
+static hal_param_t *find_param(const char *name) {
+    name_index_t *e;
+
+    if (!halcmd_in_batch || !param_index) return halpr_find_param_by_name(name);
+    e = bsearch(name, param_index, num_params, sizeof(name_index_t), find_index);
+    return e ? e->item : 0;
+}
+
+void halcmd_batch_begin(void) {
+    /* tell the signal handler we have the mutex */
+    hal_flag = 1;
+    rtapi_mutex_get(&(hal_data->mutex));
+    halcmd_in_batch = 1;
+    build_index();
+}
+
+void halcmd_batch_end(void) {
+    free_index();
+    halcmd_in_batch = 0;
+    rtapi_mutex_give(&(hal_data->mutex));
+    hal_flag = 0;
+}
+
+/* hal_signal_new(), hal_link() and hal_add_funct_to_thread() with the
+   mutex already held */
+static int new_signal(char *name, hal_type_t type) {
+    if (hal_data->lock & HAL_LOCK_CONFIG) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: signal_new called while HAL is locked\n");
+	return -EPERM;
+    }
+    return halpr_signal_new(name, type);
+}
+
+static int link_pin(char *pin_name, char *sig_name) {
+    hal_pin_t *pin;
+    hal_sig_t *sig;
+
+    if (hal_data->lock & HAL_LOCK_CONFIG) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: link called while HAL locked\n");
+	return -EPERM;
+    }
+    pin = find_pin(pin_name);
+    if (pin == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: pin '%s' not found\n", pin_name);
+	return -EINVAL;
+    }
+    sig = halpr_find_sig_by_name(sig_name);
+    if (sig == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: signal '%s' not found\n", sig_name);
+	return -EINVAL;
+    }
+    return halpr_link(pin, sig);
+}
+
+static int add_funct(char *funct_name, char *thread_name, int position) {
+    hal_funct_t *funct;
+    hal_thread_t *thread;
+
+    if (hal_data->lock & HAL_LOCK_CONFIG) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: add_funct_to_thread called while HAL is locked\n");
+	return -EPERM;
+    }
+    funct = halpr_find_funct_by_name(funct_name);
+    if (funct == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: function '%s' not found\n", funct_name);
+	return -EINVAL;
+    }
+    thread = halpr_find_thread_by_name(thread_name);
+    if (thread == 0) {
+	rtapi_print_msg(RTAPI_MSG_ERR,
+	    "HAL: ERROR: thread '%s' not found\n", thread_name);
+	return -EINVAL;
+    }
+    return halpr_add_funct_to_thread(funct, thread, position);
+}
+
 int do_lock_cmd(char *command)
 {
     int retval=0;
@@ -213,7 +390,9 @@ int do_linkps_cmd(char *pin, char *sig)
 {
     int retval;
 
-    retval = hal_link(pin, sig);
+    get_mutex();
+    retval = link_pin(pin, sig);
+    give_mutex();
     if (retval == 0) {
 	/* print success message */
         halcmd_info("Pin '%s' linked to signal '%s'\n", pin, sig);
@@ -315,7 +494,9 @@ int do_addf_cmd(char *func, char *thread, char **opt) {
 
     if(position_str && *position_str) position = atoi(position_str);
 
-    retval = hal_add_funct_to_thread(func, thread, position);
+    get_mutex();
+    retval = add_funct(func, thread, position);
+    give_mutex();
     if(retval == 0) {
         halcmd_info("Function '%s' added to thread '%s'\n",
                     func, thread);
@@ -401,7 +582,7 @@ static int preflight_net_cmd(char *signal, hal_sig_t *sig, char *pins[]) {
 
     for(i=0; pins[i] && *pins[i]; i++) {
         hal_pin_t *pin = 0;
-        pin = halpr_find_pin_by_name(pins[i]);
+        pin = find_pin(pins[i]);
         if(!pin) {
             halcmd_error("Pin '%s' does not exist\n",
                     pins[i]);
@@ -460,44 +641,47 @@ int do_net_cmd(char *signal, char *pins[]) {
     hal_sig_t *sig;
     int i, retval;
 
-    rtapi_mutex_get(&(hal_data->mutex));
+    get_mutex();
     /* see if signal already exists */
     sig = halpr_find_sig_by_name(signal);
 
     /* verify that everything matches up (pin types, etc) */
     retval = preflight_net_cmd(signal, sig, pins);
     if(retval < 0) {
-        rtapi_mutex_give(&(hal_data->mutex));
+        give_mutex();
         return retval;
     }
 
     {
-	hal_pin_t *pin = halpr_find_pin_by_name(signal);
+	hal_pin_t *pin = find_pin(signal);
 	if(pin) {
 	    halcmd_error(
                     "Signal name '%s' must not be the same as a pin.  "
                     "Did you omit the signal name?\n",
 		signal);
-	    rtapi_mutex_give(&(hal_data->mutex));
+	    give_mutex();
 	    return -ENOENT;
 	}
     }
     if(!sig) {
         /* Create the signal with the type of the first pin */
-        hal_pin_t *pin = halpr_find_pin_by_name(pins[0]);
-        rtapi_mutex_give(&(hal_data->mutex));
+        hal_pin_t *pin = find_pin(pins[0]);
         if(!pin) {
+            give_mutex();
             return -ENOENT;
         }
-        retval = hal_signal_new(signal, pin->type);
-    } else {
-	/* signal already exists */
-        rtapi_mutex_give(&(hal_data->mutex));
+        retval = new_signal(signal, pin->type);
     }
     /* add pins to signal */
     for(i=0; retval == 0 && pins[i] && *pins[i]; i++) {
-        retval = do_linkps_cmd(pins[i], signal);
+        retval = link_pin(pins[i], signal);
+        if (retval == 0) {
+            halcmd_info("Pin '%s' linked to signal '%s'\n", pins[i], signal);
+        } else {
+            halcmd_error("link failed\n");
+        }
     }
+    give_mutex();
 
     return retval;
 }
@@ -523,12 +707,11 @@ int do_newinst_cmd(char *comp_name, char *inst_name) {
     {
         char *argv[MAX_TOK];
         int m = 0, result;
-        argv[m++] = EMC2_BIN_DIR "/rtapi_app";
         argv[m++] = "newinst";
         argv[m++] = comp_name;
         argv[m++] = inst_name;
         argv[m++] = 0;
-        result = hal_systemv(argv);
+        result = rtapi_app_run(argv);
         if(result != 0) {
             halcmd_error( "newinst failed: %d\n", result);
             return -EINVAL;
@@ -613,20 +796,22 @@ int do_newsig_cmd(char *name, char *type)
 {
     int retval;
 
+    get_mutex();
     if (strcasecmp(type, "bit") == 0) {
-	retval = hal_signal_new(name, HAL_BIT);
+	retval = new_signal(name, HAL_BIT);
     } else if (strcasecmp(type, "float") == 0) {
-	retval = hal_signal_new(name, HAL_FLOAT);
+	retval = new_signal(name, HAL_FLOAT);
     } else if (strcasecmp(type, "u32") == 0) {
-	retval = hal_signal_new(name, HAL_U32);
+	retval = new_signal(name, HAL_U32);
     } else if (strcasecmp(type, "s32") == 0) {
-	retval = hal_signal_new(name, HAL_S32);
+	retval = new_signal(name, HAL_S32);
     } else if (strcasecmp(type, "port") == 0) {
-	retval = hal_signal_new(name, HAL_PORT);
+	retval = new_signal(name, HAL_PORT);
     } else {
 	halcmd_error("Unknown signal type '%s'\n", type);
 	retval = -EINVAL;
     }
+    give_mutex();
     if (retval < 0) {
 	halcmd_error("newsig failed\n");
     }
@@ -716,25 +901,25 @@ int do_setp_cmd(char *name, char *value)
 
     halcmd_info("setting parameter '%s' to '%s'\n", name, value);
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    get_mutex();
     /* search param list for name */
-    param = halpr_find_param_by_name(name);
+    param = find_param(name);
     if (param == 0) {
-        pin = halpr_find_pin_by_name(name);
+        pin = find_pin(name);
         if(pin == 0) {
-            rtapi_mutex_give(&(hal_data->mutex));
+            give_mutex();
             halcmd_error("parameter or pin '%s' not found\n", name);
             return -EINVAL;
         } else {
             /* found it */
             type = pin->type;
             if(pin->dir == HAL_OUT) {
-                rtapi_mutex_give(&(hal_data->mutex));
+                give_mutex();
                 halcmd_error("pin '%s' is not writable\n", name);
                 return -EINVAL;
             }
             if(pin->signal != 0) {
-                rtapi_mutex_give(&(hal_data->mutex));
+                give_mutex();
                 halcmd_error("pin '%s' is connected to a signal\n", name);
                 return -EINVAL;
             }
@@ -746,7 +931,7 @@ int do_setp_cmd(char *name, char *value)
         type = param->type;
         /* is it read only? */
         if (param->dir == HAL_RO) {
-            rtapi_mutex_give(&(hal_data->mutex));
+            give_mutex();
             halcmd_error("param '%s' is not writable\n", name);
             return -EINVAL;
         }
@@ -755,7 +940,7 @@ int do_setp_cmd(char *name, char *value)
 
     retval = set_common(type, d_ptr, value);
 
-    rtapi_mutex_give(&(hal_data->mutex));
+    give_mutex();
     if (retval == 0) {
 	/* print success message */
         if(param) {
@@ -858,17 +1043,17 @@ int do_sets_cmd(char *name, char *value)
 
     rtapi_print_msg(RTAPI_MSG_DBG, "setting signal '%s'\n", name);
     /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
+    get_mutex();
     /* search signal list for name */
     sig = halpr_find_sig_by_name(name);
     if (sig == 0) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	give_mutex();
 	halcmd_error("signal '%s' not found\n", name);
 	return -EINVAL;
     }
     /* found it - it have a writer? if it is a port we can set its buffer size */
     if ((sig->type != HAL_PORT) && (sig->writers > 0)) {
-	rtapi_mutex_give(&(hal_data->mutex));
+	give_mutex();
 	halcmd_error("signal '%s' already has writer(s)\n", name);
 	return -EINVAL;
     }
@@ -876,7 +1061,7 @@ int do_sets_cmd(char *name, char *value)
     type = sig->type;
     d_ptr = SHMPTR(sig->data_ptr);
     retval = set_common(type, d_ptr, value);
-    rtapi_mutex_give(&(hal_data->mutex));
+    give_mutex();
     if (retval == 0) {
 	/* print success message */
 	halcmd_info("Signal '%s' set to %s\n", name, value);
@@ -1074,14 +1259,297 @@ int do_status_cmd(char *type)
     return 0;
 }
 
-int do_loadrt_cmd(char *mod_name, char *args[])
+static double rtapi_app_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#if defined(RTAPI_USPACE)
+/* In uspace, the first rtapi_app to run becomes the master and stays
+   until the last module is unloaded; the ones after it only pass their
+   command line to the master over a socket and wait for the result.
+   Rather than start one of those for every loadrt, unloadrt and
+   newinst, halcmd talks to the master itself over a connection it
+   keeps, and can send it several loads before it waits for the first
+   (see halcmd_loadrt_start()).  The connection is set to "onerror
+   stop": once a command fails, the master skips the ones already sent
+   after it until it gets "resume".  Until there is a master, or if it
+   went away, rtapi_app is run as before. */
+static int rtapi_app_fd = -1;
+static int rtapi_app_pending;	/* sent, reply not read yet */
+static int rtapi_app_failed;	/* one failed, the master skips the rest */
+static double rtapi_app_mark;	/* when the master got to the next reply */
+
+static void rtapi_app_disconnect(void)
+{
+    if (rtapi_app_fd >= 0) {
+	close(rtapi_app_fd);
+    }
+    rtapi_app_fd = -1;
+    rtapi_app_pending = 0;
+    rtapi_app_failed = 0;
+}
+
+static int rtapi_app_write(char *argv[])
+{
+    char *buf, *cp;
+    int n, len = 16;
+    ssize_t sent;
+
+    for (n = 0; argv[n]; n++) {
+	len += strlen(argv[n]) + 12;
+    }
+    buf = cp = malloc(len);
+    if (buf == NULL) {
+	return -1;
+    }
+    cp += sprintf(cp, "%d ", n);
+    for (n = 0; argv[n]; n++) {
+	cp += sprintf(cp, "%d %s", (int) strlen(argv[n]), argv[n]);
+    }
+    sent = send(rtapi_app_fd, buf, cp - buf, MSG_NOSIGNAL);
+    n = (sent == cp - buf) ? 0 : -1;
+    free(buf);
+    return n;
+}
+
+static int rtapi_app_read(int *result)
+{
+    int r = 0, neg = 1;
+    char ch;
+
+    while (1) {
+	if (read(rtapi_app_fd, &ch, 1) != 1) {
+	    return -1;
+	}
+	if (ch == '-') {
+	    neg = -1;
+	} else if (ch == ' ') {
+	    *result = r * neg;
+	    return 0;
+	} else {
+	    r = 10 * r + ch - '0';
+	}
+    }
+}
+
+static int rtapi_app_connect(void)
+{
+    struct sockaddr_un addr;
+    char *path = getenv("RTAPI_FIFO_PATH"), *home = getenv("HOME");
+    char *onerror[] = { "onerror", "stop", NULL };
+    int result, len;
+
+    if (rtapi_app_fd >= 0) {
+	return 0;
+    }
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path) {
+	len = snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+    } else if (home) {
+	len = snprintf(addr.sun_path, sizeof(addr.sun_path), "%s/.rtapi_fifo",
+	    home);
+    } else {
+	return -1;
+    }
+    if (len >= (int) sizeof(addr.sun_path)) {
+	return -1;
+    }
+    rtapi_app_fd = socket(PF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (rtapi_app_fd < 0) {
+	return -1;
+    }
+    if (connect(rtapi_app_fd, (struct sockaddr *) &addr, sizeof(addr)) != 0
+	|| rtapi_app_write(onerror) != 0 || rtapi_app_read(&result) != 0) {
+	rtapi_app_disconnect();
+	return -1;
+    }
+    return 0;
+}
+
+/* reads the reply to the oldest command sent, and how long it took the
+   master to get there from the one before; -1 if the master went away
+   without replying */
+static int rtapi_app_reply(int *result, double *elapsed)
+{
+    double now;
+
+    if (rtapi_app_fd < 0 || rtapi_app_pending == 0
+	|| rtapi_app_read(result) != 0) {
+	rtapi_app_disconnect();
+	return -1;
+    }
+    rtapi_app_pending--;
+    now = rtapi_app_now();
+    *elapsed = now - rtapi_app_mark;
+    rtapi_app_mark = now;
+    if (*result != 0) {
+	rtapi_app_failed = 1;
+    }
+    return 0;
+}
+
+/* sends argv (without the program name) to the master; -1 if there is
+   no master to send it to */
+static int rtapi_app_send(char *argv[])
+{
+    char *resume[] = { "resume", NULL };
+    int result;
+    double elapsed;
+
+    if (rtapi_app_connect() != 0) {
+	return -1;
+    }
+    if (rtapi_app_failed) {
+	/* what is left of the last pipeline was skipped */
+	while (rtapi_app_pending > 0) {
+	    if (rtapi_app_reply(&result, &elapsed) != 0) {
+		return -1;
+	    }
+	}
+	if (rtapi_app_write(resume) != 0 || rtapi_app_read(&result) != 0) {
+	    rtapi_app_disconnect();
+	    return -1;
+	}
+	rtapi_app_failed = 0;
+    }
+    if (rtapi_app_pending == 0) {
+	rtapi_app_mark = rtapi_app_now();
+    }
+    if (rtapi_app_write(argv) != 0) {
+	rtapi_app_disconnect();
+	return -1;
+    }
+    rtapi_app_pending++;
+    return 0;
+}
+
+/* runs one rtapi_app command and returns its result */
+static int rtapi_app_run(char *argv[])
+{
+    char *cmd[MAX_TOK+2];
+    int n, result;
+    double elapsed;
+
+    if (rtapi_app_send(argv) == 0 && rtapi_app_reply(&result, &elapsed) == 0) {
+	return result;
+    }
+    cmd[0] = EMC2_BIN_DIR "/rtapi_app";
+    for (n = 0; argv[n] && n < MAX_TOK; n++) {
+	cmd[n+1] = argv[n];
+    }
+    cmd[n+1] = NULL;
+    return hal_systemv(cmd);
+}
+#endif
+
+/* what is left to do once the module is in */
+static int loadrt_done(char *mod_name, char *args[], double elapsed)
 {
     char arg_string[MAX_CMD_LEN+1];
-    int m=0, n=0, retval;
+    int n;
     hal_comp_t *comp;
-    char *argv[MAX_TOK+3];
     char *cp1;
+
+    /* make the args that were passed to the module into a single string */
+    n = 0;
+    arg_string[0] = '\0';
+    while ( args[n] && args[n][0] != '\0' ) {
+	strncat(arg_string, args[n++], MAX_CMD_LEN);
+	strncat(arg_string, " ", MAX_CMD_LEN);
+    }
+    /* allocate HAL shmem for the string */
+    cp1 = hal_malloc(strlen(arg_string)+1);
+    if ( cp1 == NULL ) {
+	halcmd_error("failed to allocate memory for module args\n");
+	return -1;
+    }
+    /* copy string to shmem */
+    strcpy (cp1, arg_string);
+    /* get mutex before accessing shared data */
+    rtapi_mutex_get(&(hal_data->mutex));
+    /* search component list for the newly loaded component */
+    comp = halpr_find_comp_by_name(mod_name);
+    if (comp == 0) {
+	rtapi_mutex_give(&(hal_data->mutex));
+	halcmd_error("module '%s' not loaded\n", mod_name);
+	return -EINVAL;
+    }
+    /* link args to comp struct */
+    comp->insmod_args = SHMOFF(cp1);
+    rtapi_mutex_give(&(hal_data->mutex));
+    /* print success message */
+    halcmd_info("Realtime module '%s' loaded in %.1f ms\n", mod_name,
+	elapsed * 1e3);
+    return 0;
+}
+
+int halcmd_loadrt_start(char *mod_name, char *args[])
+{
+#if defined(RTAPI_USPACE)
+    char *argv[MAX_TOK+3];
+    int m = 0, n = 0;
+
+    if (hal_get_lock()&HAL_LOCK_LOAD) {
+	halcmd_error("HAL is locked, loading of modules is not permitted\n");
+	return -EPERM;
+    }
+    argv[m++] = "load";
+    argv[m++] = mod_name;
+    while ( args[n] && args[n][0] != '\0' ) {
+        argv[m++] = args[n++];
+    }
+    argv[m] = NULL;
+    return rtapi_app_send(argv) == 0 ? 0 : 1;
+#else
+    return 1;
+#endif
+}
+
+int halcmd_loadrt_finish(char *mod_name, char *args[])
+{
+#if defined(RTAPI_USPACE)
+    int skipping = rtapi_app_failed, result;
+    double elapsed;
+
+    if (rtapi_app_reply(&result, &elapsed) != 0) {
+	if (skipping) {
+	    return -ECANCELED;
+	}
+	/* the master went away before it got to this one */
+	return do_loadrt_cmd(mod_name, args);
+    }
+    if (skipping && result == -ECANCELED) {
+	return -ECANCELED;
+    }
+    if (result != 0) {
+	halcmd_error("insmod for %s failed, returned %d\n", mod_name, result);
+	return -1;
+    }
+    return loadrt_done(mod_name, args, elapsed);
+#else
+    return -ENOSYS;
+#endif
+}
+
+int do_loadrt_cmd(char *mod_name, char *args[])
+{
+    int m=0, n=0, retval;
+    char *argv[MAX_TOK+3];
+    double t0 = rtapi_app_now();
 #if defined(RTAPI_USPACE)
+    retval = halcmd_loadrt_start(mod_name, args);
+    if (retval < 0) {
+	return retval;
+    }
+    if (retval == 0) {
+	return halcmd_loadrt_finish(mod_name, args);
+    }
+    /* no master yet, so this rtapi_app becomes it */
     argv[m++] = "-Wn";
     argv[m++] = mod_name;
     argv[m++] = EMC2_BIN_DIR "/rtapi_app";
@@ -1143,6 +1611,7 @@ int do_loadrt_cmd(char *mod_name, char *args[])
     retval = hal_systemv(argv);
 #endif
 
+
     if ( retval != 0 ) {
 	halcmd_error("insmod for %s failed, returned %d\n"
 #if !defined(RTAPI_USPACE)
@@ -1151,36 +1620,7 @@ int do_loadrt_cmd(char *mod_name, char *args[])
         , mod_name, retval );
 	return -1;
     }
-    /* make the args that were passed to the module into a single string */
-    n = 0;
-    arg_string[0] = '\0';
-    while ( args[n] && args[n][0] != '\0' ) {
-	strncat(arg_string, args[n++], MAX_CMD_LEN);
-	strncat(arg_string, " ", MAX_CMD_LEN);
-    }
-    /* allocate HAL shmem for the string */
-    cp1 = hal_malloc(strlen(arg_string)+1);
-    if ( cp1 == NULL ) {
-	halcmd_error("failed to allocate memory for module args\n");
-	return -1;
-    }
-    /* copy string to shmem */
-    strcpy (cp1, arg_string);
-    /* get mutex before accessing shared data */
-    rtapi_mutex_get(&(hal_data->mutex));
-    /* search component list for the newly loaded component */
-    comp = halpr_find_comp_by_name(mod_name);
-    if (comp == 0) {
-	rtapi_mutex_give(&(hal_data->mutex));
-	halcmd_error("module '%s' not loaded\n", mod_name);
-	return -EINVAL;
-    }
-    /* link args to comp struct */
-    comp->insmod_args = SHMOFF(cp1);
-    rtapi_mutex_give(&(hal_data->mutex));
-    /* print success message */
-    halcmd_info("Realtime module '%s' loaded\n", mod_name);
-    return 0;
+    return loadrt_done(mod_name, args, rtapi_app_now() - t0);
 }
 
 int do_delsig_cmd(char *mod_name)
@@ -1346,17 +1786,20 @@ static int unloadrt_comp(char *mod_name)
     char *argv[4];
 
 #if defined(RTAPI_USPACE)
-    argv[0] = EMC2_BIN_DIR "/rtapi_app";
-    argv[1] = "unload";
+    argv[0] = "unload";
+    argv[1] = mod_name;
+    argv[2] = NULL;
+
+    retval = rtapi_app_run(argv);
 #else
     argv[0] = EMC2_BIN_DIR "/linuxcnc_module_helper";
     argv[1] = "remove";
-#endif
     argv[2] = mod_name;
     /* add a NULL to terminate the argv array */
     argv[3] = NULL;
 
     retval = hal_systemv(argv);
+#endif
 
     if ( retval != 0 ) {
 	halcmd_error("rmmod failed, returned %d\n", retval);
@@ -1919,7 +2362,7 @@ static void print_thread_info(char **patterns)
 
     if (scriptmode == 0) {
 	halcmd_output("Realtime Threads:\n");
-	halcmd_output("     Period  FP     Name               (     Time, Max-Time )\n");
+	halcmd_output("     Period  FP     Name                CPU (     Time, Max-Time )\n");
     }
     rtapi_mutex_get(&(hal_data->mutex));
     next_thread = hal_data->thread_list_ptr;
@@ -1943,13 +2386,30 @@ static void print_thread_info(char **patterns)
                     dptr = &(pin->dummysig);
                 }
 
-                halcmd_output(((scriptmode == 0) ? "%11ld  %-3s  %20s ( %8ld, %8ld )\n"
-                                                 : "%ld %s %s %8ld %ld"),
-                              tptr->period,
-                              (tptr->uses_fp ? "YES" : "NO"),
-                              tptr->name,
-                              (long)*(long*)dptr,
-                              (long)tptr->maxtime);
+                char cpu[16];
+                if (tptr->cpu_id < 0) {
+                    snprintf(cpu, sizeof(cpu), "-");
+                } else {
+                    snprintf(cpu, sizeof(cpu), "%d", tptr->cpu_id);
+                }
+                /* the CPU goes after the name, which scripts such as
+                   hal_procs_lib.tcl read as the third field */
+                if (scriptmode == 0) {
+                    halcmd_output("%11ld  %-3s  %20s %4s ( %8ld, %8ld )\n",
+                                  tptr->period,
+                                  (tptr->uses_fp ? "YES" : "NO"),
+                                  tptr->name,
+                                  cpu,
+                                  (long)*(long*)dptr,
+                                  (long)tptr->maxtime);
+                } else {
+                    halcmd_output("%ld %s %s %8ld %ld",
+                                  tptr->period,
+                                  (tptr->uses_fp ? "YES" : "NO"),
+                                  tptr->name,
+                                  (long)*(long*)dptr,
+                                  (long)tptr->maxtime);
+                }
             } else {
                 rtapi_print_msg(RTAPI_MSG_ERR,
                      "unexpected: cannot find time pin for %s thread",tptr->name);
@@ -90,6 +90,22 @@ int hal_systemv(char *const argv[]);
 
 extern int scriptmode, comp_id;
 
+/* Between these, the commands flagged A_BATCH run under one hold of
+   the HAL mutex; no other command may be run. */
+extern void halcmd_batch_begin(void);
+extern void halcmd_batch_end(void);
+extern int halcmd_in_batch;
+
+/* do_loadrt_cmd() in two halves, so that several loads can be sent to
+   rtapi_app before the first is waited for.  halcmd_loadrt_start()
+   returns 0 once the load is sent, and then halcmd_loadrt_finish() must
+   be called for it, in the same order; 1 if the load can't be sent
+   that way and needs do_loadrt_cmd().  halcmd_loadrt_finish() returns
+   -ECANCELED, without a message, for a load skipped because one sent
+   before it failed. */
+extern int halcmd_loadrt_start(char *mod_name, char *args[]);
+extern int halcmd_loadrt_finish(char *mod_name, char *args[]);
+
 RTAPI_END_DECLS
 
 #endif
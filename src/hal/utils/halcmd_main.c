@@ -60,6 +60,8 @@
 #include <search.h>
 
 static int get_input(FILE *srcfile, char *buf, size_t bufsize);
+static int get_command(FILE *srcfile, char **tokens, int *linenumber, int *result);
+static int run_batch(FILE *srcfile, int keep_going);
 static void print_help_general(int showR);
 static int release_HAL_mutex(void);
 static int propose_completion(char *all, char *fragment, int start);
@@ -80,9 +82,9 @@ int main(int argc, char **argv)
     int c, fd;
     int keep_going, retval, errorcount;
     int filemode = 0;
+    int batchmode = 0;
     char *filename = NULL;
     FILE *srcfile = NULL;
-    char raw_buf[MAX_CMD_LEN+1];
     int linenumber = 1;
     char *cf=NULL, *cw=NULL, *cl=NULL;
 
@@ -97,7 +99,7 @@ int main(int argc, char **argv)
     keep_going = 0;
     /* start parsing the command line, options first */
     while(1) {
-        c = getopt(argc, argv, "+RCfi:kqQsvVhe");
+        c = getopt(argc, argv, "+RCbfi:kqQsvVhe");
         if(c == -1) break;
         switch(c) {
             case 'R':
@@ -147,6 +149,10 @@ int main(int argc, char **argv)
 	    case 'f':
                 filemode = 1;
 		break;
+	    case 'b':
+		/* -b = batch, apply links and values together */
+                batchmode = 1;
+		break;
 	    case 'C':
                 cl = getenv("COMP_LINE");
                 cw = getenv("COMP_POINT");
@@ -226,6 +232,8 @@ int main(int argc, char **argv)
     }
 
     if (srcfile && isatty(fileno(srcfile))) {
+        /* a batch needs the whole file before it can run anything */
+        batchmode = 0;
         if (scriptmode) {
             prompt = prompt_script;
         } else {
@@ -252,54 +260,12 @@ int main(int argc, char **argv)
                 errorcount++;
             }
         }
+    } else if (batchmode) {
+        errorcount = run_batch(srcfile, keep_going);
     } else {
-        int   extend_ct = 0; // extend lines with backslash (\)
+	char *tokens[MAX_TOK+1];
 	/* read command line(s) from 'srcfile' */
-	while (get_input(srcfile, raw_buf, MAX_CMD_LEN)) {
-	    char *tokens[MAX_TOK+1];
-            char  eline [(LINELEN + 2) * (MAX_EXTEND_LINES + 1)];
-            char *elineptr;
-            char *elinenext;
-            int   newLinePos;
-
-	    halcmd_set_linenumber(linenumber++);
-
-            newLinePos = (int)strlen(raw_buf) - 1; // interactive
-            if (raw_buf[newLinePos] == '\n') { newLinePos--; }  // tty
-
-            if (newLinePos > 0 && raw_buf[newLinePos] == '\\') { // backslash
-                raw_buf[newLinePos] = 0;
-                newLinePos++;
-                if (!extend_ct) { //first extend
-                    if (prompt == prompt_interactive) prompt = prompt_continue;
-                    elineptr = eline;
-                    strncpy(elineptr,raw_buf,strlen(raw_buf));
-                    elinenext = elineptr + strlen(raw_buf);
-                } else { // subsequent extends
-                    strncpy(elinenext,raw_buf,newLinePos);
-                    elinenext = elinenext + strlen(raw_buf);
-                }
-                *elinenext = 0;
-                extend_ct++;
-                continue; // get next line to extend
-            } else { // no backslash
-                if (extend_ct) { // extend finished
-                    strncpy(elinenext,raw_buf,strlen(raw_buf));
-                    *(eline+strlen(eline)+0)='\n';
-                    elinenext = elinenext + strlen(raw_buf);
-                    *elinenext = 0;
-                    elineptr = eline;
-                }
-            }
-            if (!extend_ct) { elineptr = (char*)raw_buf; }
-            extend_ct = 0;
-            if (prompt == prompt_continue) { prompt = prompt_interactive; }
-
-	    /* remove comments, do var substitution, and tokenise */
-	    retval = halcmd_preprocess_line(elineptr, tokens);
-	    if(echo_mode) {
-	        halcmd_echo("%s\n", eline);
-	    }
+	while (get_command(srcfile, tokens, &linenumber, &retval)) {
 	    if (retval == 0) {
 		/* the "quit" command is not handled by parse_line() */
 		if ( ( strcasecmp(tokens[0],"quit") == 0 ) ||
@@ -323,8 +289,7 @@ int main(int argc, char **argv)
 		/* exit from loop */
 		break;
 	    }
-	} //while get_input()
-        extend_ct=0;
+	} //while get_command()
     }
     /* all done */
     halcmd_shutdown();
@@ -336,6 +301,275 @@ int main(int argc, char **argv)
 
 }
 
+/* get_command() reads one command from 'srcfile', joining lines that
+   end in a backslash, and removes comments, does variable substitution
+   and tokenises it into tokens[].  It returns 0 at the end of the
+   file, otherwise 1 with the result of halcmd_preprocess_line() in
+   *result.  The tokens stay good until the next call.
+*/
+static int get_command(FILE *srcfile, char **tokens, int *linenumber, int *result)
+{
+    char raw_buf[MAX_CMD_LEN+1];
+    static char eline[(LINELEN + 2) * (MAX_EXTEND_LINES + 1)];
+    char *elineptr;
+    char *elinenext = NULL;
+    int   newLinePos;
+    int   extend_ct = 0; // extend lines with backslash (\)
+
+    while (get_input(srcfile, raw_buf, MAX_CMD_LEN)) {
+        halcmd_set_linenumber((*linenumber)++);
+
+        newLinePos = (int)strlen(raw_buf) - 1; // interactive
+        if (raw_buf[newLinePos] == '\n') { newLinePos--; }  // tty
+
+        if (newLinePos > 0 && raw_buf[newLinePos] == '\\') { // backslash
+            raw_buf[newLinePos] = 0;
+            newLinePos++;
+            if (!extend_ct) { //first extend
+                if (prompt == prompt_interactive) prompt = prompt_continue;
+                elineptr = eline;
+                strncpy(elineptr,raw_buf,strlen(raw_buf));
+                elinenext = elineptr + strlen(raw_buf);
+            } else { // subsequent extends
+                strncpy(elinenext,raw_buf,newLinePos);
+                elinenext = elinenext + strlen(raw_buf);
+            }
+            *elinenext = 0;
+            extend_ct++;
+            continue; // get next line to extend
+        } else { // no backslash
+            if (extend_ct) { // extend finished
+                strncpy(elinenext,raw_buf,strlen(raw_buf));
+                *(eline+strlen(eline)+0)='\n';
+                elinenext = elinenext + strlen(raw_buf);
+                *elinenext = 0;
+                elineptr = eline;
+            }
+        }
+        if (!extend_ct) { elineptr = (char*)raw_buf; }
+        if (prompt == prompt_continue) { prompt = prompt_interactive; }
+
+        /* remove comments, do var substitution, and tokenise */
+        *result = halcmd_preprocess_line(elineptr, tokens);
+        if(echo_mode) {
+            halcmd_echo("%s\n", eline);
+        }
+        return 1;
+    }
+    return 0;
+}
+
+/* With -b the file is read and checked in full before any of it runs,
+   so a typo near the end no longer leaves half a machine configured.
+   Then each run of commands that only link, set or add functions (see
+   halcmd_batchable()) between two that load, wait for or show
+   something is applied under a single hold of the HAL mutex, with the
+   pin and parameter names looked up in an index instead of the lists.
+   The commands still run in the order they were written, so the result
+   is the same as without -b.  A run of loadrt commands is sent to
+   rtapi_app all at once (see pipeline_loads()); it still loads them one
+   after the other, since a module may need the symbols, pins or threads
+   of the one before it, but halcmd no longer waits in between.
+*/
+typedef struct {
+    int linenumber;
+    char *buf;
+    char *tokens[MAX_TOK+1];
+} batch_cmd_t;
+
+static double batch_time(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static int save_command(batch_cmd_t *cmd, char **tokens)
+{
+    int n, len = 0;
+    char *cp;
+
+    for (n = 0; n < MAX_TOK && tokens[n][0]; n++) {
+        len += strlen(tokens[n]) + 1;
+    }
+    cmd->buf = cp = malloc(len + 1);
+    if (cp == NULL) {
+        return -ENOMEM;
+    }
+    for (n = 0; n < MAX_TOK && tokens[n][0]; n++) {
+        strcpy(cp, tokens[n]);
+        cmd->tokens[n] = cp;
+        cp += strlen(cp) + 1;
+    }
+    for (; n <= MAX_TOK; n++) {
+        cmd->tokens[n] = "";
+    }
+    return 0;
+}
+
+static int is_loadrt(batch_cmd_t *cmd)
+{
+    return strcmp(cmd->tokens[0], "loadrt") == 0 && cmd->tokens[1][0];
+}
+
+/* Sends the loadrt commands at the start of cmds[] to rtapi_app before
+   it reads any of the results.  Returns how many commands it dealt
+   with: 0 if the first has to be run the usual way after all, else up
+   to and including the first that failed, in which case *failed is
+   set.  The master skips the loads after a failed one, so with -k
+   they are simply tried again. */
+static int pipeline_loads(batch_cmd_t *cmds, int count, int *failed)
+{
+    int started = 0, done, n;
+
+    *failed = 0;
+    while (started < count && is_loadrt(&cmds[started])
+           && halcmd_loadrt_start(cmds[started].tokens[1],
+                                  &cmds[started].tokens[2]) == 0) {
+        started++;
+    }
+    for (done = 0; done < started; done++) {
+        halcmd_set_linenumber(cmds[done].linenumber);
+        if (halcmd_loadrt_finish(cmds[done].tokens[1],
+                                 &cmds[done].tokens[2]) != 0) {
+            *failed = 1;
+            break;
+        }
+    }
+    if (!*failed) {
+        return started;
+    }
+    for (n = done + 1; n < started; n++) {
+        halcmd_loadrt_finish(cmds[n].tokens[1], &cmds[n].tokens[2]);
+    }
+    return done + 1;
+}
+
+static int run_batch(FILE *srcfile, int keep_going)
+{
+    batch_cmd_t *cmds = NULL, *cmd;
+    int num_cmds = 0, max_cmds = 0;
+    char *tokens[MAX_TOK+1];
+    int linenumber = 1, errorcount = 0, retval, n;
+    int batches = 0, batched = 0, others = 0, loads = 0;
+    double t, t_read, t_run = 0, t_batch = 0, t_load = 0;
+
+    /* read and check everything */
+    t = batch_time();
+    while (get_command(srcfile, tokens, &linenumber, &retval)) {
+        if (retval != 0) {
+            errorcount++;
+            continue;
+        }
+        if (tokens[0][0] == '\0') {
+            continue;
+        }
+        if ( ( strcasecmp(tokens[0],"quit") == 0 ) ||
+             ( strcasecmp(tokens[0],"exit") == 0 ) ) {
+            break;
+        }
+        if (num_cmds == max_cmds) {
+            batch_cmd_t *more;
+            max_cmds = max_cmds ? 2 * max_cmds : 256;
+            more = realloc(cmds, max_cmds * sizeof(batch_cmd_t));
+            if (more == NULL) {
+                halcmd_error("out of memory\n");
+                errorcount++;
+                break;
+            }
+            cmds = more;
+        }
+        cmd = &cmds[num_cmds];
+        cmd->linenumber = halcmd_get_linenumber();
+        if (save_command(cmd, tokens) != 0) {
+            halcmd_error("out of memory\n");
+            errorcount++;
+            break;
+        }
+        num_cmds++;
+    }
+    t_read = batch_time() - t;
+
+    /* then run it */
+    if (errorcount == 0 || keep_going) {
+        for (n = 0; n < num_cmds; n++) {
+            char *argv[MAX_TOK+1];
+            int batchable;
+
+            cmd = &cmds[n];
+            batchable = halcmd_batchable(cmd->tokens);
+            if (batchable && !halcmd_in_batch) {
+                t = batch_time();
+                halcmd_batch_begin();
+                batches++;
+            } else if (!batchable && halcmd_in_batch) {
+                halcmd_batch_end();
+                t_batch += batch_time() - t;
+            }
+            if (!batchable) {
+                t = batch_time();
+            }
+            if (is_loadrt(cmd)) {
+                int done, failed;
+
+                done = pipeline_loads(cmd, num_cmds - n, &failed);
+                if (done > 0) {
+                    loads += done;
+                    t_load += batch_time() - t;
+                    n += done - 1;
+                    if ( halcmd_done ) {
+                        errorcount++;
+                        break;
+                    }
+                    if (failed) {
+                        errorcount++;
+                        if (!keep_going) break;
+                    }
+                    continue;
+                }
+            }
+            halcmd_set_linenumber(cmd->linenumber);
+            /* parse_cmd() may change the array, so give it a copy */
+            memcpy(argv, cmd->tokens, sizeof(argv));
+            retval = halcmd_parse_cmd(argv);
+            if (batchable) {
+                batched++;
+            } else {
+                others++;
+                t_run += batch_time() - t;
+            }
+            /* did a signal happen while we were busy? */
+            if ( halcmd_done ) {
+                errorcount++;
+                break;
+            }
+            if ( retval != 0 ) {
+                errorcount++;
+                if (!keep_going) break;
+            }
+        }
+        if (halcmd_in_batch) {
+            halcmd_batch_end();
+            t_batch += batch_time() - t;
+        }
+    }
+
+    if (rtapi_get_msg_level() >= RTAPI_MSG_INFO) {
+        printf("%s: read %d commands in %.1f ms, loaded %d modules"
+               " in %.1f ms, ran %d others in %.1f ms,"
+               " applied %d in %d batches in %.1f ms\n",
+               halcmd_get_filename(), num_cmds, t_read * 1e3,
+               loads, t_load * 1e3, others, t_run * 1e3, batched, batches,
+               t_batch * 1e3);
+    }
+    for (n = 0; n < num_cmds; n++) {
+        free(cmds[n].buf);
+    }
+    free(cmds);
+    return errorcount;
+}
+
 /* release_HAL_mutex() unconditionally releases the hal_mutex
    very useful after a program segfaults while holding the mutex
 */
@@ -405,6 +639,9 @@ static void print_help_general(int showR)
     printf("\nUsage:   halcmd [options] [cmd [args]]\n\n");
     printf("\n         halcmd [options] -f [filename]\n\n");
     printf("options:\n\n");
+    printf("  -b             Batch - read the whole file first, then make the\n");
+    printf("                 links and set the values between two loads at once.\n");
+    printf("                 (Only with -f)\n");
     printf("  -e             echo the commands from stdin to stderr\n");
     printf("  -f [filename]  Read commands from 'filename', not command\n");
     printf("                 line.  If no filename, read from stdin.\n");
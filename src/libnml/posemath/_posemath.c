@@ -27,6 +27,8 @@
 #include <stdio.h>
 #include <stdarg.h>
 #endif
+/* compile the inline Cartesian functions as the exported ones too */
+#define PM_CART_EXPORT
 #include "posemath.h"
 
 #include "rtapi_math.h"
@@ -136,28 +138,36 @@ int pmCartCylConvert(PmCartesian const * const v, PmCylindrical * const c)
 
 int pmSphCartConvert(PmSpherical const * const s, PmCartesian * const v)
 {
-    double _r;
+    double _r, sp, cp, st, ct;
 
-    _r = s->r * sin(s->phi);
-    v->z = s->r * cos(s->phi);
-    v->x = _r * cos(s->theta);
-    v->y = _r * sin(s->theta);
+    sincos(s->phi, &sp, &cp);
+    sincos(s->theta, &st, &ct);
+    _r = s->r * sp;
+    v->z = s->r * cp;
+    v->x = _r * ct;
+    v->y = _r * st;
 
     return pmErrno = 0;
 }
 
 int pmSphCylConvert(PmSpherical const * const s, PmCylindrical * const c)
 {
+    double sp, cp;
+
+    sincos(s->phi, &sp, &cp);
     c->theta = s->theta;
-    c->r = s->r * cos(s->phi);
-    c->z = s->r * sin(s->phi);
+    c->r = s->r * cp;
+    c->z = s->r * sp;
     return pmErrno = 0;
 }
 
 int pmCylCartConvert(PmCylindrical const * const c, PmCartesian * const v)
 {
-    v->x = c->r * cos(c->theta);
-    v->y = c->r * sin(c->theta);
+    double st, ct;
+
+    sincos(c->theta, &st, &ct);
+    v->x = c->r * ct;
+    v->y = c->r * st;
     v->z = c->z;
     return pmErrno = 0;
 }
@@ -584,13 +594,9 @@ int pmZyzMatConvert(PmEulerZyz  const * const zyz, PmRotationMatrix * const m)
     double sa, sb, sg;
     double ca, cb, cg;
 
-    sa = sin(zyz->z);
-    sb = sin(zyz->y);
-    sg = sin(zyz->zp);
-
-    ca = cos(zyz->z);
-    cb = cos(zyz->y);
-    cg = cos(zyz->zp);
+    sincos(zyz->z, &sa, &ca);
+    sincos(zyz->y, &sb, &cb);
+    sincos(zyz->zp, &sg, &cg);
 
     m->x.x = ca * cb * cg - sa * sg;
     m->y.x = -ca * cb * sg - sa * cg;
@@ -644,13 +650,9 @@ int pmZyxMatConvert(PmEulerZyx  const * const zyx, PmRotationMatrix * const m)
     double sa, sb, sg;
     double ca, cb, cg;
 
-    sa = sin(zyx->z);
-    sb = sin(zyx->y);
-    sg = sin(zyx->x);
-
-    ca = cos(zyx->z);
-    cb = cos(zyx->y);
-    cg = cos(zyx->x);
+    sincos(zyx->z, &sa, &ca);
+    sincos(zyx->y, &sb, &cb);
+    sincos(zyx->x, &sg, &cg);
 
     m->x.x = ca * cb;
     m->y.x = ca * sb * sg - sa * cg;
@@ -714,13 +716,9 @@ int pmRpyMatConvert(PmRpy  const * const rpy, PmRotationMatrix * const m)
     double sa, sb, sg;
     double ca, cb, cg;
 
-    sa = sin(rpy->y);
-    sb = sin(rpy->p);
-    sg = sin(rpy->r);
-
-    ca = cos(rpy->y);
-    cb = cos(rpy->p);
-    cg = cos(rpy->r);
+    sincos(rpy->y, &sa, &ca);
+    sincos(rpy->p, &sb, &cb);
+    sincos(rpy->r, &sg, &cg);
 
     m->x.x = ca * cb;
     m->y.x = ca * sb * sg - sa * cg;
@@ -785,13 +783,6 @@ int pmCartCartCompare(PmCartesian const * const v1, PmCartesian const * const v2
     return 1;
 }
 
-int pmCartCartDot(PmCartesian const * const v1, PmCartesian const * const v2, double *d)
-{
-    *d = v1->x * v2->x + v1->y * v2->y + v1->z * v2->z;
-
-    return pmErrno = 0;
-}
-
 int pmCartCartMult(PmCartesian const * const v1, PmCartesian const * const v2,
         PmCartesian * const out)
 {
@@ -812,76 +803,12 @@ int pmCartCartDiv(PmCartesian const * const v1, PmCartesian const * const v2,
     return pmErrno = 0;
 }
 
-int pmCartCartCross(PmCartesian const * const v1, PmCartesian const * const v2,
-        PmCartesian * const vout)
-{
-    if (vout == v1 || vout == v2) {
-        return pmErrno = PM_IMPL_ERR;
-    }
-    vout->x = v1->y * v2->z - v1->z * v2->y;
-    vout->y = v1->z * v2->x - v1->x * v2->z;
-    vout->z = v1->x * v2->y - v1->y * v2->x;
-
-    return pmErrno = 0;
-}
-
 int pmCartInfNorm(PmCartesian const * v, double * out)
 {
     *out = fmax(fabs(v->x),fmax(fabs(v->y),fabs(v->z)));
     return pmErrno = 0;
 }
 
-int pmCartMag(PmCartesian const * const v, double *d)
-{
-    *d = pmSqrt(pmSq(v->x) + pmSq(v->y) + pmSq(v->z));
-
-    return pmErrno = 0;
-}
-
-/** Find square of magnitude of a vector (useful for some calculations to save a sqrt).*/
-int pmCartMagSq(PmCartesian const * const v, double *d)
-{
-    *d = pmSq(v->x) + pmSq(v->y) + pmSq(v->z);
-
-    return pmErrno = 0;
-}
-
-int pmCartCartDisp(PmCartesian const * const v1, PmCartesian const * const v2,
-        double *d)
-{
-    *d = pmSqrt(pmSq(v2->x - v1->x) + pmSq(v2->y - v1->y) + pmSq(v2->z - v1->z));
-
-    return pmErrno = 0;
-}
-
-int pmCartCartAdd(PmCartesian const * const v1, PmCartesian const * const v2,
-        PmCartesian * const vout)
-{
-    vout->x = v1->x + v2->x;
-    vout->y = v1->y + v2->y;
-    vout->z = v1->z + v2->z;
-
-    return pmErrno = 0;
-}
-
-int pmCartCartSub(PmCartesian const * const v1, PmCartesian const * const v2,
-        PmCartesian * const vout)
-{
-    vout->x = v1->x - v2->x;
-    vout->y = v1->y - v2->y;
-    vout->z = v1->z - v2->z;
-
-    return pmErrno = 0;
-}
-
-int pmCartScalMult(PmCartesian const * const v1, double d, PmCartesian * const vout)
-{
-    if (v1 != vout) {
-        *vout = *v1;
-    }
-    return pmCartScalMultEq(vout, d);
-}
-
 int pmCartScalDiv(PmCartesian const * const v1, double d, PmCartesian * const vout)
 {
     if (v1 != vout) {
@@ -899,15 +826,6 @@ int pmCartNeg(PmCartesian const * const v1, PmCartesian * const vout)
     return pmCartNegEq(vout);
 }
 
-int pmCartNegEq(PmCartesian * const v1)
-{
-    v1->x = -v1->x;
-    v1->y = -v1->y;
-    v1->z = -v1->z;
-
-    return pmErrno = 0;
-}
-
 int pmCartInv(PmCartesian const * const v1, PmCartesian * const vout)
 {
     if (v1 != vout) {
@@ -936,16 +854,6 @@ int pmCartInvEq(PmCartesian * const v)
     return pmErrno = 0;
 }
 
-// This used to be called pmCartNorm.
-
-int pmCartUnit(PmCartesian const * const v, PmCartesian * const vout)
-{
-    if (vout != v) {
-        *vout = *v;
-    }
-    return pmCartUnitEq(vout);
-}
-
 int pmCartAbs(PmCartesian const * const v, PmCartesian * const vout)
 {
 
@@ -958,34 +866,6 @@ int pmCartAbs(PmCartesian const * const v, PmCartesian * const vout)
 
 /* Compound assign operator equivalent functions. These are to prevent issues with passing the same variable as both input (const) and output */
 
-int pmCartCartAddEq(PmCartesian * const v, PmCartesian const * const v_add)
-{
-    v->x += v_add->x;
-    v->y += v_add->y;
-    v->z += v_add->z;
-
-    return pmErrno = 0;
-}
-
-int pmCartCartSubEq(PmCartesian * const v, PmCartesian const * const v_sub)
-{
-    v->x -= v_sub->x;
-    v->y -= v_sub->y;
-    v->z -= v_sub->z;
-
-    return pmErrno = 0;
-}
-
-int pmCartScalMultEq(PmCartesian * const v, double d)
-{
-
-    v->x *= d;
-    v->y *= d;
-    v->z *= d;
-
-    return pmErrno = 0;
-}
-
 int pmCartScalDivEq(PmCartesian * const v, double d)
 {
 
@@ -1004,24 +884,6 @@ int pmCartScalDivEq(PmCartesian * const v, double d)
     return pmErrno = 0;
 }
 
-int pmCartUnitEq(PmCartesian * const v)
-{
-    double size = pmSqrt(pmSq(v->x) + pmSq(v->y) + pmSq(v->z));
-
-    if (size == 0.0) {
-#ifdef PM_PRINT_ERROR
-        pmPrintError("Zero vector in pmCartUnit\n");
-#endif
-        return pmErrno = PM_NORM_ERR;
-    }
-
-    v->x /= size;
-    v->y /= size;
-    v->z /= size;
-
-    return pmErrno = 0;
-}
-
 /*! \todo This is if 0'd out so we can find all the pmCartNorm calls that should
  be renamed pmCartUnit. 
  Later we'll put this back. */
@@ -1875,7 +1737,7 @@ int pmCircleInit(PmCircle * const circle,
 int pmCirclePoint(PmCircle const * const circle, double angle, PmCartesian * const point)
 {
     PmCartesian par, perp;
-    double scale;
+    double scale, s, c;
 
 #ifdef PM_DEBUG
     if (0 == circle || 0 == point) {
@@ -1888,8 +1750,9 @@ int pmCirclePoint(PmCircle const * const circle, double angle, PmCartesian * con
 #endif
 
     /* compute components rel to center */
-    pmCartScalMult(&circle->rTan, cos(angle), &par);
-    pmCartScalMult(&circle->rPerp, sin(angle), &perp);
+    sincos(angle, &s, &c);
+    pmCartScalMult(&circle->rTan, c, &par);
+    pmCartScalMult(&circle->rPerp, s, &perp);
 
     /* add to get radius vector rel to center */
     pmCartCartAdd(&par, &perp, point);
@@ -848,28 +848,14 @@ extern "C" {
 /* NOTE:  only Cartesian type supported in C now */
 
     extern int pmCartCartCompare(PmCartesian const * const, PmCartesian const * const);
-    extern int pmCartCartDot(PmCartesian const * const, PmCartesian const * const, double * const);
-    extern int pmCartCartCross(PmCartesian const * const, PmCartesian const * const, PmCartesian * const);
     extern int pmCartCartMult(PmCartesian const * const, PmCartesian const * const, PmCartesian * const);
     extern int pmCartCartDiv(PmCartesian const * const, PmCartesian const * const, PmCartesian * const);
     extern int pmCartInfNorm(PmCartesian const * v, double * out);
-    extern int pmCartMag(PmCartesian const * const, double * const);
-    extern int pmCartMagSq(PmCartesian const * const, double * const);
-    extern int pmCartCartDisp(PmCartesian const * const v1, PmCartesian const * const v2, double *d);
-    extern int pmCartCartAdd(PmCartesian const * const, PmCartesian const * const, PmCartesian * const);
-    extern int pmCartCartSub(PmCartesian const * const, PmCartesian const * const, PmCartesian * const);
-    extern int pmCartScalMult(PmCartesian const * const, double, PmCartesian * const);
     extern int pmCartScalDiv(PmCartesian const * const, double, PmCartesian * const);
     extern int pmCartNeg(PmCartesian const * const, PmCartesian * const);
-    extern int pmCartUnit(PmCartesian const * const, PmCartesian * const);
     extern int pmCartAbs(PmCartesian const * const, PmCartesian * const);
     // Equivalent of compound operators like +=, -=, etc. Basically, these functions work directly on the first PmCartesian
-    extern int pmCartCartAddEq(PmCartesian * const, PmCartesian const * const);
-    extern int pmCartCartSubEq(PmCartesian * const, PmCartesian const * const);
-    extern int pmCartScalMultEq(PmCartesian * const, double);
     extern int pmCartScalDivEq(PmCartesian * const, double);
-    extern int pmCartUnitEq(PmCartesian * const);
-    extern int pmCartNegEq(PmCartesian * const);
 /*! \todo Another #if 0 */
 #if 0
     extern int pmCartNorm(PmCartesian const * const v, PmCartesian * const vout);
@@ -885,6 +871,132 @@ extern "C" {
     extern int pmCartPlaneProj(PmCartesian const * const v, PmCartesian const * const normal,
 	PmCartesian * vout);
 
+/*
+   The Cartesian functions below run many times per servo cycle in the
+   trajectory planner and the kinematics, and each is only a few flops, so
+   they are defined here for the compiler to inline rather than paying a
+   call for every one.  _posemath.c defines PM_CART_EXPORT before including
+   this file to compile the same bodies as the exported library functions.
+   Each output component is computed from the same input components only,
+   so the output may alias an input.
+*/
+#ifdef PM_CART_EXPORT
+#define PM_CART_INLINE
+#else
+#define PM_CART_INLINE static inline
+#endif
+
+/* the same as pmSqrt() for sums of squares, without the call */
+#define pmCartSqrt(x) ((x) > 0.0 ? __builtin_sqrt(x) : 0.0)
+
+    PM_CART_INLINE int pmCartCartDot(PmCartesian const * const v1, PmCartesian const * const v2, double * const d)
+    {
+	*d = v1->x * v2->x + v1->y * v2->y + v1->z * v2->z;
+	return pmErrno = 0;
+    }
+
+    PM_CART_INLINE int pmCartCartCross(PmCartesian const * const v1, PmCartesian const * const v2, PmCartesian * const vout)
+    {
+	if (vout == v1 || vout == v2) {
+	    return pmErrno = PM_IMPL_ERR;
+	}
+	vout->x = v1->y * v2->z - v1->z * v2->y;
+	vout->y = v1->z * v2->x - v1->x * v2->z;
+	vout->z = v1->x * v2->y - v1->y * v2->x;
+	return pmErrno = 0;
+    }
+
+    PM_CART_INLINE int pmCartMagSq(PmCartesian const * const v, double * const d)
+    {
+	*d = pmSq(v->x) + pmSq(v->y) + pmSq(v->z);
+	return pmErrno = 0;
+    }
+
+    PM_CART_INLINE int pmCartMag(PmCartesian const * const v, double * const d)
+    {
+	double sq = pmSq(v->x) + pmSq(v->y) + pmSq(v->z);
+	*d = pmCartSqrt(sq);
+	return pmErrno = 0;
+    }
+
+    PM_CART_INLINE int pmCartCartDisp(PmCartesian const * const v1, PmCartesian const * const v2, double *d)
+    {
+	double sq = pmSq(v2->x - v1->x) + pmSq(v2->y - v1->y) + pmSq(v2->z - v1->z);
+	*d = pmCartSqrt(sq);
+	return pmErrno = 0;
+    }
+
+    PM_CART_INLINE int pmCartCartAdd(PmCartesian const * const v1, PmCartesian const * const v2, PmCartesian * const vout)
+    {
+	vout->x = v1->x + v2->x;
+	vout->y = v1->y + v2->y;
+	vout->z = v1->z + v2->z;
+	return pmErrno = 0;
+    }
+
+    PM_CART_INLINE int pmCartCartSub(PmCartesian const * const v1, PmCartesian const * const v2, PmCartesian * const vout)
+    {
+	vout->x = v1->x - v2->x;
+	vout->y = v1->y - v2->y;
+	vout->z = v1->z - v2->z;
+	return pmErrno = 0;
+    }
+
+    PM_CART_INLINE int pmCartScalMult(PmCartesian const * const v1, double d, PmCartesian * const vout)
+    {
+	vout->x = v1->x * d;
+	vout->y = v1->y * d;
+	vout->z = v1->z * d;
+	return pmErrno = 0;
+    }
+
+    PM_CART_INLINE int pmCartUnit(PmCartesian const * const v, PmCartesian * const vout)
+    {
+	double size = pmCartSqrt(pmSq(v->x) + pmSq(v->y) + pmSq(v->z));
+
+	if (size == 0.0) {
+	    if (vout != v) {
+		*vout = *v;
+	    }
+#ifdef PM_PRINT_ERROR
+	    pmPrintError("Zero vector in pmCartUnit\n");
+#endif
+	    return pmErrno = PM_NORM_ERR;
+	}
+	vout->x = v->x / size;
+	vout->y = v->y / size;
+	vout->z = v->z / size;
+	return pmErrno = 0;
+    }
+
+    PM_CART_INLINE int pmCartCartAddEq(PmCartesian * const v, PmCartesian const * const v_add)
+    {
+	return pmCartCartAdd(v, v_add, v);
+    }
+
+    PM_CART_INLINE int pmCartCartSubEq(PmCartesian * const v, PmCartesian const * const v_sub)
+    {
+	return pmCartCartSub(v, v_sub, v);
+    }
+
+    PM_CART_INLINE int pmCartScalMultEq(PmCartesian * const v, double d)
+    {
+	return pmCartScalMult(v, d, v);
+    }
+
+    PM_CART_INLINE int pmCartUnitEq(PmCartesian * const v)
+    {
+	return pmCartUnit(v, v);
+    }
+
+    PM_CART_INLINE int pmCartNegEq(PmCartesian * const v)
+    {
+	v->x = -v->x;
+	v->y = -v->y;
+	v->z = -v->z;
+	return pmErrno = 0;
+    }
+
 /* rotation functions */
 
 /* quaternion functions */
@@ -364,6 +364,17 @@ RTAPI_BEGIN_DECLS
     extern int rtapi_task_new(void (*taskcode) (void *), void *arg,
 	int prio, int owner, unsigned long int stacksize, int uses_fp);
 
+/** 'rtapi_task_new_cpu()' is rtapi_task_new() for a task that runs on
+    a given CPU.  'cpu_id' is the number of the CPU, or -1 for the one
+    RTAPI picks for all realtime tasks by default (the last one, or
+    RTAPI_CPU_NUMBER in uspace).  Tasks on different CPUs really do
+    run at the same time.  Returns -EINVAL if there is no such CPU.
+    Call only from within init/cleanup code, not from realtime tasks.
+*/
+    extern int rtapi_task_new_cpu(void (*taskcode) (void *), void *arg,
+	int prio, int owner, unsigned long int stacksize, int uses_fp,
+	int cpu_id);
+
 /** 'rtapi_task_delete()' deletes a task.  'task_id' is a task ID
     from a previous call to rtapi_task_new().  It frees memory
     associated with 'task', and does any other cleanup needed.  If
@@ -45,6 +45,9 @@ enum memory_order {
 #define atomic_load_explicit(obj, order) \
     ({ (void)order; __typeof__(*(obj)) v = *(obj); __sync_synchronize(); v; })
 
+#define atomic_thread_fence(order) \
+    ({ (void)order; __sync_synchronize(); (void)0; })
+
 #endif
 
 #endif
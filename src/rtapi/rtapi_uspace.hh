@@ -57,6 +57,7 @@ struct rtapi_task {
   int uses_fp;
   size_t stacksize;
   int prio;
+  int cpu_id;			/* CPU to run on, -1 for the default */
   long period;
   struct timespec nextstart;
   unsigned ratio;
@@ -77,7 +78,8 @@ struct RtapiApp
     int prio_next_lower(int prio);
     long clock_set_period(long int period_nsec);
     int task_new(void (*taskcode)(void*), void *arg,
-            int prio, int owner, unsigned long int stacksize, int uses_fp);
+            int prio, int owner, unsigned long int stacksize, int uses_fp,
+            int cpu_id=-1);
     virtual rtapi_task *do_task_new() = 0;
     static int allocate_task_id();
     static struct rtapi_task *get_task(int task_id);
@@ -263,10 +263,18 @@ int rtapi_get_msg_level() {
 #define rdtscll(val) ((val) = rtapi_get_time())
 #endif
 
+#ifdef RTAPI
+extern int rtapi_virtual_time;
+#endif
+
 long long rtapi_get_clocks(void)
 {
     long long int retval;
 
+#ifdef RTAPI
+    /* in virtual time, clocks are simulated nanoseconds too */
+    if(rtapi_virtual_time) return rtapi_get_time();
+#endif
     rdtscll(retval);
     return retval;
 }
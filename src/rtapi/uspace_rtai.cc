@@ -87,7 +87,8 @@ struct RtaiApp : RtapiApp {
         if(task->uses_fp) rt_task_use_fpu(task->rt_task, 1);
         // assumes processor numbers are contiguous
         int nprocs = sysconf( _SC_NPROCESSORS_ONLN );
-        rt_set_runnable_on_cpus(task->rt_task, 1u << (nprocs - 1));
+        int cpu = task->cpu_id >= 0 ? task->cpu_id : nprocs - 1;
+        rt_set_runnable_on_cpus(task->rt_task, 1u << cpu);
         rt_make_hard_real_time();
         rt_task_make_periodic_relative_ns(task->rt_task, task->period, task->period);
         (task->taskcode) (task->arg);
@@ -24,6 +24,7 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/stat.h>
+#include <poll.h>
 #include <fcntl.h>
 #include <unistd.h>
 #include <errno.h>
@@ -263,7 +264,10 @@ static int do_load_cmd(string name, vector<string> args) {
     if(w == NULL) {
         char what[LINELEN+1];
         snprintf(what, LINELEN, "%s/%s.so", EMC2_RTLIB_DIR, name.c_str());
+        struct timespec t0, t1, t2;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
         void *module = modules[name] = dlopen(what, RTLD_GLOBAL | RTLD_NOW);
+        clock_gettime(CLOCK_MONOTONIC, &t1);
         if(!module) {
             rtapi_print_msg(RTAPI_MSG_ERR, "%s: dlopen: %s\n", name.c_str(), dlerror());
             modules.erase(name);
@@ -294,6 +298,11 @@ static int do_load_cmd(string name, vector<string> args) {
 	    return result;
         } else {
             instance_count ++;
+            clock_gettime(CLOCK_MONOTONIC, &t2);
+            rtapi_print_msg(RTAPI_MSG_INFO,
+                "%s: loaded in %.1f ms (dlopen %.1f ms)\n", name.c_str(),
+                (t2.tv_sec - t0.tv_sec) * 1e3 + (t2.tv_nsec - t0.tv_nsec) * 1e-6,
+                (t1.tv_sec - t0.tv_sec) * 1e3 + (t1.tv_nsec - t0.tv_nsec) * 1e-6);
 	    return 0;
         }
     } else {
@@ -333,22 +342,6 @@ static int read_number(int fd) {
     }
 }
 
-static string read_string(int fd) {
-    int len = read_number(fd);
-    char buf[len];
-    if(read(fd, buf, len) != len) throw ReadError();
-    return string(buf, len);
-}
-
-static vector<string> read_strings(int fd) {
-    vector<string> result;
-    int count = read_number(fd);
-    for(int i=0; i<count; i++) {
-        result.push_back(read_string(fd));
-    }
-    return result;
-}
-
 static void write_number(string &buf, int num) {
     char numbuf[10];
     sprintf(numbuf, "%d ", num);
@@ -405,35 +398,165 @@ static int slave(int fd, vector<string> args) {
     return result;
 }
 
+/* A connection to the master.  A plain rtapi_app sends one command
+   and hangs up, but halcmd keeps its connection open and may send
+   several commands before it reads the first reply, so what comes in
+   is buffered until a whole command is there.  The commands of one
+   connection run in the order they were sent and each reply goes out
+   as soon as it is known.  After "onerror stop", once a command has
+   failed the rest are not run but answered with -ECANCELED, until
+   "resume": a pipelined load then stops at the first failure just like
+   one load after the other would. */
+struct client_t {
+    int fd;
+    string in;
+    bool stop_on_error;
+    bool failed;
+};
+
+static vector<client_t> clients;
+
+static bool parse_number(const string &buf, size_t &pos, int &num) {
+    int r = 0, neg = 1;
+
+    while(pos < buf.size()) {
+        char ch = buf[pos++];
+        if(ch == '-') neg = -1;
+        else if(ch == ' ') { num = r * neg; return true; }
+        else r = 10 * r + ch - '0';
+    }
+    return false;
+}
+
+// false if the command is not all there yet
+static bool parse_strings(const string &buf, size_t &pos, vector<string> &result) {
+    int count;
+    if(!parse_number(buf, pos, count)) return false;
+    if(count < 0) throw ReadError();
+    for(int i=0; i<count; i++) {
+        int len;
+        if(!parse_number(buf, pos, len)) return false;
+        if(len < 0) throw ReadError();
+        if(buf.size() - pos < (size_t)len) return false;
+        result.push_back(buf.substr(pos, len));
+        pos += len;
+    }
+    return true;
+}
+
+/* While the first load of a pipeline initializes, have the kernel read
+   in the modules queued behind it.  dlopen() itself stays in order:
+   glibc serializes it anyway, and a module may need the symbols, pins
+   or threads of the one loaded before it. */
+static void prefetch_module(const string &name) {
+    char what[LINELEN+1];
+    snprintf(what, LINELEN, "%s/%s.so", EMC2_RTLIB_DIR, name.c_str());
+    int fd = open(what, O_RDONLY | O_CLOEXEC);
+    if(fd < 0) return;
+    posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+    close(fd);
+}
+
+static int client_command(client_t &c, const vector<string> &args) {
+    if(args.size() == 2 && args[0] == "onerror") {
+        c.stop_on_error = args[1] == "stop";
+        return 0;
+    } else if(args.size() == 1 && args[0] == "resume") {
+        c.failed = false;
+        return 0;
+    }
+    if(c.failed) return -ECANCELED;
+    int result = handle_command(args);
+    if(result != 0 && c.stop_on_error) c.failed = true;
+    return result;
+}
+
+// false when done with the connection
+static bool serve_client(client_t &c) {
+    char buf[4096];
+    ssize_t len = read(c.fd, buf, sizeof(buf));
+    if(len < 0) {
+        rtapi_print_msg(RTAPI_MSG_ERR,
+            "rtapi_app: failed to read from slave: %s\n", strerror(errno));
+        return false;
+    }
+    if(len == 0) return false;
+    c.in.append(buf, len);
+
+    vector<vector<string>> cmds;
+    size_t pos = 0;
+    try {
+        while(true) {
+            size_t start = pos;
+            vector<string> args;
+            if(!parse_strings(c.in, pos, args)) { pos = start; break; }
+            cmds.push_back(args);
+        }
+    } catch (ReadError &e) {
+        rtapi_print_msg(RTAPI_MSG_ERR, "rtapi_app: malformed command from slave\n");
+        return false;
+    }
+    c.in.erase(0, pos);
+
+    for(size_t i=1; i<cmds.size(); i++) {
+        if(cmds[i].size() >= 2 && cmds[i][0] == "load")
+            prefetch_module(cmds[i][1]);
+    }
+    for(size_t i=0; i<cmds.size(); i++) {
+        string reply;
+        write_number(reply, client_command(c, cmds[i]));
+        if(write(c.fd, reply.data(), reply.size()) != (ssize_t)reply.size()) {
+            rtapi_print_msg(RTAPI_MSG_ERR,
+                "rtapi_app: failed to write to slave: %s\n", strerror(errno));
+            return false;
+        }
+        // the rest would never run anyway
+        if(force_exit || instance_count == 0) return false;
+    }
+    return true;
+}
+
 static int callback(int fd)
 {
-    struct sockaddr_un client_addr;
-    memset(&client_addr, 0, sizeof(client_addr));
-    socklen_t len = sizeof(client_addr);
-    int fd1 = accept(fd, (sockaddr*)&client_addr, &len);
-    if(fd1 < 0) {
+    vector<struct pollfd> fds(clients.size() + 1);
+    fds[0].fd = fd;
+    fds[0].events = POLLIN;
+    for(size_t i=0; i<clients.size(); i++) {
+        fds[i+1].fd = clients[i].fd;
+        fds[i+1].events = POLLIN;
+    }
+    if(poll(fds.data(), fds.size(), -1) < 0) {
+        if(errno == EINTR) return 1;
         rtapi_print_msg(RTAPI_MSG_ERR,
-            "rtapi_app: failed to accept connection from slave: %s\n", strerror(errno));
+            "rtapi_app: failed to wait for slaves: %s\n", strerror(errno));
         return -1;
-    } else {
-        int result;
-        try {
-            result = handle_command(read_strings(fd1));
-        } catch (ReadError &e) {
+    }
+
+    for(size_t i=0; i<clients.size(); i++) {
+        if(!fds[i+1].revents) continue;
+        if(!serve_client(clients[i])) {
+            close(clients[i].fd);
+            clients[i].fd = -1;
+        }
+        if(force_exit || instance_count == 0) break;
+    }
+    clients.erase(remove_if(clients.begin(), clients.end(),
+        [](const client_t &c) { return c.fd < 0; }), clients.end());
+    if(force_exit || instance_count == 0) return 0;
+
+    if(fds[0].revents & POLLIN) {
+        struct sockaddr_un client_addr;
+        memset(&client_addr, 0, sizeof(client_addr));
+        socklen_t len = sizeof(client_addr);
+        int fd1 = accept(fd, (sockaddr*)&client_addr, &len);
+        if(fd1 < 0) {
             rtapi_print_msg(RTAPI_MSG_ERR,
-                "rtapi_app: failed to read from slave: %s\n", strerror(errno));
-            close(fd1);
+                "rtapi_app: failed to accept connection from slave: %s\n", strerror(errno));
             return -1;
         }
-        string buf;
-        write_number(buf, result);
-        if(write(fd1, buf.data(), buf.size()) != (ssize_t)buf.size()) {
-            rtapi_print_msg(RTAPI_MSG_ERR,
-                "rtapi_app: failed to write to slave: %s\n", strerror(errno));
-        };
-        close(fd1);
+        clients.push_back(client_t{fd1, string(), false, false});
     }
-    return !force_exit && instance_count > 0;
+    return 1;
 }
 
 static pthread_t main_thread{};
@@ -580,8 +703,17 @@ struct rtapi_module {
 #define MAX_MODULES  64
 #define MODULE_OFFSET 32768
 
+/* In virtual time (RTAPI_VIRTUAL_TIME=1) nothing sleeps.  Tasks take
+   turns, one at a time, in the order of their next start time and
+   then of priority, and the clock jumps to the start time of whichever
+   runs next.  A simulated machine then runs as fast as the CPU allows,
+   and the same way every time.  RTAPI_VIRTUAL_SPEED=n keeps it from
+   running more than n times faster than the wall clock, for when it
+   has to keep pace with userspace programs. */
+int rtapi_virtual_time;
+
 rtapi_task::rtapi_task()
-    : magic{}, id{}, owner{}, stacksize{}, prio{},
+    : magic{}, id{}, owner{}, stacksize{}, prio{}, cpu_id{-1},
       period{}, nextstart{},
       ratio{}, arg{}, taskcode{}
 {}
@@ -590,18 +722,41 @@ namespace
 {
 struct PosixTask : rtapi_task
 {
-    PosixTask() : rtapi_task{}, thr{}
+    PosixTask() : rtapi_task{}, thr{}, vt_active{}
     {}
 
     pthread_t thr;                /* thread's context */
+    bool vt_active;               /* taking turns in virtual time */
 };
 
+static long long timespec_ns(const struct timespec &ts) {
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static struct timespec ns_timespec(long long ns) {
+    struct timespec ts;
+    ts.tv_sec = ns / 1000000000LL;
+    ts.tv_nsec = ns % 1000000000LL;
+    return ts;
+}
+
 struct Posix : RtapiApp
 {
-    Posix(int policy = SCHED_FIFO) : RtapiApp(policy), do_thread_lock(policy != SCHED_FIFO) {
+    Posix(int policy = SCHED_FIFO, bool virtual_time = false)
+        : RtapiApp(policy), do_thread_lock(policy != SCHED_FIFO),
+          virtual_time(virtual_time), vt_speed(0), vt_now(0),
+          vt_running(nullptr) {
         pthread_once(&key_once, init_key);
         if(do_thread_lock)
             pthread_mutex_init(&thread_lock, 0);
+        if(virtual_time) {
+            pthread_mutex_init(&vt_lock, 0);
+            pthread_cond_init(&vt_cond, 0);
+            const char *speed = getenv("RTAPI_VIRTUAL_SPEED");
+            if(speed) vt_speed = atof(speed);
+            clock_gettime(CLOCK_MONOTONIC, &vt_wall_start);
+            rtapi_virtual_time = 1;
+        }
     }
     int task_delete(int id);
     int task_start(int task_id, unsigned long period_nsec);
@@ -621,6 +776,18 @@ struct Posix : RtapiApp
     bool do_thread_lock;
     pthread_mutex_t thread_lock;
 
+    bool virtual_time;
+    double vt_speed;              /* 0 for as fast as possible */
+    struct timespec vt_wall_start;
+    pthread_mutex_t vt_lock;      /* guards the rest */
+    pthread_cond_t vt_cond;
+    long long vt_now;
+    PosixTask *vt_running;        /* the task whose turn it is */
+    void vt_start(PosixTask *task);
+    void vt_next(PosixTask *task);
+    void vt_take_turn(PosixTask *task);
+    PosixTask *vt_first();
+
     static pthread_once_t key_once;
     static pthread_key_t key;
     static void init_key(void) {
@@ -628,6 +795,8 @@ struct Posix : RtapiApp
     }
 
     long long do_get_time(void) {
+        if(virtual_time)
+            return __atomic_load_n(&vt_now, __ATOMIC_ACQUIRE);
         struct timespec ts;
         clock_gettime(CLOCK_MONOTONIC, &ts);
         return ts.tv_sec * 1000000000LL + ts.tv_nsec;
@@ -776,6 +945,12 @@ static int harden_rt()
 
 static RtapiApp *makeApp()
 {
+    const char *virtual_time = getenv("RTAPI_VIRTUAL_TIME");
+    if(virtual_time && atoi(virtual_time))
+    {
+        rtapi_print_msg(RTAPI_MSG_ERR, "Note: Using POSIX virtual time\n");
+        return new Posix(SCHED_OTHER, true);
+    }
     if(euid != 0 || harden_rt() < 0)
     {
         rtapi_print_msg(RTAPI_MSG_ERR, "Note: Using POSIX non-realtime\n");
@@ -859,13 +1034,21 @@ int RtapiApp::allocate_task_id()
 }
 
 int RtapiApp::task_new(void (*taskcode) (void*), void *arg,
-        int prio, int owner, unsigned long int stacksize, int uses_fp) {
+        int prio, int owner, unsigned long int stacksize, int uses_fp,
+        int cpu_id) {
   /* check requested priority */
   if ((prio > rtapi_prio_highest()) || (prio < rtapi_prio_lowest()))
   {
     return -EINVAL;
   }
 
+  /* and CPU */
+  if (cpu_id >= CPU_SETSIZE || cpu_id >= sysconf(_SC_NPROCESSORS_CONF))
+  {
+    rtapi_print_msg(RTAPI_MSG_ERR, "rtapi_task_new: no CPU %d\n", cpu_id);
+    return -EINVAL;
+  }
+
   /* label as a valid task structure */
   int n = allocate_task_id();
   if(n < 0) return n;
@@ -880,6 +1063,7 @@ int RtapiApp::task_new(void (*taskcode) (void*), void *arg,
   task->stacksize = stacksize;
   task->taskcode = taskcode;
   task->prio = prio;
+  task->cpu_id = cpu_id < 0 ? -1 : cpu_id;
   task->magic = TASK_MAGIC;
   task_array[n] = task;
 
@@ -918,6 +1102,15 @@ int Posix::task_delete(int id)
 
   pthread_cancel(task->thr);
   pthread_join(task->thr, 0);
+  Posix &papp = reinterpret_cast<Posix&>(App());
+  if(papp.virtual_time) {
+      // it may have been cancelled during its turn
+      pthread_mutex_lock(&papp.vt_lock);
+      task->vt_active = false;
+      if(papp.vt_running == task) papp.vt_running = nullptr;
+      pthread_cond_broadcast(&papp.vt_cond);
+      pthread_mutex_unlock(&papp.vt_lock);
+  }
   task->magic = 0;
   task_array[id] = 0;
   delete task;
@@ -1002,22 +1195,29 @@ int Posix::task_start(int task_id, unsigned long int period_nsec)
       return -errno;
   if(pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED) < 0)
       return -errno;
-  if(nprocs > 1) {
+  // threads asked for a CPU go there, the rest share the one realtime
+  // CPU; isolcpus or taskset only changes which one that is
+  int cpu_number = task->cpu_id;
+  if(cpu_number == -1 && nprocs > 1) {
       const static int rt_cpu_number = find_rt_cpu_number();
-      if(rt_cpu_number != -1) {
+      cpu_number = rt_cpu_number;
+  }
+  if(cpu_number != -1) {
 #ifdef __FreeBSD__
-          cpuset_t cpuset;
+      cpuset_t cpuset;
 #else
-          cpu_set_t cpuset;
+      cpu_set_t cpuset;
 #endif
-          CPU_ZERO(&cpuset);
-          CPU_SET(rt_cpu_number, &cpuset);
-          if(pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset) < 0)
-               return -errno;
-      }
+      CPU_ZERO(&cpuset);
+      CPU_SET(cpu_number, &cpuset);
+      int res = pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset);
+      if(res != 0)
+           return -res;
   }
-  if(pthread_create(&task->thr, &attr, &wrapper, reinterpret_cast<void*>(task)) < 0)
-      return -errno;
+  // e.g. EINVAL for a CPU that is offline
+  int res = pthread_create(&task->thr, &attr, &wrapper, reinterpret_cast<void*>(task));
+  if(res != 0)
+      return -res;
 
   return 0;
 }
@@ -1043,12 +1243,17 @@ void *Posix::wrapper(void *arg)
   pthread_setspecific(key, arg);
 
   Posix &papp = reinterpret_cast<Posix&>(App());
+  if(papp.virtual_time)
+      papp.vt_start(static_cast<PosixTask*>(task));
+
   if(papp.do_thread_lock)
       pthread_mutex_lock(&papp.thread_lock);
 
-  struct timespec now;
-  clock_gettime(RTAPI_CLOCK, &now);
-  rtapi_timespec_advance(task->nextstart, now, task->period + task->pll_correction);
+  if(!papp.virtual_time) {
+      struct timespec now;
+      clock_gettime(RTAPI_CLOCK, &now);
+      rtapi_timespec_advance(task->nextstart, now, task->period + task->pll_correction);
+  }
 
   /* call the task function with the task argument */
   (task->taskcode) (task->arg);
@@ -1091,23 +1296,95 @@ void Posix::wait() {
         pthread_mutex_unlock(&thread_lock);
     pthread_testcancel();
     struct rtapi_task *task = reinterpret_cast<rtapi_task*>(pthread_getspecific(key));
-    rtapi_timespec_advance(task->nextstart, task->nextstart, task->period + task->pll_correction);
-    struct timespec now;
-    clock_gettime(RTAPI_CLOCK, &now);
-    if(rtapi_timespec_less(task->nextstart, now))
+    if(virtual_time)
     {
-        if(policy == SCHED_FIFO)
-            unexpected_realtime_delay(task);
+        vt_next(static_cast<PosixTask*>(task));
     }
     else
     {
-        int res = rtapi_clock_nanosleep(RTAPI_CLOCK, TIMER_ABSTIME, &task->nextstart, nullptr, &now);
-        if(res < 0) perror("clock_nanosleep");
+        rtapi_timespec_advance(task->nextstart, task->nextstart, task->period + task->pll_correction);
+        struct timespec now;
+        clock_gettime(RTAPI_CLOCK, &now);
+        if(rtapi_timespec_less(task->nextstart, now))
+        {
+            if(policy == SCHED_FIFO)
+                unexpected_realtime_delay(task);
+        }
+        else
+        {
+            int res = rtapi_clock_nanosleep(RTAPI_CLOCK, TIMER_ABSTIME, &task->nextstart, nullptr, &now);
+            if(res < 0) perror("clock_nanosleep");
+        }
     }
     if(do_thread_lock)
         pthread_mutex_lock(&thread_lock);
 }
 
+static void vt_unlock(void *arg)
+{
+    pthread_mutex_unlock(reinterpret_cast<pthread_mutex_t*>(arg));
+}
+
+// the next task to run: soonest start, then highest priority, then
+// lowest id so that it never depends on which thread got here first
+PosixTask *Posix::vt_first()
+{
+    PosixTask *first = nullptr;
+    for(int n = 0; n < MAX_TASKS; n++)
+    {
+        auto task = ::rtapi_get_task<PosixTask>(n);
+        if(!task || !task->vt_active) continue;
+        if(!first
+            || rtapi_timespec_less(task->nextstart, first->nextstart)
+            || (!rtapi_timespec_less(first->nextstart, task->nextstart)
+                && task->prio > first->prio))
+            first = task;
+    }
+    return first;
+}
+
+// called with vt_lock held
+void Posix::vt_take_turn(PosixTask *task)
+{
+    pthread_cleanup_push(vt_unlock, &vt_lock);
+    while(vt_running || vt_first() != task)
+        pthread_cond_wait(&vt_cond, &vt_lock);
+    pthread_cleanup_pop(0);
+    vt_running = task;
+    long long start = timespec_ns(task->nextstart);
+    if(start > vt_now) __atomic_store_n(&vt_now, start, __ATOMIC_RELEASE);
+}
+
+void Posix::vt_start(PosixTask *task)
+{
+    pthread_mutex_lock(&vt_lock);
+    task->nextstart = ns_timespec(vt_now + task->period);
+    task->vt_active = true;
+    pthread_cond_broadcast(&vt_cond);
+    vt_take_turn(task);
+    pthread_mutex_unlock(&vt_lock);
+}
+
+void Posix::vt_next(PosixTask *task)
+{
+    pthread_mutex_lock(&vt_lock);
+    task->nextstart = ns_timespec(timespec_ns(task->nextstart)
+            + task->period + task->pll_correction);
+    if(vt_running == task) vt_running = nullptr;
+    pthread_cond_broadcast(&vt_cond);
+    vt_take_turn(task);
+    long long now = vt_now;
+    pthread_mutex_unlock(&vt_lock);
+
+    if(vt_speed > 0)
+    {
+        // hold this turn until the wall clock catches up
+        struct timespec wall = ns_timespec(timespec_ns(vt_wall_start)
+                + (long long)(now / vt_speed));
+        rtapi_clock_nanosleep(RTAPI_CLOCK, TIMER_ABSTIME, &wall, nullptr, nullptr);
+    }
+}
+
 unsigned char Posix::do_inb(unsigned int port)
 {
 #ifdef HAVE_SYS_IO_H
@@ -1125,6 +1402,13 @@ void Posix::do_outb(unsigned char val, unsigned int port)
 }
 
 void Posix::do_delay(long ns) {
+    if(virtual_time) {
+        // time passes only for the task whose turn it is
+        pthread_mutex_lock(&vt_lock);
+        __atomic_store_n(&vt_now, vt_now + ns, __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&vt_lock);
+        return;
+    }
     struct timespec ts = {0, ns};
     rtapi_clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, NULL, NULL);
 }
@@ -1170,6 +1454,13 @@ int rtapi_task_new(void (*taskcode) (void*), void *arg,
     return App().task_new(taskcode, arg, prio, owner, stacksize, uses_fp);
 }
 
+int rtapi_task_new_cpu(void (*taskcode) (void*), void *arg,
+        int prio, int owner, unsigned long int stacksize, int uses_fp,
+        int cpu_id) {
+    return App().task_new(taskcode, arg, prio, owner, stacksize, uses_fp,
+            cpu_id);
+}
+
 int rtapi_task_delete(int id) {
     return App().task_delete(id);
 }
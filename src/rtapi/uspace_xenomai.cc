@@ -53,7 +53,10 @@ struct XenomaiApp : RtapiApp {
         cpu_set_t cpuset;
         CPU_ZERO(&cpuset);
         int nprocs = sysconf( _SC_NPROCESSORS_ONLN );
-        CPU_SET(nprocs-1, &cpuset); // assumes processor numbers are contiguous
+        if(task->cpu_id >= 0)
+            CPU_SET(task->cpu_id, &cpuset);
+        else
+            CPU_SET(nprocs-1, &cpuset); // assumes processor numbers are contiguous
 
         pthread_attr_t attr;
         if(pthread_attr_init(&attr) < 0)
@@ -66,7 +69,7 @@ struct XenomaiApp : RtapiApp {
             return -errno;
         if(pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED) < 0)
             return -errno;
-        if(nprocs > 1)
+        if(nprocs > 1 || task->cpu_id >= 0)
             if(pthread_attr_setaffinity_np(&attr, sizeof(cpuset), &cpuset) < 0)
                 return -errno;
         if(pthread_create(&task->thr, &attr, &wrapper, reinterpret_cast<void*>(task)) < 0)
@@ -0,0 +1,6 @@
+#!/bin/sh
+realtime start
+halcmd -b -f expected
+halcmd save
+halcmd unload all
+realtime stop
@@ -0,0 +1,56 @@
+#!/bin/sh
+realtime start
+python <<EOF2
+import hal
+import array
+h = hal.component("x")
+try:
+    pf = h.newpin("f", hal.HAL_FLOAT, hal.HAL_OUT)
+    pin = h.newpin("in", hal.HAL_S32, hal.HAL_IN)
+    pb = h.newpin("b", hal.HAL_BIT, hal.HAL_OUT)
+    param = h.newparam("param", hal.HAL_U32, hal.HAL_RW)
+    h.ready()
+
+    h["f"] = 1.5
+    h["b"] = 1
+    h["param"] = 7
+    hf = hal.get_handle("x.f")
+    hin = hal.get_handle("x.in")
+    hb = hal.get_handle("x.b")
+    hp = hal.get_handle("x.param")
+    print hf.get_name(), hf.get_type() == hal.HAL_FLOAT, hf.get(), hb.get(), hp.get()
+
+    hin.set(-3)
+    hp.set(9)
+    print h["in"], h["param"]
+
+    try:
+        hf.set(2)
+    except RuntimeError, e:
+        print "set x.f:", e
+
+    # the handle follows the pin when it is linked
+    hal.new_sig("sig", hal.HAL_FLOAT)
+    hal.connect("x.f", "sig")
+    h["f"] = 2.5
+    hs = hal.get_handle("sig")
+    print hf.get(), hs.get()
+
+    handles = [hf, hin, hb, hp]
+    print hal.get_values(handles)
+    a = array.array('d', [0] * len(handles))
+    hal.get_values(handles, a)
+    print list(a)
+
+    try:
+        hal.get_values(handles, array.array('d', [0]))
+    except ValueError, e:
+        print "short buffer:", e
+
+    try:
+        hal.get_handle("x.nothing")
+    except RuntimeError, e:
+        print e
+finally:
+    h.exit()
+EOF2
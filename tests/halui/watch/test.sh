@@ -0,0 +1,67 @@
+#!/bin/sh
+realtime start
+halcmd loadrt threads name1=t period1=1000000
+halcmd loadrt halui_watch comp=fake
+halcmd addf halui-watch t
+halcmd start
+python <<EOF2
+import hal
+import os
+import time
+
+def wait_for(what, value):
+    end = time.time() + 5
+    while time.time() < end:
+        if hal.get_value(what) == value:
+            return True
+        time.sleep(.01)
+    return False
+
+def wait_change(before):
+    end = time.time() + 5
+    while time.time() < end:
+        if hal.get_value("halui-watch.changes") != before:
+            return True
+        time.sleep(.01)
+    return False
+
+h = hal.component("fake")
+try:
+    h.newpin("a", hal.HAL_BIT, hal.HAL_IN)
+    h.newpin("b", hal.HAL_FLOAT, hal.HAL_IN)
+    h.newpin("out", hal.HAL_BIT, hal.HAL_OUT)
+    h.ready()
+    print "pins", wait_for("halui-watch.pin-count", 2)
+
+    n = hal.get_value("halui-watch.changes")
+    hal.set_p("fake.a", "1")
+    print "set", wait_change(n)
+
+    # linking is a topology change: the table is built again and the
+    # new signal's value is read
+    hal.new_sig("bsig", hal.HAL_FLOAT)
+    n = hal.get_value("halui-watch.changes")
+    hal.connect("fake.b", "bsig")
+    print "linked", wait_change(n)
+    n = hal.get_value("halui-watch.changes")
+    os.system("halcmd sets bsig 2.5")
+    print "signal", wait_change(n)
+finally:
+    h.exit()
+
+# the pins of a component loaded again are found again
+h = hal.component("fake")
+try:
+    h.newpin("a", hal.HAL_BIT, hal.HAL_IN)
+    h.newpin("b", hal.HAL_FLOAT, hal.HAL_IN)
+    h.newpin("c", hal.HAL_S32, hal.HAL_IN)
+    h.ready()
+    print "again", wait_for("halui-watch.pin-count", 3)
+    n = hal.get_value("halui-watch.changes")
+    hal.set_p("fake.c", "-4")
+    print "set", wait_change(n)
+finally:
+    h.exit()
+EOF2
+halcmd unload all
+realtime stop
@@ -235,6 +235,7 @@ double GET_EXTERNAL_TOOL_LENGTH_VOFFSET() {}
 double GET_EXTERNAL_TOOL_LENGTH_WOFFSET() {}
 int GET_EXTERNAL_POCKETS_MAX() {}
 int GET_EXTERNAL_TOOL_SLOT() {}
+int GET_EXTERNAL_TOOL_POCKET(int toolno) {}
 int GET_EXTERNAL_SELECTED_TOOL_SLOT() {}
 CANON_TOOL_TABLE GET_EXTERNAL_TOOL_TABLE(int pocket) {}
 int GET_EXTERNAL_TC_FAULT() {}
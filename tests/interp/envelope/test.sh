@@ -0,0 +1,10 @@
+#!/bin/bash
+# inside the limits: prints the envelope, exits 0
+rs274 -E -i test.ini inside.ngc || exit 1
+# past the limits: says which and where, exits 1
+rs274 -E -i test.ini outside.ngc 2>&1 >/dev/null
+test $? = 1 || exit 1
+# can't be run to the end: unchecked, exits 2
+rs274 -E -i test.ini unchecked.ngc >/dev/null 2>&1
+test $? = 2 || exit 1
+exit 0
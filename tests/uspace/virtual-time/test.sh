@@ -0,0 +1,11 @@
+#!/bin/bash
+set -eo pipefail
+
+. rtapi.conf
+
+if [ "$RTPREFIX" != uspace ]; then
+    echo "test only meaningful on uspace"
+    exit 0
+fi
+
+RTAPI_VIRTUAL_TIME=1 halrun virtual-time.hal
@@ -0,0 +1,144 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <canoncache.hh>
+
+static const char *cache_file = "test_canoncache.canon";
+static const uint64_t key = 0x1234567890abcdefULL;
+
+static void write_cache(int calls)
+{
+    CanonCacheWriter w;
+    CanonRecord r;
+
+    for (int n = 0; n < calls; n++) {
+        r.clear();
+        r.put_int(n);
+        r.put_double(n * 0.5);
+        r.put_string("G1 X1");
+        w.put(CANON_CACHE_CALL, n % 7, r);
+    }
+    r.clear();
+    r.put_int(3);
+    r.put_int(calls);
+    w.put(CANON_CACHE_RESULT, 0, r);
+    REQUIRE(w.save(cache_file, key) == 0);
+}
+
+static std::string read_file()
+{
+    std::string s;
+    char buf[4096];
+    size_t n;
+    FILE *f = fopen(cache_file, "rb");
+    REQUIRE(f != NULL);
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        s.append(buf, n);
+    fclose(f);
+    return s;
+}
+
+static void write_file(const std::string &s)
+{
+    FILE *f = fopen(cache_file, "wb");
+    REQUIRE(f != NULL);
+    REQUIRE(fwrite(s.data(), 1, s.size(), f) == s.size());
+    fclose(f);
+}
+
+TEST_CASE("records come back in the order they were saved")
+{
+    write_cache(1000);
+
+    CanonCacheReader r;
+    int kind, op;
+    const char *data;
+    size_t len;
+
+    REQUIRE(r.open(cache_file, key) == 0);
+    for (int pass = 0; pass < 2; pass++) {
+        for (int n = 0; n < 1000; n++) {
+            REQUIRE(r.next(kind, op, data, len));
+            CHECK(kind == CANON_CACHE_CALL);
+            CHECK(op == n % 7);
+
+            CanonFields f(data, len);
+            int i;
+            double d;
+            std::string s;
+            REQUIRE(f.get_int(i));
+            REQUIRE(f.get_double(d));
+            REQUIRE(f.get_string(s));
+            CHECK(i == n);
+            CHECK(d == n * 0.5);
+            CHECK(s == "G1 X1");
+            CHECK(f.done());
+            // nothing more to read
+            CHECK(!f.get_int(i));
+        }
+        REQUIRE(r.next(kind, op, data, len));
+        CHECK(kind == CANON_CACHE_RESULT);
+        CHECK(!r.next(kind, op, data, len));
+        r.rewind();
+    }
+    remove(cache_file);
+}
+
+TEST_CASE("a cache for another key or a damaged cache is not opened")
+{
+    CanonCacheReader r;
+
+    remove(cache_file);
+    CHECK(r.open(cache_file, key) != 0);
+
+    write_cache(10);
+    CHECK(r.open(cache_file, key + 1) != 0);
+    CHECK(!r.is_open());
+    REQUIRE(r.open(cache_file, key) == 0);
+    r.close();
+
+    std::string good = read_file();
+
+    // cut short
+    write_file(good.substr(0, good.size() - 1));
+    CHECK(r.open(cache_file, key) != 0);
+    write_file(good.substr(0, 10));
+    CHECK(r.open(cache_file, key) != 0);
+
+    // one bit changed in a record
+    std::string bad = good;
+    bad[bad.size() - 3] ^= 4;
+    write_file(bad);
+    CHECK(r.open(cache_file, key) != 0);
+
+    write_file(good);
+    CHECK(r.open(cache_file, key) == 0);
+    remove(cache_file);
+}
+
+TEST_CASE("hashes depend on content and on where it is split")
+{
+    CanonHash a, b, c;
+    a.add("ab");
+    a.add("c");
+    b.add("a");
+    b.add("bc");
+    c.add("ab");
+    c.add("c");
+    CHECK(a.value() != b.value());
+    CHECK(a.value() == c.value());
+
+    // a file hashes like its contents
+    write_file("0123456789abcdef0123");
+    CanonHash f, s;
+    uint64_t size = 0;
+    REQUIRE(f.add_file(cache_file, &size) == 0);
+    s.add("0123456789abcdef0123", 20);
+    CHECK(size == 20);
+    CHECK(f.value() == s.value());
+    remove(cache_file);
+    CHECK(f.add_file(cache_file) != 0);
+}
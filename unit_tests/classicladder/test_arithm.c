@@ -0,0 +1,221 @@
+#include "greatest.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "classicladder.h"
+#include "arithm_eval.h"
+
+/* Expand to all the definitions that need to be in
+   the test runner's main file. */
+GREATEST_MAIN_DEFS();
+
+/* the words the expressions use, in place of vars_access.c: any var
+   type reads and writes the same ones */
+#define WORDS 16
+
+static int words[WORDS];
+
+int ReadVar(int TypeVar, int Offset)
+{
+    (void) TypeVar;
+    return (Offset >= 0 && Offset < WORDS) ? words[Offset] : 0;
+}
+
+void WriteVar(int TypeVar, int NumVar, int Value)
+{
+    (void) TypeVar;
+    if (NumVar >= 0 && NumVar < WORDS) {
+	words[NumVar] = Value;
+    }
+}
+
+void rtapi_print(const char *fmt, ...)
+{
+    (void) fmt;
+}
+
+static void random_words(void)
+{
+    int n;
+
+    for (n = 0; n < WORDS; n++) {
+	words[n] = rand() % 19 - 9;
+    }
+}
+
+/* a var, indexed by one of the first words some of the times; the
+   index words are kept from 0 to 3 so that it stays in the words */
+static void add_var(char *s)
+{
+    char *end = s + strlen(s);
+
+    if (rand() % 4 == 0) {
+	sprintf(end, "@%d/%d[%d/%d]@", VAR_MEM_WORD, 4 + rand() % 8,
+	    VAR_MEM_WORD, rand() % 2);
+    } else {
+	sprintf(end, "@%d/%d@", VAR_MEM_WORD, rand() % WORDS);
+    }
+}
+
+/* a random expression of the grammar arithm_eval.c parses; nothing
+   is divided by a value that could be 0 */
+static void add_expr(char *s, int depth)
+{
+    static const char *ops[] = { "+", "-", "*", "&", "|" };
+    static const char *funcs[] = { "MINI", "MAXI", "AVG", "MOY" };
+    char *end = s + strlen(s);
+    int n, count;
+
+    switch (depth > 0 ? rand() % 10 : rand() % 3) {
+    case 0:
+	sprintf(end, "%d", rand() % 10);
+	break;
+    case 1:
+	sprintf(end, "$%X", rand() % 256);
+	break;
+    case 2:
+	add_var(s);
+	break;
+    case 3:
+	strcat(s, "ABS(");
+	add_var(s);
+	strcat(s, ")");
+	break;
+    case 4:
+	strcat(s, funcs[rand() % 4]);
+	count = 1 + rand() % 3;
+	for (n = 0; n < count; n++) {
+	    strcat(s, n ? "," : "(");
+	    add_var(s);
+	}
+	strcat(s, ")");
+	break;
+    case 5:
+	strcat(s, "!");
+	add_expr(s, 0);
+	break;
+    case 6:
+	strcat(s, "(");
+	add_expr(s, depth - 1);
+	strcat(s, ")");
+	break;
+    case 7:
+	add_expr(s, 0);
+	sprintf(s + strlen(s), "%s%d", rand() % 2 ? "/" : "%", 1 + rand() % 9);
+	break;
+    case 8:
+	add_expr(s, 0);
+	sprintf(s + strlen(s), "^%d", rand() % 3);
+	break;
+    default:
+	add_expr(s, depth - 1);
+	strcat(s, ops[rand() % 5]);
+	add_expr(s, depth - 1);
+	break;
+    }
+}
+
+/* random compares and operates, as long as a StrArithmExpr holds */
+static void random_compare(char *s)
+{
+    static const char *tests[] = { "<", ">", "=", "<=", ">=", "<>" };
+    char buf[4 * ARITHM_EXPR_SIZE];
+
+    do {
+	buf[0] = '\0';
+	add_expr(buf, 2);
+	strcat(buf, tests[rand() % 6]);
+	add_expr(buf, 2);
+    } while (strlen(buf) >= ARITHM_EXPR_SIZE);
+    strcpy(s, buf);
+}
+
+static void random_calc(char *s)
+{
+    char buf[4 * ARITHM_EXPR_SIZE];
+
+    do {
+	buf[0] = '\0';
+	add_var(buf);
+	strcat(buf, rand() % 2 ? ":=" : "=");
+	add_expr(buf, 3);
+    } while (strlen(buf) >= ARITHM_EXPR_SIZE);
+    strcpy(s, buf);
+}
+
+#define EXPRESSIONS 20000
+
+TEST compares_give_what_the_string_gives(void)
+{
+    static StrArithmCode code;
+    char expr[ARITHM_EXPR_SIZE];
+    int n, k;
+
+    srand(1);
+    for (n = 0; n < EXPRESSIONS; n++) {
+	random_compare(expr);
+	CompileArithmExpr(expr, TRUE, &code);
+	ASSERT_EQm(expr, ARITHM_CODE_COMPARE, code.Kind);
+	for (k = 0; k < 4; k++) {
+	    random_words();
+	    ASSERT_EQm(expr, EvalCompare(expr), EvalArithmCode(&code));
+	}
+    }
+    PASS();
+}
+
+TEST calcs_write_what_the_string_writes(void)
+{
+    static StrArithmCode code;
+    char expr[ARITHM_EXPR_SIZE];
+    int before[WORDS], by_string[WORDS];
+    int n, k;
+
+    srand(2);
+    for (n = 0; n < EXPRESSIONS; n++) {
+	random_calc(expr);
+	CompileArithmExpr(expr, FALSE, &code);
+	ASSERT_EQm(expr, ARITHM_CODE_CALC, code.Kind);
+	for (k = 0; k < 4; k++) {
+	    random_words();
+	    memcpy(before, words, sizeof(words));
+	    MakeCalc(expr, FALSE);
+	    memcpy(by_string, words, sizeof(words));
+	    memcpy(words, before, sizeof(words));
+	    EvalArithmCode(&code);
+	    ASSERT_MEM_EQm(expr, by_string, words, sizeof(words));
+	}
+    }
+    PASS();
+}
+
+TEST bad_expressions_are_not_compiled(void)
+{
+    static const char *compares[] = { "1+2", "(1<2", "@200/1", "FOO(1)<2" };
+    static const char *calcs[] = { "@200/1@", "@200/1@ 3", "1:=2", "@200/1@:=ABS(" };
+    StrArithmCode code;
+    unsigned int n;
+
+    for (n = 0; n < sizeof(compares) / sizeof(compares[0]); n++) {
+	CompileArithmExpr((char *) compares[n], TRUE, &code);
+	ASSERT_EQm(compares[n], ARITHM_CODE_NONE, code.Kind);
+    }
+    for (n = 0; n < sizeof(calcs) / sizeof(calcs[0]); n++) {
+	CompileArithmExpr((char *) calcs[n], FALSE, &code);
+	ASSERT_EQm(calcs[n], ARITHM_CODE_NONE, code.Kind);
+    }
+    PASS();
+}
+
+SUITE(arithm) {
+    RUN_TEST(compares_give_what_the_string_gives);
+    RUN_TEST(calcs_write_what_the_string_writes);
+    RUN_TEST(bad_expressions_are_not_compiled);
+}
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(arithm);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,107 @@
+#include "catch.hpp"
+
+#include <interp_testing_util.hh> // For core interp stuff and extra REQUIRE macros/ setup
+#include <rs274ngc_interp.hh>
+#include <interp_inspection.hh>
+#include <interp_return.hh>
+#include <saicanon.hh>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+
+// The checkpoint is taken after line 5, in G91, and the lines after it
+// only come out right from the position the program had reached there.
+static const char program[] =
+  "G21 G17 G90 G54\n"
+  "G0 X0 Y0 Z0\n"
+  "G91\n"
+  "G1 X10 Y5 F100\n"
+  "G1 X10\n"
+  "G1 X5 Y-5\n"
+  "G90 G2 X35 Y0 I5 J0\n"
+  "G91 G3 X-10 Y0 I-5 J0\n"
+  "G1 Z-1\n"
+  "M2\n";
+
+#define CHECKPOINT_LINE 5
+
+// reads and executes up to the end, or stops after line 'stop'
+static int run(Interp &interp, int stop)
+{
+  for (;;) {
+    int status = interp.read();
+    if (status == INTERP_ENDFILE)
+      return INTERP_OK;
+    if (status != INTERP_OK)
+      return status;
+    status = interp.execute();
+    if (status == INTERP_EXIT)
+      return INTERP_OK;
+    if (status != INTERP_OK)
+      return status;
+    if (interp.sequence_number() == stop)
+      return INTERP_OK;
+  }
+}
+
+TEST_CASE("Interp Checkpoint")
+{
+  char path[] = "/tmp/test_interp_checkpoint-XXXXXX";
+  int fd = mkstemp(path);
+  REQUIRE(fd >= 0);
+  REQUIRE(write(fd, program, sizeof(program) - 1) == (ssize_t) sizeof(program) - 1);
+  close(fd);
+
+  std::string state;
+  double end_x, end_y, end_z, end_canon_x, end_canon_y;
+  {
+    DECL_INIT_TEST_INTERP();
+    REQUIRE_INTERP_OK(test_interp.open(path));
+    REQUIRE_INTERP_OK(run(test_interp, CHECKPOINT_LINE));
+    REQUIRE_INTERP_OK(test_interp.checkpoint(state));
+    REQUIRE_INTERP_OK(run(test_interp, -1));
+    end_x = currentX(settings);
+    end_y = currentY(settings);
+    end_z = currentZ(settings);
+    end_canon_x = _sai._program_position_x;
+    end_canon_y = _sai._program_position_y;
+    test_interp.close();
+  }
+  CHECK_FUZZ(end_x, 25.0);
+  CHECK_FUZZ(end_y, 0.0);
+  CHECK_FUZZ(end_z, -1.0);
+
+  SECTION("Resume into G91 moves and IJ arcs")
+  {
+    DECL_INIT_TEST_INTERP();
+    REQUIRE_INTERP_OK(test_interp.open(path));
+    REQUIRE_INTERP_OK(test_interp.restore_checkpoint(state));
+    CHECK_FUZZ(currentX(settings), 20.0);
+    CHECK_FUZZ(currentY(settings), 5.0);
+    REQUIRE(settings->distance_mode == MODE_INCREMENTAL);
+    REQUIRE_INTERP_OK(run(test_interp, -1));
+    CHECK_FUZZ(currentX(settings), end_x);
+    CHECK_FUZZ(currentY(settings), end_y);
+    CHECK_FUZZ(currentZ(settings), end_z);
+    CHECK_FUZZ(_sai._program_position_x, end_canon_x);
+    CHECK_FUZZ(_sai._program_position_y, end_canon_y);
+    test_interp.close();
+  }
+
+  SECTION("Refused for another file")
+  {
+    DECL_INIT_TEST_INTERP();
+    char other[] = "/tmp/test_interp_checkpoint-XXXXXX";
+    int ofd = mkstemp(other);
+    REQUIRE(ofd >= 0);
+    REQUIRE(write(ofd, program, sizeof(program) - 1) == (ssize_t) sizeof(program) - 1);
+    close(ofd);
+    REQUIRE_INTERP_OK(test_interp.open(other));
+    REQUIRE(test_interp.restore_checkpoint(state) != INTERP_OK);
+    test_interp.close();
+    unlink(other);
+  }
+
+  unlink(path);
+}
@@ -4,6 +4,8 @@
 #include <python_plugin.hh>
 #include <rs274ngc_interp.hh>
 #include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
 #include <saicanon.hh>
 
 int _task = 1; // Dummy this out, not used in unit test
@@ -14,9 +16,27 @@ struct _inittab builtin_modules[] = {
     { nullptr, nullptr }
 };
 
+// the interpreter saves its parameters to rs274ngc.var in the current
+// directory, so the tests run in a directory of their own
+static const char *scratch_files[] = {
+    "test_interp_canon.log", "rs274ngc.var", "rs274ngc.var.bak", nullptr
+};
+
 int main (int argc, char * argv[]) {
+    char dir[] = "/tmp/test_interp-XXXXXX";
+    if (!mkdtemp(dir) || chdir(dir) != 0) {
+        perror("test_interp: scratch directory");
+        return 1;
+    }
     // KLUDGE just to satisfy saicanon dependencies, not used in tests
     _outfile = fopen("test_interp_canon.log", "w");
     PythonPlugin::instantiate(builtin_modules);
-    return Catch::Session().run( argc, argv );
+    int result = Catch::Session().run( argc, argv );
+
+    fclose(_outfile);
+    for (int n = 0; scratch_files[n]; n++)
+        unlink(scratch_files[n]);
+    if (chdir("/") == 0)
+        rmdir(dir);
+    return result;
 }
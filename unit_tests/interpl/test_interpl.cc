@@ -0,0 +1,391 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <math.h>
+#include <stdarg.h>
+#include <string.h>
+#include <atomic>
+#include <thread>
+
+#include "rcs.hh"
+#include "interpl.hh"
+#include "emc.hh"
+#include "emc_nml.hh"
+#include "rcs_print.hh"
+
+// stand-ins for the parts of libnml and libemc the list uses
+int NMLmsg::automatically_clear = 1;
+NMLmsg::NMLmsg(NMLTYPE t, size_t s) : type(t), size(s) {}
+void NMLmsg::clear() {}
+RCS_CMD_MSG::RCS_CMD_MSG(NMLTYPE t, long sz) : NMLmsg(t, (size_t) sz)
+{
+    serial_number = 0;
+}
+int emc_debug = 0;
+const char *emc_symbol_lookup(uint32_t) { return "?"; }
+int rcs_print(const char *, ...) { return 0; }
+int set_print_rcs_error_info(const char *, int) { return 0; }
+int print_rcs_error_new(const char *, ...) { return 0; }
+
+// these run on the writer threads too, where REQUIRE can not be used
+
+// along X at 10 units/s from wherever the last move ended
+static int move_x(NML_INTERP_LIST &list, int line, double x)
+{
+    EMC_TRAJ_LINEAR_MOVE m;
+    memset(&m.end, 0, sizeof(m.end));
+    m.end.tran.x = x;
+    m.vel = 10;
+    list.set_line_number(line);
+    return list.append(m);
+}
+
+static int dwell(NML_INTERP_LIST &list, int line, double seconds)
+{
+    EMC_TRAJ_DELAY d;
+    d.delay = seconds;
+    list.set_line_number(line);
+    return list.append(d);
+}
+
+TEST_CASE("appends come off in order")
+{
+    NML_INTERP_LIST list;
+
+    dwell(list, 1, 0.5);
+    dwell(list, 2, 0.25);
+    REQUIRE(list.len() == 2);
+    REQUIRE(list.time() == 0.75);
+
+    NMLmsg *m = list.get();
+    REQUIRE(m != NULL);
+    REQUIRE(m->type == EMC_TRAJ_DELAY_TYPE);
+    REQUIRE(list.get_line_number() == 1);
+    REQUIRE(list.get_duration() == 0.5);
+    REQUIRE(list.len() == 1);
+    REQUIRE(list.get() != NULL);
+    REQUIRE(list.get_line_number() == 2);
+    REQUIRE(list.get() == NULL);
+    REQUIRE(list.get_line_number() == 0);
+    REQUIRE(list.len() == 0);
+    REQUIRE(list.time() == 0);
+}
+
+TEST_CASE("held appends are seen only when published")
+{
+    NML_INTERP_LIST list;
+
+    list.hold(true);
+    dwell(list, 1, 1);
+    dwell(list, 1, 2);
+    REQUIRE(list.len() == 0);
+    REQUIRE(list.time() == 0);
+    REQUIRE(list.get() == NULL);
+
+    list.publish();
+    REQUIRE(list.len() == 2);
+    REQUIRE(list.time() == 3);
+
+    dwell(list, 2, 4);
+    REQUIRE(list.len() == 2);
+    list.discard();
+    list.publish();
+    REQUIRE(list.len() == 2);
+    REQUIRE(list.time() == 3);
+
+    // turning hold off publishes what was held
+    dwell(list, 3, 8);
+    list.hold(false);
+    REQUIRE(list.len() == 3);
+    REQUIRE(list.time() == 11);
+
+    REQUIRE(list.get() != NULL);
+    REQUIRE(list.get() != NULL);
+    REQUIRE(list.get() != NULL);
+    REQUIRE(list.get_line_number() == 3);
+    REQUIRE(list.get() == NULL);
+}
+
+TEST_CASE("an emptied list takes no time")
+{
+    NML_INTERP_LIST list;
+    int bad = 0;
+
+    // durations that do not add up exactly in floating point, published
+    // a few at a time and taken one at a time
+    list.hold(true);
+    for (int n = 1; n <= 1000; n++) {
+        dwell(list, n, 0.1 * (n % 7) + 1e-3 / n);
+        if (n % 3 == 0) {
+            list.publish();
+            if (list.time() <= 0)
+                bad++;
+            while (list.get() != NULL) {
+            }
+            if (list.time() != 0)
+                bad++;
+        }
+    }
+    REQUIRE(bad == 0);
+    list.publish();
+    REQUIRE(list.len() == 1);
+    REQUIRE(list.get() != NULL);
+    REQUIRE(list.len() == 0);
+    REQUIRE(list.time() == 0);
+}
+
+TEST_CASE("clear takes off only what was published")
+{
+    NML_INTERP_LIST list;
+
+    move_x(list, 1, 10);
+    move_x(list, 2, 20);
+    list.hold(true);
+    move_x(list, 3, 30);
+    list.clear();
+    REQUIRE(list.len() == 0);
+    REQUIRE(list.time() == 0);
+
+    list.publish();
+    REQUIRE(list.len() == 1);
+    REQUIRE(list.get() != NULL);
+    REQUIRE(list.get_line_number() == 3);
+    REQUIRE(list.get_duration() == 1);
+
+    // after a clear the machine may be anywhere, so the next move has no
+    // start to time it from
+    list.clear();
+    move_x(list, 4, 40);
+    list.publish();
+    REQUIRE(list.get() != NULL);
+    REQUIRE(list.get_duration() == 0);
+}
+
+// appends a move or dwell and returns the run time estimated for it
+static double estimate(NML_INTERP_LIST &list, NMLmsg &msg)
+{
+    REQUIRE(list.append(msg) == 0);
+    REQUIRE(list.get() != NULL);
+    return list.get_duration();
+}
+
+static double line_to(NML_INTERP_LIST &list, double x, double y, double z,
+    double a = 0, double u = 0)
+{
+    EMC_TRAJ_LINEAR_MOVE m;
+    memset(&m.end, 0, sizeof(m.end));
+    m.end.tran.x = x;
+    m.end.tran.y = y;
+    m.end.tran.z = z;
+    m.end.a = a;
+    m.end.u = u;
+    m.vel = 10;
+    return estimate(list, m);
+}
+
+// an arc in XY, about the Z axis
+static double arc_to(NML_INTERP_LIST &list, double x, double y, double z,
+    int turn)
+{
+    EMC_TRAJ_CIRCULAR_MOVE m;
+    memset(&m.end, 0, sizeof(m.end));
+    m.end.tran.x = x;
+    m.end.tran.y = y;
+    m.end.tran.z = z;
+    m.center.x = m.center.y = m.center.z = 0;
+    m.normal.x = m.normal.y = 0;
+    m.normal.z = 1;
+    m.turn = turn;
+    m.vel = 10;
+    return estimate(list, m);
+}
+
+TEST_CASE("run times are estimated at the programmed speed")
+{
+    NML_INTERP_LIST list;
+
+    // the first move has nowhere to start from
+    REQUIRE(line_to(list, 0, 0, 0) == 0);
+
+    SECTION("a line") {
+        REQUIRE(line_to(list, 30, 40, 0) == Approx(5));
+        REQUIRE(line_to(list, 30, 40, -10) == Approx(1));
+    }
+
+    SECTION("a move of rotary or uvw axes only is timed in their units") {
+        REQUIRE(line_to(list, 0, 0, 0, 90) == Approx(9));
+        REQUIRE(line_to(list, 0, 0, 0, 90, 20) == Approx(2));
+        // back to XYZ, which only counts the XYZ length
+        REQUIRE(line_to(list, 10, 0, 0, 0, 0) == Approx(1));
+    }
+
+    SECTION("arcs, counterclockwise and clockwise, with extra turns") {
+        const double quarter = 10 * M_PI / 2 / 10;
+        const double turn = 10 * 2 * M_PI / 10;
+
+        line_to(list, 10, 0, 0);
+        // G3, then G2 back, a quarter each
+        REQUIRE(arc_to(list, 0, 10, 0, 0) == Approx(quarter));
+        REQUIRE(arc_to(list, 10, 0, 0, -1) == Approx(quarter));
+        // the same with P2, one more turn each
+        REQUIRE(arc_to(list, 0, 10, 0, 1) == Approx(quarter + turn));
+        REQUIRE(arc_to(list, 10, 0, 0, -2) == Approx(quarter + turn));
+        // the long way round
+        REQUIRE(arc_to(list, 0, 10, 0, -1) == Approx(3 * quarter));
+        // a whole circle ends where it started
+        REQUIRE(arc_to(list, 0, 10, 0, 0) == Approx(turn));
+        REQUIRE(arc_to(list, 0, 10, 0, -1) == Approx(turn));
+        // a helix climbs along the arc
+        REQUIRE(arc_to(list, -10, 0, 5, 0) ==
+            Approx(sqrt(pow(10 * M_PI / 2, 2) + 25) / 10));
+    }
+
+    SECTION("a dwell takes its time, and moves go on from before it") {
+        EMC_TRAJ_DELAY d;
+        d.delay = 2.5;
+        line_to(list, 10, 0, 0);
+        REQUIRE(estimate(list, d) == 2.5);
+        REQUIRE(line_to(list, 20, 0, 0) == Approx(1));
+    }
+}
+
+TEST_CASE("the command from get() outlives a clear")
+{
+    NML_INTERP_LIST list;
+
+    dwell(list, 1, 0.5);
+    dwell(list, 2, 1);
+    dwell(list, 3, 2);
+    EMC_TRAJ_DELAY *d = (EMC_TRAJ_DELAY *) list.get();
+    REQUIRE(d != NULL);
+    // task issues the command after clearing for an abort or a new plan
+    list.clear();
+    list.clear();
+    REQUIRE(d->type == EMC_TRAJ_DELAY_TYPE);
+    REQUIRE(d->delay == 0.5);
+
+    // and again when the list was empty when cleared the first time
+    dwell(list, 4, 4);
+    d = (EMC_TRAJ_DELAY *) list.get();
+    list.clear();
+    dwell(list, 5, 8);
+    list.clear();
+    REQUIRE(d->delay == 4);
+
+    REQUIRE(list.get() == NULL);
+    dwell(list, 6, 16);
+    d = (EMC_TRAJ_DELAY *) list.get();
+    REQUIRE(d->delay == 16);
+    REQUIRE(list.get_line_number() == 6);
+    REQUIRE(list.time() == 0);
+}
+
+// lines of this many moves are published together
+#define LINE_NODES 3
+#define LINES 20000
+
+TEST_CASE("a reader on another thread sees whole lines")
+{
+    NML_INTERP_LIST list;
+    std::atomic<bool> done(false);
+    int failed = 0;
+
+    std::thread writer([&] {
+        list.hold(true);
+        for (int line = 1; line <= LINES; line++) {
+            for (int n = 0; n < LINE_NODES; n++)
+                failed += dwell(list, line, 0.001 * n) != 0;
+            // every tenth line fails and is dropped
+            if (line % 10 == 0)
+                list.discard();
+            else
+                list.publish();
+        }
+        done = true;
+    });
+
+    int line = 0, nodes = 0, got = 0, bad_len = 0, bad_time = 0;
+    bool bad_order = false;
+    for (;;) {
+        bool finished = done;
+        int len = list.len();
+        double time = list.time();
+        if (len < 0 || len > LINES * LINE_NODES)
+            bad_len++;
+        if (time < 0)
+            bad_time++;
+        NMLmsg *m = list.get();
+        if (m == NULL) {
+            if (finished)
+                break;
+            continue;
+        }
+        got++;
+        if (list.get_line_number() != line) {
+            // a new line starts only when the last one came whole
+            if (nodes != LINE_NODES && line != 0)
+                bad_order = true;
+            if (list.get_line_number() < line || list.get_line_number() % 10 == 0)
+                bad_order = true;
+            line = list.get_line_number();
+            nodes = 0;
+        }
+        nodes++;
+    }
+    writer.join();
+
+    REQUIRE(failed == 0);
+    REQUIRE_FALSE(bad_order);
+    REQUIRE(bad_len == 0);
+    REQUIRE(bad_time == 0);
+    REQUIRE(got == LINES / 10 * 9 * LINE_NODES);
+    REQUIRE(list.len() == 0);
+    REQUIRE(list.time() == 0);
+}
+
+TEST_CASE("clear while the writer appends")
+{
+    NML_INTERP_LIST list;
+    std::atomic<bool> done(false);
+    int failed = 0;
+
+    std::thread writer([&] {
+        list.hold(true);
+        for (int line = 1; line <= LINES; line++) {
+            for (int n = 0; n < LINE_NODES; n++)
+                failed += move_x(list, line, line + n) != 0;
+            list.publish();
+        }
+        done = true;
+    });
+
+    int clears = 0, partial = 0, bad = 0;
+    while (!done) {
+        int len = list.len();
+        if (len < 0 || list.time() < 0)
+            bad++;
+        list.clear();
+        clears++;
+        // whatever comes next was published after the clear, so it is a
+        // whole line
+        NMLmsg *m = list.get();
+        if (m != NULL) {
+            int line = list.get_line_number();
+            int nodes = 1;
+            while ((m = list.get()) != NULL && list.get_line_number() == line)
+                nodes++;
+            if (nodes != LINE_NODES)
+                partial++;
+        }
+    }
+    writer.join();
+    list.clear();
+
+    REQUIRE(failed == 0);
+    REQUIRE(clears > 0);
+    REQUIRE(bad == 0);
+    REQUIRE(partial == 0);
+    REQUIRE(list.len() == 0);
+    REQUIRE(list.time() == 0);
+    REQUIRE(list.get() == NULL);
+}
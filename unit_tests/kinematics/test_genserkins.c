@@ -0,0 +1,173 @@
+#include "greatest.h"
+#include "gotypes.h"
+#include "gomath.h"
+#include "genserkins.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Expand to all the definitions that need to be in
+   the test runner's main file. */
+GREATEST_MAIN_DEFS();
+
+/* Number of calls each path is timed over */
+#define BENCH_CALLS 20000
+
+static genser_struct genser;
+
+/* the PUMA-like defaults from genserkins.h */
+static void puma_setup(genser_struct *g)
+{
+    static const go_real a[6] = {DEFAULT_A1, DEFAULT_A2, DEFAULT_A3,
+                                 DEFAULT_A4, DEFAULT_A5, DEFAULT_A6};
+    static const go_real alpha[6] = {DEFAULT_ALPHA1, DEFAULT_ALPHA2, DEFAULT_ALPHA3,
+                                     DEFAULT_ALPHA4, DEFAULT_ALPHA5, DEFAULT_ALPHA6};
+    static const go_real d[6] = {DEFAULT_D1, DEFAULT_D2, DEFAULT_D3,
+                                 DEFAULT_D4, DEFAULT_D5, DEFAULT_D6};
+    int t;
+
+    for (t = 0; t < 6; t++) {
+        g->links[t].u.dh.a = a[t];
+        g->links[t].u.dh.alpha = alpha[t];
+        g->links[t].u.dh.d = d[t];
+        g->links[t].u.dh.theta = 0;
+        g->links[t].type = GO_LINK_DH;
+        g->links[t].quantity = GO_QUANTITY_ANGLE;
+    }
+    g->link_num = 6;
+    g->max_iterations = 100;
+    genser_kin_precompute(g);
+}
+
+/* joints well away from the wrist singularity */
+static void random_joints(go_real *j)
+{
+    int t;
+
+    for (t = 0; t < 6; t++) {
+        j[t] = ((double) rand() / RAND_MAX - 0.5) * 2.0;
+    }
+    if (fabs(j[4]) < 0.2) {
+        j[4] = 0.2;
+    }
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+TEST fwd_fast_matches_generic() {
+    go_real j[6];
+    go_pose ref;
+    go_hom fast;
+    go_pose fast_pose;
+    int n;
+
+    srand(1);
+    for (n = 0; n < 1000; n++) {
+        random_joints(j);
+        ASSERT_EQ(GO_RESULT_OK, genser_kin_fwd(&genser, j, &ref));
+        ASSERT_EQ(GO_RESULT_OK, genser_kin_fwd_fast(&genser, j, &fast));
+        ASSERT_EQ(GO_RESULT_OK, go_hom_pose_convert(&fast, &fast_pose));
+        ASSERT_IN_RANGE(ref.tran.x, fast_pose.tran.x, 1e-9);
+        ASSERT_IN_RANGE(ref.tran.y, fast_pose.tran.y, 1e-9);
+        ASSERT_IN_RANGE(ref.tran.z, fast_pose.tran.z, 1e-9);
+        ASSERT(go_quat_quat_compare(&ref.rot, &fast_pose.rot));
+    }
+    PASS();
+}
+
+TEST inv_fast_matches_generic() {
+    go_real j[6], jref[6], jfast[6];
+    go_pose target;
+    go_hom target_hom;
+    int n, t;
+
+    srand(2);
+    for (n = 0; n < 200; n++) {
+        random_joints(j);
+        genser_kin_fwd(&genser, j, &target);
+        go_pose_hom_convert(&target, &target_hom);
+        /* start a few degrees off, as from the previous servo cycle */
+        for (t = 0; t < 6; t++) {
+            jref[t] = jfast[t] = j[t] + 0.05;
+        }
+        ASSERT_EQ(GO_RESULT_OK, genser_kin_inv(&genser, &target, jref));
+        ASSERT_EQ(GO_RESULT_OK, genser_kin_inv_fast(&genser, &target_hom, jfast));
+        for (t = 0; t < 6; t++) {
+            ASSERT_IN_RANGE(jref[t], jfast[t], 1e-6);
+            ASSERT_IN_RANGE(j[t], jfast[t], 1e-6);
+        }
+    }
+    PASS();
+}
+
+TEST bench_fwd() {
+    go_real j[6];
+    go_pose ref;
+    go_hom fast;
+    double t0, t_ref, t_fast;
+    int n;
+
+    random_joints(j);
+    t0 = now();
+    for (n = 0; n < BENCH_CALLS; n++) {
+        j[0] += 1e-6;
+        genser_kin_fwd(&genser, j, &ref);
+    }
+    t_ref = now() - t0;
+    t0 = now();
+    for (n = 0; n < BENCH_CALLS; n++) {
+        j[0] += 1e-6;
+        genser_kin_fwd_fast(&genser, j, &fast);
+    }
+    t_fast = now() - t0;
+    printf("genser fwd: generic %.0f ns/call, fast %.0f ns/call\n",
+           t_ref / BENCH_CALLS * 1e9, t_fast / BENCH_CALLS * 1e9);
+    PASS();
+}
+
+TEST bench_inv() {
+    go_real j[6], jest[6];
+    go_pose target;
+    go_hom target_hom;
+    double t0, t_ref, t_fast;
+    int n, t;
+
+    random_joints(j);
+    genser_kin_fwd(&genser, j, &target);
+    go_pose_hom_convert(&target, &target_hom);
+    t0 = now();
+    for (n = 0; n < BENCH_CALLS / 10; n++) {
+        for (t = 0; t < 6; t++) jest[t] = j[t] + 0.01;
+        genser_kin_inv(&genser, &target, jest);
+    }
+    t_ref = now() - t0;
+    t0 = now();
+    for (n = 0; n < BENCH_CALLS / 10; n++) {
+        for (t = 0; t < 6; t++) jest[t] = j[t] + 0.01;
+        genser_kin_inv_fast(&genser, &target_hom, jest);
+    }
+    t_fast = now() - t0;
+    printf("genser inv: generic %.0f ns/call, fast %.0f ns/call\n",
+           t_ref / (BENCH_CALLS / 10) * 1e9, t_fast / (BENCH_CALLS / 10) * 1e9);
+    PASS();
+}
+
+SUITE(genserkins) {
+    puma_setup(&genser);
+    RUN_TEST(fwd_fast_matches_generic);
+    RUN_TEST(inv_fast_matches_generic);
+    RUN_TEST(bench_fwd);
+    RUN_TEST(bench_inv);
+}
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();      /* command-line arguments, initialization. */
+    RUN_SUITE(genserkins);
+    GREATEST_MAIN_END();        /* display results */
+}
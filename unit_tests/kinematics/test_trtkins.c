@@ -0,0 +1,270 @@
+#include "greatest.h"
+#include "rtapi_math.h"
+#include "posemath.h"
+#include "trtfuncs.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Expand to all the definitions that need to be in
+   the test runner's main file. */
+GREATEST_MAIN_DEFS();
+
+/* Number of servo periods each path is timed over */
+#define BENCH_PERIODS 200000
+
+/* the xyzac-trt-kins formulas as they were, written out per call */
+static void xyzac_fwd_ref(const double *j, double dy, double dz, double *w)
+{
+    double a_rad = j[3] * TO_RAD;
+    double c_rad = j[4] * TO_RAD;
+
+    w[0] = + cos(c_rad)              * (j[0]     )
+           + sin(c_rad) * cos(a_rad) * (j[1] - dy)
+           + sin(c_rad) * sin(a_rad) * (j[2] - dz)
+           + sin(c_rad) * dy;
+    w[1] = - sin(c_rad)              * (j[0]     )
+           + cos(c_rad) * cos(a_rad) * (j[1] - dy)
+           + cos(c_rad) * sin(a_rad) * (j[2] - dz)
+           + cos(c_rad) * dy;
+    w[2] = + 0
+           - sin(a_rad) * (j[1] - dy)
+           + cos(a_rad) * (j[2] - dz)
+           + dz;
+}
+
+static void xyzac_inv_ref(const double *w, double a, double c,
+                          double dy, double dz, double *j)
+{
+    double c_rad = c * TO_RAD;
+    double a_rad = a * TO_RAD;
+
+    j[0] = + cos(c_rad) * w[0]
+           - sin(c_rad) * w[1];
+    j[1] = + sin(c_rad) * cos(a_rad) * w[0]
+           + cos(c_rad) * cos(a_rad) * w[1]
+           - sin(a_rad)              * w[2]
+           - cos(a_rad) * dy
+           + sin(a_rad) * dz + dy;
+    j[2] = + sin(c_rad) * sin(a_rad) * w[0]
+           + cos(c_rad) * sin(a_rad) * w[1]
+           + cos(a_rad)              * w[2]
+           - sin(a_rad) * dy
+           - cos(a_rad) * dz
+           + dz;
+}
+
+/* and xyzbc-trt-kins */
+static void xyzbc_fwd_ref(const double *j, double dx, double dz, double *w)
+{
+    double b_rad = j[3] * TO_RAD;
+    double c_rad = j[4] * TO_RAD;
+
+    w[0] =   cos(c_rad) * cos(b_rad) * (j[0] - dx)
+           + sin(c_rad) *              (j[1])
+           - cos(c_rad) * sin(b_rad) * (j[2] - dz)
+           + cos(c_rad) * dx;
+    w[1] = - sin(c_rad) * cos(b_rad) * (j[0] - dx)
+           + cos(c_rad) *              (j[1])
+           + sin(c_rad) * sin(b_rad) * (j[2] - dz)
+           - sin(c_rad) * dx;
+    w[2] =   sin(b_rad) * (j[0] - dx)
+           + cos(b_rad) * (j[2] - dz)
+           + dz;
+}
+
+static void xyzbc_inv_ref(const double *w, double b, double c,
+                          double dx, double dz, double *j)
+{
+    double b_rad = b * TO_RAD;
+    double c_rad = c * TO_RAD;
+    double   dpx = -cos(b_rad)*dx - sin(b_rad)*dz + dx;
+    double   dpz = sin(b_rad)*dx - cos(b_rad)*dz + dz;
+
+    j[0] =   cos(c_rad) * cos(b_rad) * (w[0])
+           - sin(c_rad) * cos(b_rad) * (w[1])
+           + sin(b_rad) * (w[2])
+           + dpx;
+    j[1] =   sin(c_rad) * (w[0])
+           + cos(c_rad) * (w[1]);
+    j[2] = - cos(c_rad) * sin(b_rad) * (w[0])
+           + sin(c_rad) * sin(b_rad) * (w[1])
+           + cos(b_rad) * (w[2])
+           + dpz;
+}
+
+static double rnd(double range)
+{
+    return ((double) rand() / RAND_MAX - 0.5) * 2.0 * range;
+}
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+TEST xyzac_matches_reference(void)
+{
+    trt_kins_t k;
+    double j[5], w[3], wref[3], jj[3], jref[3], pivot[3];
+    int n, i;
+
+    trt_init(&k, TRT_TILT_A);
+    srand(1);
+    for (n = 0; n < 1000; n++) {
+        for (i = 0; i < 3; i++) j[i] = rnd(500);
+        j[3] = rnd(120);
+        j[4] = rnd(720);
+        pivot[0] = 0;
+        pivot[1] = rnd(100);
+        /* z offset plus a tool */
+        pivot[2] = rnd(100) + rnd(50);
+        xyzac_fwd_ref(j, pivot[1], pivot[2], wref);
+        trt_forward(trt_xform(&k, j[3], j[4], pivot), j, w);
+        for (i = 0; i < 3; i++) ASSERT_IN_RANGE(wref[i], w[i], 1e-9);
+
+        xyzac_inv_ref(w, j[3], j[4], pivot[1], pivot[2], jref);
+        trt_inverse(trt_xform(&k, j[3], j[4], pivot), w, jj);
+        for (i = 0; i < 3; i++) {
+            ASSERT_IN_RANGE(jref[i], jj[i], 1e-9);
+            ASSERT_IN_RANGE(j[i], jj[i], 1e-9);
+        }
+    }
+    PASS();
+}
+
+TEST xyzbc_matches_reference(void)
+{
+    trt_kins_t k;
+    double j[5], w[3], wref[3], jj[3], jref[3], pivot[3];
+    int n, i;
+
+    trt_init(&k, TRT_TILT_B);
+    srand(2);
+    for (n = 0; n < 1000; n++) {
+        for (i = 0; i < 3; i++) j[i] = rnd(500);
+        j[3] = rnd(120);
+        j[4] = rnd(720);
+        pivot[0] = rnd(100);
+        pivot[1] = 0;
+        pivot[2] = rnd(100) + rnd(50);
+        xyzbc_fwd_ref(j, pivot[0], pivot[2], wref);
+        trt_forward(trt_xform(&k, j[3], j[4], pivot), j, w);
+        for (i = 0; i < 3; i++) ASSERT_IN_RANGE(wref[i], w[i], 1e-9);
+
+        xyzbc_inv_ref(w, j[3], j[4], pivot[0], pivot[2], jref);
+        trt_inverse(trt_xform(&k, j[3], j[4], pivot), w, jj);
+        for (i = 0; i < 3; i++) {
+            ASSERT_IN_RANGE(jref[i], jj[i], 1e-9);
+            ASSERT_IN_RANGE(j[i], jj[i], 1e-9);
+        }
+    }
+    PASS();
+}
+
+TEST tool_tip_stays_put(void)
+{
+    trt_kins_t k;
+    double j[3], w0[3], w[3], pivot[3];
+    double tool = 35;
+
+    /* with the tool length in the pivot offset, a tool tip sitting on
+       the tilt axis stays there whatever A is; C only turns it about
+       the table center */
+    trt_init(&k, TRT_TILT_A);
+    pivot[0] = 0; pivot[1] = 20; pivot[2] = 80 + tool;
+    j[0] = pivot[0]; j[1] = pivot[1]; j[2] = pivot[2];
+    trt_forward(trt_xform(&k, 0, 0, pivot), j, w0);
+    trt_forward(trt_xform(&k, 45, 30, pivot), j, w);
+    ASSERT_IN_RANGE(w0[2], w[2], 1e-9);
+    ASSERT_IN_RANGE(hypot(w0[0], w0[1]), hypot(w[0], w[1]), 1e-9);
+    trt_forward(trt_xform(&k, 45, 0, pivot), j, w);
+    ASSERT_IN_RANGE(w0[0], w[0], 1e-9);
+    ASSERT_IN_RANGE(w0[1], w[1], 1e-9);
+    ASSERT_IN_RANGE(w0[2], w[2], 1e-9);
+    PASS();
+}
+
+TEST angle_cache(void)
+{
+    trt_angle_t a = {0};
+
+    trt_angle(&a, 30);
+    ASSERT_IN_RANGE(0.5, a.s, 1e-12);
+    trt_angle(&a, 90);
+    ASSERT_IN_RANGE(1.0, a.s, 1e-12);
+    ASSERT_IN_RANGE(0.0, a.c, 1e-12);
+    PASS();
+}
+
+/* One servo period calls the inverse on the commanded pose and the
+   forward on the joints that come out of it. moving: the rotaries
+   change every period, as in simultaneous 5 axis; otherwise they
+   stand still, as in 3+2 machining. */
+static void bench(int moving)
+{
+    trt_kins_t k;
+    double j[5], w[3], pivot[3] = {0, 20, 80};
+    double a = 30, c = 45;
+    double t0, t_ref, t_trt, sum = 0;
+    int n;
+
+    trt_init(&k, TRT_TILT_A);
+    w[0] = 100; w[1] = 50; w[2] = 10;
+    t0 = now();
+    for (n = 0; n < BENCH_PERIODS; n++) {
+        if (moving) { a += 1e-4; c += 1e-3; }
+        w[0] += 1e-5;
+        xyzac_inv_ref(w, a, c, pivot[1], pivot[2], j);
+        j[3] = a; j[4] = c;
+        xyzac_fwd_ref(j, pivot[1], pivot[2], w);
+        sum += w[0];
+    }
+    t_ref = now() - t0;
+
+    a = 30; c = 45;
+    w[0] = 100; w[1] = 50; w[2] = 10;
+    t0 = now();
+    for (n = 0; n < BENCH_PERIODS; n++) {
+        if (moving) { a += 1e-4; c += 1e-3; }
+        w[0] += 1e-5;
+        trt_inverse(trt_xform(&k, a, c, pivot), w, j);
+        trt_forward(trt_xform(&k, a, c, pivot), j, w);
+        sum += w[0];
+    }
+    t_trt = now() - t0;
+    printf("xyzac-trt %s rotaries: per call %.0f ns/period, cached %.0f ns/period (%g)\n",
+           moving ? "moving" : "still",
+           t_ref / BENCH_PERIODS * 1e9, t_trt / BENCH_PERIODS * 1e9,
+           sum * 0);
+}
+
+TEST bench_still(void)
+{
+    bench(0);
+    PASS();
+}
+
+TEST bench_moving(void)
+{
+    bench(1);
+    PASS();
+}
+
+SUITE(trtkins_suite) {
+    RUN_TEST(xyzac_matches_reference);
+    RUN_TEST(xyzbc_matches_reference);
+    RUN_TEST(tool_tip_stays_put);
+    RUN_TEST(angle_cache);
+    RUN_TEST(bench_still);
+    RUN_TEST(bench_moving);
+}
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(trtkins_suite);
+    GREATEST_MAIN_END();
+}
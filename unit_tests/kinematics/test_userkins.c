@@ -0,0 +1,190 @@
+#include "greatest.h"
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "userkins.h"
+
+/* Expand to all the definitions that need to be in
+   the test runner's main file. */
+GREATEST_MAIN_DEFS();
+
+/* genserkins built against libuserkins-hal, by the build; its joints
+   are in degrees */
+#ifndef USERKINS_TEST_MODULE
+#define USERKINS_TEST_MODULE "genserkins.so"
+#endif
+
+/* more than one slice per copy, so the batch runs on threads */
+#define POSES 2000
+
+/* degrees; genserkins stops iterating when a step is below 1e-6 rad */
+#define TOLERANCE 1e-4
+
+static userkins_t *kins;
+static double joints[POSES * USERKINS_JOINTS];
+static double solved[POSES * USERKINS_JOINTS];
+static EmcPose poses[POSES];
+static int result[POSES];
+
+/* the waist turns through 150 degrees, far enough that a guess from
+   the start of the path finds another solution at its end; the other
+   joints stay well away from the wrist singularity */
+static void path_joints(double *j, long n)
+{
+    long i;
+    int t;
+
+    memset(j, 0, n * USERKINS_JOINTS * sizeof(*j));
+    for (i = 0; i < n; i++) {
+        j[i * USERKINS_JOINTS] = 150.0 * i / n;
+        for (t = 1; t < 6; t++) {
+            j[i * USERKINS_JOINTS + t] = 10 + 5 * t;
+        }
+    }
+}
+
+TEST loads_copies(void)
+{
+    ASSERT(kins != NULL);
+    ASSERT_EQ(2, userkins_copies(kins));
+    ASSERT_EQ(KINEMATICS_BOTH, userkins_type(kins));
+    PASS();
+}
+
+TEST forward_then_inverse_round_trips(void)
+{
+    long i;
+    int t;
+
+    path_joints(joints, POSES);
+    ASSERT_EQ(0, userkins_forward(kins, joints, poses, result, POSES));
+
+    /* each pose starts from a guess a little off its joints */
+    memcpy(solved, joints, sizeof(solved));
+    for (i = 0; i < POSES; i++) {
+        solved[i * USERKINS_JOINTS + 1] += 0.5;
+    }
+    ASSERT_EQ(0, userkins_inverse(kins, poses, solved, result, POSES, 0));
+    for (i = 0; i < POSES; i++) {
+        ASSERT_EQ(0, result[i]);
+        for (t = 0; t < 6; t++) {
+            ASSERT_IN_RANGE(joints[i * USERKINS_JOINTS + t],
+                solved[i * USERKINS_JOINTS + t], TOLERANCE);
+        }
+    }
+    PASS();
+}
+
+TEST inverse_follows_a_path_from_the_first_seed(void)
+{
+    long i;
+    int t;
+
+    path_joints(joints, POSES);
+    ASSERT_EQ(0, userkins_forward(kins, joints, poses, NULL, POSES));
+
+    /* only the first pose has a guess; the rest are far off, and are
+       replaced by the solution before them */
+    for (i = 0; i < POSES * USERKINS_JOINTS; i++) {
+        solved[i] = 1000;
+    }
+    memcpy(solved, joints, USERKINS_JOINTS * sizeof(*solved));
+    solved[1] += 0.5;
+    ASSERT_EQ(0, userkins_inverse(kins, poses, solved, result, POSES,
+            USERKINS_SEED_PREVIOUS));
+    for (i = 0; i < POSES; i++) {
+        for (t = 0; t < 6; t++) {
+            ASSERT_IN_RANGE(joints[i * USERKINS_JOINTS + t],
+                solved[i * USERKINS_JOINTS + t], TOLERANCE);
+        }
+    }
+    PASS();
+}
+
+TEST set_reaches_every_copy(void)
+{
+    double a2, before_x, after_x;
+
+    ASSERT_EQ(0, userkins_get(kins, "genserkins.A-2", &a2));
+    path_joints(joints, POSES);
+    userkins_forward(kins, joints, poses, NULL, POSES);
+    before_x = poses[POSES - 1].tran.x;
+
+    ASSERT_EQ(0, userkins_set(kins, "genserkins.A-2", a2 + 10));
+    userkins_forward(kins, joints, poses, NULL, POSES);
+    after_x = poses[POSES - 1].tran.x;
+    /* the last pose is on the second copy */
+    ASSERT(fabs(after_x - before_x) > 1);
+    ASSERT_EQ(0, userkins_set(kins, "genserkins.A-2", a2));
+
+    ASSERT(userkins_set(kins, "genserkins.no-such-pin", 0) < 0);
+    PASS();
+}
+
+/* two callers on the same copies get their own answers */
+struct caller {
+    double offset;
+    double joints[POSES * USERKINS_JOINTS];
+    EmcPose poses[POSES];
+    double solved[POSES * USERKINS_JOINTS];
+    long failed;
+};
+
+static void *call(void *arg)
+{
+    struct caller *c = (struct caller *) arg;
+    long i;
+    int n;
+
+    path_joints(c->joints, POSES);
+    for (i = 0; i < POSES; i++) {
+        c->joints[i * USERKINS_JOINTS] += c->offset;
+    }
+    c->failed = 0;
+    for (n = 0; n < 20; n++) {
+        memcpy(c->solved, c->joints, sizeof(c->solved));
+        c->failed += userkins_forward(kins, c->joints, c->poses, NULL, POSES);
+        c->failed += userkins_inverse(kins, c->poses, c->solved, NULL, POSES, 0);
+    }
+    return NULL;
+}
+
+TEST callers_on_threads_take_turns(void)
+{
+    static struct caller c[2];
+    pthread_t thread;
+    long i;
+
+    c[0].offset = 0;
+    c[1].offset = 30;
+    ASSERT_EQ(0, pthread_create(&thread, NULL, call, &c[1]));
+    call(&c[0]);
+    pthread_join(thread, NULL);
+    for (int n = 0; n < 2; n++) {
+        ASSERT_EQ(0, c[n].failed);
+        for (i = 0; i < POSES * USERKINS_JOINTS; i++) {
+            ASSERT_IN_RANGE(c[n].joints[i], c[n].solved[i], TOLERANCE);
+        }
+    }
+    PASS();
+}
+
+SUITE(userkins) {
+    kins = userkins_load(USERKINS_TEST_MODULE, 0, NULL, 2);
+    RUN_TEST(loads_copies);
+    if (kins) {
+        RUN_TEST(forward_then_inverse_round_trips);
+        RUN_TEST(inverse_follows_a_path_from_the_first_seed);
+        RUN_TEST(set_reaches_every_copy);
+        RUN_TEST(callers_on_threads_take_turns);
+        userkins_unload(kins);
+    }
+}
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(userkins);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,285 @@
+#include "greatest.h"
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+
+#include "motion.h"
+#include "tcq.h"
+
+/* Expand to all the definitions that need to be in
+   the test runner's main file. */
+GREATEST_MAIN_DEFS();
+
+static emcmot_command_queue_t queue;
+
+/* a planner queue with PLANNER_ROOM slots before it counts as full, which
+   is what planner_room() in command.c reports */
+#define PLANNER_ROOM 10
+#define PLANNER_SIZE (TC_QUEUE_MARGIN + PLANNER_ROOM)
+
+static TC_QUEUE_STRUCT planner;
+static TC_STRUCT planner_space[PLANNER_SIZE];
+
+/* the id a run() fails on, 0 for none */
+static int fail_id;
+static int runs;
+
+static int planner_room(void)
+{
+    return tcqRoom(&planner);
+}
+
+static int run_into_planner(emcmot_command_t * c)
+{
+    TC_STRUCT tc;
+
+    runs++;
+    if (c->id == fail_id) {
+	return -1;
+    }
+    memset(&tc, 0, sizeof(tc));
+    tc.id = c->id;
+    return tcqPut(&planner, &tc);
+}
+
+static int put(int id)
+{
+    emcmot_command_t c;
+
+    memset(&c, 0, sizeof(c));
+    c.command = EMCMOT_SET_LINE;
+    c.id = id;
+    return emcmotCommandQueuePut(&queue, &c);
+}
+
+static void setup(void *arg)
+{
+    (void) arg;
+    memset(&queue, 0, sizeof(queue));
+    emcmotCommandQueueInit(&queue, 4);
+    tcqCreate(&planner, PLANNER_SIZE, planner_space);
+    fail_id = 0;
+    runs = 0;
+}
+
+TEST puts_stop_when_full(void)
+{
+    int n;
+
+    ASSERT_EQ(0, emcmotCommandQueueLen(&queue));
+    ASSERT_EQ(0, emcmotCommandQueuePeek(&queue, 0));
+    for (n = 0; n < EMCMOT_COMMAND_QUEUE_SIZE; n++) {
+	ASSERT_EQ(0, put(n));
+    }
+    ASSERT_EQ(-1, put(n));
+    ASSERT_EQ(EMCMOT_COMMAND_QUEUE_SIZE, emcmotCommandQueueLen(&queue));
+
+    ASSERT_EQ(0, emcmotCommandQueuePeek(&queue, -1));
+    ASSERT_EQ(0, emcmotCommandQueuePeek(&queue, EMCMOT_COMMAND_QUEUE_SIZE));
+    ASSERT_EQ(EMCMOT_COMMAND_QUEUE_SIZE - 1,
+	emcmotCommandQueuePeek(&queue, EMCMOT_COMMAND_QUEUE_SIZE - 1)->id);
+
+    /* taking one makes room for exactly one */
+    emcmotCommandQueueTake(&queue, 1, 0);
+    ASSERT_EQ(0, put(100));
+    ASSERT_EQ(-1, put(101));
+    ASSERT_EQ(1, emcmotCommandQueuePeek(&queue, 0)->id);
+    ASSERT_EQ(100,
+	emcmotCommandQueuePeek(&queue, EMCMOT_COMMAND_QUEUE_SIZE - 1)->id);
+
+    emcmotCommandQueueTake(&queue, EMCMOT_COMMAND_QUEUE_SIZE, 0);
+    ASSERT_EQ(0, emcmotCommandQueueLen(&queue));
+    ASSERT_EQ(0, emcmotCommandQueuePeek(&queue, 0));
+    PASS();
+}
+
+TEST in_and_out_wrap_around(void)
+{
+    int n, k, id = 0, next = 0;
+
+    /* both counters overflow during the test */
+    queue.in = queue.out = UINT_MAX - 2 * EMCMOT_COMMAND_QUEUE_SIZE - 3;
+    for (n = 0; n < 5 * EMCMOT_COMMAND_QUEUE_SIZE; n++) {
+	while (put(id) == 0) {
+	    id++;
+	}
+	ASSERT_EQ(EMCMOT_COMMAND_QUEUE_SIZE, emcmotCommandQueueLen(&queue));
+	/* take an odd number each time so the slots move around */
+	for (k = 0; k < 7; k++) {
+	    ASSERT_EQ(next + k, emcmotCommandQueuePeek(&queue, k)->id);
+	}
+	emcmotCommandQueueTake(&queue, 7, 0);
+	next += 7;
+    }
+    ASSERT(queue.in < UINT_MAX / 2);
+    ASSERT_EQ(EMCMOT_COMMAND_QUEUE_SIZE - 7, emcmotCommandQueueLen(&queue));
+    PASS();
+}
+
+TEST room_follows_the_planner(void)
+{
+    int id = 1;
+
+    /* nothing may be sent before motion has said how much the planner
+       takes */
+    ASSERT(emcmotCommandQueueRoom(&queue) <= 0);
+    ASSERT_EQ(0, emcmotCommandQueueRun(&queue, run_into_planner,
+	    planner_room));
+    ASSERT_EQ(PLANNER_ROOM, emcmotCommandQueueRoom(&queue));
+
+    /* what was sent on that room always fits into the planner */
+    while (emcmotCommandQueueRoom(&queue) > 0) {
+	ASSERT_EQ(0, put(id++));
+    }
+    ASSERT_EQ(PLANNER_ROOM, emcmotCommandQueueLen(&queue));
+
+    /* at most batch a cycle, and the room left is what the planner has
+       left less what is still waiting */
+    ASSERT_EQ(4, emcmotCommandQueueRun(&queue, run_into_planner,
+	    planner_room));
+    ASSERT_EQ(PLANNER_ROOM - 4, planner_room());
+    ASSERT_EQ(0, emcmotCommandQueueRoom(&queue));
+    ASSERT_EQ(4, emcmotCommandQueueRun(&queue, run_into_planner,
+	    planner_room));
+    ASSERT_EQ(2, emcmotCommandQueueRun(&queue, run_into_planner,
+	    planner_room));
+    ASSERT_EQ(0, planner_room());
+    ASSERT_EQ(0, emcmotCommandQueueRoom(&queue));
+    ASSERT_EQ(PLANNER_ROOM, tcqLen(&planner));
+    ASSERT_EQ(1, tcqItem(&planner, 0)->id);
+    ASSERT_EQ(PLANNER_ROOM, tcqItem(&planner, PLANNER_ROOM - 1)->id);
+
+    /* a full planner takes nothing, even if more was sent */
+    ASSERT_EQ(0, put(id++));
+    ASSERT_EQ(0, emcmotCommandQueueRun(&queue, run_into_planner,
+	    planner_room));
+    ASSERT_EQ(-1, emcmotCommandQueueRoom(&queue));
+
+    /* as the planner finishes moves, the room comes back */
+    tcqRemove(&planner, 3);
+    ASSERT_EQ(1, emcmotCommandQueueRun(&queue, run_into_planner,
+	    planner_room));
+    ASSERT_EQ(2, emcmotCommandQueueRoom(&queue));
+    ASSERT_EQ(PLANNER_ROOM + 1, tcqLast(&planner)->id);
+    PASS();
+}
+
+TEST room_is_capped_by_the_queue(void)
+{
+    static TC_STRUCT space[TC_QUEUE_MARGIN + 2 * EMCMOT_COMMAND_QUEUE_SIZE];
+
+    tcqCreate(&planner, TC_QUEUE_MARGIN + 2 * EMCMOT_COMMAND_QUEUE_SIZE,
+	space);
+    emcmotCommandQueueRun(&queue, run_into_planner, planner_room);
+    ASSERT_EQ(2 * EMCMOT_COMMAND_QUEUE_SIZE, queue.room);
+    ASSERT_EQ(EMCMOT_COMMAND_QUEUE_SIZE, emcmotCommandQueueRoom(&queue));
+    PASS();
+}
+
+TEST a_failed_command_drops_the_rest_until_abort(void)
+{
+    int id;
+
+    emcmotCommandQueueRun(&queue, run_into_planner, planner_room);
+    for (id = 1; id <= 6; id++) {
+	ASSERT_EQ(0, put(id));
+    }
+
+    /* 3 fails: 1 and 2 are planned, 3 to 6 are gone */
+    fail_id = 3;
+    ASSERT_EQ(6, emcmotCommandQueueRun(&queue, run_into_planner,
+	    planner_room));
+    ASSERT_EQ(3, runs);
+    ASSERT_EQ(1, queue.failed);
+    ASSERT_EQ(0, emcmotCommandQueueLen(&queue));
+    ASSERT_EQ(2, tcqLen(&planner));
+
+    /* what task sends before it sees the error is dropped unrun */
+    ASSERT_EQ(0, put(7));
+    ASSERT_EQ(0, put(8));
+    ASSERT_EQ(2, emcmotCommandQueueRun(&queue, run_into_planner,
+	    planner_room));
+    ASSERT_EQ(3, runs);
+    ASSERT_EQ(2, tcqLen(&planner));
+
+    /* the abort command clears it */
+    queue.failed = 0;
+    ASSERT_EQ(0, put(9));
+    ASSERT_EQ(1, emcmotCommandQueueRun(&queue, run_into_planner,
+	    planner_room));
+    ASSERT_EQ(4, runs);
+    ASSERT_EQ(9, tcqLast(&planner)->id);
+    PASS();
+}
+
+/* a reader thread takes commands a few at a time while this one puts
+   them as fast as the room allows; they must all arrive, in order. Both
+   yield while waiting so this also finishes on a single cpu. */
+#define COMMANDS 200000
+
+static int mismatches;
+
+static void *reader(void *arg)
+{
+    int next = 0, n, len;
+    emcmot_command_t *c;
+
+    (void) arg;
+    while (next < COMMANDS) {
+	len = emcmotCommandQueueLen(&queue);
+	if (len == 0) {
+	    sched_yield();
+	    continue;
+	}
+	if (len > 5) {
+	    len = 5;
+	}
+	for (n = 0; n < len; n++) {
+	    c = emcmotCommandQueuePeek(&queue, n);
+	    if (c == 0 || c->id != next + n) {
+		mismatches++;
+	    }
+	}
+	emcmotCommandQueueTake(&queue, len, EMCMOT_COMMAND_QUEUE_SIZE);
+	next += len;
+    }
+    return 0;
+}
+
+TEST puts_while_taking_are_consistent(void)
+{
+    pthread_t thread;
+    int id = 0;
+
+    mismatches = 0;
+    queue.room = EMCMOT_COMMAND_QUEUE_SIZE;
+    ASSERT_EQ(0, pthread_create(&thread, 0, reader, 0));
+    while (id < COMMANDS) {
+	if (emcmotCommandQueueRoom(&queue) > 0) {
+	    ASSERT_EQ(0, put(id++));
+	} else {
+	    sched_yield();
+	}
+    }
+    pthread_join(thread, 0);
+    ASSERT_EQ(0, mismatches);
+    ASSERT_EQ(0, emcmotCommandQueueLen(&queue));
+    PASS();
+}
+
+SUITE(cmdqueue) {
+    SET_SETUP(setup, 0);
+    RUN_TEST(puts_stop_when_full);
+    RUN_TEST(in_and_out_wrap_around);
+    RUN_TEST(room_follows_the_planner);
+    RUN_TEST(room_is_capped_by_the_queue);
+    RUN_TEST(a_failed_command_drops_the_rest_until_abort);
+    RUN_TEST(puts_while_taking_are_consistent);
+}
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(cmdqueue);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,296 @@
+#include "greatest.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* The homing state machines are tested directly, driving simulated
+   joints with home switches. */
+#include "homing.c"
+#include "simple_tp.h"
+
+/* Expand to all the definitions that need to be in
+   the test runner's main file. */
+GREATEST_MAIN_DEFS();
+
+#define NJOINTS 12
+#define SERVO_FREQ 1000.0
+/* give up after this many simulated seconds; the runs here take well
+   under a minute of machine time, and a few milliseconds to simulate */
+#define MAX_SECONDS 120
+
+/* what homing.c expects from the rest of motmod */
+static emcmot_joint_t joint_array[EMCMOT_MAX_JOINTS];
+emcmot_joint_t *joints = joint_array;
+static struct emcmot_status_t status;
+static struct emcmot_config_t config;
+struct emcmot_status_t *emcmotStatus = &status;
+struct emcmot_config_t *emcmotConfig = &config;
+double servo_freq = SERVO_FREQ;
+
+static int errors;
+
+void reportError(const char *fmt, ...)
+{
+    va_list ap;
+
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fprintf(stderr, "\n");
+    errors++;
+}
+
+bool checkAllHomed(void) { return 0; }
+void switch_to_teleop_mode(void) { }
+void emcmotSetRotaryUnlock(int axis, int unlock) { }
+int emcmotGetRotaryIsUnlocked(int axis) { return 1; }
+
+void rtapi_print_msg(msg_level_t level, const char *fmt, ...) { }
+
+void *hal_malloc(long int size)
+{
+    return calloc(1, size);
+}
+
+static hal_bit_t pin_bits[EMCMOT_MAX_JOINTS * 4];
+static hal_s32_t pin_s32s[EMCMOT_MAX_JOINTS];
+static int nbits, ns32s;
+
+int hal_pin_bit_newf(hal_pin_dir_t dir, hal_bit_t ** data_ptr_addr,
+    int comp_id, const char *fmt, ...)
+{
+    *data_ptr_addr = &pin_bits[nbits++];
+    return 0;
+}
+
+int hal_pin_s32_newf(hal_pin_dir_t dir, hal_s32_t ** data_ptr_addr,
+    int comp_id, const char *fmt, ...)
+{
+    *data_ptr_addr = &pin_s32s[ns32s++];
+    return 0;
+}
+
+/* where each joint's home switch trips, in motor position */
+static double switch_pos[EMCMOT_MAX_JOINTS];
+/* servo period each joint started homing, and started its final move */
+static long started[EMCMOT_MAX_JOINTS];
+static long final_move[EMCMOT_MAX_JOINTS];
+
+static void setup_joints(const int *sequence, const int *after)
+{
+    int jno;
+
+    memset(joint_array, 0, sizeof(joint_array));
+    memset(&status, 0, sizeof(status));
+    memset(&config, 0, sizeof(config));
+    status.motion_state = EMCMOT_MOTION_FREE;
+    config.numJoints = NJOINTS;
+    errors = 0;
+    nbits = ns32s = 0;
+
+    homing_init();
+    export_joint_home_pins(NJOINTS, 0);
+    for (jno = 0; jno < NJOINTS; jno++) {
+        emcmot_joint_t *joint = &joints[jno];
+        joint->flag = EMCMOT_JOINT_ACTIVE_BIT;
+        joint->vel_limit = 50;
+        joint->min_pos_limit = -200;
+        joint->max_pos_limit = 200;
+        joint->free_tp.max_acc = 500;
+        switch_pos[jno] = 5 + 2 * jno;
+        started[jno] = final_move[jno] = -1;
+        /* search toward the switch, back off, latch slowly, then
+           move a little way off it */
+        set_joint_homing_params(jno, 0, -2, 0, 40, 5, 0,
+                                sequence[jno], after ? after[jno] : -1, 0);
+        set_joint_homed(jno, 0);
+    }
+    /* first pass initialization, done by the servo thread at startup */
+    do_homing_sequence();
+}
+
+/* one servo period, in the order motmod does it */
+static void servo_period(long cycle)
+{
+    int jno;
+
+    for (jno = 0; jno < NJOINTS; jno++) {
+        emcmot_joint_t *joint = &joints[jno];
+        *(joint_home_data->jhd[jno].home_sw) =
+            joint->pos_fb + joint->motor_offset >= switch_pos[jno];
+    }
+    read_homing_in_pins(NJOINTS);
+    do_homing_sequence();
+    do_homing();
+    write_homing_out_pins(NJOINTS);
+    for (jno = 0; jno < NJOINTS; jno++) {
+        emcmot_joint_t *joint = &joints[jno];
+        if (started[jno] < 0 && H[jno].home_state != HOME_IDLE) {
+            started[jno] = cycle;
+        }
+        if (final_move[jno] < 0 && H[jno].home_state == HOME_FINAL_MOVE_WAIT) {
+            final_move[jno] = cycle;
+        }
+        simple_tp_update(&joint->free_tp, 1.0 / SERVO_FREQ);
+        joint->pos_cmd = joint->free_tp.curr_pos;
+        joint->pos_fb = joint->pos_cmd;
+    }
+}
+
+/* home all joints, returns the machine time it took in seconds */
+static double home_all(void)
+{
+    long cycle;
+
+    set_home_sequence_state(HOME_SEQUENCE_START);
+    for (cycle = 0; cycle < MAX_SECONDS * SERVO_FREQ; cycle++) {
+        servo_period(cycle);
+        if (get_home_sequence_state() == HOME_SEQUENCE_IDLE
+            && !get_homing_is_active()) {
+            break;
+        }
+    }
+    return cycle / SERVO_FREQ;
+}
+
+/* a 12 joint gantry cell: Z first, then two gantry pairs each with a
+   synchronized final move, then seven more joints */
+static const int cell_sequence[NJOINTS] =
+    {0, -1, -1, -2, -2, 3, 4, 5, 6, 7, 8, 9};
+/* really everything only needs Z out of the way */
+static const int cell_after[NJOINTS] =
+    {-1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1};
+
+static double sequence_time, graph_time;
+
+TEST by_sequence(void)
+{
+    int jno;
+
+    setup_joints(cell_sequence, NULL);
+    sequence_time = home_all();
+    for (jno = 0; jno < NJOINTS; jno++) {
+        ASSERT(H[jno].homed);
+    }
+    /* each sequence waits for the one before it */
+    for (jno = 6; jno < NJOINTS; jno++) {
+        ASSERT(started[jno] > started[jno - 1]);
+    }
+    ASSERT_EQ(0, errors);
+    printf("homing by HOME_SEQUENCE took %.3f s of machine time\n", sequence_time);
+    PASS();
+}
+
+TEST by_home_after(void)
+{
+    int jno;
+
+    setup_joints(cell_sequence, cell_after);
+    graph_time = home_all();
+    for (jno = 0; jno < NJOINTS; jno++) {
+        ASSERT(H[jno].homed);
+    }
+    /* everything starts together once joint 0 is done */
+    for (jno = 2; jno < NJOINTS; jno++) {
+        ASSERT_EQ(started[1], started[jno]);
+    }
+    ASSERT(started[1] > started[0]);
+    ASSERT_EQ(0, errors);
+    printf("homing by HOME_AFTER took %.3f s of machine time\n", graph_time);
+    ASSERT(graph_time < sequence_time / 2);
+    PASS();
+}
+
+TEST gantry_pairs_stay_together(void)
+{
+    setup_joints(cell_sequence, cell_after);
+    home_all();
+    /* the switches are at different places, yet each pair makes its
+       final move together */
+    ASSERT(final_move[1] >= 0);
+    ASSERT_EQ(final_move[1], final_move[2]);
+    ASSERT(final_move[3] >= 0);
+    ASSERT_EQ(final_move[3], final_move[4]);
+    /* but the pairs do not wait for each other */
+    ASSERT(final_move[1] != final_move[3]);
+    PASS();
+}
+
+TEST home_after_orders_joints(void)
+{
+    int after[NJOINTS];
+    int sequence[NJOINTS];
+    int jno;
+
+    /* a chain 11 -> 10 -> ... -> 0, all with the same sequence */
+    for (jno = 0; jno < NJOINTS; jno++) {
+        sequence[jno] = 0;
+        after[jno] = jno + 1 < NJOINTS ? 1 << (jno + 1) : 0;
+    }
+    setup_joints(sequence, after);
+    home_all();
+    for (jno = 0; jno < NJOINTS; jno++) {
+        ASSERT(H[jno].homed);
+    }
+    for (jno = 0; jno + 1 < NJOINTS; jno++) {
+        ASSERT(started[jno] > started[jno + 1]);
+    }
+    PASS();
+}
+
+TEST home_after_loop(void)
+{
+    int after[NJOINTS];
+    int sequence[NJOINTS];
+    int jno;
+
+    for (jno = 0; jno < NJOINTS; jno++) {
+        sequence[jno] = 999;
+        after[jno] = -1;
+    }
+    sequence[0] = sequence[1] = 0;
+    after[0] = 1 << 1;
+    after[1] = 1 << 0;
+    setup_joints(sequence, after);
+    home_all();
+    ASSERT(!H[0].homed);
+    ASSERT(!H[1].homed);
+    ASSERT_EQ(1, errors);
+    PASS();
+}
+
+TEST sequence_gap_stops_home_all(void)
+{
+    int sequence[NJOINTS];
+    int jno;
+
+    for (jno = 0; jno < NJOINTS; jno++) {
+        sequence[jno] = 999;
+    }
+    sequence[0] = 0;
+    sequence[1] = 1;
+    sequence[2] = 3;
+    setup_joints(sequence, NULL);
+    home_all();
+    ASSERT(H[0].homed);
+    ASSERT(H[1].homed);
+    ASSERT(!H[2].homed);
+    ASSERT(!H[3].homed);
+    PASS();
+}
+
+SUITE(homing_suite) {
+    RUN_TEST(by_sequence);
+    RUN_TEST(by_home_after);
+    RUN_TEST(gantry_pairs_stay_together);
+    RUN_TEST(home_after_orders_joints);
+    RUN_TEST(home_after_loop);
+    RUN_TEST(sequence_gap_stops_home_all);
+}
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(homing_suite);
+    GREATEST_MAIN_END();
+}
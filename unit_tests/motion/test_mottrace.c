@@ -0,0 +1,119 @@
+#include "greatest.h"
+#include <pthread.h>
+#include <string.h>
+
+#include "mottrace.h"
+
+/* Expand to all the definitions that need to be in
+   the test runner's main file. */
+GREATEST_MAIN_DEFS();
+
+static emcmot_trace_t trace;
+static emcmot_trace_event_t events[EMCMOT_TRACE_SIZE];
+
+TEST events_come_back_oldest_first(void)
+{
+    int n;
+
+    memset(&trace, 0, sizeof(trace));
+    for (n = 0; n < 10; n++) {
+	emcmotTracePutTime(&trace, EMCMOT_TRACE_ADD, 100 + n, 1000 * n);
+    }
+
+    ASSERT_EQ(0, emcmotTraceRead(&trace, EMCMOT_TRACE_READ, events));
+    ASSERT_EQ(10, emcmotTraceRead(&trace, EMCMOT_TRACE_ADD, events));
+    for (n = 0; n < 10; n++) {
+	ASSERT_EQ(100 + n, events[n].id);
+	ASSERT_EQ(1000 * n, events[n].time);
+    }
+    PASS();
+}
+
+TEST a_full_ring_keeps_the_newest(void)
+{
+    int n, count;
+
+    memset(&trace, 0, sizeof(trace));
+    for (n = 0; n < 3 * EMCMOT_TRACE_SIZE + 5; n++) {
+	emcmotTracePutTime(&trace, EMCMOT_TRACE_ACTIVE, n, n);
+    }
+
+    /* all but the slot the next event goes in */
+    count = emcmotTraceRead(&trace, EMCMOT_TRACE_ACTIVE, events);
+    ASSERT_EQ(EMCMOT_TRACE_SIZE - 1, count);
+    for (n = 0; n < count; n++) {
+	ASSERT_EQ(2 * EMCMOT_TRACE_SIZE + 6 + n, events[n].id);
+    }
+    PASS();
+}
+
+TEST nothing_is_put_while_disabled(void)
+{
+    memset(&trace, 0, sizeof(trace));
+    emcmotTracePut(&trace, EMCMOT_TRACE_READ, 1);
+    ASSERT_EQ(0, emcmotTraceRead(&trace, EMCMOT_TRACE_READ, events));
+
+    trace.enabled = 1;
+    emcmotTracePut(&trace, EMCMOT_TRACE_READ, 2);
+    emcmotTracePut(&trace, EMCMOT_TRACE_READ, 3);
+    ASSERT_EQ(2, emcmotTraceRead(&trace, EMCMOT_TRACE_READ, events));
+    ASSERT_EQ(2, events[0].id);
+    ASSERT(events[1].time >= events[0].time);
+
+    /* out of range stages are ignored */
+    emcmotTracePut(&trace, EMCMOT_TRACE_STAGES, 4);
+    emcmotTracePut(&trace, -1, 4);
+    ASSERT_EQ(0, emcmotTraceRead(&trace, EMCMOT_TRACE_STAGES, events));
+    PASS();
+}
+
+/* a writer thread puts events whose time is their sequence number and
+   whose id is derived from it; whatever the reader gets must be
+   consecutive and intact */
+#define WRITES 2000000
+
+static void *writer(void *arg)
+{
+    int n;
+
+    (void) arg;
+    for (n = 0; n < WRITES; n++) {
+	emcmotTracePutTime(&trace, EMCMOT_TRACE_WRITE, n * 7 + 3, n);
+    }
+    return 0;
+}
+
+TEST reads_while_writing_are_consistent(void)
+{
+    pthread_t thread;
+    int reads = 0, n, count;
+
+    memset(&trace, 0, sizeof(trace));
+    ASSERT_EQ(0, pthread_create(&thread, 0, writer, 0));
+    do {
+	count = emcmotTraceRead(&trace, EMCMOT_TRACE_WRITE, events);
+	for (n = 0; n < count; n++) {
+	    ASSERT_EQ(events[n].time * 7 + 3, events[n].id);
+	    if (n > 0) {
+		ASSERT_EQ(events[n - 1].time + 1, events[n].time);
+	    }
+	}
+	reads++;
+    } while (count == 0 || events[count - 1].time < WRITES - 1);
+    pthread_join(thread, 0);
+    printf("%d reads during %d writes\n", reads, WRITES);
+    PASS();
+}
+
+SUITE(mottrace) {
+    RUN_TEST(events_come_back_oldest_first);
+    RUN_TEST(a_full_ring_keeps_the_newest);
+    RUN_TEST(nothing_is_put_while_disabled);
+    RUN_TEST(reads_while_writing_are_consistent);
+}
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(mottrace);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,352 @@
+#include "greatest.h"
+#include "posemath.h"
+#include "rtapi_math.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+/* Expand to all the definitions that need to be in
+   the test runner's main file. */
+GREATEST_MAIN_DEFS();
+
+/* The Cartesian functions are inline in posemath.h.  They are checked
+   against the out-of-line versions posemath used to have, copied here,
+   and the two are timed on the kind of arithmetic a blend does. */
+
+#define NUM_VECS 1024
+#define ROUNDS 20000
+
+static PmCartesian vecs[NUM_VECS];
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double rnd(void)
+{
+    return (double) rand() / RAND_MAX * 200.0 - 100.0;
+}
+
+static void fill_vecs(void)
+{
+    int n;
+
+    srand(1);
+    for (n = 0; n < NUM_VECS; n++) {
+	vecs[n].x = rnd();
+	vecs[n].y = rnd();
+	vecs[n].z = rnd();
+    }
+    /* a zero vector and some very small ones */
+    vecs[0].x = vecs[0].y = vecs[0].z = 0.0;
+    vecs[1].x = 1e-300;
+    vecs[2].y = -1e-160;
+}
+
+__attribute__((noinline))
+static int oldCartCartDot(PmCartesian const * const v1, PmCartesian const * const v2, double *d)
+{
+    *d = v1->x * v2->x + v1->y * v2->y + v1->z * v2->z;
+    return pmErrno = 0;
+}
+
+__attribute__((noinline))
+static int oldCartCartCross(PmCartesian const * const v1, PmCartesian const * const v2,
+        PmCartesian * const vout)
+{
+    if (vout == v1 || vout == v2) {
+        return pmErrno = PM_IMPL_ERR;
+    }
+    vout->x = v1->y * v2->z - v1->z * v2->y;
+    vout->y = v1->z * v2->x - v1->x * v2->z;
+    vout->z = v1->x * v2->y - v1->y * v2->x;
+    return pmErrno = 0;
+}
+
+__attribute__((noinline))
+static int oldCartMag(PmCartesian const * const v, double *d)
+{
+    *d = pmSqrt(pmSq(v->x) + pmSq(v->y) + pmSq(v->z));
+    return pmErrno = 0;
+}
+
+__attribute__((noinline))
+static int oldCartCartDisp(PmCartesian const * const v1, PmCartesian const * const v2,
+        double *d)
+{
+    *d = pmSqrt(pmSq(v2->x - v1->x) + pmSq(v2->y - v1->y) + pmSq(v2->z - v1->z));
+    return pmErrno = 0;
+}
+
+__attribute__((noinline))
+static int oldCartCartSub(PmCartesian const * const v1, PmCartesian const * const v2,
+        PmCartesian * const vout)
+{
+    vout->x = v1->x - v2->x;
+    vout->y = v1->y - v2->y;
+    vout->z = v1->z - v2->z;
+    return pmErrno = 0;
+}
+
+__attribute__((noinline))
+static int oldCartCartAddEq(PmCartesian * const v, PmCartesian const * const v_add)
+{
+    v->x += v_add->x;
+    v->y += v_add->y;
+    v->z += v_add->z;
+    return pmErrno = 0;
+}
+
+__attribute__((noinline))
+static int oldCartScalMultEq(PmCartesian * const v, double d)
+{
+    v->x *= d;
+    v->y *= d;
+    v->z *= d;
+    return pmErrno = 0;
+}
+
+__attribute__((noinline))
+static int oldCartScalMult(PmCartesian const * const v1, double d, PmCartesian * const vout)
+{
+    if (v1 != vout) {
+        *vout = *v1;
+    }
+    return oldCartScalMultEq(vout, d);
+}
+
+__attribute__((noinline))
+static int oldCartUnitEq(PmCartesian * const v)
+{
+    double size = pmSqrt(pmSq(v->x) + pmSq(v->y) + pmSq(v->z));
+
+    if (size == 0.0) {
+        return pmErrno = PM_NORM_ERR;
+    }
+    v->x /= size;
+    v->y /= size;
+    v->z /= size;
+    return pmErrno = 0;
+}
+
+__attribute__((noinline))
+static int oldCartUnit(PmCartesian const * const v, PmCartesian * const vout)
+{
+    if (vout != v) {
+        *vout = *v;
+    }
+    return oldCartUnitEq(vout);
+}
+
+static int same(PmCartesian a, PmCartesian b)
+{
+    return a.x == b.x && a.y == b.y && a.z == b.z;
+}
+
+TEST cart_functions_match_old_ones(void)
+{
+    int n;
+
+    for (n = 0; n < NUM_VECS; n++) {
+	PmCartesian const *a = &vecs[n], *b = &vecs[(n * 7 + 3) % NUM_VECS];
+	PmCartesian r1, r2;
+	double d1, d2;
+	int e1, e2;
+
+	pmCartCartDot(a, b, &d1);
+	oldCartCartDot(a, b, &d2);
+	ASSERT_EQ(d2, d1);
+	pmCartMag(a, &d1);
+	oldCartMag(a, &d2);
+	ASSERT_EQ(d2, d1);
+	pmCartCartDisp(a, b, &d1);
+	oldCartCartDisp(a, b, &d2);
+	ASSERT_EQ(d2, d1);
+
+	pmCartCartCross(a, b, &r1);
+	oldCartCartCross(a, b, &r2);
+	ASSERT(same(r1, r2));
+	pmCartCartSub(a, b, &r1);
+	oldCartCartSub(a, b, &r2);
+	ASSERT(same(r1, r2));
+	pmCartScalMult(a, b->x, &r1);
+	oldCartScalMult(a, b->x, &r2);
+	ASSERT(same(r1, r2));
+
+	e1 = pmCartUnit(a, &r1);
+	e2 = oldCartUnit(a, &r2);
+	ASSERT_EQ(e2, e1);
+	ASSERT(same(r1, r2));
+
+	/* in place */
+	r1 = r2 = *a;
+	pmCartCartAddEq(&r1, b);
+	oldCartCartAddEq(&r2, b);
+	ASSERT(same(r1, r2));
+	pmCartScalMultEq(&r1, 0.25);
+	oldCartScalMultEq(&r2, 0.25);
+	ASSERT(same(r1, r2));
+	e1 = pmCartUnitEq(&r1);
+	e2 = oldCartUnitEq(&r2);
+	ASSERT_EQ(e2, e1);
+	ASSERT(same(r1, r2));
+	pmCartCartSub(&r1, b, &r1);
+	oldCartCartSub(&r2, b, &r2);
+	ASSERT(same(r1, r2));
+    }
+
+    ASSERT_EQ(PM_NORM_ERR, pmCartUnitEq(&vecs[0]));
+    ASSERT_EQ(PM_IMPL_ERR, pmCartCartCross(&vecs[3], &vecs[4], &vecs[3]));
+    PASS();
+}
+
+/* a vector rotated about x, then y, then z, one sin and cos at a time */
+static PmCartesian rotate_rpy(PmRpy const *rpy, PmCartesian v)
+{
+    PmCartesian t;
+
+    t.x = v.x;
+    t.y = cos(rpy->r) * v.y - sin(rpy->r) * v.z;
+    t.z = sin(rpy->r) * v.y + cos(rpy->r) * v.z;
+    v = t;
+    t.x = cos(rpy->p) * v.x + sin(rpy->p) * v.z;
+    t.y = v.y;
+    t.z = -sin(rpy->p) * v.x + cos(rpy->p) * v.z;
+    v = t;
+    t.x = cos(rpy->y) * v.x - sin(rpy->y) * v.y;
+    t.y = sin(rpy->y) * v.x + cos(rpy->y) * v.y;
+    t.z = v.z;
+    return t;
+}
+
+static int close_to(PmCartesian a, PmCartesian b)
+{
+    return fabs(a.x - b.x) < 1e-12 && fabs(a.y - b.y) < 1e-12 &&
+	fabs(a.z - b.z) < 1e-12;
+}
+
+TEST rpy_matrix_matches_single_rotations(void)
+{
+    PmCartesian ex = {1, 0, 0}, ey = {0, 1, 0}, ez = {0, 0, 1};
+    int n;
+
+    for (n = 0; n < 100; n++) {
+	PmRpy rpy;
+	PmRotationMatrix m;
+
+	rpy.r = rnd() * 0.05;
+	rpy.p = rnd() * 0.015;
+	rpy.y = rnd() * 0.05;
+	pmRpyMatConvert(&rpy, &m);
+
+	ASSERT(close_to(rotate_rpy(&rpy, ex), m.x));
+	ASSERT(close_to(rotate_rpy(&rpy, ey), m.y));
+	ASSERT(close_to(rotate_rpy(&rpy, ez), m.z));
+    }
+    PASS();
+}
+
+TEST circle_point_matches_sin_and_cos(void)
+{
+    PmCartesian start = {10, 0, 0}, end = {0, 10, 0};
+    PmCartesian center = {0, 0, 0}, normal = {0, 0, 1};
+    PmCircle circle;
+    int n;
+
+    ASSERT_EQ(0, pmCircleInit(&circle, &start, &end, &center, &normal, 0));
+    for (n = 0; n <= 100; n++) {
+	double angle = circle.angle * n / 100;
+	PmCartesian p;
+
+	pmCirclePoint(&circle, angle, &p);
+	ASSERT_IN_RANGE(10 * cos(angle), p.x, 1e-12);
+	ASSERT_IN_RANGE(10 * sin(angle), p.y, 1e-12);
+	ASSERT_IN_RANGE(0.0, p.z, 1e-12);
+    }
+    PASS();
+}
+
+/* the middle of a blend calculation: unit vectors of two segments, the
+   angle between them and a point along the bisector */
+static double blend_inline(void)
+{
+    double sum = 0;
+    int r, n;
+
+    for (r = 0; r < ROUNDS; r++) {
+	for (n = 1; n < NUM_VECS; n++) {
+	    PmCartesian u1, u2, b;
+	    double dot, len;
+
+	    pmCartCartSub(&vecs[n], &vecs[n - 1], &u1);
+	    pmCartUnitEq(&u1);
+	    pmCartUnit(&vecs[n], &u2);
+	    pmCartCartDot(&u1, &u2, &dot);
+	    pmCartCartSub(&u2, &u1, &b);
+	    pmCartMag(&b, &len);
+	    pmCartScalMultEq(&b, dot);
+	    pmCartCartAddEq(&b, &vecs[n]);
+	    sum += b.x + len;
+	}
+    }
+    return sum;
+}
+
+static double blend_old(void)
+{
+    double sum = 0;
+    int r, n;
+
+    for (r = 0; r < ROUNDS; r++) {
+	for (n = 1; n < NUM_VECS; n++) {
+	    PmCartesian u1, u2, b;
+	    double dot, len;
+
+	    oldCartCartSub(&vecs[n], &vecs[n - 1], &u1);
+	    oldCartUnitEq(&u1);
+	    oldCartUnit(&vecs[n], &u2);
+	    oldCartCartDot(&u1, &u2, &dot);
+	    oldCartCartSub(&u2, &u1, &b);
+	    oldCartMag(&b, &len);
+	    oldCartScalMultEq(&b, dot);
+	    oldCartCartAddEq(&b, &vecs[n]);
+	    sum += b.x + len;
+	}
+    }
+    return sum;
+}
+
+TEST inline_blend_math_timing(void)
+{
+    double t0, t1, t2, s1, s2;
+
+    t0 = now();
+    s1 = blend_old();
+    t1 = now();
+    s2 = blend_inline();
+    t2 = now();
+
+    ASSERT_EQ(s1, s2);
+    printf("blend arithmetic: %.1f ns/step out of line, %.1f ns/step inline\n",
+	(t1 - t0) * 1e9 / ROUNDS / (NUM_VECS - 1),
+	(t2 - t1) * 1e9 / ROUNDS / (NUM_VECS - 1));
+    PASS();
+}
+
+SUITE(posemath) {
+    fill_vecs();
+    RUN_TEST(cart_functions_match_old_ones);
+    RUN_TEST(rpy_matrix_matches_single_rotations);
+    RUN_TEST(circle_point_matches_sin_and_cos);
+    RUN_TEST(inline_blend_math_timing);
+}
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(posemath);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,157 @@
+#define CATCH_CONFIG_MAIN
+#include "catch.hpp"
+
+#include <stdio.h>
+#include <string.h>
+#include <toolstore.hh>
+
+static const char *db_file = "test_toolstore.db";
+
+static void remove_db()
+{
+    remove(db_file);
+    remove("test_toolstore.db-wal");
+    remove("test_toolstore.db-shm");
+}
+
+static CANON_TOOL_TABLE make_tool(int toolno, int pocket)
+{
+    CANON_TOOL_TABLE t;
+
+    memset(&t, 0, sizeof(t));
+    t.toolno = toolno;
+    t.pocketno = pocket;
+    t.diameter = toolno * 0.01;
+    t.offset.tran.z = toolno * 0.1;
+    return t;
+}
+
+TEST_CASE("tools are found by number and by pocket")
+{
+    remove_db();
+    ToolStore store;
+    REQUIRE(store.open(db_file) == 0);
+    REQUIRE(store.put(make_tool(1, 2), "tool1") == 0);
+    REQUIRE(store.put(make_tool(7, 5)) == 0);
+    REQUIRE(store.put(make_tool(9, -1)) == 0);
+
+    CHECK(store.size() == 3);
+    REQUIRE(store.find_tool(7) != NULL);
+    CHECK(store.find_tool(7)->pocketno == 5);
+    CHECK(store.find_tool(7)->offset.tran.z == Approx(0.7));
+    REQUIRE(store.find_pocket(2) != NULL);
+    CHECK(store.find_pocket(2)->toolno == 1);
+    CHECK(store.find_tool(3) == NULL);
+    CHECK(store.find_pocket(3) == NULL);
+    CHECK(strcmp(store.comment(1), "tool1") == 0);
+
+    // a tool not in the magazine has no pocket
+    REQUIRE(store.find_tool(9) != NULL);
+    CHECK(store.find_pocket(-1) == NULL);
+
+    // moving a tool frees its old pocket
+    REQUIRE(store.put(make_tool(7, 6)) == 0);
+    CHECK(store.find_pocket(5) == NULL);
+    CHECK(store.find_pocket(6)->toolno == 7);
+    // and a comment not given is kept
+    CHECK(strcmp(store.comment(1), "tool1") == 0);
+
+    // two tools can't share a pocket
+    CHECK(store.put(make_tool(8, 2)) != 0);
+    CHECK(store.find_tool(8) == NULL);
+    CHECK(store.find_pocket(2)->toolno == 1);
+
+    REQUIRE(store.remove(1) == 0);
+    CHECK(store.find_tool(1) == NULL);
+    CHECK(store.find_pocket(2) == NULL);
+}
+
+TEST_CASE("changes are saved as they are made")
+{
+    remove_db();
+    {
+        ToolStore store;
+        REQUIRE(store.open(db_file) == 0);
+        REQUIRE(store.begin() == 0);
+        for (int n = 1; n <= 5000; n++)
+            REQUIRE(store.put(make_tool(n, n < 100 ? n : -1)) == 0);
+        REQUIRE(store.commit() == 0);
+
+        CANON_TOOL_TABLE t = make_tool(4321, -1);
+        t.offset.tran.z = 12.5;
+        REQUIRE(store.put(t, "long drill") == 0);
+        REQUIRE(store.swap_pockets(0, 17) == 0);
+        REQUIRE(store.set_spindle(17, 0) == 0);
+    }
+
+    ToolStore store;
+    REQUIRE(store.open(db_file) == 0);
+    CHECK(store.size() == 5000);
+    CHECK(store.find_tool(4321)->offset.tran.z == Approx(12.5));
+    CHECK(strcmp(store.comment(4321), "long drill") == 0);
+    CHECK(store.find_pocket(0)->toolno == 17);
+    CHECK(store.find_tool(17)->pocketno == 0);
+    CHECK(store.find_pocket(17) == NULL);
+    CHECK(store.spindle_tool() == 17);
+    CHECK(store.spindle_pocket() == 0);
+}
+
+TEST_CASE("a reader sees what the writer saved")
+{
+    remove_db();
+    ToolStore writer, reader;
+    REQUIRE(writer.open(db_file) == 0);
+    REQUIRE(writer.put(make_tool(1, 1)) == 0);
+    REQUIRE(reader.open(db_file, true) == 0);
+    CHECK(reader.find_pocket(1)->toolno == 1);
+
+    // nothing written, nothing to read again
+    REQUIRE(reader.refresh() == 0);
+    CHECK(reader.find_pocket(1)->toolno == 1);
+
+    REQUIRE(writer.put(make_tool(2, 2)) == 0);
+    REQUIRE(writer.swap_pockets(1, 3) == 0);
+    REQUIRE(reader.refresh() == 0);
+    CHECK(reader.find_pocket(1) == NULL);
+    CHECK(reader.find_pocket(2)->toolno == 2);
+    CHECK(reader.find_pocket(3)->toolno == 1);
+
+    // a read only store can't be changed
+    CHECK(reader.put(make_tool(4, 4)) != 0);
+    CHECK(reader.find_tool(4) == NULL);
+    remove_db();
+}
+
+TEST_CASE("pockets beyond the table take over indices in turn")
+{
+    PocketMap map;
+
+    // at first each index stands for the pocket of the same number
+    CHECK(map.pocket(0) == 0);
+    CHECK(map.pocket(7) == 7);
+    CHECK(map.index(7) == 7);
+    CHECK(map.pocket(CANON_POCKETS_MAX) == -1);
+    CHECK(map.index(CANON_POCKETS_MAX) == -1);
+    CHECK(map.assign(7) == 7);
+    CHECK(map.assign(0) == 0);
+    CHECK(map.assign(-1) == -1);
+
+    // a pocket beyond the table gets an index, and keeps it
+    CHECK(map.assign(1000) == 1);
+    CHECK(map.assign(1000) == 1);
+    CHECK(map.pocket(1) == 1000);
+    CHECK(map.index(1) == -1);
+
+    // indices in use are skipped
+    CHECK(map.assign(1001, 2, 3) == 4);
+    CHECK(map.assign(1002, 5) == 6);
+
+    // and after the last index it starts over, never giving away the
+    // spindle
+    for (int n = 7; n < CANON_POCKETS_MAX; n++)
+        CHECK(map.assign(2000 + n) == n);
+    CHECK(map.assign(3000) == 1);
+    CHECK(map.index(1000) == -1);
+    CHECK(map.assign(3001) == 2);
+    CHECK(map.pocket(0) == 0);
+}
@@ -0,0 +1,313 @@
+#include "greatest.h"
+#include "tp.h"
+#include "tcq.h"
+#include "bezier.h"
+#include "blendmath.h"
+#include "mot_priv.h"
+#include "motion_debug.h"
+#include "motion_types.h"
+#include "rtapi_math.h"
+#include <stdio.h>
+
+/* Expand to all the definitions that need to be in
+   the test runner's main file. */
+GREATEST_MAIN_DEFS();
+
+static const double angles[] = {0.05, 0.3, 0.8, 1.5, 2.2, 2.8, 3.1};
+#define NUM_ANGLES ((int) (sizeof(angles) / sizeof(angles[0])))
+
+/* A corner in no particular orientation, turning by phi */
+static void corner(double phi, PmCartesian *c, PmCartesian *u1, PmCartesian *u2)
+{
+    PmCartesian e1 = {0.6, 0.0, 0.8}, e2 = {0.0, 1.0, 0.0}, a, b;
+
+    c->x = 10.0; c->y = -3.0; c->z = 7.0;
+    *u1 = e1;
+    pmCartScalMult(&e1, cos(phi), &a);
+    pmCartScalMult(&e2, sin(phi), &b);
+    pmCartCartAdd(&a, &b, u2);
+}
+
+static double dist(PmCartesian const *a, PmCartesian const *b)
+{
+    double d;
+    pmCartCartDisp(a, b, &d);
+    return d;
+}
+
+TEST shape_meets_lines(void)
+{
+    int n;
+
+    for (n = 0; n < NUM_ANGLES; n++) {
+        BezierShape shape;
+        BezierBlend bez;
+        PmCartesian c, u1, u2, p, q;
+        double d = 2.0, k, len;
+
+        ASSERT_EQ(TP_ERR_OK, bezierShapeFromAngle(&shape, angles[n]));
+        corner(angles[n], &c, &u1, &u2);
+        ASSERT_EQ(TP_ERR_OK, bezierInitFromLines(&bez, &c, &u1, &u2, d, &shape));
+        bezierLength(&bez, &len);
+
+        /* starts and ends on the lines, d from the corner */
+        bezierPoint(&bez, 0.0, &p);
+        pmCartScalMult(&u1, -d, &q);
+        pmCartCartAddEq(&q, &c);
+        ASSERT_IN_RANGE(0.0, dist(&p, &q), 1e-12);
+        bezierPoint(&bez, len, &p);
+        pmCartScalMult(&u2, d, &q);
+        pmCartCartAddEq(&q, &c);
+        ASSERT_IN_RANGE(0.0, dist(&p, &q), 1e-9);
+
+        /* with no curvature there */
+        bezierCurvature(&bez, 0.0, &k);
+        ASSERT_IN_RANGE(0.0, k, 1e-12);
+        bezierCurvature(&bez, 1.0, &k);
+        ASSERT_IN_RANGE(0.0, k, 1e-12);
+
+        /* passing the corner at the deviation the shape gives */
+        bezierPoint(&bez, len / 2.0, &p);
+        ASSERT_IN_RANGE(shape.deviation * d, dist(&p, &c), 1e-9);
+        ASSERT_IN_RANGE(shape.length * d, len, 1e-9);
+    }
+    PASS();
+}
+
+TEST shape_peak_curvature(void)
+{
+    int n, i;
+
+    for (n = 0; n < NUM_ANGLES; n++) {
+        BezierShape shape;
+        BezierBlend bez;
+        PmCartesian c, u1, u2;
+        double d = 0.5, k, k_max = 0;
+
+        bezierShapeFromAngle(&shape, angles[n]);
+        corner(angles[n], &c, &u1, &u2);
+        bezierInitFromLines(&bez, &c, &u1, &u2, d, &shape);
+        for (i = 0; i <= 10000; i++) {
+            bezierCurvature(&bez, i / 10000.0, &k);
+            if (k > k_max) k_max = k;
+        }
+        ASSERT_IN_RANGE(shape.curvature / d, k_max, 1e-4 * k_max);
+        /* an arc through the same point is the best that can be done,
+           and the blend is never much worse */
+        double r_arc = shape.deviation * cos(angles[n] / 2.0)
+            / (1.0 - cos(angles[n] / 2.0));
+        ASSERT(shape.curvature * r_arc > 0.99);
+        ASSERT(shape.curvature * r_arc < 1.1);
+    }
+    PASS();
+}
+
+/* Equal steps in progress have to be equal steps along the curve, or the
+   planner's velocity would not be the machine's. The chords are a little
+   shorter than the curve, by a few parts per million here. */
+TEST progress_is_arc_length(void)
+{
+    int n, i;
+
+    for (n = 0; n < NUM_ANGLES; n++) {
+        BezierShape shape;
+        BezierBlend bez;
+        PmCartesian c, u1, u2, p, last;
+        double len, step, total = 0;
+        const int steps = 2000;
+
+        bezierShapeFromAngle(&shape, angles[n]);
+        corner(angles[n], &c, &u1, &u2);
+        bezierInitFromLines(&bez, &c, &u1, &u2, 1.0, &shape);
+        bezierLength(&bez, &len);
+        bezierPoint(&bez, 0.0, &last);
+        for (i = 1; i <= steps; i++) {
+            bezierPoint(&bez, len * i / steps, &p);
+            step = dist(&p, &last);
+            ASSERT_IN_RANGE(len / steps, step, 1e-5 * len / steps);
+            total += step;
+            last = p;
+        }
+        ASSERT_IN_RANGE(len, total, 1e-5 * len);
+    }
+    PASS();
+}
+
+TEST consumed_line(void)
+{
+    BezierShape shape;
+    BezierBlend bez;
+    PmCartesian c, u1, u2, p, q;
+
+    bezierShapeFromAngle(&shape, 1.0);
+    corner(1.0, &c, &u1, &u2);
+    bezierInitFromLines(&bez, &c, &u1, &u2, 1.0, &shape);
+    bez.line_length = 0.25;
+
+    /* the first part is what is left of the previous line */
+    bezierPoint(&bez, 0.0, &p);
+    pmCartScalMult(&u1, -1.25, &q);
+    pmCartCartAddEq(&q, &c);
+    ASSERT_IN_RANGE(0.0, dist(&p, &q), 1e-12);
+    bezierPoint(&bez, 0.25, &p);
+    pmCartScalMult(&u1, -1.0, &q);
+    pmCartCartAddEq(&q, &c);
+    ASSERT_IN_RANGE(0.0, dist(&p, &q), 1e-12);
+    PASS();
+}
+
+/* Within the same tolerance and acceleration, the Bezier blend keeps the
+   arc's speed to within a few percent. */
+TEST parameters_match_arc(void)
+{
+    int n;
+
+    for (n = 0; n < NUM_ANGLES; n++) {
+        BlendParameters arc = {0}, bez;
+        BezierShape shape;
+
+        arc.tolerance = 0.01;
+        arc.L1 = arc.L2 = 100.0;
+        arc.a_max = 1000.0;
+        arc.a_n_max = arc.a_max * BLEND_ACC_RATIO_NORMAL;
+        arc.v_goal = arc.v_req = 1000.0;
+        arc.phi = angles[n];
+        arc.theta = (PM_PI - arc.phi) / 2.0;
+        bez = arc;
+
+        bezierShapeFromAngle(&shape, arc.phi);
+        ASSERT_EQ(TP_ERR_OK, blendComputeParameters(&arc));
+        ASSERT_EQ(TP_ERR_OK, blendComputeBezierParameters(&bez, &shape));
+
+        /* the peak normal acceleration and the deviation are in bounds */
+        ASSERT(pmSq(bez.v_plan) * shape.curvature / bez.d_plan
+               <= bez.a_n_max * (1 + 1e-9));
+        ASSERT(bez.d_plan * shape.deviation <= bez.tolerance * (1 + 1e-9));
+        ASSERT(bez.v_plan > 0.95 * arc.v_plan);
+        ASSERT(bez.v_plan < 1.01 * arc.v_plan);
+    }
+    PASS();
+}
+
+/* Run a zig-zag through the planner with the Bezier blend selected. */
+#define CYCLE_TIME 0.001
+#define FEED 200.0
+#define ACCEL 2000.0
+#define TOL 0.05
+#define NUM_CORNERS 20
+
+static TP_STRUCT tp;
+static TC_STRUCT queue_space[DEFAULT_TC_QUEUE_SIZE];
+
+static EmcPose zigzag(int n)
+{
+    EmcPose p;
+
+    ZERO_EMC_POSE(p);
+    p.tran.x = 10.0 * n;
+    p.tran.y = (n % 2) ? 10.0 : 0.0;
+    return p;
+}
+
+/* distance from the zig-zag, which is made of 45 degree lines */
+static double off_path(EmcPose const *p)
+{
+    int n = (int) floor(p->tran.x / 10.0);
+    double y = (n % 2) ? 10.0 - (p->tran.x - 10.0 * n) : p->tran.x - 10.0 * n;
+
+    return fabs(p->tran.y - y) * M_SQRT1_2;
+}
+
+static double run_zigzag(int bezier, int *num_bezier, double *worst_acc,
+                         double *worst_off)
+{
+    EmcPose start = zigzag(0), pos;
+    double vel[2] = {0, 0}, last[2], v, a;
+    int n, i;
+    long cycles = 0;
+
+    emcmotConfig->arcBlendEnable = 1;
+    emcmotConfig->arcBlendOptDepth = 50;
+    emcmotConfig->arcBlendGapCycles = 4;
+    emcmotConfig->arcBlendRampFreq = 100;
+    emcmotConfig->arcBlendTangentKinkRatio = 0.1;
+    emcmotConfig->arcBlendBezier = bezier;
+    emcmotConfig->maxFeedScale = 1.0;
+    emcmotConfig->numSpindles = 1;
+    emcmotStatus->net_feed_scale = 1.0;
+    for (n = 0; n < EMCMOT_MAX_AXIS; n++) {
+        emcmotDebug->axes[n].vel_limit = FEED;
+        emcmotDebug->axes[n].acc_limit = ACCEL;
+    }
+    tpCreate(&tp, DEFAULT_TC_QUEUE_SIZE, queue_space);
+    tpSetCycleTime(&tp, CYCLE_TIME);
+    tpSetVmax(&tp, FEED, FEED);
+    tpSetVlimit(&tp, FEED);
+    tpSetAmax(&tp, ACCEL);
+    tpSetPos(&tp, &start);
+    tpSetTermCond(&tp, TC_TERM_COND_PARABOLIC, TOL);
+
+    for (n = 1; n <= NUM_CORNERS + 1; n++) {
+        tpSetId(&tp, n);
+        tpAddLine(&tp, zigzag(n), EMC_MOTION_TYPE_FEED, FEED, FEED, ACCEL,
+                  FS_ENABLED, 0, -1);
+    }
+    *num_bezier = 0;
+    for (i = 0; i < tcqLen(&tp.queue); i++) {
+        if (tcqItem(&tp.queue, i)->motion_type == TC_BEZIER) (*num_bezier)++;
+    }
+
+    *worst_acc = *worst_off = 0;
+    last[0] = start.tran.x;
+    last[1] = start.tran.y;
+    while (!tpIsDone(&tp) && cycles < 100000) {
+        tpRunCycle(&tp, CYCLE_TIME * 1e9);
+        tpGetPos(&tp, &pos);
+        cycles++;
+        for (i = 0; i < 2; i++) {
+            v = ((i ? pos.tran.y : pos.tran.x) - last[i]) / CYCLE_TIME;
+            a = (v - vel[i]) / CYCLE_TIME;
+            if (cycles > 1 && fabs(a) > *worst_acc) *worst_acc = fabs(a);
+            vel[i] = v;
+        }
+        last[0] = pos.tran.x;
+        last[1] = pos.tran.y;
+        if (off_path(&pos) > *worst_off) *worst_off = off_path(&pos);
+    }
+    return cycles * CYCLE_TIME;
+}
+
+TEST planner_zigzag(void)
+{
+    int num_arc, num_bezier;
+    double acc, off, t_arc, t_bezier;
+
+    t_arc = run_zigzag(0, &num_arc, &acc, &off);
+    ASSERT(tpIsDone(&tp));
+    ASSERT_EQ(0, num_arc);
+
+    t_bezier = run_zigzag(1, &num_bezier, &acc, &off);
+    ASSERT(tpIsDone(&tp));
+    ASSERT(num_bezier > 0);
+    ASSERT(acc <= ACCEL * (1 + 1e-6));
+    ASSERT(off <= TOL * (1 + 1e-6));
+    printf("zig-zag: %.3f s with blend arcs, %.3f s with Bezier blends\n",
+           t_arc, t_bezier);
+    ASSERT(t_bezier < 1.05 * t_arc);
+    PASS();
+}
+
+SUITE(bezier_suite) {
+    RUN_TEST(shape_meets_lines);
+    RUN_TEST(shape_peak_curvature);
+    RUN_TEST(progress_is_arc_length);
+    RUN_TEST(consumed_line);
+    RUN_TEST(parameters_match_arc);
+    RUN_TEST(planner_zigzag);
+}
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(bezier_suite);
+    GREATEST_MAIN_END();
+}
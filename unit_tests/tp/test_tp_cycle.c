@@ -0,0 +1,220 @@
+#include "greatest.h"
+#include "tp.h"
+#include "tcq.h"
+#include "mot_priv.h"
+#include "motion_debug.h"
+#include "motion_types.h"
+#include "rtapi_math.h"
+#include <stdio.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#endif
+
+/* Expand to all the definitions that need to be in
+   the test runner's main file. */
+GREATEST_MAIN_DEFS();
+
+/* The planner is run the way motmod runs it: segments are added while
+   the queue has room, and tpRunCycle() is called once per period. The
+   path is the kind CAM output is made of, a circle cut into short
+   tangent lines, so the optimizer walks back over many queued segments
+   for each one added. */
+
+#define CYCLE_TIME 0.001
+#define RADIUS 50.0
+#define SEG_LEN 0.5
+#define NUM_SEGS 10000
+#define FEED 100.0
+#define ACCEL 1000.0
+#define QUEUE_SIZE DEFAULT_TC_QUEUE_SIZE
+
+static TP_STRUCT tp;
+static TC_STRUCT queue_space[QUEUE_SIZE];
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static EmcPose point(int n)
+{
+    EmcPose p;
+    double a = n * SEG_LEN / RADIUS;
+
+    ZERO_EMC_POSE(p);
+    p.tran.x = RADIUS * cos(a) - RADIUS;
+    p.tran.y = RADIUS * sin(a);
+    /* climb a little, so laps don't repeat */
+    p.tran.z = n * 1e-4;
+    return p;
+}
+
+static void setup(int opt_depth)
+{
+    EmcPose start = point(0);
+    int n;
+
+    emcmotConfig->arcBlendEnable = 1;
+    emcmotConfig->arcBlendOptDepth = opt_depth;
+    emcmotConfig->arcBlendGapCycles = 4;
+    emcmotConfig->arcBlendRampFreq = 100;
+    emcmotConfig->arcBlendTangentKinkRatio = 0.1;
+    emcmotConfig->maxFeedScale = 1.0;
+    emcmotConfig->numSpindles = 1;
+    emcmotStatus->net_feed_scale = 1.0;
+    for (n = 0; n < EMCMOT_MAX_AXIS; n++) {
+        emcmotDebug->axes[n].vel_limit = 1000.0;
+        emcmotDebug->axes[n].acc_limit = 10000.0;
+    }
+
+    tpCreate(&tp, QUEUE_SIZE, queue_space);
+    tpSetCycleTime(&tp, CYCLE_TIME);
+    tpSetVmax(&tp, FEED, FEED);
+    tpSetVlimit(&tp, FEED);
+    tpSetAmax(&tp, ACCEL);
+    tpSetPos(&tp, &start);
+    tpSetTermCond(&tp, TC_TERM_COND_PARABOLIC, 0.01);
+}
+
+/* In motmod the planner runs once a servo period, and whatever runs in
+   between leaves little of the queue in the cache. To time that case,
+   the entries a cycle or an add may look at, the first few and the
+   last ones, are flushed before a cycle. Flushing takes far longer than
+   the cycle, so only every COLD_EVERY-th cycle is flushed and timed. */
+#define EVICT_FRONT 4
+#define EVICT_BACK 64
+#define COLD_EVERY 10
+
+static void evict(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    int len = tcqLen(&tp.queue), n;
+    size_t off;
+
+    for (n = 0; n < len; n++) {
+        char *tc;
+        if (n == EVICT_FRONT && len - EVICT_BACK > n) {
+            n = len - EVICT_BACK;
+        }
+        tc = (char *) tcqItem(&tp.queue, n);
+        for (off = 0; off < sizeof(TC_STRUCT); off += 64) {
+            _mm_clflush(tc + off);
+        }
+    }
+    _mm_mfence();
+#endif
+}
+
+typedef struct {
+    long cycles;
+    long timed_cycles, timed_adds;
+    double t_add, t_cycle;
+    double max_step;
+    EmcPose end;
+} run_t;
+
+/* Runs the whole path, timing the adds and the cycles apart. */
+static void run(int opt_depth, int cold, run_t *r)
+{
+    EmcPose pos, last;
+    int next = 1, first, timed;
+    double t0, step;
+
+    setup(opt_depth);
+    r->cycles = r->timed_cycles = r->timed_adds = 0;
+    r->t_add = r->t_cycle = r->max_step = 0;
+    tpGetPos(&tp, &last);
+    while (next <= NUM_SEGS || !tpIsDone(&tp)) {
+        timed = !cold || r->cycles % COLD_EVERY == 0;
+        if (cold && timed) evict();
+        first = next;
+        t0 = now();
+        while (next <= NUM_SEGS && !tcqFull(&tp.queue)) {
+            tpSetId(&tp, next);
+            tpAddLine(&tp, point(next), EMC_MOTION_TYPE_FEED, FEED, FEED,
+                      ACCEL, FS_ENABLED, 0, -1);
+            next++;
+        }
+        if (timed) {
+            r->t_add += now() - t0;
+            r->timed_adds += next - first;
+        }
+
+        t0 = now();
+        tpRunCycle(&tp, CYCLE_TIME * 1e9);
+        if (timed) {
+            r->t_cycle += now() - t0;
+            r->timed_cycles++;
+        }
+        r->cycles++;
+
+        tpGetPos(&tp, &pos);
+        step = pmSqrt(pmSq(pos.tran.x - last.tran.x)
+                      + pmSq(pos.tran.y - last.tran.y)
+                      + pmSq(pos.tran.z - last.tran.z));
+        if (step > r->max_step) r->max_step = step;
+        last = pos;
+        if (r->cycles > 10 * (long) (NUM_SEGS * SEG_LEN / FEED / CYCLE_TIME)) {
+            break;
+        }
+    }
+    r->end = last;
+}
+
+TEST follows_path(void)
+{
+    run_t r;
+    EmcPose end = point(NUM_SEGS);
+
+    run(50, 0, &r);
+    ASSERT(tpIsDone(&tp));
+    ASSERT_IN_RANGE(end.tran.x, r.end.tran.x, 1e-6);
+    ASSERT_IN_RANGE(end.tran.y, r.end.tran.y, 1e-6);
+    ASSERT_IN_RANGE(end.tran.z, r.end.tran.z, 1e-6);
+    /* never faster than the feed */
+    ASSERT(r.max_step <= FEED * CYCLE_TIME * (1 + 1e-6));
+    /* and blended, not stopping at every segment */
+    ASSERT(r.cycles < 1.2 * NUM_SEGS * SEG_LEN / FEED / CYCLE_TIME);
+    PASS();
+}
+
+static void bench(int opt_depth, int cold)
+{
+    run_t r;
+
+    run(opt_depth, cold, &r);
+    printf("%s cache, optimization depth %d: %ld cycles, %.0f ns/cycle,"
+           " %.0f ns/segment added\n", cold ? "cold" : "warm",
+           opt_depth, r.cycles, r.t_cycle / r.timed_cycles * 1e9,
+           r.timed_adds ? r.t_add / r.timed_adds * 1e9 : 0);
+}
+
+TEST bench_warm(void)
+{
+    bench(50, 0);
+    bench(500, 0);
+    PASS();
+}
+
+TEST bench_cold(void)
+{
+    bench(50, 1);
+    bench(500, 1);
+    PASS();
+}
+
+SUITE(tp_cycle_suite) {
+    RUN_TEST(follows_path);
+    RUN_TEST(bench_warm);
+    RUN_TEST(bench_cold);
+}
+
+int main(int argc, char **argv) {
+    GREATEST_MAIN_BEGIN();
+    RUN_SUITE(tp_cycle_suite);
+    GREATEST_MAIN_END();
+}
@@ -0,0 +1,369 @@
+/* tp_replay: runs the trajectory planner on the moves of a canon log
+   the way motmod would, and reports how long the cycles took and how
+   well the machine limits were kept.
+
+   The log is what the standalone interpreter prints:
+
+       rs274 -g program.ngc > program.canon
+       tp_replay program.canon
+
+   Only the moves and the settings that shape them are replayed, in
+   program coordinates; offsets, tool changes and spindle commands are
+   skipped. Lengths are converted to mm, so the limits given on the
+   command line are in mm/s and mm/s^2 for every axis. */
+
+#include "tp.h"
+#include "tcq.h"
+#include "mot_priv.h"
+#include "motion_debug.h"
+#include "motion_types.h"
+#include "rtapi_math.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+static TP_STRUCT tp;
+static TC_STRUCT queue_space[DEFAULT_TC_QUEUE_SIZE];
+
+static double cycle_time = 0.001;
+static double max_vel = 100.0;
+static double max_acc = 1000.0;
+static int opt_depth = 50;
+static int bezier = 0;
+
+/* what the log has set so far */
+static struct {
+    double scale;		/* mm per program unit */
+    double feed;		/* mm/s */
+    int plane;			/* 0 XY, 1 YZ, 2 XZ */
+    EmcPose pos;
+    int lineno;
+} canon = {1.0, 0.0, 0, {{0, 0, 0}, 0, 0, 0, 0, 0, 0}, 0};
+
+static int moves, skipped, failed;
+static double programmed_time;
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void usage(void)
+{
+    fprintf(stderr,
+        "Usage: tp_replay [-c cycle-time] [-v max-vel] [-a max-acc]"
+        " [-d opt-depth] [-b] canon-log\n"
+        "  -c  planner period in seconds (%g)\n"
+        "  -v  velocity limit of each axis in mm/s (%g)\n"
+        "  -a  acceleration limit of each axis in mm/s^2 (%g)\n"
+        "  -d  arc blend optimization depth (%d)\n"
+        "  -b  blend corners between lines with Bezier curves\n",
+        cycle_time, max_vel, max_acc, opt_depth);
+    exit(2);
+}
+
+static void setup(void)
+{
+    int n;
+
+    emcmotConfig->arcBlendEnable = 1;
+    emcmotConfig->arcBlendOptDepth = opt_depth;
+    emcmotConfig->arcBlendGapCycles = 4;
+    emcmotConfig->arcBlendRampFreq = 100;
+    emcmotConfig->arcBlendTangentKinkRatio = 0.1;
+    emcmotConfig->arcBlendBezier = bezier;
+    emcmotConfig->maxFeedScale = 1.0;
+    emcmotConfig->numSpindles = 1;
+    emcmotStatus->net_feed_scale = 1.0;
+    for (n = 0; n < EMCMOT_MAX_AXIS; n++) {
+        emcmotDebug->axes[n].vel_limit = max_vel;
+        emcmotDebug->axes[n].acc_limit = max_acc;
+    }
+
+    tpCreate(&tp, DEFAULT_TC_QUEUE_SIZE, queue_space);
+    tpSetCycleTime(&tp, cycle_time);
+    tpSetVmax(&tp, max_vel, max_vel);
+    tpSetVlimit(&tp, max_vel);
+    tpSetAmax(&tp, max_acc);
+    tpSetPos(&tp, &canon.pos);
+    /* G64 with no tolerance, as the interpreter starts */
+    tpSetTermCond(&tp, TC_TERM_COND_PARABOLIC, 0);
+}
+
+static int args(const char *s, double *v, int max)
+{
+    char *end;
+    int n = 0;
+
+    while (n < max) {
+        v[n] = strtod(s, &end);
+        if (end == s) break;
+        n++;
+        s = end;
+        while (*s == ' ' || *s == ',') s++;
+    }
+    return n;
+}
+
+static void pose(EmcPose *p, double x, double y, double z,
+                 double a, double b, double c)
+{
+    EmcPose q;
+
+    ZERO_EMC_POSE(q);
+    q.tran.x = x * canon.scale;
+    q.tran.y = y * canon.scale;
+    q.tran.z = z * canon.scale;
+    q.a = a;
+    q.b = b;
+    q.c = c;
+    *p = q;
+}
+
+static void added(int res)
+{
+    TC_STRUCT *tc;
+
+    moves++;
+    if (res < 0) {
+        fprintf(stderr, "tp_replay: line %d: move not accepted (%d)\n",
+                canon.lineno, res);
+        failed++;
+        return;
+    }
+    /* how long it would take at the programmed feed */
+    tc = tcqLast(&tp.queue);
+    if (tc && tc->canon_motion_type != EMC_MOTION_TYPE_TRAVERSE
+        && tc->reqvel > 0) {
+        programmed_time += tc->target / tc->reqvel;
+    }
+}
+
+static void arc(const double *v)
+{
+    EmcPose end;
+    PmCartesian center, normal = {0, 0, 0}, r;
+    int rotation = (int) v[4];
+    double along, radius, vel;
+
+    switch (canon.plane) {
+    case 1:
+        pose(&end, v[5], v[0], v[1], v[6], v[7], v[8]);
+        center.x = v[5]; center.y = v[2]; center.z = v[3];
+        normal.x = 1;
+        break;
+    case 2:
+        pose(&end, v[1], v[5], v[0], v[6], v[7], v[8]);
+        center.x = v[3]; center.y = v[5]; center.z = v[2];
+        normal.y = 1;
+        break;
+    default:
+        pose(&end, v[0], v[1], v[5], v[6], v[7], v[8]);
+        center.x = v[2]; center.y = v[3]; center.z = v[5];
+        normal.z = 1;
+        break;
+    }
+    pmCartScalMult(&center, canon.scale, &center);
+    if (canon.feed <= 0) {
+        /* emccanon drops feed moves it has no speed for */
+        skipped++;
+        canon.pos = end;
+        return;
+    }
+
+    /* like emccanon, keep the centripetal acceleration to a part of
+       the limit so there is some left along the path */
+    pmCartCartSub(&end.tran, &center, &r);
+    pmCartCartDot(&r, &normal, &along);
+    radius = sqrt(fmax(pmSq(r.x) + pmSq(r.y) + pmSq(r.z) - pmSq(along), 0));
+    vel = fmin(max_vel, sqrt(max_acc * sqrt(3.0) / 2.0 * radius));
+    if (rotation == 0) {
+        added(tpAddLine(&tp, end, EMC_MOTION_TYPE_ARC, fmin(canon.feed, vel),
+                        vel, max_acc, FS_ENABLED, 0, -1));
+    } else {
+        added(tpAddCircle(&tp, end, center, normal,
+                          rotation > 0 ? rotation - 1 : rotation,
+                          EMC_MOTION_TYPE_ARC, fmin(canon.feed, vel), vel,
+                          max_acc, FS_ENABLED, 0));
+    }
+    canon.pos = end;
+}
+
+/* Reads the log up to the next move and queues it. Settings are
+   applied as they are met, so they take effect for the moves after
+   them, as they do when task sends them. Returns 0 at the end. */
+static int next_move(FILE *f)
+{
+    char line[1024], name[64];
+    double v[9];
+    EmcPose end;
+    char *s, *p;
+
+    while (fgets(line, sizeof(line), f)) {
+        canon.lineno++;
+        /* "  123 N..... NAME(args)", the count and N word optional */
+        p = strchr(line, '(');
+        if (!p) continue;
+        *p++ = 0;
+        s = strrchr(line, ' ');
+        s = s ? s + 1 : line;
+        snprintf(name, sizeof(name), "%.63s", s);
+
+        if (!strcmp(name, "STRAIGHT_TRAVERSE") || !strcmp(name, "STRAIGHT_FEED")) {
+            int traverse = name[9] == 'T';
+            if (args(p, v, 6) < 6) goto bad;
+            pose(&end, v[0], v[1], v[2], v[3], v[4], v[5]);
+            if (!traverse && canon.feed <= 0) {
+                skipped++;
+            } else if (traverse) {
+                added(tpAddLine(&tp, end, EMC_MOTION_TYPE_TRAVERSE, max_vel,
+                                max_vel, max_acc, FS_ENABLED, 0, -1));
+            } else {
+                added(tpAddLine(&tp, end, EMC_MOTION_TYPE_FEED,
+                                fmin(canon.feed, max_vel), max_vel, max_acc,
+                                FS_ENABLED, 0, -1));
+            }
+            canon.pos = end;
+            return 1;
+        } else if (!strcmp(name, "ARC_FEED")) {
+            if (args(p, v, 9) < 9) goto bad;
+            arc(v);
+            return 1;
+        } else if (!strcmp(name, "SET_FEED_RATE")) {
+            if (args(p, v, 1) < 1) goto bad;
+            canon.feed = v[0] * canon.scale / 60.0;
+        } else if (!strcmp(name, "USE_LENGTH_UNITS")) {
+            if (strstr(p, "INCHES")) canon.scale = 25.4;
+            else if (strstr(p, "CM")) canon.scale = 10.0;
+            else canon.scale = 1.0;
+        } else if (!strcmp(name, "SELECT_PLANE")) {
+            canon.plane = strstr(p, "_YZ") ? 1 : strstr(p, "_XZ") ? 2 : 0;
+        } else if (!strcmp(name, "SET_MOTION_CONTROL_MODE")) {
+            if (strstr(p, "EXACT_STOP")) {
+                tpSetTermCond(&tp, TC_TERM_COND_STOP, 0);
+            } else if (strstr(p, "EXACT_PATH")) {
+                tpSetTermCond(&tp, TC_TERM_COND_EXACT, 0);
+            } else if ((s = strchr(p, ',')) && args(s + 1, v, 1) == 1) {
+                tpSetTermCond(&tp, TC_TERM_COND_PARABOLIC, v[0] * canon.scale);
+            }
+        }
+        continue;
+    bad:
+        fprintf(stderr, "tp_replay: line %d: can't read %s\n",
+                canon.lineno, name);
+        failed++;
+    }
+    return 0;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+    double x = *(const double *) a, y = *(const double *) b;
+
+    return x < y ? -1 : x > y;
+}
+
+int main(int argc, char **argv)
+{
+    FILE *f;
+    double *times = NULL;
+    long cycles = 0, size = 0, still = 0;
+    double t0, t, d, feed_dist = 0, feed_time = 0;
+    double vel[3] = {0, 0, 0}, worst_vel = 0, worst_acc = 0;
+    long over_vel = 0, over_acc = 0;
+    EmcPose pos, last;
+    int c, more, i;
+
+    while ((c = getopt(argc, argv, "c:v:a:d:b")) != -1) {
+        switch (c) {
+        case 'c': cycle_time = atof(optarg); break;
+        case 'v': max_vel = atof(optarg); break;
+        case 'a': max_acc = atof(optarg); break;
+        case 'd': opt_depth = atoi(optarg); break;
+        case 'b': bezier = 1; break;
+        default: usage();
+        }
+    }
+    if (optind != argc - 1 || cycle_time <= 0 || max_vel <= 0 || max_acc <= 0) {
+        usage();
+    }
+    f = fopen(argv[optind], "r");
+    if (!f) {
+        perror(argv[optind]);
+        return 2;
+    }
+
+    setup();
+    last = canon.pos;
+    more = 1;
+    while (more || !tpIsDone(&tp)) {
+        while (more && !tcqFull(&tp.queue)) {
+            more = next_move(f);
+        }
+
+        t0 = now();
+        tpRunCycle(&tp, cycle_time * 1e9);
+        t = now() - t0;
+
+        if (cycles == size) {
+            size = size ? 2 * size : 65536;
+            times = realloc(times, size * sizeof(*times));
+            if (!times) {
+                perror("tp_replay");
+                return 2;
+            }
+        }
+        times[cycles++] = t;
+
+        tpGetPos(&tp, &pos);
+        for (i = 0; i < 3; i++) {
+            double v = ((&pos.tran.x)[i] - (&last.tran.x)[i]) / cycle_time;
+            double a = (v - vel[i]) / cycle_time;
+            vel[i] = v;
+            if (fabs(v) > worst_vel) worst_vel = fabs(v);
+            if (fabs(a) > worst_acc) worst_acc = fabs(a);
+            if (fabs(v) > max_vel * (1 + 1e-6)) over_vel++;
+            if (fabs(a) > max_acc * (1 + 1e-6)) over_acc++;
+        }
+        pmCartCartDisp(&pos.tran, &last.tran, &d);
+        if (tpGetMotionType(&tp) != EMC_MOTION_TYPE_TRAVERSE && d > 0) {
+            feed_dist += d;
+            feed_time += cycle_time;
+        }
+        last = pos;
+        /* a planner that has stopped moving would never be done */
+        still = d > 0 ? 0 : still + 1;
+        if (still * cycle_time > 60) {
+            fprintf(stderr, "tp_replay: planner stuck at cycle %ld\n", cycles);
+            failed++;
+            break;
+        }
+    }
+    fclose(f);
+
+    printf("%s: %d moves, %d without a feed skipped, %ld cycles, %.3f s\n",
+           argv[optind], moves, skipped, cycles, cycles * cycle_time);
+    qsort(times, cycles, sizeof(*times), cmp_double);
+    printf("cycle time: median %.0f ns, 90%% %.0f ns, 99%% %.0f ns,"
+           " 99.9%% %.0f ns, max %.0f ns\n",
+           times[cycles / 2] * 1e9, times[cycles * 9 / 10] * 1e9,
+           times[cycles * 99 / 100] * 1e9, times[cycles * 999 / 1000] * 1e9,
+           times[cycles - 1] * 1e9);
+    if (feed_time > 0) {
+        printf("feed: %.1f mm/min while cutting, %.1f%% of the programmed"
+               " feed (%.3f s against %.3f s)\n",
+               feed_dist / feed_time * 60, programmed_time / feed_time * 100,
+               feed_time, programmed_time);
+    }
+    printf("limits: velocity over in %ld axis cycles (worst %.1f%%),"
+           " acceleration over in %ld (worst %.1f%%)\n",
+           over_vel, worst_vel / max_vel * 100,
+           over_acc, worst_acc / max_acc * 100);
+    free(times);
+    return failed || over_vel || over_acc ? 1 : 0;
+}
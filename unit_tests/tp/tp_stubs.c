@@ -0,0 +1,20 @@
+/* What tp.c expects from the rest of motmod, for running the planner
+   in user space. The motion structs start out zeroed; the caller fills
+   in the configuration it needs. */
+
+#include "mot_priv.h"
+#include "motion_debug.h"
+#include "motion_types.h"
+
+static struct emcmot_status_t status;
+static struct emcmot_config_t config;
+static struct emcmot_debug_t debug;
+emcmot_status_t *emcmotStatus = &status;
+emcmot_config_t *emcmotConfig = &config;
+emcmot_debug_t *emcmotDebug = &debug;
+
+void emcmotDioWrite(int index, char value) { }
+void emcmotAioWrite(int index, double value) { }
+void emcmotSetRotaryUnlock(int axis, int unlock) { }
+int emcmotGetRotaryIsUnlocked(int axis) { return 1; }
+void rtapi_print_msg(msg_level_t level, const char *fmt, ...) { }